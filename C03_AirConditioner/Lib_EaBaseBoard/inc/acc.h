@@ -27,7 +27,7 @@ typedef enum
 
 void acc_init (void);
 
-void acc_read (int8_t *x, int8_t *y, int8_t *z);
+uint32_t acc_read (int8_t *x, int8_t *y, int8_t *z);
 void acc_setRange(acc_range_t range);
 void acc_setMode(acc_mode_t mode);
 
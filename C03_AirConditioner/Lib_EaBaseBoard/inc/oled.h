@@ -11,6 +11,9 @@
 #define OLED_DISPLAY_WIDTH  96
 #define OLED_DISPLAY_HEIGHT 64
 
+/* GPDMA channel used by oled_initDma(), 0 has the highest priority */
+#define OLED_DMA_CH 0
+
 
 typedef enum
 {
@@ -20,6 +23,9 @@ typedef enum
 
 
 void oled_init (void);
+void oled_initDma(oled_color_t color);
+uint8_t oled_isDmaBusy(void);
+void oled_dmaIrq(void);
 void oled_putPixel(uint8_t x, uint8_t y, oled_color_t color);
 void oled_line(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, oled_color_t color);
 void oled_circle(uint8_t x0, uint8_t y0, uint8_t r, oled_color_t color);
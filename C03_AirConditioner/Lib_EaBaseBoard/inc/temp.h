@@ -8,6 +8,8 @@
 #ifndef __TEMP_H
 #define __TEMP_H
 
+/* returned by temp_read when the sensor does not respond */
+#define TEMP_READ_ERROR ((int32_t)0x80000000)
 
 void temp_init (uint32_t (*getMsTick)(void));
 int32_t temp_read(void);
@@ -20,7 +20,7 @@ typedef enum {
 
 void uart2_init (uint32_t baudRate, uart2_channel_t chan);
 void uart2_setBaudRate(uint32_t baudRate);
-void uart2_send(uint8_t *buffer, uint32_t length);
+uint32_t uart2_send(uint8_t *buffer, uint32_t length);
 void uart2_sendString(uint8_t *string);
 uint32_t uart2_receive(uint8_t *buffer, uint32_t length, uint32_t blocking);
 uint8_t uart2_getModemStatus(void);
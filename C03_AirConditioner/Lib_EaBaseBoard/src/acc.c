@@ -64,6 +64,12 @@
 #define ACC_STATUS_DOVR 0x02
 #define ACC_STATUS_PERR 0x04
 
+/*
+ * Status reads before acc_read gives up waiting for DRDY. A read takes
+ * about 0.3 ms at 100 kHz and new data comes at 125 Hz.
+ */
+#define ACC_DRDY_POLLS  100
+
 
 /******************************************************************************
  * External global variables
@@ -115,12 +121,28 @@ static uint8_t getStatus(void)
     uint8_t buf[1];
 
     buf[0] = ACC_ADDR_STATUS;
-    I2CWrite(ACC_I2C_ADDR, buf, 1);
-    I2CRead(ACC_I2C_ADDR, buf, 1);
+    if (I2CWrite(ACC_I2C_ADDR, buf, 1) != 0
+            || I2CRead(ACC_I2C_ADDR, buf, 1) != 0) {
+        return 0;
+    }
 
     return buf[0];
 }
 
+static int readAxis(uint8_t reg, int8_t *value)
+{
+    uint8_t buf[1];
+
+    buf[0] = reg;
+    if (I2CWrite(ACC_I2C_ADDR, buf, 1) != 0
+            || I2CRead(ACC_I2C_ADDR, buf, 1) != 0) {
+        return (-1);
+    }
+
+    *value = (int8_t)buf[0];
+    return (0);
+}
+
 static uint8_t getModeControl(void)
 {
     uint8_t buf[1];
@@ -175,35 +197,38 @@ void acc_init (void)
  *   [out] y - read y value
  *   [out] z - read z value
  *
+ * Returns:
+ *   TRUE if the values were read, FALSE if the device did not become
+ *   ready or did not answer. The values are then unchanged.
+ *
  *****************************************************************************/
-void acc_read (int8_t *x, int8_t *y, int8_t *z)
+uint32_t acc_read (int8_t *x, int8_t *y, int8_t *z)
 {
-    uint8_t buf[1];
+    int8_t vx = 0, vy = 0, vz = 0;
+    int i = 0;
 
     /* wait for ready flag */
-    while ((getStatus() & ACC_STATUS_DRDY) == 0);
+    while ((getStatus() & ACC_STATUS_DRDY) == 0) {
+        if (++i >= ACC_DRDY_POLLS) {
+            return FALSE;
+        }
+    }
 
     /*
      * Have experienced problems reading all registers
      * at once. Change to reading them one-by-one.
      */
-    buf[0] = ACC_ADDR_XOUT8;
-    I2CWrite(ACC_I2C_ADDR, buf, 1);
-    I2CRead(ACC_I2C_ADDR, buf, 1);
-
-    *x = (int8_t)buf[0];
+    if (readAxis(ACC_ADDR_XOUT8, &vx) != 0
+            || readAxis(ACC_ADDR_YOUT8, &vy) != 0
+            || readAxis(ACC_ADDR_ZOUT8, &vz) != 0) {
+        return FALSE;
+    }
 
-    buf[0] = ACC_ADDR_YOUT8;
-    I2CWrite(ACC_I2C_ADDR, buf, 1);
-    I2CRead(ACC_I2C_ADDR, buf, 1);
-
-    *y = (int8_t)buf[0];
-
-    buf[0] = ACC_ADDR_ZOUT8;
-    I2CWrite(ACC_I2C_ADDR, buf, 1);
-    I2CRead(ACC_I2C_ADDR, buf, 1);
+    *x = vx;
+    *y = vy;
+    *z = vz;
 
-    *z = (int8_t)buf[0];
+    return TRUE;
 }
 
 /******************************************************************************
@@ -16,6 +16,7 @@
  *****************************************************************************/
 
 #include "lpc17xx_i2c.h"
+#include "lpc17xx_stats.h"
 #include "string.h"
 #include "stdio.h"
 #include "eeprom.h"
@@ -186,6 +187,7 @@ int16_t eeprom_write(uint8_t* buf, uint16_t offset, uint16_t len)
 
         /* delay to wait for a write cycle */
         eepromDelay();
+        STATS_INC(eeprom_writes);
 
         len     -= wLen;
         written += wLen;
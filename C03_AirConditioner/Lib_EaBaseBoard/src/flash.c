@@ -18,6 +18,8 @@
 
 #include "lpc17xx_gpio.h"
 #include "lpc17xx_ssp.h"
+#include "lpc17xx_trace.h"
+#include "lpc17xx_stats.h"
 #include "flash.h"
 
 /******************************************************************************
@@ -54,6 +56,12 @@
 #define STATUS_PROTECT  (1 << 1)
 #define STATUS_POW2     (1 << 0)
 
+/*
+ * Status polls before a busy device is given up on. With the delay
+ * between polls this is about 300 ms; a page program takes at most 40 ms.
+ */
+#define BUSY_POLLS      1000
+
 
 
 #define FLAG_IS_POW2 0x01
@@ -154,18 +162,26 @@ static uint8_t readStatus(void)
 }
 
 
-static void pollIsBusy(void)
+static uint32_t pollIsBusy(void)
 {
   uint8_t status = 0;
   int i = 0;
+  int polls = 0;
 
   do
   {
+    if (polls++ >= BUSY_POLLS) {
+      return FALSE;
+    }
+
     for (i = 0; i < 0x2000; i++);
 
     status = readStatus();
+    STATS_INC(flash_busy_polls);
   }
   while ((status & STATUS_RDY) == 0);
+
+  return TRUE;
 }
 
 static void setAddressBytes(uint8_t* addr, uint32_t offset)
@@ -219,9 +235,10 @@ uint32_t flash_init (void)
     exitDeepPowerDown();
     readDeviceId(deviceId);
 
-    do {
-        status = readStatus();
-    } while ((status & STATUS_RDY) == 0);
+    if (!pollIsBusy()) {
+        return FALSE;
+    }
+    status = readStatus();
 
     if ((status & STATUS_POW2) != 0)
     {
@@ -259,7 +276,7 @@ uint32_t flash_init (void)
  *   [in] len - number of bytes to write
  *
  * Returns:
- *   number of written bytes
+ *   number of written bytes, less than len if the device stayed busy
  *
  *****************************************************************************/
 uint32_t flash_write(uint8_t* buf, uint32_t offset, uint32_t len)
@@ -281,6 +298,7 @@ uint32_t flash_write(uint8_t* buf, uint32_t offset, uint32_t len)
             - (offset%pageSize));
     wLen = MIN(wLen, len);
 
+    TRACE_DRV_BEGIN(TRACE_DRV_FLASH_WRITE);
     while (len) {
 
         /* write address */
@@ -299,13 +317,16 @@ uint32_t flash_write(uint8_t* buf, uint32_t offset, uint32_t len)
         /* delay to wait for a write cycle */
         //eepromDelay();
 
+        if (!pollIsBusy()) {
+            break;
+        }
+
         len     -= wLen;
         written += wLen;
         offset  += wLen;
         wLen = MIN(pageSize, len);
-
-        pollIsBusy();
     }
+    TRACE_DRV_END(TRACE_DRV_FLASH_WRITE);
 
     return written;
 }
@@ -16,6 +16,7 @@
  *****************************************************************************/
 
 #include "lpc17xx_i2c.h"
+#include "lpc17xx_prof.h"
 #include "light.h"
 
 /******************************************************************************
@@ -180,6 +181,7 @@ uint32_t light_read(void)
 {
     uint32_t data = 0;
     uint8_t buf[1];
+    PROF_BEGIN(PROF_ID_LIGHT_READ);
 
     buf[0] = ADDR_LSB_SENSOR;
     I2CWrite(LIGHT_I2C_ADDR, buf, 1);
@@ -197,6 +199,7 @@ uint32_t light_read(void)
     /* Rext = 100k */
     /* E = (range(k) * DATA)  / 2^n */
 
+    PROF_END(PROF_ID_LIGHT_READ);
     return (range*data / width);
 }
 
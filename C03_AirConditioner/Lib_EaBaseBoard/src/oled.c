@@ -18,9 +18,12 @@
  *****************************************************************************/
 
 #include <string.h>
+#include <cr_section_macros.h>
 #include "lpc17xx_gpio.h"
 #include "lpc17xx_i2c.h"
 #include "lpc17xx_ssp.h"
+#include "lpc17xx_gpdma.h"
+#include "lpc17xx_prof.h"
 #include "oled.h"
 #include "font5x7.h"
 
@@ -50,6 +53,16 @@
 
 #define SHADOW_FB_SIZE (OLED_DISPLAY_WIDTH*OLED_DISPLAY_HEIGHT >> 3)
 
+#define OLED_PAGES (OLED_DISPLAY_HEIGHT >> 3)
+
+/*
+ * oled_initDma() sends the init sequence, then the address and the
+ * shadow framebuffer row of each page
+ */
+#define DMA_SEGMENTS (1 + 2 * OLED_PAGES)
+
+#define PAGE_ADDRESS(page) { 0xB0 + (page), 0x0F & X_OFFSET, 0x10 | (X_OFFSET >> 4) }
+
 #define setAddress(page,lowerAddr,higherAddr)\
     writeCommand(page);\
     writeCommand(lowerAddr);\
@@ -70,12 +83,66 @@
  * serial mode (only parallel mode). Since it isn't possible to write only
  * one pixel to the display (a minimum of one column, 8 pixels, is always
  * wriiten) a shadow framebuffer is needed to keep track of the display
- * data.
+ * data. It is kept in the AHB SRAM, out of the way of the CPU data
+ * accesses to the local SRAM.
  */
-static uint8_t shadowFB[SHADOW_FB_SIZE];
+__BSS(RAM2) static uint8_t shadowFB[SHADOW_FB_SIZE];
 
 static uint8_t const  font_mask[8] = {0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01};
 
+/*
+ * Recommended Initial code according to manufacturer. A table, so that
+ * oled_initDma() can send it as one DMA transfer.
+ */
+static const uint8_t initSequence[] = {
+    0x02,   //set low column address
+    0x12,   //set high column address
+    0x40,   //(display start set)
+    0x2e,   //(stop horzontal scroll)
+    0x81,   //(set contrast control register)
+    0x32,
+    0x82,   //(brightness for color banks)
+    0x80,   //(display on)
+    0xa1,   //(set segment re-map)
+    0xa6,   //(set normal/inverse display)
+    // 0xa7,   //(set inverse display)
+    0xa8,   //(set multiplex ratio)
+    0x3F,
+    0xd3,   //(set display offset)
+    0x40,
+    0xad,   //(set dc-dc on/off)
+    0x8E,   //
+    0xc8,   //(set com output scan direction)
+    0xd5,   //(set display clock divide ratio/oscillator/frequency)
+    0xf0,   //
+    0xd8,   //(set area color mode on/off & low power display mode )
+    0x05,   //
+    0xd9,   //(set pre-charge period)
+    0xF1,
+    0xda,   //(set com pins hardware configuration)
+    0x12,
+    0xdb,   //(set vcom deselect level)
+    0x34,
+    0x91,   //(set look up table for area color)
+    0x3f,
+    0x3f,
+    0x3f,
+    0x3f,
+    0xaf,   //(display on)
+    0xa4,   //(display on)
+};
+
+#ifndef OLED_USE_I2C
+/* page and column address of the panel columns of each page */
+static const uint8_t pageAddress[OLED_PAGES][3] = {
+    PAGE_ADDRESS(0), PAGE_ADDRESS(1), PAGE_ADDRESS(2), PAGE_ADDRESS(3),
+    PAGE_ADDRESS(4), PAGE_ADDRESS(5), PAGE_ADDRESS(6), PAGE_ADDRESS(7)
+};
+
+static volatile uint8_t dmaSegment = 0; /* segment on the bus */
+static volatile uint8_t dmaBusy = 0;
+#endif
+
 
 /******************************************************************************
  * Local Functions
@@ -247,47 +314,75 @@ void oled_inverse(int inverse){
 static void
 runInitSequence(void)
 {
-    /*
-     * Recommended Initial code according to manufacturer
-     */
+    uint32_t i = 0;
 
-    writeCommand(0x02);//set low column address
-    writeCommand(0x12);//set high column address
-    writeCommand(0x40);//(display start set)
-    writeCommand(0x2e);//(stop horzontal scroll)
-    writeCommand(0x81);//(set contrast control register)
-    writeCommand(0x32);
-    writeCommand(0x82);//(brightness for color banks)
-    writeCommand(0x80);//(display on)
-    writeCommand(0xa1);//(set segment re-map)
-    writeCommand(0xa6);//(set normal/inverse display)
-    // writeCommand(0xa7);//(set inverse display)
-    writeCommand(0xa8);//(set multiplex ratio)
-    writeCommand(0x3F);
-    writeCommand(0xd3);//(set display offset)
-    writeCommand(0x40);
-    writeCommand(0xad);//(set dc-dc on/off)
-    writeCommand(0x8E);//
-    writeCommand(0xc8);//(set com output scan direction)
-    writeCommand(0xd5);//(set display clock divide ratio/oscillator/frequency)
-    writeCommand(0xf0);//
-    writeCommand(0xd8);//(set area color mode on/off & low power display mode )
-    writeCommand(0x05);//
-    writeCommand(0xd9);//(set pre-charge period)
-    writeCommand(0xF1);
-    writeCommand(0xda);//(set com pins hardware configuration)
-    writeCommand(0x12);
-    writeCommand(0xdb);//(set vcom deselect level)
-    writeCommand(0x34);
-    writeCommand(0x91);//(set look up table for area color)
-    writeCommand(0x3f);
-    writeCommand(0x3f);
-    writeCommand(0x3f);
-    writeCommand(0x3f);
-    writeCommand(0xaf);//(display on)
-    writeCommand(0xa4);//(display on)
+    for (i = 0; i < sizeof(initSequence); i++) {
+        writeCommand(initSequence[i]);
+    }
 }
 
+#ifndef OLED_USE_I2C
+/******************************************************************************
+ *
+ * Description:
+ *    Start one segment of the oled_initDma() transfer
+ *
+ * Params:
+ *   [in] seg - segment, 0 .. DMA_SEGMENTS-1
+ *
+ *****************************************************************************/
+static void
+startSegment(uint8_t seg)
+{
+    GPDMA_Channel_CFG_Type dmaCfg;
+    uint8_t page = (seg - 1) >> 1;
+
+    if (seg == 0) {
+        OLED_CMD();
+        dmaCfg.SrcMemAddr = (uint32_t)initSequence;
+        dmaCfg.TransferSize = sizeof(initSequence);
+    }
+    else if (seg & 1) {
+        OLED_CMD();
+        dmaCfg.SrcMemAddr = (uint32_t)pageAddress[page];
+        dmaCfg.TransferSize = sizeof(pageAddress[page]);
+    }
+    else {
+        OLED_DATA();
+        dmaCfg.SrcMemAddr = (uint32_t)&shadowFB[page * OLED_DISPLAY_WIDTH];
+        dmaCfg.TransferSize = OLED_DISPLAY_WIDTH;
+    }
+    OLED_CS_ON();
+
+    dmaCfg.ChannelNum = OLED_DMA_CH;
+    dmaCfg.TransferWidth = 0;
+    dmaCfg.DstMemAddr = 0;
+    dmaCfg.TransferType = GPDMA_TRANSFERTYPE_M2P;
+    dmaCfg.SrcConn = GPDMA_CONN_SSP1_Tx;
+    dmaCfg.DstConn = GPDMA_CONN_SSP1_Tx;
+    dmaCfg.DMALLI = 0;
+
+    GPDMA_Setup(&dmaCfg);
+    GPDMA_ChannelCmd(OLED_DMA_CH, ENABLE);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Stop a transfer started by oled_initDma()
+ *
+ *****************************************************************************/
+static void
+stopDma(void)
+{
+    GPDMA_ChannelCmd(OLED_DMA_CH, DISABLE);
+    SSP_DMACmd(LPC_SSP1, SSP_DMA_TX, DISABLE);
+    while (SSP_GetStatus(LPC_SSP1, SSP_STAT_BUSY) == SET);
+    OLED_CS_OFF();
+    dmaBusy = 0;
+}
+#endif
+
 
 /******************************************************************************
  *
@@ -367,6 +462,13 @@ void oled_init (void)
 {
     int i = 0;
 
+#ifndef OLED_USE_I2C
+    /* takes over from a transfer of oled_initDma() that didn't finish */
+    if (dmaBusy) {
+        stopDma();
+    }
+#endif
+
     //GPIO_SetDir(PORT0, 0, 1);
     GPIO_SetDir(2, (1<<1), 1);
     GPIO_SetDir(2, (1<<7), 1);
@@ -393,6 +495,107 @@ void oled_init (void)
     GPIO_SetValue( 2, (1<<1) );
 }
 
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize the OLED Display and fill it with one color, like
+ *    oled_init() followed by oled_clearScreen(), with GPDMA moving the bytes
+ *    to SSP1 in the background. The DMA interrupt handler must call
+ *    oled_dmaIrq().
+ *
+ *    SSP1 and the display belong to the transfer until oled_isDmaBusy()
+ *    returns 0: don't draw and don't use other devices on SSP1 before. It
+ *    resets the GPDMA controller, so start it before anything else uses
+ *    the GPDMA. oled_init() stops a transfer that doesn't finish.
+ *
+ * Params:
+ *   [in] color - color to fill the screen with
+ *
+ *****************************************************************************/
+void oled_initDma(oled_color_t color)
+{
+#ifdef OLED_USE_I2C
+    oled_init();
+    oled_clearScreen(color);
+#else
+    GPIO_SetDir(2, (1<<1), 1);
+    GPIO_SetDir(2, (1<<7), 1);
+    GPIO_SetDir(0, (1<<6), 1);
+
+    /* make sure power is off, it is turned on after the last segment */
+    GPIO_ClearValue( 2, (1<<1) );
+    OLED_CS_OFF();
+
+    memset(shadowFB, (color == OLED_COLOR_WHITE) ? 0xff : 0, SHADOW_FB_SIZE);
+
+    GPDMA_Init();
+    SSP_DMACmd(LPC_SSP1, SSP_DMA_TX, ENABLE);
+
+    dmaSegment = 0;
+    dmaBusy = 1;
+    NVIC_EnableIRQ(DMA_IRQn);
+    startSegment(0);
+#endif
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Check if the transfer of oled_initDma() is still running
+ *
+ *****************************************************************************/
+uint8_t oled_isDmaBusy(void)
+{
+#ifdef OLED_USE_I2C
+    return 0;
+#else
+    return dmaBusy;
+#endif
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    GPDMA interrupt work of oled_initDma(), to be called from the DMA
+ *    interrupt handler. Only looks at OLED_DMA_CH. After a DMA error the
+ *    transfer stays busy; oled_init() recovers.
+ *
+ *****************************************************************************/
+void oled_dmaIrq(void)
+{
+#ifndef OLED_USE_I2C
+    if (!dmaBusy || GPDMA_IntGetStatus(GPDMA_STAT_INT, OLED_DMA_CH) != SET) {
+        return;
+    }
+
+    if (GPDMA_IntGetStatus(GPDMA_STAT_INTERR, OLED_DMA_CH) == SET) {
+        GPDMA_ClearIntPending(GPDMA_STATCLR_INTERR, OLED_DMA_CH);
+        GPDMA_ChannelCmd(OLED_DMA_CH, DISABLE);
+        return;
+    }
+
+    GPDMA_ClearIntPending(GPDMA_STATCLR_INTTC, OLED_DMA_CH);
+
+    /* the last bytes are still in the FIFO, D/C must not change under them */
+    while (SSP_GetStatus(LPC_SSP1, SSP_STAT_BUSY) == SET);
+    OLED_CS_OFF();
+
+    if (++dmaSegment < DMA_SEGMENTS) {
+        startSegment(dmaSegment);
+        return;
+    }
+
+    SSP_DMACmd(LPC_SSP1, SSP_DMA_TX, DISABLE);
+
+    /*
+     * power on; writing the display RAM took longer than the delay
+     * oled_init() waits
+     */
+    GPIO_SetValue( 2, (1<<1) );
+    dmaBusy = 0;
+#endif
+}
+
 /******************************************************************************
  *
  * Description:
@@ -404,7 +607,7 @@ void oled_init (void)
  *   [in] color - color of the pixel
  *
  *****************************************************************************/
-void oled_putPixel(uint8_t x, uint8_t y, oled_color_t color) {
+__RAMFUNC(RAM) void oled_putPixel(uint8_t x, uint8_t y, oled_color_t color) {
     uint8_t page;
     uint16_t add;
     uint8_t lAddr;
@@ -792,7 +995,8 @@ void oled_clearScreen(oled_color_t color)
     memset(shadowFB, c, SHADOW_FB_SIZE);
 }
 
-uint8_t oled_putChar(uint8_t x, uint8_t y, uint8_t ch, oled_color_t fb, oled_color_t bg)
+/* the glyph blitter runs from SRAM, it draws every character pixel by pixel */
+__RAMFUNC(RAM) uint8_t oled_putChar(uint8_t x, uint8_t y, uint8_t ch, oled_color_t fb, oled_color_t bg)
 {
     unsigned char data = 0;
     unsigned char i = 0, j = 0;
@@ -835,6 +1039,8 @@ uint8_t oled_putChar(uint8_t x, uint8_t y, uint8_t ch, oled_color_t fb, oled_col
 void oled_putString(uint8_t x, uint8_t y, uint8_t *pStr, oled_color_t fb,
         oled_color_t bg)
 {
+  PROF_BEGIN(PROF_ID_OLED_PUTSTRING);
+
   while(1)
   {
       if( (*pStr)=='\0' )
@@ -847,5 +1053,6 @@ void oled_putString(uint8_t x, uint8_t y, uint8_t *pStr, oled_color_t fb,
     }
     x += 6;
   }
+  PROF_END(PROF_ID_OLED_PUTSTRING);
   return;
 }
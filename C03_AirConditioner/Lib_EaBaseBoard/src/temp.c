@@ -16,6 +16,9 @@
  *****************************************************************************/
 
 #include "lpc17xx_gpio.h"
+#include "lpc17xx_prof.h"
+#include "lpc17xx_trace.h"
+#include "lpc17xx_stats.h"
 #include "temp.h"
 
 /******************************************************************************
@@ -49,6 +52,13 @@
 #endif
 
 
+/*
+ * A measurement takes NUM_HALF_PERIODS/2 sensor periods, about 0.6 s at
+ * 100 C. A sensor that stops toggling makes temp_read give up after this.
+ */
+#define TEMP_READ_TIMEOUT_MS 1000
+
+
 #define P0_6_STATE ((GPIO_ReadValue(0) & (1 << 6)) != 0)
 #define P0_2_STATE ((GPIO_ReadValue(0) & (1 << 2)) != 0)
 
@@ -106,14 +116,19 @@ void temp_init (uint32_t (*getMsTicks)(void))
  * Returns:
  *    10 x T(c), i.e. 10 times the temperature in Celcius. Example:
  *    if the temperature is 22.4 degrees the returned value is 224.
+ *    TEMP_READ_ERROR if the sensor output did not toggle within
+ *    TEMP_READ_TIMEOUT_MS; the tick callback must be running.
  *
  *****************************************************************************/
 int32_t temp_read (void)
 {
     uint8_t state = 0;
+    uint32_t t0 = 0;
     uint32_t t1 = 0;
     uint32_t t2 = 0;
     int i = 0;
+    PROF_BEGIN(PROF_ID_TEMP_READ);
+    TRACE_DRV_BEGIN(TRACE_DRV_TEMP_READ);
 
     /*
      * T(C) = ( period (us) / scalar ) - 273.15 K
@@ -122,15 +137,30 @@ int32_t temp_read (void)
      */
 
     state = GET_TEMP_STATE;
+    t0 = getTicks();
 
     /* get next state change before measuring time */
-    while(GET_TEMP_STATE == state);
+    while(GET_TEMP_STATE == state) {
+        if ((getTicks() - t0) > TEMP_READ_TIMEOUT_MS) {
+            STATS_INC(temp_timeouts);
+            PROF_END(PROF_ID_TEMP_READ);
+            TRACE_DRV_END(TRACE_DRV_TEMP_READ);
+            return TEMP_READ_ERROR;
+        }
+    }
     state = !state;
 
     t1 = getTicks();
 
     for (i = 0; i < NUM_HALF_PERIODS; i++) {
-        while(GET_TEMP_STATE == state);
+        while(GET_TEMP_STATE == state) {
+            if ((getTicks() - t0) > TEMP_READ_TIMEOUT_MS) {
+                STATS_INC(temp_timeouts);
+                PROF_END(PROF_ID_TEMP_READ);
+                TRACE_DRV_END(TRACE_DRV_TEMP_READ);
+                return TEMP_READ_ERROR;
+            }
+        }
         state = !state;
     }
 
@@ -143,5 +173,7 @@ int32_t temp_read (void)
     }
 
 
+    PROF_END(PROF_ID_TEMP_READ);
+    TRACE_DRV_END(TRACE_DRV_TEMP_READ);
     return ( (2*1000*t2) / (NUM_HALF_PERIODS*TEMP_SCALAR_DIV10) - 2731 );
 }
@@ -9,6 +9,24 @@
 /*
  * NOTE: I2C must have been initialized before calling any functions in this
  * file.
+ *
+ * The 64 byte TX and RX FIFOs of the bridge are enabled. Instead of
+ * checking LSR before every byte, the FIFO level (TXLVL/RXLVL) is read once
+ * and then up to that many bytes are moved in one I2C transfer; the bridge
+ * does not increment the register address for THR/RHR, so a burst goes
+ * straight into / out of the FIFO.
+ *
+ * The bridge's IRQ# output is read as a GPIO. While nothing is pending no
+ * I2C transfers are made at all; the I2C bus is shared with the other
+ * base board devices, so the I2C accesses themselves are always made from
+ * the caller's context and never from an interrupt.
+ *
+ * IRQ# is taken to be on P2.12, which has not been checked against the
+ * base board schematic. uart2_init() therefore enables the THR interrupt
+ * with the TX FIFO empty and checks that the pin goes low. If it does not,
+ * or if a later wait for IRQ# times out while TXLVL/RXLVL show that the
+ * bridge has something to report, the line is not used any more and the
+ * FIFO levels are polled over I2C instead, as without an IRQ line.
  */
 
 /******************************************************************************
@@ -38,6 +56,8 @@
 #define R_LSR 0x05
 #define R_MSR 0x06
 
+#define R_TXLVL  0x08
+#define R_RXLVL  0x09
 #define R_IOCTRL 0x0E
 #define R_EFCR   0x0F
 
@@ -51,6 +71,30 @@
 #define LSR_THRE	0x20
 #define LSR_RDR		0x01
 
+#define FCR_FIFO_EN    0x01
+#define FCR_RX_RESET   0x02
+#define FCR_TX_RESET   0x04
+
+#define IER_RHR        0x01    /* RX FIFO above trigger level or RX timeout */
+#define IER_THR        0x02    /* TX FIFO below trigger level */
+#define IER_RLS        0x04    /* receive line status error */
+
+#define FIFO_SIZE      64
+
+/* IRQ# output of the bridge, active low */
+#define IRQ_PORT       2
+#define IRQ_PIN        12
+#define IRQ_ASSERTED() ((GPIO_ReadValue(IRQ_PORT) & (1 << IRQ_PIN)) == 0)
+
+/* IRQ# polls before a wait is given up, about 100 ms */
+#define IRQ_WAIT_POLLS 0x100000UL
+
+/* IRQ# polls for the THR interrupt in uart2_init(), a few I2C bit times */
+#define IRQ_CHECK_POLLS 0x1000UL
+
+/* TXLVL/RXLVL reads before a wait is given up without IRQ#, about 100 ms */
+#define LEVEL_WAIT_POLLS 250
+
 /******************************************************************************
  * External global variables
  *****************************************************************************/
@@ -61,6 +105,9 @@
 
 static uint8_t channel = 0;
 
+/* IRQ# does not follow the bridge, the FIFO levels are polled instead */
+static uint8_t irqMissing = 0;
+
 /******************************************************************************
  * Local Functions
  *****************************************************************************/
@@ -121,6 +168,110 @@ static uint8_t readReg(uint8_t reg)
     return buf[0];
 }
 
+/* write len bytes (at most FIFO_SIZE) to the TX FIFO in one transfer */
+static void writeFifo(uint8_t* data, uint32_t len)
+{
+    uint8_t buf[FIFO_SIZE + 1];
+    uint32_t i = 0;
+
+    buf[0] = SUB_ADDR(channel, R_THR);
+    for (i = 0; i < len; i++) {
+        buf[i + 1] = data[i];
+    }
+    I2CWrite(UART2_ADDR, buf, len + 1);
+}
+
+/* read len bytes (at most the RX FIFO level) from the RX FIFO in one transfer */
+static void readFifo(uint8_t* data, uint32_t len)
+{
+    uint8_t reg = SUB_ADDR(channel, R_RHR);
+
+    I2CWrite(UART2_ADDR, &reg, 1);
+    I2CRead(UART2_ADDR, data, len);
+}
+
+/*
+ * Poll TXLVL (txSpace) or RXLVL until it is non-zero. Used instead of
+ * IRQ# when the line does not work. Returns FALSE if the level stayed 0
+ * for LEVEL_WAIT_POLLS reads.
+ */
+static uint32_t waitLevel(uint8_t txSpace)
+{
+    uint32_t polls = 0;
+
+    while (readReg(txSpace ? R_TXLVL : R_RXLVL) == 0) {
+        if (++polls >= LEVEL_WAIT_POLLS) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*
+ * Wait for the IRQ# line. The THR interrupt is only enabled while waiting
+ * for TX FIFO space, otherwise it would keep IRQ# asserted. Returns FALSE
+ * if IRQ# was not asserted within IRQ_WAIT_POLLS polls and the FIFO level
+ * has not changed either.
+ */
+static uint32_t waitIrq(uint8_t txSpace)
+{
+    uint32_t polls = 0;
+    uint32_t asserted = TRUE;
+
+    if (irqMissing) {
+        return waitLevel(txSpace);
+    }
+
+    if (txSpace) {
+        writeReg(R_IER, IER_RHR | IER_RLS | IER_THR);
+    }
+
+    while (!IRQ_ASSERTED()) {
+        if (++polls >= IRQ_WAIT_POLLS) {
+            asserted = FALSE;
+            break;
+        }
+    }
+
+    if (txSpace) {
+        writeReg(R_IER, IER_RHR | IER_RLS);
+    }
+
+    /* reading IIR clears a THR interrupt, reading LSR clears an RLS one */
+    (void)readReg(R_IIR);
+    (void)readReg(R_LSR);
+
+    if (!asserted && readReg(txSpace ? R_TXLVL : R_RXLVL) != 0) {
+        /* the bridge has something to report but IRQ# never went low */
+        irqMissing = 1;
+        asserted = TRUE;
+    }
+
+    return asserted;
+}
+
+/*
+ * Check that IRQ# follows the bridge: with the TX FIFO empty the THR
+ * interrupt asserts it at once.
+ */
+static void checkIrq(void)
+{
+    uint32_t polls = 0;
+
+    irqMissing = 1;
+    writeReg(R_IER, IER_RHR | IER_RLS | IER_THR);
+
+    while (polls++ < IRQ_CHECK_POLLS) {
+        if (IRQ_ASSERTED()) {
+            irqMissing = 0;
+            break;
+        }
+    }
+
+    writeReg(R_IER, IER_RHR | IER_RLS);
+    (void)readReg(R_IIR);
+}
+
 
 /******************************************************************************
  * Public Functions
@@ -129,7 +280,7 @@ static uint8_t readReg(uint8_t reg)
 /******************************************************************************
  *
  * Description:
- *    Initialize the ISL29003 Device
+ *    Initialize the SC16IS752 Device
  *
  * Params:
  *   [in] baudRate - the baud rate to use
@@ -146,8 +297,15 @@ void uart2_init (uint32_t baudRate, uart2_channel_t chan)
     GPIO_SetDir(0, 1<<9, 1); // SI-A1
     GPIO_SetDir(2, 1<<8, 1); // CS#-A0
 
+    GPIO_SetDir(IRQ_PORT, 1<<IRQ_PIN, 0); // IRQ#
+
     channel = chan;
     uart2_setBaudRate(baudRate);
+
+    /* enable and reset the FIFOs, default trigger levels (8 / 8) */
+    writeReg(R_FCR, FCR_FIFO_EN | FCR_RX_RESET | FCR_TX_RESET);
+
+    checkIrq();
 }
 
 /******************************************************************************
@@ -194,25 +352,38 @@ void uart2_setBaudRate(uint32_t baudRate)
  *   [in] buffer - buffer with data
  *   [in] length - number of bytes of data
  *
+ * Returns:
+ *   number of bytes sent, less than length if the TX FIFO did not drain
+ *
  *****************************************************************************/
-void uart2_send(uint8_t *buffer, uint32_t length)
+uint32_t uart2_send(uint8_t *buffer, uint32_t length)
 {
+    uint32_t space = 0;
+    uint32_t sent = 0;
+
     if (!buffer) {
         /* error */
-        return;
+        return 0;
     }
 
     while ( length != 0 )
     {
-        /* THRE status, contain valid data */
-        while ( !(readReg(R_LSR) & LSR_THRE) );
+        space = readReg(R_TXLVL);
+        if (space == 0) {
+            if (!waitIrq(TRUE)) {
+                break;
+            }
+            continue;
+        }
 
-        writeReg(R_THR, *buffer);
+        space = MIN(space, length);
+        writeFifo(buffer, space);
 
-        buffer++;
-        length--;
+        buffer += space;
+        sent   += space;
+        length -= space;
     }
-    return;
+    return sent;
 }
 
 /******************************************************************************
@@ -226,65 +397,67 @@ void uart2_send(uint8_t *buffer, uint32_t length)
  *****************************************************************************/
 void uart2_sendString(uint8_t *string)
 {
+    uint32_t len = 0;
+
     if (!string) {
         /* error */
         return;
     }
 
-    while ( *string != '\0' )
-    {
-        /* THRE status, contain valid data */
-        while ( !(readReg(R_LSR) & LSR_THRE) );
-        writeReg(R_THR, *string);
-
-        string++;
+    while (string[len] != '\0') {
+        len++;
     }
 
-    return;
+    uart2_send(string, len);
 }
 
 /******************************************************************************
  *
  * Description:
- *    Receive data from UART
+ *    Receive data from UART. In non-blocking mode no I2C transfer is made
+ *    unless the bridge asserts IRQ#; data below the RX trigger level is
+ *    reported by the RX timeout after four character times. Without a
+ *    working IRQ# line RXLVL is read on every call.
  *
  * Params:
  *   [in] buffer - data will be written to this buffer
  *   [in] length - length of buffer in bytes
  *   [in] blocking - TRUE if blocking mode should be used; otherwise FALSE
  *
+ * Returns:
+ *   number of bytes received. In blocking mode this is less than length
+ *   only if no data came for about 100 ms.
+ *
  *****************************************************************************/
 uint32_t uart2_receive(uint8_t *buffer, uint32_t length, uint32_t blocking)
 {
     uint32_t recvd = 0;
     uint32_t toRecv = length;
+    uint32_t level = 0;
 
-    if (blocking) {
-
-        while (toRecv) {
-            /* wait for data */
-            while (!(readReg(R_LSR) & LSR_RDR));
-
-            *buffer++ = readReg(R_RHR);
-
-            recvd++;
-            toRecv--;
-        }
-
+    if (!blocking && !irqMissing && !IRQ_ASSERTED()) {
+        return 0;
     }
-    else {
 
-        while (toRecv) {
-            /* break if no data */
-            if (!(readReg(R_LSR) & LSR_RDR)) {
+    while (toRecv) {
+        level = readReg(R_RXLVL);
+        if (level == 0) {
+            if (!blocking) {
                 break;
             }
+            /* wait for data */
+            if (!waitIrq(FALSE)) {
+                break;
+            }
+            continue;
+        }
 
-            *buffer++ = readReg(R_RHR);
+        level = MIN(level, toRecv);
+        readFifo(buffer, level);
 
-            recvd++;
-            toRecv--;
-        }
+        buffer += level;
+        recvd  += level;
+        toRecv -= level;
     }
 
     return recvd;
@@ -167,6 +167,9 @@ extern "C"
 
 /** Time out in case of using I2C slave mode */
 #define I2C_SLAVE_TIME_OUT						0x10000UL
+/** Time out for each bus state change in master polling mode, e.g. a
+ * slave holding SCL low. The transfer then fails with I2C_I2STAT_NO_INF */
+#define I2C_MASTER_TIME_OUT						0x10000UL
 
 /********************************************************************//**
  * I2C Data register definition
@@ -134,6 +134,18 @@
 /* EMAC ------------------------------ */
 #define _EMAC
 
+/* PROF (DWT cycle counter profiler) - */
+/* Comment the line below and PROF_BEGIN/PROF_END compile to nothing */
+#define _PROF
+
+/* TRACE (ITM/SWO event trace) ----- */
+/* Comment the line below and the TRACE_ event macros compile to nothing */
+#define _TRACE
+
+/* STATS (driver runtime counters) -- */
+/* Comment the line below and STATS_INC/STATS_ADD compile to nothing */
+#define _STATS
+
 /************************** GLOBAL/PUBLIC MACRO DEFINITIONS *********************************/
 
 #ifdef  DEBUG
@@ -0,0 +1,141 @@
+/**********************************************************************
+* $Id$		lpc17xx_prof.h				2026-10-19
+*//**
+* @file		lpc17xx_prof.h
+* @brief	Contains all macro definitions and function prototypes
+* 			support for the DWT cycle counter profiler on LPC17xx
+* @version	1.0
+* @date		19. Oct. 2026
+**********************************************************************/
+
+/* Peripheral group ----------------------------------------------------------- */
+/** @defgroup PROF PROF (DWT cycle counter profiler)
+ * @ingroup LPC1700CMSIS_FwLib_Drivers
+ * @{
+ */
+
+#ifndef LPC17XX_PROF_H_
+#define LPC17XX_PROF_H_
+
+/* Includes ------------------------------------------------------------------- */
+#include "LPC17xx.h"
+#include "lpc_types.h"
+
+/* The profiler switch (_PROF) lives in the library configuration file */
+#ifdef __BUILD_WITH_EXAMPLE__
+#include "lpc17xx_libcfg.h"
+#else
+#include "lpc17xx_libcfg_default.h"
+#endif /* __BUILD_WITH_EXAMPLE__ */
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/* Private Macros ------------------------------------------------------------- */
+/** @defgroup PROF_Private_Macros PROF Private Macros
+ * @{
+ */
+
+/* --------------------- BIT DEFINITIONS -------------------------------------- */
+/* core_cm3.h (CMSIS 1.30) has no DWT register map */
+/** DWT control register */
+#define PROF_DWT_CTRL			(*(volatile uint32_t *)0xE0001000UL)
+/** DWT cycle counter */
+#define PROF_DWT_CYCCNT			(*(volatile uint32_t *)0xE0001004UL)
+/** DWT_CTRL: cycle counter enable bit */
+#define PROF_DWT_CTRL_CYCCNTENA	((uint32_t)(1<<0))
+
+/**
+ * @}
+ */
+
+
+/* Public Types --------------------------------------------------------------- */
+/** @defgroup PROF_Public_Types PROF Public Types
+ * @{
+ */
+
+/**
+ * @brief Probe ids, one table entry each
+ */
+typedef enum {
+	PROF_ID_OLED_PUTSTRING = 0,	/*!< oled_putString() */
+	PROF_ID_TEMP_READ,			/*!< temp_read() */
+	PROF_ID_LIGHT_READ,			/*!< light_read() */
+	PROF_ID_SSP_READWRITE,		/*!< SSP_ReadWrite() */
+	PROF_ID_I2C_TRANSFER,		/*!< I2C_MasterTransferData() */
+	PROF_ID_MAIN_LOOP,			/*!< one pass of the main loop, without the idle wait */
+	PROF_ID_CONTROL_STEP,		/*!< temperature controller step */
+	PROF_NUM_IDS
+} PROF_ID_Type;
+
+/**
+ * @brief Statistics of one probe, in CPU cycles
+ */
+typedef struct {
+	const char *name;	/**< Probe name */
+	uint32_t count;		/**< Number of measurements */
+	uint32_t min;		/**< Shortest measurement */
+	uint32_t max;		/**< Longest measurement */
+	uint32_t mean;		/**< Mean of all measurements */
+} PROF_ENTRY_Type;
+
+/**
+ * @}
+ */
+
+
+/* Public Macros -------------------------------------------------------------- */
+/** @defgroup PROF_Public_Macros PROF Public Macros
+ * @{
+ */
+
+#ifdef _PROF
+/** Start a measurement; declares a local, so PROF_END must be in the same scope */
+#define PROF_BEGIN(id)	uint32_t prof_start_##id = PROF_DWT_CYCCNT
+/** End a measurement started by PROF_BEGIN(id) */
+#define PROF_END(id)	PROF_Record(id, PROF_DWT_CYCCNT - prof_start_##id)
+#else
+#define PROF_BEGIN(id)
+#define PROF_END(id)
+#endif /* _PROF */
+
+/**
+ * @}
+ */
+
+
+/* Public Functions ----------------------------------------------------------- */
+/** @defgroup PROF_Public_Functions PROF Public Functions
+ * @{
+ */
+
+#ifdef _PROF
+void PROF_Init(void);
+void PROF_Record(PROF_ID_Type id, uint32_t cycles);
+void PROF_Reset(void);
+Status PROF_GetEntry(PROF_ID_Type id, PROF_ENTRY_Type *entry);
+uint32_t PROF_GetOverhead(void);
+#else
+#define PROF_Init()
+#endif /* _PROF */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LPC17XX_PROF_H_ */
+
+/**
+ * @}
+ */
+
+/* --------------------------------- End Of File ------------------------------ */
@@ -0,0 +1,118 @@
+/**********************************************************************
+* $Id$		lpc17xx_stats.h				2026-10-19
+*//**
+* @file		lpc17xx_stats.h
+* @brief	Contains all macro definitions and function prototypes
+* 			support for the driver runtime counters on LPC17xx
+* @version	1.0
+* @date		19. Oct. 2026
+**********************************************************************/
+
+/* Peripheral group ----------------------------------------------------------- */
+/** @defgroup STATS STATS (driver runtime counters)
+ * @ingroup LPC1700CMSIS_FwLib_Drivers
+ * @{
+ */
+
+#ifndef LPC17XX_STATS_H_
+#define LPC17XX_STATS_H_
+
+/* Includes ------------------------------------------------------------------- */
+#include "LPC17xx.h"
+#include "lpc_types.h"
+
+/* The counter switch (_STATS) lives in the library configuration file */
+#ifdef __BUILD_WITH_EXAMPLE__
+#include "lpc17xx_libcfg.h"
+#else
+#include "lpc17xx_libcfg_default.h"
+#endif /* __BUILD_WITH_EXAMPLE__ */
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/* Public Types --------------------------------------------------------------- */
+/** @defgroup STATS_Public_Types STATS Public Types
+ * @{
+ */
+
+/**
+ * @brief Counters of all drivers, kept in one block of words so that a
+ * snapshot is a single short copy
+ */
+typedef struct {
+	uint32_t i2c_transfers;		/**< I2C_MasterTransferData() calls */
+	uint32_t i2c_nacks;			/**< Address or data bytes not acknowledged */
+	uint32_t i2c_timeouts;		/**< Polled bus steps timed out (I2C_I2STAT_NO_INF) */
+	uint32_t i2c_retries;		/**< Transfers restarted after a failure */
+	uint32_t i2c_errors;		/**< Transfers failed after the last retry */
+	uint32_t ssp_bytes;			/**< Bytes moved by polled SSP_ReadWrite() */
+	uint32_t ssp_overruns;		/**< Receive overruns (SSP_STAT_ERROR) */
+	uint32_t temp_timeouts;		/**< temp_read() timeouts */
+	uint32_t flash_busy_polls;	/**< Dataflash status reads waiting for ready */
+	uint32_t eeprom_writes;		/**< EEPROM page write cycles */
+	uint32_t loop_overruns;		/**< Main loop passes longer than the period */
+} STATS_Type;
+
+/**
+ * @}
+ */
+
+
+/* Public Macros -------------------------------------------------------------- */
+/** @defgroup STATS_Public_Macros STATS Public Macros
+ * @{
+ */
+
+#ifdef _STATS
+/** Count one event; a single word increment, no locking */
+#define STATS_INC(field)	(STATS_Counters.field++)
+/** Count n events */
+#define STATS_ADD(field, n)	(STATS_Counters.field += (uint32_t)(n))
+#else
+#define STATS_INC(field)
+#define STATS_ADD(field, n)
+#endif /* _STATS */
+
+/**
+ * @}
+ */
+
+
+/* Public Functions ----------------------------------------------------------- */
+/** @defgroup STATS_Public_Functions STATS Public Functions
+ * @{
+ */
+
+#ifdef _STATS
+/**
+ * Written by the drivers; read them with STATS_Snapshot(). Increments are
+ * not locked. The I2C counters are written both by polled transfers and by
+ * the I2C interrupt handler, so a count can be lost if the interrupt hits
+ * an increment in thread context; that is accepted for statistics.
+ */
+extern volatile STATS_Type STATS_Counters;
+
+void STATS_Snapshot(STATS_Type *snap);
+void STATS_Reset(void);
+#endif /* _STATS */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LPC17XX_STATS_H_ */
+
+/**
+ * @}
+ */
+
+/* --------------------------------- End Of File ------------------------------ */
@@ -0,0 +1,151 @@
+/**********************************************************************
+* $Id$		lpc17xx_trace.h				2026-10-19
+*//**
+* @file		lpc17xx_trace.h
+* @brief	Contains all macro definitions and function prototypes
+* 			support for the ITM/SWO event trace on LPC17xx
+* @version	1.0
+* @date		19. Oct. 2026
+**********************************************************************/
+
+/* Peripheral group ----------------------------------------------------------- */
+/** @defgroup TRACE TRACE (ITM/SWO event trace)
+ * @ingroup LPC1700CMSIS_FwLib_Drivers
+ * @{
+ */
+
+#ifndef LPC17XX_TRACE_H_
+#define LPC17XX_TRACE_H_
+
+/* Includes ------------------------------------------------------------------- */
+#include "LPC17xx.h"
+#include "lpc_types.h"
+#include "lpc17xx_trace_ids.h"
+
+/* The trace switch (_TRACE) lives in the library configuration file */
+#ifdef __BUILD_WITH_EXAMPLE__
+#include "lpc17xx_libcfg.h"
+#else
+#include "lpc17xx_libcfg_default.h"
+#endif /* __BUILD_WITH_EXAMPLE__ */
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/* Private Macros ------------------------------------------------------------- */
+/** @defgroup TRACE_Private_Macros TRACE Private Macros
+ * @{
+ */
+
+/* --------------------- BIT DEFINITIONS -------------------------------------- */
+/* core_cm3.h (CMSIS 1.30) has no TPIU register map */
+/** TPIU asynchronous clock prescaler register */
+#define TRACE_TPIU_ACPR			(*(volatile uint32_t *)0xE0040010UL)
+/** TPIU selected pin protocol register */
+#define TRACE_TPIU_SPPR			(*(volatile uint32_t *)0xE00400F0UL)
+/** TPIU formatter and flush control register */
+#define TRACE_TPIU_FFCR			(*(volatile uint32_t *)0xE0040304UL)
+/** SPPR: asynchronous NRZ (UART) protocol */
+#define TRACE_TPIU_SPPR_NRZ		((uint32_t)(2))
+/** FFCR: formatter bypassed, only ITM packets on SWO */
+#define TRACE_TPIU_FFCR_BYPASS	((uint32_t)(1<<8))
+/** ITM lock access key */
+#define TRACE_ITM_UNLOCK		((uint32_t)(0xC5ACCE55))
+
+#ifdef _TRACE
+/*
+ * Write one byte to a stimulus port. Nothing is written unless the port is
+ * enabled; if the ITM FIFO is full the event is dropped and counted. It
+ * never waits, which keeps an event at a few cycles.
+ */
+#define TRACE_PUT8(port, b) \
+	do { \
+		if (ITM->TER & (1UL << (port))) { \
+			if (ITM->PORT[port].u32 != 0) { \
+				ITM->PORT[port].u8 = (uint8_t)(b); \
+			} else { \
+				TRACE_Lost++; \
+			} \
+		} \
+	} while (0)
+
+#define TRACE_PUT32(port, w) \
+	do { \
+		if (ITM->TER & (1UL << (port))) { \
+			if (ITM->PORT[port].u32 != 0) { \
+				ITM->PORT[port].u32 = (uint32_t)(w); \
+			} else { \
+				TRACE_Lost++; \
+			} \
+		} \
+	} while (0)
+#endif /* _TRACE */
+
+/**
+ * @}
+ */
+
+
+/* Public Macros -------------------------------------------------------------- */
+/** @defgroup TRACE_Public_Macros TRACE Public Macros
+ * @{
+ */
+
+#ifdef _TRACE
+#define TRACE_TASK_BEGIN(id)	TRACE_PUT8(TRACE_PORT_TASK, (id))
+#define TRACE_TASK_END(id)		TRACE_PUT8(TRACE_PORT_TASK, TRACE_END | (id))
+#define TRACE_ISR_ENTER(id)		TRACE_PUT8(TRACE_PORT_ISR, (id))
+#define TRACE_ISR_EXIT(id)		TRACE_PUT8(TRACE_PORT_ISR, TRACE_END | (id))
+#define TRACE_DRV_BEGIN(id)		TRACE_PUT8(TRACE_PORT_DRV, (id))
+#define TRACE_DRV_END(id)		TRACE_PUT8(TRACE_PORT_DRV, TRACE_END | (id))
+#define TRACE_VALUE(id, v)		TRACE_PUT32(TRACE_PORT_VALUE, \
+									((uint32_t)(id) << 24) | ((uint32_t)(v) & 0xFFFFFF))
+#else
+#define TRACE_TASK_BEGIN(id)
+#define TRACE_TASK_END(id)
+#define TRACE_ISR_ENTER(id)
+#define TRACE_ISR_EXIT(id)
+#define TRACE_DRV_BEGIN(id)
+#define TRACE_DRV_END(id)
+#define TRACE_VALUE(id, v)
+#endif /* _TRACE */
+
+/**
+ * @}
+ */
+
+
+/* Public Functions ----------------------------------------------------------- */
+/** @defgroup TRACE_Public_Functions TRACE Public Functions
+ * @{
+ */
+
+#ifdef _TRACE
+/** Events dropped on a full ITM FIFO; updated without locking, approximate */
+extern volatile uint32_t TRACE_Lost;
+
+void TRACE_Init(uint32_t swoBaud);
+uint32_t TRACE_GetLost(void);
+#else
+#define TRACE_Init(swoBaud)
+#endif /* _TRACE */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LPC17XX_TRACE_H_ */
+
+/**
+ * @}
+ */
+
+/* --------------------------------- End Of File ------------------------------ */
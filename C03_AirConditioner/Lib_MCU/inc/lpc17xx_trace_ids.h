@@ -0,0 +1,107 @@
+/**********************************************************************
+* $Id$		lpc17xx_trace_ids.h			2026-10-19
+*//**
+* @file		lpc17xx_trace_ids.h
+* @brief	Event ids and ITM stimulus ports of the trace channel. Has no
+* 			target dependencies, the host decoder includes it too.
+* @version	1.0
+* @date		19. Oct. 2026
+**********************************************************************/
+
+/* Peripheral group ----------------------------------------------------------- */
+/** @addtogroup TRACE
+ * @{
+ */
+
+#ifndef LPC17XX_TRACE_IDS_H_
+#define LPC17XX_TRACE_IDS_H_
+
+/* Public Macros -------------------------------------------------------------- */
+/** @defgroup TRACE_Public_Macros TRACE Public Macros
+ * @{
+ */
+
+/** Stimulus port 0 is left to ITM_SendChar() text */
+#define TRACE_PORT_TEXT		0
+/** Task events, one byte: TRACE_END flag | TRACE_TASK_Type */
+#define TRACE_PORT_TASK		1
+/** Interrupt events, one byte: TRACE_END flag | TRACE_ISR_Type */
+#define TRACE_PORT_ISR		2
+/** Driver transactions, one byte: TRACE_END flag | TRACE_DRV_Type */
+#define TRACE_PORT_DRV		3
+/** Values, four bytes: id << 24 | 24 bit value */
+#define TRACE_PORT_VALUE	4
+
+/** Ports enabled by TRACE_Init() */
+#define TRACE_PORT_MASK		0x1F
+
+/** Set in an event byte for the end of a task, interrupt or transaction */
+#define TRACE_END			0x80
+
+/**
+ * @}
+ */
+
+
+/* Public Types --------------------------------------------------------------- */
+/** @defgroup TRACE_Public_Types TRACE Public Types
+ * @{
+ */
+
+/** Tasks, TRACE_PORT_TASK */
+typedef enum {
+	TRACE_TASK_MAIN_LOOP = 0,	/*!< one pass of the sensor/display loop */
+	TRACE_TASK_CONTROL,			/*!< temperature controller step */
+	TRACE_TASK_TELEMETRY,		/*!< telemetry frame */
+	TRACE_NUM_TASKS
+} TRACE_TASK_Type;
+
+/** Interrupt handlers, TRACE_PORT_ISR */
+typedef enum {
+	TRACE_ISR_SYSTICK = 0,
+	TRACE_ISR_TIMER0,
+	TRACE_ISR_PWM1,
+	TRACE_ISR_MCPWM,
+	TRACE_ISR_QEI,
+	TRACE_ISR_UART0,
+	TRACE_ISR_UART3,
+	TRACE_ISR_CAN,
+	TRACE_ISR_RTC,
+	TRACE_ISR_DMA,
+	TRACE_NUM_ISRS
+} TRACE_ISR_Type;
+
+/** Driver transactions, TRACE_PORT_DRV */
+typedef enum {
+	TRACE_DRV_I2C = 0,			/*!< I2C_MasterTransferData() */
+	TRACE_DRV_SSP,				/*!< SSP_ReadWrite() */
+	TRACE_DRV_FLASH_WRITE,		/*!< flash_write() */
+	TRACE_DRV_TEMP_READ,		/*!< temp_read() */
+	TRACE_NUM_DRVS
+} TRACE_DRV_Type;
+
+/** Values, TRACE_PORT_VALUE */
+typedef enum {
+	TRACE_VAL_DUTY = 0,			/*!< compressor duty */
+	TRACE_VAL_TEMP,				/*!< temperature, 10 x T(C) */
+	TRACE_NUM_VALS
+} TRACE_VAL_Type;
+
+/** Names in enum order, for the decoder */
+#define TRACE_TASK_NAMES	"main_loop", "control", "telemetry"
+#define TRACE_ISR_NAMES		"SysTick", "TIMER0", "PWM1", "MCPWM", "QEI", \
+							"UART0", "UART3", "CAN", "RTC", "DMA"
+#define TRACE_DRV_NAMES		"i2c", "ssp", "flash_write", "temp_read"
+#define TRACE_VAL_NAMES		"duty", "temp"
+
+/**
+ * @}
+ */
+
+#endif /* LPC17XX_TRACE_IDS_H_ */
+
+/**
+ * @}
+ */
+
+/* --------------------------------- End Of File ------------------------------ */
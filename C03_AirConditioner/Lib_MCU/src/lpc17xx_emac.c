@@ -56,8 +56,16 @@ const uint8_t EMAC_clkdiv[] = { 4, 6, 8, 10, 14, 20, 28 };
 
 /* EMAC local DMA Descriptors */
 
+/** The EMAC DMA is an AHB master, it can not reach the CPU local SRAM.
+ * Descriptors and buffers are placed in the AHB SRAM bank (0x2007C000) */
+#if defined   (  __GNUC__  )
+#define EMAC_AHB_RAM	__attribute__ ((section(".bss.$RamAHB32")))
+#else
+#define EMAC_AHB_RAM
+#endif
+
 /** Rx Descriptor data array */
-static RX_Desc Rx_Desc[EMAC_NUM_RX_FRAG];
+static RX_Desc Rx_Desc[EMAC_NUM_RX_FRAG] EMAC_AHB_RAM;
 
 /** Rx Status data array - Must be 8-Byte aligned */
 #if defined ( __CC_ARM   )
@@ -66,19 +74,19 @@ static __align(8) RX_Stat Rx_Stat[EMAC_NUM_RX_FRAG];
 #pragma data_alignment=8
 static RX_Stat Rx_Stat[EMAC_NUM_RX_FRAG];
 #elif defined   (  __GNUC__  )
-static __attribute__ ((aligned (8))) RX_Stat Rx_Stat[EMAC_NUM_RX_FRAG];
+static __attribute__ ((aligned (8))) RX_Stat Rx_Stat[EMAC_NUM_RX_FRAG] EMAC_AHB_RAM;
 #endif
 
 /** Tx Descriptor data array */
-static TX_Desc Tx_Desc[EMAC_NUM_TX_FRAG];
+static TX_Desc Tx_Desc[EMAC_NUM_TX_FRAG] EMAC_AHB_RAM;
 /** Tx Status data array */
-static TX_Stat Tx_Stat[EMAC_NUM_TX_FRAG];
+static TX_Stat Tx_Stat[EMAC_NUM_TX_FRAG] EMAC_AHB_RAM;
 
 /* EMAC local DMA buffers */
 /** Rx buffer data */
-static uint32_t rx_buf[EMAC_NUM_RX_FRAG][EMAC_ETH_MAX_FLEN>>2];
+static uint32_t rx_buf[EMAC_NUM_RX_FRAG][EMAC_ETH_MAX_FLEN>>2] EMAC_AHB_RAM;
 /** Tx buffer data */
-static uint32_t tx_buf[EMAC_NUM_TX_FRAG][EMAC_ETH_MAX_FLEN>>2];
+static uint32_t tx_buf[EMAC_NUM_TX_FRAG][EMAC_ETH_MAX_FLEN>>2] EMAC_AHB_RAM;
 
 /**
  * @}
@@ -773,6 +781,46 @@ void EMAC_ReadPacketBuffer(EMAC_PACKETBUF_Type *pDataStruct)
 	}
 }
 
+/*********************************************************************//**
+ * @brief		Get the Rx packet data buffer at current index due to
+ * 				RxConsumeIndex, without copying it
+ * @param[in]	None
+ * @return		Pointer to the received frame, it is valid until
+ * 				EMAC_UpdateRxConsumeIndex() is called
+ **********************************************************************/
+uint8_t *EMAC_GetRxPacketBuffer(void)
+{
+	return (uint8_t *)Rx_Desc[LPC_EMAC->RxConsumeIndex].Packet;
+}
+
+/*********************************************************************//**
+ * @brief		Get the Tx packet data buffer at current index due to
+ * 				TxProduceIndex so a frame can be built in place
+ * @param[in]	None
+ * @return		Pointer to a word-aligned buffer of EMAC_ETH_MAX_FLEN bytes
+ *
+ * Note: Check EMAC_CheckTransmitIndex() first, the buffer is only free
+ * if it returns TRUE.
+ **********************************************************************/
+uint8_t *EMAC_GetTxPacketBuffer(void)
+{
+	return (uint8_t *)Tx_Desc[LPC_EMAC->TxProduceIndex].Packet;
+}
+
+/*********************************************************************//**
+ * @brief		Set the length of the frame built in the Tx packet data
+ * 				buffer at current index due to TxProduceIndex
+ * @param[in]	ulDataLen	Frame length in bytes, without CRC
+ * @return		None
+ *
+ * Note: Call EMAC_UpdateTxProduceIndex() afterwards to start the
+ * transmission.
+ **********************************************************************/
+void EMAC_SetTxPacketSize(uint32_t ulDataLen)
+{
+	Tx_Desc[LPC_EMAC->TxProduceIndex].Ctrl = (ulDataLen - 1) | (EMAC_TCTRL_INT | EMAC_TCTRL_LAST);
+}
+
 /*********************************************************************//**
  * @brief 		Enable/Disable interrupt for each type in EMAC
  * @param[in]	ulIntType	Interrupt Type, should be:
@@ -860,7 +908,9 @@ Bool EMAC_CheckReceiveIndex(void)
  **********************************************************************/
 Bool EMAC_CheckTransmitIndex(void)
 {
-	uint32_t tmp = LPC_EMAC->TxConsumeIndex -1;
+	uint32_t tmp = LPC_EMAC->TxConsumeIndex;
+	/* the ring is full when the produce index is one behind the consume index */
+	tmp = (tmp == 0) ? (EMAC_NUM_TX_FRAG - 1) : (tmp - 1);
 	if (LPC_EMAC->TxProduceIndex == tmp) {
 		return FALSE;
 	} else {
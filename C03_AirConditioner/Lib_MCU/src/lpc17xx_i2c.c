@@ -31,6 +31,9 @@
 
 /* Includes ------------------------------------------------------------------- */
 #include "lpc17xx_i2c.h"
+#include "lpc17xx_prof.h"
+#include "lpc17xx_trace.h"
+#include "lpc17xx_stats.h"
 #include "lpc17xx_clkpwr.h"
 #include "lpc17xx_pinsel.h"
 
@@ -95,9 +98,15 @@ static uint32_t I2C_SendByte (LPC_I2C_TypeDef *I2Cx, uint8_t databyte);
 /* I2C get byte subroutine */
 static uint32_t I2C_GetByte (LPC_I2C_TypeDef *I2Cx, uint8_t *retdat, Bool ack);
 
+/* Count a failed bus step of a polled transfer by its cause */
+static void I2C_CountFailure (uint32_t CodeStatus);
+
 /* I2C set clock (hz) */
 static void I2C_SetClock (LPC_I2C_TypeDef *I2Cx, uint32_t target_clock);
 
+/* I2C wait for state change, bounded */
+static uint32_t I2C_WaitStatus (LPC_I2C_TypeDef *I2Cx);
+
 /*--------------------------------------------------------------------------------*/
 /********************************************************************//**
  * @brief		Convert from I2C peripheral to number
@@ -118,6 +127,27 @@ static int32_t I2C_getNum(LPC_I2C_TypeDef *I2Cx){
 	return (-1);
 }
 
+/********************************************************************//**
+ * @brief		Wait for the next bus state (SI flag) in master mode
+ * @param[in]	I2Cx: I2C peripheral selected, should be:
+ * 				- LPC_I2C0
+ * 				- LPC_I2C1
+ * 				- LPC_I2C2
+ * @return 		value of I2C status register, or I2C_I2STAT_NO_INF if
+ * 				SI was not set within I2C_MASTER_TIME_OUT polls
+ *********************************************************************/
+static uint32_t I2C_WaitStatus (LPC_I2C_TypeDef *I2Cx)
+{
+	uint32_t timeout = I2C_MASTER_TIME_OUT;
+
+	while (!(I2Cx->I2CONSET & I2C_I2CONSET_SI)){
+		if (--timeout == 0){
+			return (I2C_I2STAT_NO_INF);
+		}
+	}
+	return (I2Cx->I2STAT & I2C_STAT_CODE_BITMASK);
+}
+
 /********************************************************************//**
  * @brief		Generate a start condition on I2C bus (in master mode only)
  * @param[in]	I2Cx: I2C peripheral selected, should be:
@@ -128,13 +158,15 @@ static int32_t I2C_getNum(LPC_I2C_TypeDef *I2Cx){
  *********************************************************************/
 static uint32_t I2C_Start (LPC_I2C_TypeDef *I2Cx)
 {
+	uint32_t CodeStatus;
+
 	I2Cx->I2CONSET = I2C_I2CONSET_STA;
 	I2Cx->I2CONCLR = I2C_I2CONCLR_SIC;
 
 	// Wait for complete
-	while (!(I2Cx->I2CONSET & I2C_I2CONSET_SI));
+	CodeStatus = I2C_WaitStatus(I2Cx);
 	I2Cx->I2CONCLR = I2C_I2CONCLR_STAC;
-	return (I2Cx->I2STAT & I2C_STAT_CODE_BITMASK);
+	return (CodeStatus);
 }
 
 /********************************************************************//**
@@ -176,8 +208,7 @@ static uint32_t I2C_SendByte (LPC_I2C_TypeDef *I2Cx, uint8_t databyte)
 	I2Cx->I2DAT = databyte & I2C_I2DAT_BITMASK;
 	I2Cx->I2CONCLR = I2C_I2CONCLR_SIC;
 
-	while (!(I2Cx->I2CONSET & I2C_I2CONSET_SI));
-	return (I2Cx->I2STAT & I2C_STAT_CODE_BITMASK);
+	return (I2C_WaitStatus(I2Cx));
 }
 
 /********************************************************************//**
@@ -192,6 +223,8 @@ static uint32_t I2C_SendByte (LPC_I2C_TypeDef *I2Cx, uint8_t databyte)
  *********************************************************************/
 static uint32_t I2C_GetByte (LPC_I2C_TypeDef *I2Cx, uint8_t *retdat, Bool ack)
 {
+	uint32_t CodeStatus;
+
 	if (ack == TRUE)
 	{
 		I2Cx->I2CONSET = I2C_I2CONSET_AA;
@@ -202,9 +235,33 @@ static uint32_t I2C_GetByte (LPC_I2C_TypeDef *I2Cx, uint8_t *retdat, Bool ack)
 	}
 	I2Cx->I2CONCLR = I2C_I2CONCLR_SIC;
 
-	while (!(I2Cx->I2CONSET & I2C_I2CONSET_SI));
+	CodeStatus = I2C_WaitStatus(I2Cx);
 	*retdat = (uint8_t) (I2Cx->I2DAT & I2C_I2DAT_BITMASK);
-	return (I2Cx->I2STAT & I2C_STAT_CODE_BITMASK);
+	return (CodeStatus);
+}
+
+/********************************************************************//**
+ * @brief		Count a failed bus step of a polled transfer: a timeout
+ * 				waiting for the bus, or a byte not acknowledged. Other
+ * 				failures (e.g. arbitration lost) are only counted as
+ * 				retries and errors.
+ * @param[in]	CodeStatus: status code returned by the failed step
+ * @return 		None
+ *********************************************************************/
+static void I2C_CountFailure (uint32_t CodeStatus)
+{
+	switch (CodeStatus){
+	case I2C_I2STAT_NO_INF:
+		STATS_INC(i2c_timeouts);
+		break;
+	case I2C_I2STAT_M_TX_SLAW_NACK:
+	case I2C_I2STAT_M_TX_DAT_NACK:
+	case I2C_I2STAT_M_RX_SLAR_NACK:
+		STATS_INC(i2c_nacks);
+		break;
+	default:
+		break;
+	}
 }
 
 /*********************************************************************//**
@@ -493,6 +550,7 @@ next_stage:
 		case I2C_I2STAT_M_TX_DAT_NACK:
 			// update status
 			txrx_setup->status |= I2C_SETUP_STATUS_NOACKF;
+			STATS_INC(i2c_nacks);
 			goto retry;
 		/* Arbitration lost in SLA+R/W or Data bytes -------------------------------*/
 		case I2C_I2STAT_M_TX_ARB_LOST:
@@ -574,6 +632,7 @@ send_slar:
 		case I2C_I2STAT_M_RX_SLAR_NACK:
 			// update status
 			txrx_setup->status |= I2C_SETUP_STATUS_NOACKF;
+			STATS_INC(i2c_nacks);
 			goto retry;
 
 		/* Arbitration lost ----------------------------------------------------*/
@@ -589,6 +648,7 @@ retry:
 				I2Cx->I2CONSET = I2C_I2CONSET_STA;
 				I2Cx->I2CONCLR = I2C_I2CONCLR_AAC | I2C_I2CONCLR_SIC;
 				txrx_setup->retransmissions_count++;
+				STATS_INC(i2c_retries);
 			}
 			// End of stage
 			else {
@@ -597,6 +657,9 @@ end_stage:
 				I2C_IntCmd(I2Cx, 0);
 				// Send stop
 				I2C_Stop(I2Cx);
+				if (!(txrx_setup->status & I2C_SETUP_STATUS_DONE)){
+					STATS_INC(i2c_errors);
+				}
 
 				I2C_MasterComplete[tmp] = TRUE;
 			}
@@ -782,6 +845,9 @@ Status I2C_MasterTransferData(LPC_I2C_TypeDef *I2Cx, I2C_M_SETUP_Type *TransferC
 	uint8_t *rxdat;
 	uint32_t CodeStatus;
 	uint8_t tmp;
+	PROF_BEGIN(PROF_ID_I2C_TRANSFER);
+	TRACE_DRV_BEGIN(TRACE_DRV_I2C);
+	STATS_INC(i2c_transfers);
 
 	// reset all default state
 	txdat = (uint8_t *) TransferCfg->tx_data;
@@ -808,6 +874,7 @@ retry:
 		CodeStatus = I2C_Start(I2Cx);
 		if ((CodeStatus != I2C_I2STAT_M_TX_START) \
 				&& (CodeStatus != I2C_I2STAT_M_TX_RESTART)){
+			I2C_CountFailure(CodeStatus);
 			TransferCfg->retransmissions_count++;
 			if (TransferCfg->retransmissions_count > TransferCfg->retransmissions_max){
 				// save status
@@ -824,6 +891,7 @@ retry:
 			/* Send slave address + WR direction bit = 0 ----------------------------------- */
 			CodeStatus = I2C_SendByte(I2Cx, (TransferCfg->sl_addr7bit << 1));
 			if (CodeStatus != I2C_I2STAT_M_TX_SLAW_ACK){
+				I2C_CountFailure(CodeStatus);
 				TransferCfg->retransmissions_count++;
 				if (TransferCfg->retransmissions_count > TransferCfg->retransmissions_max){
 					// save status
@@ -839,6 +907,7 @@ retry:
 			{
 				CodeStatus = I2C_SendByte(I2Cx, *txdat);
 				if (CodeStatus != I2C_I2STAT_M_TX_DAT_ACK){
+					I2C_CountFailure(CodeStatus);
 					TransferCfg->retransmissions_count++;
 					if (TransferCfg->retransmissions_count > TransferCfg->retransmissions_max){
 						// save status
@@ -861,6 +930,7 @@ retry:
 			CodeStatus = I2C_Start(I2Cx);
 			if ((CodeStatus != I2C_I2STAT_M_RX_START) \
 					&& (CodeStatus != I2C_I2STAT_M_RX_RESTART)){
+				I2C_CountFailure(CodeStatus);
 				TransferCfg->retransmissions_count++;
 				if (TransferCfg->retransmissions_count > TransferCfg->retransmissions_max){
 					// Update status
@@ -878,6 +948,7 @@ retry:
 
 			CodeStatus = I2C_SendByte(I2Cx, ((TransferCfg->sl_addr7bit << 1) | 0x01));
 			if (CodeStatus != I2C_I2STAT_M_RX_SLAR_ACK){
+				I2C_CountFailure(CodeStatus);
 				TransferCfg->retransmissions_count++;
 				if (TransferCfg->retransmissions_count > TransferCfg->retransmissions_max){
 					// update status
@@ -900,6 +971,7 @@ retry:
 					// Issue an ACK signal for next data frame
 					CodeStatus = I2C_GetByte(I2Cx, &tmp, 1);
 					if (CodeStatus != I2C_I2STAT_M_RX_DAT_ACK){
+						I2C_CountFailure(CodeStatus);
 						TransferCfg->retransmissions_count++;
 						if (TransferCfg->retransmissions_count > TransferCfg->retransmissions_max){
 							// update status
@@ -913,6 +985,7 @@ retry:
 					// Do not issue an ACK signal
 					CodeStatus = I2C_GetByte(I2Cx, &tmp, 0);
 					if (CodeStatus != I2C_I2STAT_M_RX_DAT_NACK){
+						I2C_CountFailure(CodeStatus);
 						TransferCfg->retransmissions_count++;
 						if (TransferCfg->retransmissions_count > TransferCfg->retransmissions_max){
 							// update status
@@ -930,11 +1003,19 @@ retry:
 
 		/* Send STOP condition ------------------------------------------------- */
 		I2C_Stop(I2Cx);
+		STATS_ADD(i2c_retries, TransferCfg->retransmissions_count);
+		PROF_END(PROF_ID_I2C_TRANSFER);
+		TRACE_DRV_END(TRACE_DRV_I2C);
 		return SUCCESS;
 
 error:
 		// Send stop condition
 		I2C_Stop(I2Cx);
+		// the last failure is not retried
+		STATS_ADD(i2c_retries, TransferCfg->retransmissions_count - 1);
+		STATS_INC(i2c_errors);
+		PROF_END(PROF_ID_I2C_TRANSFER);
+		TRACE_DRV_END(TRACE_DRV_I2C);
 		return ERROR;
 	}
 
@@ -950,9 +1031,13 @@ error:
 		I2Cx->I2CONSET = I2C_I2CONSET_STA;
 		I2C_IntCmd(I2Cx, 1);
 
+		PROF_END(PROF_ID_I2C_TRANSFER);
+		TRACE_DRV_END(TRACE_DRV_I2C);
 		return (SUCCESS);
 	}
 
+	PROF_END(PROF_ID_I2C_TRANSFER);
+	TRACE_DRV_END(TRACE_DRV_I2C);
 	return ERROR;
 }
 
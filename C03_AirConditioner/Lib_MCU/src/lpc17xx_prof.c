@@ -0,0 +1,187 @@
+/**********************************************************************
+* $Id$		lpc17xx_prof.c				2026-10-19
+*//**
+* @file		lpc17xx_prof.c
+* @brief	Contains all functions support for the DWT cycle counter
+* 			profiler on LPC17xx
+* @version	1.0
+* @date		19. Oct. 2026
+**********************************************************************/
+
+/* Peripheral group ----------------------------------------------------------- */
+/** @addtogroup PROF
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------- */
+#include "lpc17xx_prof.h"
+
+
+/* If this source file built with example, the LPC17xx FW library configuration
+ * file in each example directory ("lpc17xx_libcfg.h") must be included,
+ * otherwise the default FW library configuration file must be included instead
+ */
+#ifdef __BUILD_WITH_EXAMPLE__
+#include "lpc17xx_libcfg.h"
+#else
+#include "lpc17xx_libcfg_default.h"
+#endif /* __BUILD_WITH_EXAMPLE__ */
+
+
+#ifdef _PROF
+
+/* Private Types -------------------------------------------------------------- */
+
+typedef struct {
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint64_t sum;
+} PROF_STAT_Type;
+
+/* Private Variables ---------------------------------------------------------- */
+
+static PROF_STAT_Type prof_stats[PROF_NUM_IDS];
+
+/** Cycles between the two counter reads of an empty probe */
+static uint32_t prof_overhead = 0;
+
+static const char * const prof_names[PROF_NUM_IDS] = {
+	"oled_putString",
+	"temp_read",
+	"light_read",
+	"SSP_ReadWrite",
+	"I2C_Transfer",
+	"main_loop",
+	"control_step",
+};
+
+/* Public Functions ----------------------------------------------------------- */
+/** @addtogroup PROF_Public_Functions
+ * @{
+ */
+
+/********************************************************************//**
+ * @brief 		Enable the DWT cycle counter, measure the probe overhead
+ * 				and clear the table
+ * @param[in]	None
+ * @return		None
+ *********************************************************************/
+void PROF_Init(void)
+{
+	uint32_t start, cycles;
+	uint8_t i;
+
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	PROF_DWT_CYCCNT = 0;
+	PROF_DWT_CTRL |= PROF_DWT_CTRL_CYCCNTENA;
+
+	prof_overhead = 0xFFFFFFFF;
+	for (i = 0; i < 8; i++) {
+		start = PROF_DWT_CYCCNT;
+		cycles = PROF_DWT_CYCCNT - start;
+		if (cycles < prof_overhead) {
+			prof_overhead = cycles;
+		}
+	}
+
+	PROF_Reset();
+}
+
+/********************************************************************//**
+ * @brief 		Add a measurement to the table, called by PROF_END
+ * @param[in]	id		Probe id
+ * @param[in]	cycles	Measured cycles, the probe overhead is subtracted
+ * @return		None
+ *********************************************************************/
+void PROF_Record(PROF_ID_Type id, uint32_t cycles)
+{
+	PROF_STAT_Type *s = &prof_stats[id];
+	uint32_t primask;
+
+	cycles = (cycles > prof_overhead) ? (cycles - prof_overhead) : 0;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if ((s->count == 0) || (cycles < s->min)) {
+		s->min = cycles;
+	}
+	if (cycles > s->max) {
+		s->max = cycles;
+	}
+	s->sum += cycles;
+	s->count++;
+	__set_PRIMASK(primask);
+}
+
+/********************************************************************//**
+ * @brief 		Clear all measurements
+ * @param[in]	None
+ * @return		None
+ *********************************************************************/
+void PROF_Reset(void)
+{
+	uint32_t primask;
+	uint8_t i;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	for (i = 0; i < PROF_NUM_IDS; i++) {
+		prof_stats[i].count = 0;
+		prof_stats[i].min = 0;
+		prof_stats[i].max = 0;
+		prof_stats[i].sum = 0;
+	}
+	__set_PRIMASK(primask);
+}
+
+/********************************************************************//**
+ * @brief 		Get the statistics of one probe
+ * @param[in]	id		Probe id
+ * @param[out]	entry	Statistics, in CPU cycles
+ * @return		SUCCESS, or ERROR for an invalid id
+ *********************************************************************/
+Status PROF_GetEntry(PROF_ID_Type id, PROF_ENTRY_Type *entry)
+{
+	PROF_STAT_Type s;
+	uint32_t primask;
+
+	if (id >= PROF_NUM_IDS) {
+		return ERROR;
+	}
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	s = prof_stats[id];
+	__set_PRIMASK(primask);
+
+	entry->name = prof_names[id];
+	entry->count = s.count;
+	entry->min = s.min;
+	entry->max = s.max;
+	entry->mean = (s.count != 0) ? (uint32_t)(s.sum / s.count) : 0;
+
+	return SUCCESS;
+}
+
+/********************************************************************//**
+ * @brief 		Get the probe overhead subtracted from each measurement
+ * @param[in]	None
+ * @return		Overhead in CPU cycles
+ *********************************************************************/
+uint32_t PROF_GetOverhead(void)
+{
+	return prof_overhead;
+}
+
+/**
+ * @}
+ */
+
+#endif /* _PROF */
+
+/**
+ * @}
+ */
+
+/* --------------------------------- End Of File ------------------------------ */
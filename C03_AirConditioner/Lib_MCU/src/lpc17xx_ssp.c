@@ -30,6 +30,9 @@
 
 /* Includes ------------------------------------------------------------------- */
 #include "lpc17xx_ssp.h"
+#include "lpc17xx_prof.h"
+#include "lpc17xx_trace.h"
+#include "lpc17xx_stats.h"
 #include "lpc17xx_clkpwr.h"
 
 
@@ -352,6 +355,8 @@ int32_t SSP_ReadWrite (LPC_SSP_TypeDef *SSPx, SSP_DATA_SETUP_Type *dataCfg, \
     uint32_t stat;
     uint32_t tmp;
     int32_t dataword;
+    PROF_BEGIN(PROF_ID_SSP_READWRITE);
+    TRACE_DRV_BEGIN(TRACE_DRV_SSP);
 
     dataCfg->rx_cnt = 0;
     dataCfg->tx_cnt = 0;
@@ -406,6 +411,9 @@ int32_t SSP_ReadWrite (LPC_SSP_TypeDef *SSPx, SSP_DATA_SETUP_Type *dataCfg, \
 			if ((stat = SSPx->RIS) & SSP_RIS_ROR){
 				// save status and return
 				dataCfg->status = stat | SSP_STAT_ERROR;
+				STATS_INC(ssp_overruns);
+				PROF_END(PROF_ID_SSP_READWRITE);
+				TRACE_DRV_END(TRACE_DRV_SSP);
 				return (-1);
 			}
 
@@ -436,12 +444,19 @@ int32_t SSP_ReadWrite (LPC_SSP_TypeDef *SSPx, SSP_DATA_SETUP_Type *dataCfg, \
 
 		// save status
 		dataCfg->status = SSP_STAT_DONE;
+		STATS_ADD(ssp_bytes, dataCfg->tx_cnt);
 
 		if (dataCfg->tx_data != NULL){
+			PROF_END(PROF_ID_SSP_READWRITE);
+			TRACE_DRV_END(TRACE_DRV_SSP);
 			return dataCfg->tx_cnt;
 		} else if (dataCfg->rx_data != NULL){
+			PROF_END(PROF_ID_SSP_READWRITE);
+			TRACE_DRV_END(TRACE_DRV_SSP);
 			return dataCfg->rx_cnt;
 		} else {
+			PROF_END(PROF_ID_SSP_READWRITE);
+			TRACE_DRV_END(TRACE_DRV_SSP);
 			return (0);
 		}
 	}
@@ -473,6 +488,9 @@ int32_t SSP_ReadWrite (LPC_SSP_TypeDef *SSPx, SSP_DATA_SETUP_Type *dataCfg, \
 			if ((stat = SSPx->RIS) & SSP_RIS_ROR){
 				// save status and return
 				dataCfg->status = stat | SSP_STAT_ERROR;
+				STATS_INC(ssp_overruns);
+				PROF_END(PROF_ID_SSP_READWRITE);
+				TRACE_DRV_END(TRACE_DRV_SSP);
 				return (-1);
 			}
 
@@ -507,9 +525,13 @@ int32_t SSP_ReadWrite (LPC_SSP_TypeDef *SSPx, SSP_DATA_SETUP_Type *dataCfg, \
 			// Save status
 			dataCfg->status = SSP_STAT_DONE;
 		}
+		PROF_END(PROF_ID_SSP_READWRITE);
+		TRACE_DRV_END(TRACE_DRV_SSP);
 		return (0);
 	}
 
+	PROF_END(PROF_ID_SSP_READWRITE);
+	TRACE_DRV_END(TRACE_DRV_SSP);
 	return (-1);
 }
 
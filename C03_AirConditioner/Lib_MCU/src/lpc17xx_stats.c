@@ -0,0 +1,87 @@
+/**********************************************************************
+* $Id$		lpc17xx_stats.c				2026-10-19
+*//**
+* @file		lpc17xx_stats.c
+* @brief	Contains all functions support for the driver runtime
+* 			counters on LPC17xx
+* @version	1.0
+* @date		19. Oct. 2026
+**********************************************************************/
+
+/* Peripheral group ----------------------------------------------------------- */
+/** @addtogroup STATS
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------- */
+#include "lpc17xx_stats.h"
+
+
+/* If this source file built with example, the LPC17xx FW library configuration
+ * file in each example directory ("lpc17xx_libcfg.h") must be included,
+ * otherwise the default FW library configuration file must be included instead
+ */
+#ifdef __BUILD_WITH_EXAMPLE__
+#include "lpc17xx_libcfg.h"
+#else
+#include "lpc17xx_libcfg_default.h"
+#endif /* __BUILD_WITH_EXAMPLE__ */
+
+
+#ifdef _STATS
+
+/* Public Variables ----------------------------------------------------------- */
+
+volatile STATS_Type STATS_Counters;
+
+/* Public Functions ----------------------------------------------------------- */
+/** @addtogroup STATS_Public_Functions
+ * @{
+ */
+
+/********************************************************************//**
+ * @brief 		Copy all counters with interrupts disabled, so that no
+ * 				counter of the copy is newer than another
+ * @param[out]	snap	The counters
+ * @return		None
+ *********************************************************************/
+void STATS_Snapshot(STATS_Type *snap)
+{
+	uint32_t primask;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	*snap = *(STATS_Type *)&STATS_Counters;
+	__set_PRIMASK(primask);
+}
+
+/********************************************************************//**
+ * @brief 		Clear all counters
+ * @param[in]	None
+ * @return		None
+ *********************************************************************/
+void STATS_Reset(void)
+{
+	uint32_t primask;
+	uint32_t *p = (uint32_t *)&STATS_Counters;
+	uint32_t i;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	for (i = 0; i < sizeof(STATS_Type) / sizeof(uint32_t); i++) {
+		p[i] = 0;
+	}
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @}
+ */
+
+#endif /* _STATS */
+
+/**
+ * @}
+ */
+
+/* --------------------------------- End Of File ------------------------------ */
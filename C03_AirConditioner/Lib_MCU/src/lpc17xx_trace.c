@@ -0,0 +1,89 @@
+/**********************************************************************
+* $Id$		lpc17xx_trace.c				2026-10-19
+*//**
+* @file		lpc17xx_trace.c
+* @brief	Contains all functions support for the ITM/SWO event trace
+* 			on LPC17xx
+* @version	1.0
+* @date		19. Oct. 2026
+**********************************************************************/
+
+/* Peripheral group ----------------------------------------------------------- */
+/** @addtogroup TRACE
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------- */
+#include "lpc17xx_trace.h"
+
+
+/* If this source file built with example, the LPC17xx FW library configuration
+ * file in each example directory ("lpc17xx_libcfg.h") must be included,
+ * otherwise the default FW library configuration file must be included instead
+ */
+#ifdef __BUILD_WITH_EXAMPLE__
+#include "lpc17xx_libcfg.h"
+#else
+#include "lpc17xx_libcfg_default.h"
+#endif /* __BUILD_WITH_EXAMPLE__ */
+
+
+#ifdef _TRACE
+
+/* Public Variables ----------------------------------------------------------- */
+
+volatile uint32_t TRACE_Lost = 0;
+
+/* Public Functions ----------------------------------------------------------- */
+/** @addtogroup TRACE_Public_Functions
+ * @{
+ */
+
+/********************************************************************//**
+ * @brief 		Enable the ITM with local timestamps and the trace ports.
+ * 				The timestamps count CPU cycles and are sent after the
+ * 				events they belong to, so events cost no timer read.
+ * @param[in]	swoBaud	SWO bit rate in NRZ mode, 0 to keep the TPIU setup
+ * 				made by the debugger
+ * @return		None
+ *********************************************************************/
+void TRACE_Init(uint32_t swoBaud)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+
+	if (swoBaud != 0) {
+		TRACE_TPIU_SPPR = TRACE_TPIU_SPPR_NRZ;
+		TRACE_TPIU_ACPR = (SystemCoreClock / swoBaud) - 1;
+		TRACE_TPIU_FFCR = TRACE_TPIU_FFCR_BYPASS;
+	}
+
+	ITM->LAR = TRACE_ITM_UNLOCK;
+	ITM->TCR = (1UL << ITM_TCR_ATBID_Pos) | ITM_TCR_SYNCENA_Msk \
+			| ITM_TCR_TSENA_Msk | ITM_TCR_ITMENA_Msk;
+	ITM->TPR = 0;
+	ITM->TER |= TRACE_PORT_MASK;
+
+	TRACE_Lost = 0;
+}
+
+/********************************************************************//**
+ * @brief 		Get the number of events dropped on a full ITM FIFO
+ * @param[in]	None
+ * @return		Dropped events
+ *********************************************************************/
+uint32_t TRACE_GetLost(void)
+{
+	return TRACE_Lost;
+}
+
+/**
+ * @}
+ */
+
+#endif /* _TRACE */
+
+/**
+ * @}
+ */
+
+/* --------------------------------- End Of File ------------------------------ */
@@ -0,0 +1,333 @@
+/*****************************************************************************
+ *   bench.c:  Microbenchmarks of the driver library hot paths
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: Times the driver operations the air conditioner firmware spends
+ * its time in, with the DWT cycle counter, and reports them on UART3
+ * (115200 8N1, the telemetry port of the firmware) as CSV, one line per
+ * benchmark:
+ *
+ *   # bench cpu_hz=100000000
+ *   name,n,cycles,min,max,ops_per_s,bytes,bytes_per_s
+ *   ssp_rw_1,1000,...
+ *   ...
+ *   # end
+ *
+ * cycles is the mean of n operations, min and max the extremes; bytes is
+ * the payload of one operation. Lines starting with '#' are comments.
+ * No interrupts are enabled, so the numbers are of the drivers alone.
+ *
+ * The SSP transfers run with no chip select asserted. The flash benchmark
+ * programs page BENCH_FLASH_PAGE and the EEPROM one the first page; the
+ * firmware does not use either. The same source runs on the host
+ * simulator as host/build/fwbench, where the cycles follow the cost model
+ * of host/src/sim.c.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "lpc17xx_pinsel.h"
+#include "lpc17xx_gpio.h"
+#include "lpc17xx_i2c.h"
+#include "lpc17xx_ssp.h"
+#include "lpc17xx_uart.h"
+#include "lpc17xx_prof.h"
+#include "oled.h"
+#include "rgb.h"
+#include "eeprom.h"
+#include "flash.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define BENCH_UART        LPC_UART3
+#define BENCH_BAUD        115200
+
+#define LIGHT_I2C_ADDR    0x44
+#define LIGHT_REG_CMD     0x00
+#define EEPROM_I2C_ADDR   0x50
+#define EEPROM_PAGE       16
+
+#define FLASH_BENCH_PAGE  2047  /* the page below the sensor trace area */
+#define FLASH_PAGE_BYTES  256
+
+#define GPIO_BENCH_PORT   2     /* red LED of the RGB LED */
+#define GPIO_BENCH_PIN    (1 << 0)
+
+#define SSP_MAX_LEN       1024
+#define I2C_BURST_LEN     64
+
+typedef struct
+{
+    const char *name;
+    void (*run)(uint32_t i);    /* one operation */
+    uint32_t n;                 /* operations */
+    uint32_t bytes;             /* payload of one operation */
+} bench_t;
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static uint8_t buf[SSP_MAX_LEN];
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static void init_uart(void)
+{
+    UART_CFG_Type uartCfg;
+    UART_FIFO_CFG_Type fifoCfg;
+    PINSEL_CFG_Type pinCfg;
+
+    pinCfg.Funcnum = 2;
+    pinCfg.OpenDrain = 0;
+    pinCfg.Pinmode = 0;
+    pinCfg.Portnum = 0;
+    pinCfg.Pinnum = 0;
+    PINSEL_ConfigPin(&pinCfg);
+    pinCfg.Pinnum = 1;
+    PINSEL_ConfigPin(&pinCfg);
+
+    UART_ConfigStructInit(&uartCfg);
+    uartCfg.Baud_rate = BENCH_BAUD;
+    UART_Init(BENCH_UART, &uartCfg);
+    UART_FIFOConfigStructInit(&fifoCfg);
+    UART_FIFOConfig(BENCH_UART, &fifoCfg);
+    UART_TxCmd(BENCH_UART, ENABLE);
+}
+
+static void init_ssp(void)
+{
+    SSP_CFG_Type sspCfg;
+    PINSEL_CFG_Type pinCfg;
+
+    /* P0.7 SCK, P0.8 MISO, P0.9 MOSI; P2.2 flash chip select as GPIO */
+    pinCfg.Funcnum = 2;
+    pinCfg.OpenDrain = 0;
+    pinCfg.Pinmode = 0;
+    pinCfg.Portnum = 0;
+    pinCfg.Pinnum = 7;
+    PINSEL_ConfigPin(&pinCfg);
+    pinCfg.Pinnum = 8;
+    PINSEL_ConfigPin(&pinCfg);
+    pinCfg.Pinnum = 9;
+    PINSEL_ConfigPin(&pinCfg);
+    pinCfg.Funcnum = 0;
+    pinCfg.Portnum = 2;
+    pinCfg.Pinnum = 2;
+    PINSEL_ConfigPin(&pinCfg);
+
+    SSP_ConfigStructInit(&sspCfg);
+    SSP_Init(LPC_SSP1, &sspCfg);
+    SSP_Cmd(LPC_SSP1, ENABLE);
+}
+
+static void init_i2c(void)
+{
+    PINSEL_CFG_Type pinCfg;
+
+    /* P0.10 SDA2, P0.11 SCL2 */
+    pinCfg.Funcnum = 2;
+    pinCfg.OpenDrain = 0;
+    pinCfg.Pinmode = 0;
+    pinCfg.Portnum = 0;
+    pinCfg.Pinnum = 10;
+    PINSEL_ConfigPin(&pinCfg);
+    pinCfg.Pinnum = 11;
+    PINSEL_ConfigPin(&pinCfg);
+
+    I2C_Init(LPC_I2C2, 100000);
+    I2C_Cmd(LPC_I2C2, ENABLE);
+}
+
+static void print(const char *s)
+{
+    UART_Send(BENCH_UART, (uint8_t *)s, strlen(s), BLOCKING);
+}
+
+static void sspTransfer(uint32_t len)
+{
+    SSP_DATA_SETUP_Type xfer;
+
+    xfer.tx_data = buf;
+    xfer.rx_data = NULL;
+    xfer.length = len;
+    SSP_ReadWrite(LPC_SSP1, &xfer, SSP_TRANSFER_POLLING);
+}
+
+static void i2cRead(uint8_t addr, uint8_t reg, uint8_t *data, uint32_t len)
+{
+    I2C_M_SETUP_Type xfer;
+
+    xfer.sl_addr7bit = addr;
+    xfer.tx_data = &reg;
+    xfer.tx_length = 1;
+    xfer.rx_data = data;
+    xfer.rx_length = len;
+    xfer.retransmissions_max = 3;
+    I2C_MasterTransferData(LPC_I2C2, &xfer, I2C_TRANSFER_POLLING);
+}
+
+static void benchSsp1(uint32_t i)
+{
+    sspTransfer(1);
+}
+
+static void benchSsp16(uint32_t i)
+{
+    sspTransfer(16);
+}
+
+static void benchSsp132(uint32_t i)
+{
+    sspTransfer(132);
+}
+
+static void benchSsp1024(uint32_t i)
+{
+    sspTransfer(1024);
+}
+
+static void benchI2cSingle(uint32_t i)
+{
+    uint8_t v = 0;
+
+    i2cRead(LIGHT_I2C_ADDR, LIGHT_REG_CMD, &v, 1);
+}
+
+static void benchI2cBurst(uint32_t i)
+{
+    i2cRead(EEPROM_I2C_ADDR, 0, buf, I2C_BURST_LEN);
+}
+
+static void benchGpioToggle(uint32_t i)
+{
+    GPIO_SetValue(GPIO_BENCH_PORT, GPIO_BENCH_PIN);
+    GPIO_ClearValue(GPIO_BENCH_PORT, GPIO_BENCH_PIN);
+}
+
+static void benchPutChar(uint32_t i)
+{
+    oled_putChar(1 + (i % 15) * 6, 1, 'A' + (i % 26), OLED_COLOR_BLACK,
+            OLED_COLOR_WHITE);
+}
+
+static void benchClearScreen(uint32_t i)
+{
+    oled_clearScreen((i & 1) ? OLED_COLOR_WHITE : OLED_COLOR_BLACK);
+}
+
+static void benchFlashRead(uint32_t i)
+{
+    flash_read(buf, FLASH_BENCH_PAGE * flash_getPageSize(), FLASH_PAGE_BYTES);
+}
+
+static void benchFlashWrite(uint32_t i)
+{
+    flash_write(buf, FLASH_BENCH_PAGE * flash_getPageSize(),
+            FLASH_PAGE_BYTES);
+}
+
+static void benchEepromWrite(uint32_t i)
+{
+    eeprom_write(buf, 0, EEPROM_PAGE);
+}
+
+static const bench_t benches[] = {
+    { "ssp_rw_1",          benchSsp1,        1000, 1 },
+    { "ssp_rw_16",         benchSsp16,       1000, 16 },
+    { "ssp_rw_132",        benchSsp132,      200,  132 },
+    { "ssp_rw_1024",       benchSsp1024,     50,   1024 },
+    { "i2c_read_single",   benchI2cSingle,   200,  1 },
+    { "i2c_read_burst_64", benchI2cBurst,    50,   I2C_BURST_LEN },
+    { "gpio_toggle",       benchGpioToggle,  10000, 0 },
+    { "oled_putChar",      benchPutChar,     100,  0 },
+    { "oled_clearScreen",  benchClearScreen, 10,   0 },
+    { "flash_read_page",   benchFlashRead,   50,   FLASH_PAGE_BYTES },
+    { "flash_write_page",  benchFlashWrite,  10,   FLASH_PAGE_BYTES },
+    { "eeprom_write_page", benchEepromWrite, 10,   EEPROM_PAGE },
+};
+
+static void runBench(const bench_t *b)
+{
+    char line[128];
+    uint64_t total = 0;
+    uint32_t min = 0xFFFFFFFF;
+    uint32_t max = 0;
+    uint32_t start = 0;
+    uint32_t cycles = 0;
+    uint32_t mean = 0;
+    uint32_t i = 0;
+
+    for (i = 0; i < b->n; i++) {
+        start = PROF_DWT_CYCCNT;
+        b->run(i);
+        cycles = PROF_DWT_CYCCNT - start;
+
+        total += cycles;
+        if (cycles < min) {
+            min = cycles;
+        }
+        if (cycles > max) {
+            max = cycles;
+        }
+    }
+
+    mean = (uint32_t)(total / b->n);
+    if (mean == 0) {
+        mean = 1;
+    }
+    snprintf(line, sizeof(line), "%s,%u,%u,%u,%u,%u,%u,%u\r\n", b->name,
+            (unsigned)b->n, (unsigned)mean, (unsigned)min, (unsigned)max,
+            (unsigned)(SystemCoreClock / mean), (unsigned)b->bytes,
+            (unsigned)((uint64_t)b->bytes * SystemCoreClock / mean));
+    print(line);
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+int main(void)
+{
+    char line[64];
+    uint32_t i = 0;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    PROF_DWT_CYCCNT = 0;
+    PROF_DWT_CTRL |= PROF_DWT_CTRL_CYCCNTENA;
+
+    init_uart();
+    init_ssp();
+    init_i2c();
+    rgb_init();
+    oled_init();
+    eeprom_init();
+    flash_init();
+
+    for (i = 0; i < sizeof(buf); i++) {
+        buf[i] = i;
+    }
+
+    snprintf(line, sizeof(line), "# bench cpu_hz=%u\r\n",
+            (unsigned)SystemCoreClock);
+    print(line);
+    print("name,n,cycles,min,max,ops_per_s,bytes,bytes_per_s\r\n");
+    for (i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+        runBench(&benches[i]);
+    }
+    print("# end\r\n");
+
+    while (1) {
+        __WFI();
+    }
+}
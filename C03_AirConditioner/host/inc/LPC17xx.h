@@ -0,0 +1,67 @@
+/*****************************************************************************
+ *   LPC17xx.h:  Host build replacement for the CMSIS device header
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: The host build puts this directory first on the include path, so
+ * every "LPC17xx.h" of the firmware and the driver library ends up here.
+ *
+ * The register structs and base addresses are taken unchanged from the
+ * CMSIS header; the simulator (sim.c) maps memory at those addresses. Only
+ * the Cortex-M3 intrinsics, which are ARM assembly in core_cm3.h, are
+ * renamed out of the way and replaced by simulator functions.
+ */
+
+#ifndef __HOST_LPC17xx_H
+#define __HOST_LPC17xx_H
+
+#define __enable_irq        cm3_enable_irq
+#define __disable_irq       cm3_disable_irq
+#define __enable_fault_irq  cm3_enable_fault_irq
+#define __disable_fault_irq cm3_disable_fault_irq
+#define __NOP               cm3_NOP
+#define __WFI               cm3_WFI
+#define __WFE               cm3_WFE
+#define __SEV               cm3_SEV
+#define __ISB               cm3_ISB
+#define __DSB               cm3_DSB
+#define __DMB               cm3_DMB
+#define __CLREX             cm3_CLREX
+
+#include "../../Lib_CMSISv1p30_LPC17xx/inc/LPC17xx.h"
+
+#undef __enable_irq
+#undef __disable_irq
+#undef __enable_fault_irq
+#undef __disable_fault_irq
+#undef __NOP
+#undef __WFI
+#undef __WFE
+#undef __SEV
+#undef __ISB
+#undef __DSB
+#undef __DMB
+#undef __CLREX
+
+void sim_enableIrq(void);
+void sim_disableIrq(void);
+void sim_waitForInterrupt(void);
+
+#define __enable_irq()          sim_enableIrq()
+#define __disable_irq()         sim_disableIrq()
+#define __enable_fault_irq()
+#define __disable_fault_irq()
+#define __NOP()
+#define __WFI()                 sim_waitForInterrupt()
+#define __WFE()                 sim_waitForInterrupt()
+#define __SEV()
+#define __ISB()
+#define __DSB()
+#define __DMB()
+#define __CLREX()
+
+#endif /* end __HOST_LPC17xx_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
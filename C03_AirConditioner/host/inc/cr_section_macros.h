@@ -0,0 +1,24 @@
+/*****************************************************************************
+ *   cr_section_macros.h:  Host build replacement for the MCUXpresso header
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: On the target these macros put code and data in the sections the
+ * managed linker script places in a given RAM bank. The host has only one
+ * kind of memory, so they expand to nothing and everything stays where
+ * the host linker puts it.
+ */
+
+#ifndef __HOST_CR_SECTION_MACROS_H
+#define __HOST_CR_SECTION_MACROS_H
+
+#define __DATA(RAM)
+#define __BSS(RAM)
+#define __NOINIT(RAM)
+#define __RAMFUNC(RAM)
+
+#endif /* end __HOST_CR_SECTION_MACROS_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
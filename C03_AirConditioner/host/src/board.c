@@ -0,0 +1,464 @@
+/*****************************************************************************
+ *   board.c:  Simulated devices of the base board
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: The devices the drivers of Lib_EaBaseBoard talk to, on the buses
+ * and pins of the base board:
+ *
+ *  - MAX6576 temperature sensor on P0.2: a square wave with a period of
+ *    10 us per kelvin (TS1 = TS0 = 0).
+ *  - ISL29003 light sensor on I2C2 at 0x44, and MMA7455 accelerometer at
+ *    0x1D: register files with an address pointer that increments.
+ *  - 24LC08 EEPROM on I2C2 at 0x50..0x53, 16 byte pages. The write cycle
+ *    after a STOP is counted but takes no time: the driver waits for it
+ *    with a delay loop, which takes no simulated time either.
+ *  - AT45DB081D dataflash on SSP1 with its chip select on P2.2, in the
+ *    power of 2 page size: device id, status, fast read, page program
+ *    through buffer 1 and page erase. A program or erase keeps the device
+ *    busy for the typical time of the datasheet; other commands are
+ *    ignored.
+ *
+ * The OLED display on SSP1 (chip select P0.6) is in ssd1305.c.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <string.h>
+#include "sim.h"
+#include "board.h"
+#include "ssd1305.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define TEMP_PORT       0
+#define TEMP_PIN        2
+#define KELVIN_OFFSET10 2731        /* 0 C in 0.1 K */
+
+#define LIGHT_ADDR      0x44
+#define LIGHT_CMD       0x00
+#define LIGHT_CTRL      0x01
+#define LIGHT_DATA_LSB  0x04
+#define LIGHT_DATA_MSB  0x05
+
+#define ACC_ADDR        0x1D
+#define ACC_XOUT8       0x06
+#define ACC_STATUS      0x09
+#define ACC_DRDY        0x01
+
+#define EEPROM_ADDR     0x50
+#define EEPROM_BLOCKS   4
+#define EEPROM_BLOCK    256
+#define EEPROM_PAGE     16
+
+#define FLASH_CS_PORT   2
+#define FLASH_CS_PIN    2
+#define FLASH_PAGE      256
+#define FLASH_CMD_RDID      0x9F
+#define FLASH_CMD_RDSR      0xD7
+#define FLASH_CMD_FAST_READ 0x0B
+#define FLASH_CMD_PE        0x81
+#define FLASH_CMD_PP_BUF    0x82
+#define FLASH_CMD_DP        0xB9
+#define FLASH_CMD_RES       0xAB
+#define FLASH_STATUS_RDY    0x80
+#define FLASH_STATUS_ID     0x24    /* density code of the 8 Mbit part */
+#define FLASH_STATUS_POW2   0x01
+#define FLASH_PROGRAM_NS    14000000ULL /* tEP, erase and program */
+#define FLASH_ERASE_NS      13000000ULL /* tPE */
+
+#define REGDEV_SIZE     32
+
+typedef struct
+{
+    uint8_t regs[REGDEV_SIZE];
+    uint8_t ptr;
+    uint8_t first;              /* the next byte written is the pointer */
+    uint8_t (*readReg)(uint8_t reg);
+} regdev_t;
+
+typedef struct
+{
+    uint8_t block;
+    uint8_t ptr;
+    uint8_t first;
+    uint8_t written;
+} eeblock_t;
+
+typedef struct
+{
+    uint32_t idx;               /* byte in the current command */
+    uint8_t cmd;
+    uint32_t addr;
+    uint8_t buf[FLASH_PAGE];
+    uint8_t loaded;
+    uint8_t deep;
+    uint64_t busyUntil;
+} dataflash_t;
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static int32_t temp10 = 250;
+static uint32_t lux = 100;
+
+static regdev_t light;
+static regdev_t acc;
+static eeblock_t eeBlocks[EEPROM_BLOCKS];
+static dataflash_t df;
+
+static uint8_t eeprom[BOARD_EEPROM_SIZE];
+static uint8_t flash[BOARD_FLASH_SIZE];
+
+static board_stats_t stats;
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+/* --- temperature sensor ------------------------------------------------- */
+
+static uint64_t tempPeriod(void)
+{
+    return (uint64_t)(temp10 + KELVIN_OFFSET10) * 1000;
+}
+
+static uint8_t tempLevel(void *ctx, uint64_t now)
+{
+    return (now % tempPeriod()) < tempPeriod() / 2;
+}
+
+static uint64_t tempNextEdge(void *ctx, uint64_t now)
+{
+    uint64_t half = tempPeriod() / 2;
+
+    return (now / half + 1) * half;
+}
+
+/* --- register file devices ---------------------------------------------- */
+
+static uint8_t regStart(void *ctx, uint8_t read)
+{
+    regdev_t *d = (regdev_t *)ctx;
+
+    d->first = !read;
+    return 1;
+}
+
+static uint8_t regWrite(void *ctx, uint8_t b)
+{
+    regdev_t *d = (regdev_t *)ctx;
+
+    if (d->first) {
+        d->ptr = b % REGDEV_SIZE;
+        d->first = 0;
+    }
+    else {
+        d->regs[d->ptr] = b;
+        d->ptr = (d->ptr + 1) % REGDEV_SIZE;
+    }
+    return 1;
+}
+
+static uint8_t regRead(void *ctx)
+{
+    regdev_t *d = (regdev_t *)ctx;
+    uint8_t b = d->readReg != NULL ? d->readReg(d->ptr) : d->regs[d->ptr];
+
+    d->ptr = (d->ptr + 1) % REGDEV_SIZE;
+    return b;
+}
+
+static uint8_t lightReadReg(uint8_t reg)
+{
+    static const uint32_t range[4] = { 973, 3892, 15568, 62272 };
+    static const uint8_t bits[4] = { 16, 12, 8, 4 };
+    uint32_t width = 1UL << bits[light.regs[LIGHT_CMD] & 3];
+    uint32_t data = 0;
+
+    if (reg != LIGHT_DATA_LSB && reg != LIGHT_DATA_MSB) {
+        return light.regs[reg];
+    }
+
+    data = (uint32_t)((uint64_t)lux * width
+            / range[(light.regs[LIGHT_CTRL] >> 2) & 3]);
+    if (data >= width) {
+        data = width - 1;
+    }
+    return (reg == LIGHT_DATA_LSB) ? (data & 0xFF) : (data >> 8);
+}
+
+static sim_i2c_dev_t lightDev = {
+    LIGHT_ADDR, regStart, regWrite, regRead, NULL, &light
+};
+
+static sim_i2c_dev_t accDev = {
+    ACC_ADDR, regStart, regWrite, regRead, NULL, &acc
+};
+
+/* --- EEPROM ------------------------------------------------------------- */
+
+static uint8_t eeStart(void *ctx, uint8_t read)
+{
+    eeblock_t *e = (eeblock_t *)ctx;
+
+    e->first = !read;
+    return 1;
+}
+
+static uint8_t eeWrite(void *ctx, uint8_t b)
+{
+    eeblock_t *e = (eeblock_t *)ctx;
+
+    if (e->first) {
+        e->ptr = b;
+        e->first = 0;
+        return 1;
+    }
+
+    eeprom[e->block * EEPROM_BLOCK + e->ptr] = b;
+    /* the address wraps within the page */
+    e->ptr = (e->ptr & ~(EEPROM_PAGE - 1)) | ((e->ptr + 1) & (EEPROM_PAGE - 1));
+    e->written = 1;
+    return 1;
+}
+
+static uint8_t eeRead(void *ctx)
+{
+    eeblock_t *e = (eeblock_t *)ctx;
+
+    return eeprom[e->block * EEPROM_BLOCK + e->ptr++];
+}
+
+static void eeStop(void *ctx)
+{
+    eeblock_t *e = (eeblock_t *)ctx;
+
+    if (e->written) {
+        e->written = 0;
+        stats.eepromWriteCycles++;
+    }
+}
+
+static sim_i2c_dev_t eeDevs[EEPROM_BLOCKS] = {
+    { EEPROM_ADDR + 0, eeStart, eeWrite, eeRead, eeStop, &eeBlocks[0] },
+    { EEPROM_ADDR + 1, eeStart, eeWrite, eeRead, eeStop, &eeBlocks[1] },
+    { EEPROM_ADDR + 2, eeStart, eeWrite, eeRead, eeStop, &eeBlocks[2] },
+    { EEPROM_ADDR + 3, eeStart, eeWrite, eeRead, eeStop, &eeBlocks[3] },
+};
+
+/* --- dataflash ---------------------------------------------------------- */
+
+static uint8_t dfBusy(void)
+{
+    return sim_now() < df.busyUntil;
+}
+
+static void dfSelect(void *ctx, uint8_t active)
+{
+    uint32_t page = (df.addr % BOARD_FLASH_SIZE) & ~(FLASH_PAGE - 1);
+
+    if (active) {
+        df.idx = 0;
+        df.loaded = 0;
+        return;
+    }
+
+    /* the command runs when the chip select goes high */
+    if (df.idx < 4 || dfBusy()) {
+        return;
+    }
+
+    if (df.cmd == FLASH_CMD_PP_BUF && df.loaded) {
+        memcpy(&flash[page], df.buf, FLASH_PAGE);
+        df.busyUntil = sim_now() + FLASH_PROGRAM_NS;
+        stats.flashPrograms++;
+    }
+    else if (df.cmd == FLASH_CMD_PE) {
+        memset(&flash[page], 0xFF, FLASH_PAGE);
+        df.busyUntil = sim_now() + FLASH_ERASE_NS;
+        stats.flashPrograms++;
+    }
+}
+
+static uint16_t dfXfer(void *ctx, uint16_t out)
+{
+    static const uint8_t id[4] = { 0x1F, 0x25, 0x00, 0x01 };
+    uint32_t i = df.idx++;
+    uint32_t page = 0;
+
+    if (i == 0) {
+        df.cmd = out;
+        df.addr = 0;
+        if (df.cmd == FLASH_CMD_DP) {
+            df.deep = 1;
+        }
+        else if (df.cmd == FLASH_CMD_RES) {
+            df.deep = 0;
+        }
+        else if (df.cmd == FLASH_CMD_RDSR) {
+            stats.flashStatusReads++;
+        }
+        return 0xFF;
+    }
+
+    if (df.deep) {
+        return 0xFF;
+    }
+
+    switch (df.cmd) {
+    case FLASH_CMD_RDID:
+        return (i <= sizeof(id)) ? id[i - 1] : 0;
+
+    case FLASH_CMD_RDSR:
+        return (dfBusy() ? 0 : FLASH_STATUS_RDY) | FLASH_STATUS_ID
+                | FLASH_STATUS_POW2;
+
+    case FLASH_CMD_FAST_READ:
+        if (i <= 3) {
+            df.addr = (df.addr << 8) | out;
+        }
+        else if (i >= 5 && !dfBusy()) {
+            return flash[(df.addr + i - 5) % BOARD_FLASH_SIZE];
+        }
+        return 0xFF;
+
+    case FLASH_CMD_PP_BUF:
+    case FLASH_CMD_PE:
+        if (i <= 3) {
+            df.addr = (df.addr << 8) | out;
+            if (i == 3) {
+                page = (df.addr % BOARD_FLASH_SIZE) & ~(FLASH_PAGE - 1);
+                memcpy(df.buf, &flash[page], FLASH_PAGE);
+            }
+        }
+        else {
+            /* buffer 1 is loaded from the byte address on, wrapping */
+            df.buf[(df.addr + i - 4) % FLASH_PAGE] = out;
+            df.loaded = 1;
+        }
+        return 0xFF;
+    }
+
+    return 0xFF;
+}
+
+static sim_ssp_dev_t flashDev = {
+    FLASH_CS_PORT, FLASH_CS_PIN, dfSelect, dfXfer, NULL
+};
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Attach the base board devices to the simulator. Call after sim_init().
+ *
+ *****************************************************************************/
+void sim_board_init(void)
+{
+    uint8_t i = 0;
+
+    memset(&light, 0, sizeof(light));
+    light.readReg = lightReadReg;
+    memset(&acc, 0, sizeof(acc));
+    acc.regs[ACC_STATUS] = ACC_DRDY;
+    sim_board_setAcc(0, 0, 64);
+
+    memset(eeprom, 0xFF, sizeof(eeprom));
+    memset(flash, 0xFF, sizeof(flash));
+    memset(&df, 0, sizeof(df));
+    memset(&stats, 0, sizeof(stats));
+
+    sim_gpio_setSource(TEMP_PORT, TEMP_PIN, tempLevel, tempNextEdge, NULL);
+    sim_i2c_attach(2, &lightDev);
+    sim_i2c_attach(2, &accDev);
+    for (i = 0; i < EEPROM_BLOCKS; i++) {
+        eeBlocks[i].block = i;
+        sim_i2c_attach(2, &eeDevs[i]);
+    }
+    sim_ssp_attach(1, &flashDev);
+    sim_ssd1305_init();
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Set the temperature the sensor measures
+ *
+ * Params:
+ *   [in] temp - temperature in 0.1 C
+ *
+ *****************************************************************************/
+void sim_board_setTemp(int32_t temp)
+{
+    temp10 = temp;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Set the illuminance the light sensor measures
+ *
+ * Params:
+ *   [in] l - lux
+ *
+ *****************************************************************************/
+void sim_board_setLux(uint32_t l)
+{
+    lux = l;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Set the acceleration the accelerometer measures, 64 counts per g
+ *
+ *****************************************************************************/
+void sim_board_setAcc(int8_t x, int8_t y, int8_t z)
+{
+    acc.regs[ACC_XOUT8] = (uint8_t)x;
+    acc.regs[ACC_XOUT8 + 1] = (uint8_t)y;
+    acc.regs[ACC_XOUT8 + 2] = (uint8_t)z;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the dataflash contents, BOARD_FLASH_SIZE bytes
+ *
+ *****************************************************************************/
+uint8_t *sim_board_getFlash(void)
+{
+    return flash;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the EEPROM contents, BOARD_EEPROM_SIZE bytes
+ *
+ *****************************************************************************/
+uint8_t *sim_board_getEeprom(void)
+{
+    return eeprom;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the device counters
+ *
+ *****************************************************************************/
+void sim_board_getStats(board_stats_t *st)
+{
+    *st = stats;
+}
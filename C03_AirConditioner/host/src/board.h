@@ -0,0 +1,31 @@
+/*****************************************************************************
+ *   board.h:  Header file for the simulated base board devices
+ *
+ ******************************************************************************/
+#ifndef __BOARD_H
+#define __BOARD_H
+
+#include <stdint.h>
+
+#define BOARD_FLASH_SIZE    (4096 * 256)
+#define BOARD_EEPROM_SIZE   1024
+
+typedef struct
+{
+    uint32_t flashPrograms;     /* page programs and erases */
+    uint32_t flashStatusReads;
+    uint32_t eepromWriteCycles;
+} board_stats_t;
+
+void sim_board_init(void);
+void sim_board_setTemp(int32_t temp10);
+void sim_board_setLux(uint32_t lux);
+void sim_board_setAcc(int8_t x, int8_t y, int8_t z);
+uint8_t *sim_board_getFlash(void);
+uint8_t *sim_board_getEeprom(void);
+void sim_board_getStats(board_stats_t *st);
+
+#endif /* end __BOARD_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
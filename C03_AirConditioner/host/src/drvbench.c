@@ -0,0 +1,268 @@
+/*****************************************************************************
+ *   drvbench.c:  Benchmarks the base board drivers on the host
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: Runs the drivers of Lib_EaBaseBoard against the simulated board and
+ * prints, per operation, the simulated time (what it takes on the chip
+ * under the cost model of sim.c) and the host time (what it takes to
+ * simulate). For the OLED operations, the bus traffic the display saw
+ * per operation follows.
+ *
+ * Use: drvbench [-n iterations]
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lpc17xx_pinsel.h"
+#include "lpc17xx_i2c.h"
+#include "lpc17xx_ssp.h"
+#include "oled.h"
+#include "temp.h"
+#include "light.h"
+#include "acc.h"
+#include "eeprom.h"
+#include "flash.h"
+#include "sim.h"
+#include "board.h"
+#include "ssd1305.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+typedef struct
+{
+    const char *name;
+    void (*run)(uint32_t i);
+} bench_t;
+
+#define NUM_BENCHES     (sizeof(benches) / sizeof(benches[0]))
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static volatile uint32_t msTicks = 0;
+static uint8_t buf[256];
+static uint32_t n = 20;
+static ssd1305_frame_t oledTraffic;
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static uint32_t getTicks(void)
+{
+    return msTicks;
+}
+
+static uint64_t hostNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void init_ssp(void)
+{
+    SSP_CFG_Type SSP_ConfigStruct;
+    PINSEL_CFG_Type PinCfg;
+
+    PinCfg.Funcnum = 2;
+    PinCfg.OpenDrain = 0;
+    PinCfg.Pinmode = 0;
+    PinCfg.Portnum = 0;
+    PinCfg.Pinnum = 7;
+    PINSEL_ConfigPin(&PinCfg);
+    PinCfg.Pinnum = 8;
+    PINSEL_ConfigPin(&PinCfg);
+    PinCfg.Pinnum = 9;
+    PINSEL_ConfigPin(&PinCfg);
+
+    SSP_ConfigStructInit(&SSP_ConfigStruct);
+    SSP_Init(LPC_SSP1, &SSP_ConfigStruct);
+    SSP_Cmd(LPC_SSP1, ENABLE);
+}
+
+static void init_i2c(void)
+{
+    PINSEL_CFG_Type PinCfg;
+
+    PinCfg.Funcnum = 2;
+    PinCfg.OpenDrain = 0;
+    PinCfg.Pinmode = 0;
+    PinCfg.Pinnum = 10;
+    PinCfg.Portnum = 0;
+    PINSEL_ConfigPin(&PinCfg);
+    PinCfg.Pinnum = 11;
+    PINSEL_ConfigPin(&PinCfg);
+
+    I2C_Init(LPC_I2C2, 100000);
+    I2C_Cmd(LPC_I2C2, ENABLE);
+}
+
+static void countOled(const ssd1305_frame_t *f, void *ctx)
+{
+    oledTraffic.dataBytes += f->dataBytes;
+    oledTraffic.cmdBytes += f->cmdBytes;
+    oledTraffic.csToggles += f->csToggles;
+}
+
+static void benchOledClear(uint32_t i)
+{
+    oled_clearScreen((i & 1) ? OLED_COLOR_WHITE : OLED_COLOR_BLACK);
+}
+
+static void benchOledString(uint32_t i)
+{
+    oled_putString(1, 1, (uint8_t *)"Temp: 24.5 C", OLED_COLOR_BLACK,
+            OLED_COLOR_WHITE);
+}
+
+static void benchTemp(uint32_t i)
+{
+    temp_read();
+}
+
+static void benchLight(uint32_t i)
+{
+    light_read();
+}
+
+static void benchAcc(uint32_t i)
+{
+    int8_t x, y, z;
+
+    acc_read(&x, &y, &z);
+}
+
+static void benchEepromWrite(uint32_t i)
+{
+    eeprom_write(buf, (i * 16) % 1024, 16);
+}
+
+static void benchEepromRead(uint32_t i)
+{
+    eeprom_read(buf, (i * 64) % 1024, 64);
+}
+
+static void benchFlashWrite(uint32_t i)
+{
+    flash_write(buf, (i * 256) % BOARD_FLASH_SIZE, 256);
+}
+
+static void benchFlashRead(uint32_t i)
+{
+    flash_read(buf, (i * 256) % BOARD_FLASH_SIZE, 256);
+}
+
+static const bench_t benches[] = {
+    { "oled_clearScreen", benchOledClear },
+    { "oled_putString 12 chars", benchOledString },
+    { "temp_read", benchTemp },
+    { "light_read", benchLight },
+    { "acc_read", benchAcc },
+    { "eeprom_write 16 B", benchEepromWrite },
+    { "eeprom_read 64 B", benchEepromRead },
+    { "flash_write 256 B", benchFlashWrite },
+    { "flash_read 256 B", benchFlashRead },
+};
+
+static void runBenches(void)
+{
+    uint32_t b = 0;
+    uint32_t i = 0;
+    uint64_t sim0 = 0;
+    uint64_t host0 = 0;
+    sim_stats_t st0, st1;
+    ssd1305_frame_t oled[NUM_BENCHES];
+
+    SysTick_Config(SystemCoreClock / 1000);
+    init_ssp();
+    init_i2c();
+
+    oled_init();
+    light_init();
+    light_enable();
+    acc_init();
+    temp_init(&getTicks);
+    if (!flash_init()) {
+        fprintf(stderr, "drvbench: flash_init failed\n");
+    }
+
+    for (i = 0; i < sizeof(buf); i++) {
+        buf[i] = i;
+    }
+
+    printf("%-24s %8s %12s %12s %10s\n", "operation", "n", "sim us/op",
+            "host us/op", "traps/op");
+    sim_ssd1305_onFrame(countOled, NULL);
+    for (b = 0; b < NUM_BENCHES; b++) {
+        sim_ssd1305_endFrame(NULL);
+        memset(&oledTraffic, 0, sizeof(oledTraffic));
+        sim_getStats(&st0);
+        sim0 = sim_now();
+        host0 = hostNs();
+        for (i = 0; i < n; i++) {
+            benches[b].run(i);
+        }
+        sim_getStats(&st1);
+        sim_ssd1305_endFrame(NULL);
+        oled[b] = oledTraffic;
+        printf("%-24s %8u %12.1f %12.1f %10.0f\n", benches[b].name, n,
+                (sim_now() - sim0) / 1e3 / n, (hostNs() - host0) / 1e3 / n,
+                (double)(st1.traps - st0.traps) / n);
+    }
+
+    printf("\n%-24s %12s %12s %12s\n", "oled traffic per op", "data B",
+            "command B", "chip selects");
+    for (b = 0; b < NUM_BENCHES; b++) {
+        if (oled[b].dataBytes + oled[b].cmdBytes == 0) {
+            continue;
+        }
+        printf("%-24s %12.1f %12.1f %12.1f\n", benches[b].name,
+                (double)oled[b].dataBytes / n, (double)oled[b].cmdBytes / n,
+                (double)oled[b].csToggles / n);
+    }
+
+    printf("\n");
+    sim_report(stdout);
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+void SysTick_Handler(void)
+{
+    msTicks++;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 3 && strcmp(argv[1], "-n") == 0) {
+        n = strtoul(argv[2], NULL, 0);
+    }
+    else if (argc != 1) {
+        fprintf(stderr, "usage: drvbench [-n iterations]\n");
+        return 1;
+    }
+    if (n == 0) {
+        n = 1;
+    }
+
+    sim_init();
+    sim_board_init();
+    sim_run(runBenches);
+
+    return 0;
+}
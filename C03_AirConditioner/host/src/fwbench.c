@@ -0,0 +1,96 @@
+/*****************************************************************************
+ *   fwbench.c:  Runs the driver microbenchmarks on the host
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: The benchmark firmware of bench/, unchanged, on the simulated
+ * board. Its report on UART3 goes to stdout, in the same CSV as on the
+ * board, and the run ends with the "# end" line. The cycles are simulated
+ * ones, under the cost model of sim.c: they follow bus and peripheral
+ * timing, not the instructions of the drivers.
+ *
+ * Use: fwbench > results.csv
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "board.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define BENCH_UART      3
+#define BENCH_TIMEOUT   600         /* simulated seconds */
+#define END_LINE        "# end"
+
+/* main() of the benchmark firmware, renamed by the build */
+int bench_main(void);
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static char line[256];
+static uint32_t lineLen = 0;
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static void benchOut(void *ctx, uint8_t b)
+{
+    if (b == '\r') {
+        return;
+    }
+    putchar(b);
+
+    if (b != '\n') {
+        if (lineLen < sizeof(line) - 1) {
+            line[lineLen++] = b;
+        }
+        return;
+    }
+
+    line[lineLen] = '\0';
+    lineLen = 0;
+    if (strcmp(line, END_LINE) == 0) {
+        fflush(stdout);
+        exit(0);
+    }
+}
+
+static void onTimeout(void)
+{
+    fflush(stdout);
+    fprintf(stderr, "fwbench: no \"%s\" after %d s\n", END_LINE,
+            BENCH_TIMEOUT);
+    exit(1);
+}
+
+static void runBench(void)
+{
+    bench_main();
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+int main(int argc, char **argv)
+{
+    sim_init();
+    sim_board_init();
+    sim_uart_setOutput(BENCH_UART, benchOut, NULL);
+    sim_setStopTime(BENCH_TIMEOUT * 1000000000ULL, onTimeout);
+    sim_run(runBench);
+
+    return 1;
+}
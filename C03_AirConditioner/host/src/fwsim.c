@@ -0,0 +1,325 @@
+/*****************************************************************************
+ *   fwsim.c:  Runs the air conditioner firmware on the host
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: The firmware of oled_periph, unchanged, on the simulated board.
+ * It runs for the given simulated time; then the simulator counters and
+ * the time it took on the host are printed.
+ *
+ * With -r, the sensor readings of a trace recorded by the firmware
+ * (sensrec.c) drive the simulated sensors, -x times faster than they were
+ * recorded. A failed temperature read in the trace keeps the temperature
+ * before it.
+ *
+ * Use: fwsim [-t seconds] [-T temp] [-l lux] [-o file] [-f dir]
+ *            [-r trace [-x speed] [-p page size]] [-c command] [-R file]
+ *   -t  simulated run time in s, default 5, or to the end of the -r trace
+ *   -T  temperature at the sensor in C, default 25.0
+ *   -l  illuminance at the light sensor in lux, default 100
+ *   -o  write what the firmware sends on the telemetry UART (UART3) to a
+ *       file, e.g. for telemdump
+ *  -f  write each OLED frame to dir as frame_NNNNN.pbm, and one line per
+ *      frame to dir/frames.txt: number, start in ms, duration in us, data
+ *      bytes, command bytes, chip selects, inverse
+ *  -r  replay a sensor trace, see rectrace.c; -p is the dataflash page size
+ *      of the recording unit
+ *  -c  type a shell command on the telemetry UART after boot, e.g.
+ *      -c "rec on"; may be repeated
+ *  -R  write the sensor trace area of the simulated dataflash to a file at
+ *      the end. Records of the page being filled are not in the dataflash
+ *      yet, unless -c "rec off" was typed.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sim.h"
+#include "board.h"
+#include "ssd1305.h"
+#include "rectrace.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define TELEMETRY_UART 3
+#define COMMAND_AT_NS  500000000ULL    /* -c commands, after boot */
+#define COMMAND_MAX    256
+
+/* main() of the firmware, renamed by the build */
+int firmware_main(void);
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static struct timespec hostStart;
+static FILE *telemetry = NULL;
+static const char *frameDir = NULL;
+static FILE *frameLog = NULL;
+static ssd1305_frame_t frameTotal;
+
+static sensrec_record_t *trace = NULL;
+static uint32_t traceLen = 0;
+static uint32_t traceIdx = 0;
+static double traceSpeed = 1;
+
+static uint8_t commands[COMMAND_MAX];
+static uint32_t commandLen = 0;
+static const char *traceOut = NULL;
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static double hostSeconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec - hostStart.tv_sec)
+            + (ts.tv_nsec - hostStart.tv_nsec) / 1e9;
+}
+
+static void telemetryOut(void *ctx, uint8_t b)
+{
+    fputc(b, (FILE *)ctx);
+}
+
+/* simulated time of a trace record */
+static uint64_t traceTime(uint32_t i)
+{
+    return (uint64_t)((trace[i].uptime - trace[0].uptime) * 1e6 / traceSpeed);
+}
+
+/* feeds the trace records and the -c commands in at their times */
+static void inputUpdate(sim_periph_t *p, uint64_t now)
+{
+    const sensrec_record_t *r = NULL;
+
+    while (traceIdx < traceLen && traceTime(traceIdx) <= now) {
+        r = &trace[traceIdx++];
+        if (r->temp != SENSREC_NO_TEMP) {
+            sim_board_setTemp(r->temp);
+        }
+        sim_board_setLux(r->lux);
+        if (r->flags & SENSREC_ACC_VALID) {
+            sim_board_setAcc(r->accX, r->accY, r->accZ);
+        }
+    }
+
+    if (commandLen > 0 && now >= COMMAND_AT_NS) {
+        sim_uart_input(TELEMETRY_UART, commands, commandLen);
+        commandLen = 0;
+    }
+}
+
+static uint64_t inputNextEvent(sim_periph_t *p)
+{
+    uint64_t t = SIM_NEVER;
+
+    if (traceIdx < traceLen) {
+        t = traceTime(traceIdx);
+    }
+    if (commandLen > 0 && COMMAND_AT_NS < t) {
+        t = COMMAND_AT_NS;
+    }
+    return t;
+}
+
+/* no registers, only events */
+static sim_periph_t inputPeriph = {
+    "input", 0, 0, NULL, NULL, inputUpdate, inputNextEvent, NULL, NULL
+};
+
+static void writeTrace(const char *path)
+{
+    FILE *f = fopen(path, "wb");
+    uint32_t size = SENSREC_PAGES * SENSREC_PAGE_BYTES;
+
+    if (f == NULL || fwrite(sim_board_getFlash()
+            + SENSREC_FIRST_PAGE * SENSREC_PAGE_BYTES, 1, size, f) != size) {
+        perror(path);
+    }
+    if (f != NULL) {
+        fclose(f);
+    }
+}
+
+static void onFrame(const ssd1305_frame_t *f, void *ctx)
+{
+    char path[512];
+
+    frameTotal.frame = f->frame;
+    frameTotal.dataBytes += f->dataBytes;
+    frameTotal.cmdBytes += f->cmdBytes;
+    frameTotal.csToggles += f->csToggles;
+
+    if (frameDir == NULL) {
+        return;
+    }
+
+    snprintf(path, sizeof(path), "%s/frame_%05u.pbm", frameDir, f->frame);
+    if (sim_ssd1305_writePbm(path) != 0) {
+        perror(path);
+    }
+    if (frameLog != NULL) {
+        fprintf(frameLog, "%u %.3f %.1f %u %u %u %u\n", f->frame,
+                f->start / 1e6, (f->end - f->start) / 1e3, f->dataBytes,
+                f->cmdBytes, f->csToggles, sim_ssd1305_isInverse());
+    }
+}
+
+static void onStop(void)
+{
+    board_stats_t st;
+    double host = hostSeconds();
+    uint32_t frames = 0;
+
+    sim_ssd1305_endFrame(NULL);
+    sim_board_getStats(&st);
+    frames = frameTotal.frame ? frameTotal.frame : 1;
+
+    if (telemetry != NULL) {
+        fclose(telemetry);
+    }
+    if (frameLog != NULL) {
+        fclose(frameLog);
+    }
+    if (traceOut != NULL) {
+        writeTrace(traceOut);
+    }
+    sim_report(stderr);
+    fprintf(stderr, "  board        flash programs %u status reads %u"
+            " eeprom write cycles %u\n", st.flashPrograms,
+            st.flashStatusReads, st.eepromWriteCycles);
+    fprintf(stderr, "  oled         frames %u, per frame: data %u command %u"
+            " chip selects %u\n", frameTotal.frame,
+            frameTotal.dataBytes / frames, frameTotal.cmdBytes / frames,
+            frameTotal.csToggles / frames);
+    fprintf(stderr, "host time %.3f s, %.1f x real time\n", host,
+            host > 0 ? (sim_now() / 1e9) / host : 0);
+    exit(0);
+}
+
+static void runFirmware(void)
+{
+    firmware_main();
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: fwsim [-t seconds] [-T temp] [-l lux]"
+            " [-o file] [-f dir]\n"
+            "             [-r trace [-x speed] [-p page size]] [-c command]"
+            " [-R file]\n");
+    exit(1);
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+int main(int argc, char **argv)
+{
+    double seconds = 0;
+    const char *traceIn = NULL;
+    uint16_t pageSize = SENSREC_PAGE_BYTES;
+    size_t len = 0;
+    double temp = 25.0;
+    unsigned long lux = 100;
+    char path[512];
+    int i = 0;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
+            temp = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            lux = strtoul(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            telemetry = fopen(argv[++i], "wb");
+            if (telemetry == NULL) {
+                perror(argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            frameDir = argv[++i];
+            snprintf(path, sizeof(path), "%s/frames.txt", frameDir);
+            frameLog = fopen(path, "w");
+            if (frameLog == NULL) {
+                perror(path);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            traceIn = argv[++i];
+        }
+        else if (strcmp(argv[i], "-x") == 0 && i + 1 < argc) {
+            traceSpeed = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            pageSize = strtoul(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            len = strlen(argv[++i]);
+            if (commandLen + len + 1 > COMMAND_MAX) {
+                usage();
+            }
+            memcpy(&commands[commandLen], argv[i], len);
+            commandLen += len;
+            commands[commandLen++] = '\r';
+        }
+        else if (strcmp(argv[i], "-R") == 0 && i + 1 < argc) {
+            traceOut = argv[++i];
+        }
+        else {
+            usage();
+        }
+    }
+    if (traceSpeed <= 0) {
+        usage();
+    }
+    if (traceIn != NULL) {
+        traceLen = rectrace_load(traceIn, pageSize, &trace);
+        if (traceLen == 0) {
+            fprintf(stderr, "fwsim: no records in %s\n", traceIn);
+            return 1;
+        }
+        if (seconds <= 0) {
+            seconds = traceTime(traceLen - 1) / 1e9 + 1;
+        }
+    }
+    if (seconds <= 0) {
+        seconds = 5;
+    }
+
+    sim_init();
+    sim_board_init();
+    sim_board_setTemp((int32_t)(temp * 10));
+    sim_board_setLux(lux);
+    sim_setStopTime((uint64_t)(seconds * 1e9), onStop);
+    if (telemetry != NULL) {
+        sim_uart_setOutput(TELEMETRY_UART, telemetryOut, telemetry);
+    }
+    sim_ssd1305_onFrame(onFrame, NULL);
+    sim_register(&inputPeriph);
+    inputUpdate(&inputPeriph, 0);
+
+    clock_gettime(CLOCK_MONOTONIC, &hostStart);
+    sim_run(runFirmware);
+
+    return 0;
+}
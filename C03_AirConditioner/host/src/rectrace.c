@@ -0,0 +1,91 @@
+/*****************************************************************************
+ *   rectrace.c:  Loads a sensor trace recorded by the firmware
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: A trace is what the "dump" command of the firmware sends for the
+ * dataflash area of sensrec.c (the offset and length "rec" prints), or
+ * what fwsim -R writes. It is a sequence of dataflash pages, each with 16
+ * records in its first 256 bytes; with the 264 byte page size of a
+ * dataflash not switched to the power of 2 size, 8 bytes follow each page.
+ * The trace ends at the first erased record, or where the uptime stops
+ * increasing, which is where an older, longer recording continues.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "rectrace.h"
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Load a sensor trace
+ *
+ * Params:
+ *   [in] path - the dumped trace
+ *   [in] pageSize - dataflash page size of the recording unit, 256 or 264
+ *   [out] recs - the records, malloc()ed, NULL on failure
+ *
+ * Returns:
+ *    The number of records, 0 if the file could not be read or holds no
+ *    records
+ *
+ *****************************************************************************/
+uint32_t rectrace_load(const char *path, uint16_t pageSize,
+        sensrec_record_t **recs)
+{
+    uint8_t buf[SENSREC_RECORD_SIZE];
+    sensrec_record_t *r = NULL;
+    FILE *f = NULL;
+    long size = 0;
+    uint32_t max = 0;
+    uint32_t n = 0;
+
+    *recs = NULL;
+    if (pageSize < SENSREC_PAGE_BYTES) {
+        return 0;
+    }
+
+    f = fopen(path, "rb");
+    if (f == NULL) {
+        return 0;
+    }
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    max = (size / pageSize + 1) * SENSREC_RECORDS_PER_PAGE;
+    r = malloc(max * sizeof(*r));
+    if (r == NULL) {
+        fclose(f);
+        return 0;
+    }
+
+    for (n = 0; n < max; n++) {
+        if ((n % SENSREC_RECORDS_PER_PAGE) == 0
+                && fseek(f, (long)(n / SENSREC_RECORDS_PER_PAGE) * pageSize,
+                        SEEK_SET) != 0) {
+            break;
+        }
+        if (fread(buf, 1, sizeof(buf), f) != sizeof(buf)
+                || !sensrec_unpack(buf, &r[n])
+                || (n > 0 && r[n].uptime <= r[n - 1].uptime)) {
+            break;
+        }
+    }
+    fclose(f);
+
+    if (n == 0) {
+        free(r);
+        return 0;
+    }
+    *recs = r;
+    return n;
+}
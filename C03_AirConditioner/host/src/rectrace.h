@@ -0,0 +1,17 @@
+/*****************************************************************************
+ *   rectrace.h:  Header file for the sensor trace loader of the host tools
+ *
+ ******************************************************************************/
+#ifndef __RECTRACE_H
+#define __RECTRACE_H
+
+#include <stdint.h>
+#include "sensrec.h"
+
+uint32_t rectrace_load(const char *path, uint16_t pageSize,
+        sensrec_record_t **recs);
+
+#endif /* end __RECTRACE_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
@@ -0,0 +1,277 @@
+/*****************************************************************************
+ *   replay.c:  Replays a sensor trace through the temperature controller
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: Runs the controller of this build (pid.c) on the temperatures of a
+ * trace recorded by the firmware (sensrec.c), one update per control
+ * period of trace time, as controlStep() in main.c does: the safe duty
+ * after a failed read, the PID output otherwise, with the setpoint of the
+ * record. Only the controller runs, not the firmware, so a day of trace
+ * takes well under a second.
+ *
+ * Printed are the energy proxy, the duty integrated over the trace in
+ * hours at full duty, for the replay and for the duty the recording unit
+ * had, how far the replayed output is from the recorded one and, per
+ * update, the simulated time (cost model of sim.c) and the host time.
+ * With -o the output is written as CSV; -c compares the output with such
+ * a CSV of another build, run on the same trace.
+ *
+ * The controller settings default to those of init_control() in main.c.
+ * The zone load sharing is left out: the unit is alone in its zone.
+ *
+ * Use: replay [-p page size] [-P period ms] [-k kp ki kd] [-o csv]
+ *             [-c csv] trace
+ *   -p  dataflash page size of the recording unit, 256 (default) or 264
+ *   -P  control period in ms, default 500
+ *   -k  PID gains, default 15 0.5 0
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "pid.h"
+#include "sim.h"
+#include "rectrace.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+/* as init_control() and the PWM settings in main.c */
+#define PWM_DUTY_MIN      400
+#define PWM_DUTY_MAX      1000
+#define PWM_DUTY_SAFE     PWM_DUTY_MIN
+#define PID_DEADBAND      2
+#define PID_SLEW          50
+#define CONTROL_PERIOD_MS 500
+
+#define MS_PER_HOUR       3600000.0
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static sensrec_record_t *recs = NULL;
+static uint32_t numRecs = 0;
+static uint32_t period = CONTROL_PERIOD_MS;
+static double gains[3] = { 15, 0.5, 0 };
+static FILE *csvOut = NULL;
+static int32_t *prev = NULL;            /* output of the -c CSV */
+static uint32_t numPrev = 0;
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static uint64_t hostNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* the last column of each line of a CSV written with -o */
+static uint32_t loadCsv(const char *path, int32_t **out)
+{
+    char line[128];
+    char *p = NULL;
+    FILE *f = fopen(path, "r");
+    int32_t *v = NULL;
+    uint32_t n = 0;
+    uint32_t max = 0;
+
+    if (f == NULL) {
+        return 0;
+    }
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        p = strrchr(line, ',');
+        if (p == NULL || line[0] < '0' || line[0] > '9') {
+            continue;
+        }
+        if (n == max) {
+            max = max ? 2 * max : 1024;
+            v = realloc(v, max * sizeof(*v));
+            if (v == NULL) {
+                break;
+            }
+        }
+        v[n++] = atoi(p + 1);
+    }
+    fclose(f);
+
+    *out = v;
+    return v != NULL ? n : 0;
+}
+
+static void runReplay(void)
+{
+    pid_ctrl_t pid;
+    const sensrec_record_t *r = NULL;
+    uint64_t host0 = 0;
+    uint64_t sim0 = 0;
+    uint32_t end = recs[numRecs - 1].uptime;
+    uint32_t t = 0;
+    uint32_t i = 0;
+    uint32_t n = 0;
+    int32_t d = 0;
+    int32_t diff = 0;
+    double replayed = 0;
+    double recorded = 0;
+    double previous = 0;
+    double sumDiff = 0;
+    int32_t maxDiff = 0;
+    double sumPrevDiff = 0;
+    int32_t maxPrevDiff = 0;
+    uint32_t failed = 0;
+
+    pid_init(&pid, PWM_DUTY_MIN, PWM_DUTY_MAX);
+    pid_setGains(&pid, PID_GAIN(gains[0]), PID_GAIN(gains[1]),
+            PID_GAIN(gains[2]));
+    pid_setSetpoint(&pid, recs[0].setpoint);
+    pid_setDeadband(&pid, PID_DEADBAND);
+    pid_setSlewRate(&pid, PID_SLEW);
+
+    if (csvOut != NULL) {
+        fprintf(csvOut, "uptime_ms,temp,setpoint,recorded_duty,duty\n");
+    }
+
+    sim0 = sim_now();
+    host0 = hostNs();
+    for (t = recs[0].uptime; t <= end; t += period, n++) {
+        while (i + 1 < numRecs && recs[i + 1].uptime <= t) {
+            i++;
+        }
+        r = &recs[i];
+
+        if (r->setpoint != pid.setpoint) {
+            pid_setSetpoint(&pid, r->setpoint);
+        }
+        if (r->temp == SENSREC_NO_TEMP) {
+            d = PWM_DUTY_SAFE;
+            failed++;
+        }
+        else {
+            d = pid_update(&pid, r->temp);
+        }
+
+        replayed += (double)d * period;
+        recorded += (double)r->duty * period;
+        diff = abs(d - (int32_t)r->duty);
+        sumDiff += diff;
+        if (diff > maxDiff) {
+            maxDiff = diff;
+        }
+        if (n < numPrev) {
+            previous += (double)prev[n] * period;
+            diff = abs(d - prev[n]);
+            sumPrevDiff += diff;
+            if (diff > maxPrevDiff) {
+                maxPrevDiff = diff;
+            }
+        }
+
+        if (csvOut != NULL) {
+            fprintf(csvOut, "%u,%d,%d,%u,%d\n", t, r->temp, r->setpoint,
+                    r->duty, d);
+        }
+    }
+
+    printf("trace        %u records, %.3f h, %u failed temperature reads\n",
+            numRecs, (end - recs[0].uptime) / MS_PER_HOUR, failed);
+    printf("updates      %u every %u ms, %.3f sim us and %.3f host us each\n",
+            n, period, (sim_now() - sim0) / 1e3 / n,
+            (hostNs() - host0) / 1e3 / n);
+    printf("energy       replay %.3f h, recorded %.3f h at full duty\n",
+            replayed / PWM_DUTY_MAX / MS_PER_HOUR,
+            recorded / PWM_DUTY_MAX / MS_PER_HOUR);
+    printf("vs recorded  mean |diff| %.1f max %d (duty of %d)\n",
+            sumDiff / n, maxDiff, PWM_DUTY_MAX);
+    if (prev != NULL) {
+        if (numPrev != n) {
+            printf("compare      %u updates in the CSV, %u here\n", numPrev,
+                    n);
+        }
+        printf("vs compare   mean |diff| %.1f max %d, energy %+.3f h\n",
+                sumPrevDiff / (n < numPrev ? n : numPrev), maxPrevDiff,
+                (replayed - previous) / PWM_DUTY_MAX / MS_PER_HOUR);
+    }
+
+    if (csvOut != NULL) {
+        fclose(csvOut);
+    }
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: replay [-p page size] [-P period ms]"
+            " [-k kp ki kd] [-o csv] [-c csv] trace\n");
+    exit(1);
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+int main(int argc, char **argv)
+{
+    uint16_t pageSize = SENSREC_PAGE_BYTES;
+    const char *trace = NULL;
+    int i = 0;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            pageSize = strtoul(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "-P") == 0 && i + 1 < argc) {
+            period = strtoul(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "-k") == 0 && i + 3 < argc) {
+            gains[0] = atof(argv[++i]);
+            gains[1] = atof(argv[++i]);
+            gains[2] = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            csvOut = fopen(argv[++i], "w");
+            if (csvOut == NULL) {
+                perror(argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            numPrev = loadCsv(argv[++i], &prev);
+            if (numPrev == 0) {
+                fprintf(stderr, "replay: no output in %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (argv[i][0] != '-' && trace == NULL) {
+            trace = argv[i];
+        }
+        else {
+            usage();
+        }
+    }
+    if (trace == NULL || period == 0) {
+        usage();
+    }
+
+    numRecs = rectrace_load(trace, pageSize, &recs);
+    if (numRecs == 0) {
+        fprintf(stderr, "replay: no records in %s\n", trace);
+        return 1;
+    }
+
+    sim_init();
+    sim_run(runReplay);
+
+    return 0;
+}
@@ -0,0 +1,818 @@
+/*****************************************************************************
+ *   sim.c:  Host side LPC1768 peripheral simulator
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: The firmware and the driver library are compiled for Linux
+ * unchanged and access the peripherals at their real addresses. sim_init()
+ * maps memory at those addresses without any access rights, so every
+ * register access faults. The SIGSEGV handler tells the peripheral model
+ * about the access, allows the page and single-steps the instruction; the
+ * SIGTRAP handler that follows locks the page again and hands a written
+ * value to the model. The models keep their registers up to date through a
+ * second, unprotected mapping of the same memory (sim_reg()).
+ *
+ * Time is simulated, in ns, and deterministic. Every register access costs
+ * SIM_ACCESS_NS and every firmware function call SIM_CALL_NS (the firmware
+ * is built with -finstrument-functions); code that does neither takes no
+ * time. When the firmware reads registers of a model that has an event
+ * coming, SIM_POLL_READS times without a write or a side effect in
+ * between, it is taken to be polling and the time skips to the next event
+ * of any model. Reads of models without events (DWT) and of plain memory
+ * don't count either way.
+ *
+ * Interrupts are taken at firmware function calls, at __WFI() and when
+ * they are enabled again; an interrupt handler is never interrupted. This
+ * file models the NVIC, SysTick and the DWT cycle counter; the other
+ * peripherals are in the sim_*.c files. Peripherals without a model behave
+ * like plain memory.
+ *
+ * The driver library keeps pointers in 32 bit integers in places, so the
+ * firmware runs on a stack below 4 GB (sim_run()) and is linked without
+ * PIE, which puts its data there as well. The stack is bracketed by the
+ * _pvHeapStart and _vStackTop symbols of the target linker script and
+ * painted as ResetISR() paints it, so stackmon.c works unchanged; its
+ * heap figures are those of the host malloc.
+ *
+ * Only for x86-64 Linux: the write flag and the trap flag are taken from
+ * the signal context.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#define _GNU_SOURCE
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+#include "sim.h"
+#include "stackmon.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+#define PAGE_SIZE       0x1000
+#define STACK_SIZE      (8 * 1024 * 1024)
+#define PAGE_MASK       (~(uintptr_t)(PAGE_SIZE - 1))
+
+#define STR_(x)         #x
+#define STR(x)          STR_(x)
+
+#define EFLAGS_TF       0x100       /* single step */
+#define PF_WRITE        0x2         /* page fault error code: write access */
+
+#define NS_PER_CYCLE    (1000000000UL / SIM_CPU_HZ)
+
+/* system control space */
+#define SCS_BASE        0xE000E000
+#define STK_CTRL        0x010
+#define STK_LOAD        0x014
+#define STK_VAL         0x018
+#define NVIC_ISER       0x100
+#define NVIC_ICER       0x180
+#define NVIC_ISPR       0x200
+#define NVIC_ICPR       0x280
+
+#define STK_CTRL_ENABLE     (1 << 0)
+#define STK_CTRL_TICKINT    (1 << 1)
+#define STK_CTRL_COUNTFLAG  (1 << 16)
+
+#define DWT_BASE        0xE0001000
+#define DWT_CYCCNT      0x004
+
+#define SC_PCLKSEL0     0x400FC1A8
+
+typedef struct
+{
+    uint32_t base;
+    uint32_t size;
+    uint8_t *alias;
+} region_t;
+
+typedef struct
+{
+    uint32_t enabled[2];
+    uint32_t pending[2];
+    uint64_t nextTick;
+    uint32_t ticksPending;
+    uint8_t countFlag;
+} core_t;
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static region_t regions[] = {
+    { 0x2009C000, 0x00004000, NULL },   /* GPIO */
+    { 0x40000000, 0x00100000, NULL },   /* APB0 and APB1 */
+    { 0x50000000, 0x00010000, NULL },   /* AHB peripherals */
+    { 0xE0000000, 0x00100000, NULL },   /* private peripheral bus */
+};
+
+#define NUM_REGIONS (sizeof(regions) / sizeof(regions[0]))
+
+static sim_periph_t *periphs = NULL;
+
+static uint32_t fwStack[STACK_SIZE / 4] __attribute__((used, aligned(16)));
+
+__asm__(".globl _pvHeapStart\n"
+        ".set _pvHeapStart, fwStack\n"
+        ".globl _vStackTop\n"
+        ".set _vStackTop, fwStack + " STR(STACK_SIZE));
+
+static struct
+{
+    uintptr_t page;
+    uint32_t addr;
+    uint8_t write;
+    uint8_t sideEffect;
+    sim_periph_t *p;
+} trap;
+
+static uint8_t initialized = 0;
+static uint64_t now = 0;
+static uint64_t stopTime = SIM_NEVER;
+static void (*stopCb)(void) = NULL;
+static uint32_t quietReads = 0;
+static uint8_t primask = 0;
+static uint8_t inIsr = 0;
+static sim_stats_t stats;
+
+static core_t core;
+static uint32_t cycBase = 0;
+
+/******************************************************************************
+ * Interrupt handlers of the firmware
+ *****************************************************************************/
+
+void sim_unhandledIrq(void);
+
+#define WEAK_HANDLER(name) \
+    void name(void) __attribute__((weak, alias("sim_unhandledIrq")))
+
+WEAK_HANDLER(SysTick_Handler);
+WEAK_HANDLER(WDT_IRQHandler);
+WEAK_HANDLER(TIMER0_IRQHandler);
+WEAK_HANDLER(TIMER1_IRQHandler);
+WEAK_HANDLER(TIMER2_IRQHandler);
+WEAK_HANDLER(TIMER3_IRQHandler);
+WEAK_HANDLER(UART0_IRQHandler);
+WEAK_HANDLER(UART1_IRQHandler);
+WEAK_HANDLER(UART2_IRQHandler);
+WEAK_HANDLER(UART3_IRQHandler);
+WEAK_HANDLER(PWM1_IRQHandler);
+WEAK_HANDLER(I2C0_IRQHandler);
+WEAK_HANDLER(I2C1_IRQHandler);
+WEAK_HANDLER(I2C2_IRQHandler);
+WEAK_HANDLER(SPI_IRQHandler);
+WEAK_HANDLER(SSP0_IRQHandler);
+WEAK_HANDLER(SSP1_IRQHandler);
+WEAK_HANDLER(PLL0_IRQHandler);
+WEAK_HANDLER(RTC_IRQHandler);
+WEAK_HANDLER(EINT0_IRQHandler);
+WEAK_HANDLER(EINT1_IRQHandler);
+WEAK_HANDLER(EINT2_IRQHandler);
+WEAK_HANDLER(EINT3_IRQHandler);
+WEAK_HANDLER(ADC_IRQHandler);
+WEAK_HANDLER(BOD_IRQHandler);
+WEAK_HANDLER(USB_IRQHandler);
+WEAK_HANDLER(CAN_IRQHandler);
+WEAK_HANDLER(DMA_IRQHandler);
+WEAK_HANDLER(I2S_IRQHandler);
+WEAK_HANDLER(ENET_IRQHandler);
+WEAK_HANDLER(RIT_IRQHandler);
+WEAK_HANDLER(MCPWM_IRQHandler);
+WEAK_HANDLER(QEI_IRQHandler);
+WEAK_HANDLER(PLL1_IRQHandler);
+WEAK_HANDLER(USBActivity_IRQHandler);
+WEAK_HANDLER(CANActivity_IRQHandler);
+
+static void (* const vectors[SIM_NUM_IRQS])(void) = {
+    WDT_IRQHandler, TIMER0_IRQHandler, TIMER1_IRQHandler,
+    TIMER2_IRQHandler, TIMER3_IRQHandler, UART0_IRQHandler,
+    UART1_IRQHandler, UART2_IRQHandler, UART3_IRQHandler,
+    PWM1_IRQHandler, I2C0_IRQHandler, I2C1_IRQHandler, I2C2_IRQHandler,
+    SPI_IRQHandler, SSP0_IRQHandler, SSP1_IRQHandler, PLL0_IRQHandler,
+    RTC_IRQHandler, EINT0_IRQHandler, EINT1_IRQHandler, EINT2_IRQHandler,
+    EINT3_IRQHandler, ADC_IRQHandler, BOD_IRQHandler, USB_IRQHandler,
+    CAN_IRQHandler, DMA_IRQHandler, I2S_IRQHandler, ENET_IRQHandler,
+    RIT_IRQHandler, MCPWM_IRQHandler, QEI_IRQHandler, PLL1_IRQHandler,
+    USBActivity_IRQHandler, CANActivity_IRQHandler
+};
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static region_t *findRegion(uintptr_t addr)
+{
+    uint32_t i = 0;
+
+    for (i = 0; i < NUM_REGIONS; i++) {
+        if (addr >= regions[i].base
+                && addr - regions[i].base < regions[i].size) {
+            return &regions[i];
+        }
+    }
+    return NULL;
+}
+
+static sim_periph_t *findPeriph(uint32_t addr)
+{
+    sim_periph_t *p = NULL;
+
+    for (p = periphs; p != NULL; p = p->next) {
+        if (addr >= p->base && addr - p->base < p->size) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static uint64_t nextEventTime(void)
+{
+    sim_periph_t *p = NULL;
+    uint64_t t = SIM_NEVER;
+    uint64_t e = 0;
+
+    for (p = periphs; p != NULL; p = p->next) {
+        if (p->nextEvent != NULL) {
+            e = p->nextEvent(p);
+            if (e < t) {
+                t = e;
+            }
+        }
+    }
+    return t;
+}
+
+static void runUntil(uint64_t t)
+{
+    sim_periph_t *p = NULL;
+
+    if (t < now) {
+        return;
+    }
+    now = t;
+
+    for (p = periphs; p != NULL; p = p->next) {
+        if (p->update != NULL) {
+            p->update(p, now);
+        }
+    }
+
+    if (now >= stopTime) {
+        stopTime = SIM_NEVER;
+        if (stopCb != NULL) {
+            stopCb();
+        }
+    }
+}
+
+/* runs the interrupt handlers that are pending and enabled */
+static void dispatch(void)
+{
+    uint32_t bit = 0;
+    int n = 0;
+
+    if (!initialized || inIsr || primask) {
+        return;
+    }
+    inIsr = 1;
+
+    while (core.ticksPending > 0) {
+        core.ticksPending--;
+        stats.sysTicks++;
+        SysTick_Handler();
+    }
+
+    for (n = 0; n < SIM_NUM_IRQS; n++) {
+        bit = 1UL << (n & 31);
+        if (core.enabled[n >> 5] & core.pending[n >> 5] & bit) {
+            core.pending[n >> 5] &= ~bit;
+            stats.irqs++;
+            if (vectors[n] == sim_unhandledIrq) {
+                fprintf(stderr, "sim: IRQ %d enabled without a handler\n", n);
+                abort();
+            }
+            vectors[n]();
+        }
+    }
+
+    inIsr = 0;
+}
+
+static void onSegv(int sig, siginfo_t *si, void *ctx)
+{
+    ucontext_t *uc = (ucontext_t *)ctx;
+    uintptr_t addr = (uintptr_t)si->si_addr;
+    sim_periph_t *p = NULL;
+
+    if (findRegion(addr) == NULL) {
+        /* a real crash, fault again without the handler */
+        fprintf(stderr, "sim: bad access to %p at %p\n", si->si_addr,
+                (void *)uc->uc_mcontext.gregs[REG_RIP]);
+        signal(SIGSEGV, SIG_DFL);
+        return;
+    }
+
+    trap.page = addr & PAGE_MASK;
+    trap.addr = (uint32_t)addr;
+    trap.write = (uc->uc_mcontext.gregs[REG_ERR] & PF_WRITE) != 0;
+    trap.sideEffect = 0;
+    trap.p = p = findPeriph(trap.addr);
+
+    if (p != NULL) {
+        if (trap.write) {
+            p->writes++;
+        }
+        else {
+            p->reads++;
+        }
+        if (p->access != NULL) {
+            trap.sideEffect = p->access(p, trap.addr - p->base, trap.write);
+        }
+    }
+
+    mprotect((void *)trap.page, PAGE_SIZE, PROT_READ | PROT_WRITE);
+    uc->uc_mcontext.gregs[REG_EFL] |= EFLAGS_TF;
+}
+
+static void onTrap(int sig, siginfo_t *si, void *ctx)
+{
+    ucontext_t *uc = (ucontext_t *)ctx;
+    sim_periph_t *p = trap.p;
+    uint32_t off = 0;
+    uint64_t t = 0;
+
+    uc->uc_mcontext.gregs[REG_EFL] &= ~EFLAGS_TF;
+    mprotect((void *)trap.page, PAGE_SIZE, PROT_NONE);
+    stats.traps++;
+
+    if (trap.write && p != NULL && p->written != NULL) {
+        off = (trap.addr - p->base) & ~3UL;
+        p->written(p, off, *sim_reg(p->base + off));
+    }
+
+    if (trap.write || trap.sideEffect) {
+        quietReads = 0;
+    }
+    else if (p != NULL && p->nextEvent != NULL
+            && p->nextEvent(p) != SIM_NEVER
+            && ++quietReads >= SIM_POLL_READS) {
+        /* polling a peripheral that has something coming */
+        t = nextEventTime();
+        if (t != SIM_NEVER && t > now) {
+            stats.polls++;
+            runUntil(t);
+            return;
+        }
+    }
+
+    runUntil(now + SIM_ACCESS_NS);
+}
+
+/* --- NVIC and SysTick --------------------------------------------------- */
+
+static uint64_t tickPeriod(void)
+{
+    return ((uint64_t)(*sim_reg(SCS_BASE + STK_LOAD) & 0xFFFFFF) + 1)
+            * NS_PER_CYCLE;
+}
+
+static int coreAccess(sim_periph_t *p, uint32_t off, int write)
+{
+    uint32_t ctrl = *sim_reg(SCS_BASE + STK_CTRL);
+    uint64_t left = 0;
+
+    if (write) {
+        return 0;
+    }
+
+    if (off == STK_CTRL) {
+        ctrl &= ~STK_CTRL_COUNTFLAG;
+        *sim_reg(SCS_BASE + STK_CTRL) = ctrl
+                | (core.countFlag ? STK_CTRL_COUNTFLAG : 0);
+        core.countFlag = 0;
+    }
+    else if (off == STK_VAL && (ctrl & STK_CTRL_ENABLE)) {
+        left = (core.nextTick - now) / NS_PER_CYCLE;
+        *sim_reg(SCS_BASE + STK_VAL) = (uint32_t)left;
+    }
+    else if (off >= NVIC_ISER && off < NVIC_ISER + 8) {
+        *sim_reg(SCS_BASE + off) = core.enabled[(off - NVIC_ISER) >> 2];
+    }
+    else if (off >= NVIC_ICER && off < NVIC_ICER + 8) {
+        *sim_reg(SCS_BASE + off) = core.enabled[(off - NVIC_ICER) >> 2];
+    }
+    else if (off >= NVIC_ISPR && off < NVIC_ISPR + 8) {
+        *sim_reg(SCS_BASE + off) = core.pending[(off - NVIC_ISPR) >> 2];
+    }
+    else if (off >= NVIC_ICPR && off < NVIC_ICPR + 8) {
+        *sim_reg(SCS_BASE + off) = core.pending[(off - NVIC_ICPR) >> 2];
+    }
+    return 0;
+}
+
+static void coreWritten(sim_periph_t *p, uint32_t off, uint32_t val)
+{
+    if (off == STK_CTRL || off == STK_VAL) {
+        /* (re)started, a write to VAL clears the counter */
+        core.nextTick = now + tickPeriod();
+        core.countFlag = 0;
+    }
+    else if (off >= NVIC_ISER && off < NVIC_ISER + 8) {
+        core.enabled[(off - NVIC_ISER) >> 2] |= val;
+    }
+    else if (off >= NVIC_ICER && off < NVIC_ICER + 8) {
+        core.enabled[(off - NVIC_ICER) >> 2] &= ~val;
+    }
+    else if (off >= NVIC_ISPR && off < NVIC_ISPR + 8) {
+        core.pending[(off - NVIC_ISPR) >> 2] |= val;
+    }
+    else if (off >= NVIC_ICPR && off < NVIC_ICPR + 8) {
+        core.pending[(off - NVIC_ICPR) >> 2] &= ~val;
+    }
+}
+
+static void coreUpdate(sim_periph_t *p, uint64_t t)
+{
+    uint32_t ctrl = *sim_reg(SCS_BASE + STK_CTRL);
+    uint64_t period = 0;
+
+    if (!(ctrl & STK_CTRL_ENABLE)) {
+        return;
+    }
+
+    period = tickPeriod();
+    while (core.nextTick <= t) {
+        core.countFlag = 1;
+        if (ctrl & STK_CTRL_TICKINT) {
+            core.ticksPending++;
+        }
+        core.nextTick += period;
+    }
+}
+
+static uint64_t coreNextEvent(sim_periph_t *p)
+{
+    uint32_t ctrl = *sim_reg(SCS_BASE + STK_CTRL);
+
+    if ((ctrl & (STK_CTRL_ENABLE | STK_CTRL_TICKINT))
+            != (STK_CTRL_ENABLE | STK_CTRL_TICKINT)) {
+        return SIM_NEVER;
+    }
+    return core.nextTick;
+}
+
+static sim_periph_t corePeriph = {
+    "NVIC/SysTick", SCS_BASE, 0x1000,
+    coreAccess, coreWritten, coreUpdate, coreNextEvent, NULL
+};
+
+/* --- DWT cycle counter -------------------------------------------------- */
+
+static int dwtAccess(sim_periph_t *p, uint32_t off, int write)
+{
+    if (!write && off == DWT_CYCCNT) {
+        *sim_reg(DWT_BASE + DWT_CYCCNT) = (uint32_t)(now / NS_PER_CYCLE)
+                - cycBase;
+    }
+    return 0;
+}
+
+static void dwtWritten(sim_periph_t *p, uint32_t off, uint32_t val)
+{
+    if (off == DWT_CYCCNT) {
+        cycBase = (uint32_t)(now / NS_PER_CYCLE) - val;
+    }
+}
+
+static sim_periph_t dwtPeriph = {
+    "DWT", DWT_BASE, 0x1000, dwtAccess, dwtWritten
+};
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Map the peripheral address space and install the trap handlers. Must
+ *    be called before any firmware code runs.
+ *
+ *****************************************************************************/
+void sim_init(void)
+{
+    struct sigaction sa;
+    uint32_t total = 0;
+    uint32_t off = 0;
+    uint32_t i = 0;
+    void *v = NULL;
+    int fd = -1;
+
+    for (i = 0; i < NUM_REGIONS; i++) {
+        total += regions[i].size;
+    }
+
+    fd = memfd_create("lpc17xx", 0);
+    if (fd < 0 || ftruncate(fd, total) != 0) {
+        perror("sim: memfd");
+        exit(1);
+    }
+
+    for (i = 0; i < NUM_REGIONS; i++) {
+        v = mmap((void *)(uintptr_t)regions[i].base, regions[i].size,
+                PROT_NONE, MAP_SHARED | MAP_FIXED_NOREPLACE, fd, off);
+        if (v != (void *)(uintptr_t)regions[i].base) {
+            fprintf(stderr, "sim: can't map 0x%08x, link with -no-pie\n",
+                    regions[i].base);
+            exit(1);
+        }
+        regions[i].alias = mmap(NULL, regions[i].size,
+                PROT_READ | PROT_WRITE, MAP_SHARED, fd, off);
+        if (regions[i].alias == MAP_FAILED) {
+            perror("sim: mmap");
+            exit(1);
+        }
+        off += regions[i].size;
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_flags = SA_SIGINFO;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_sigaction = onSegv;
+    sigaction(SIGSEGV, &sa, NULL);
+    sa.sa_sigaction = onTrap;
+    sigaction(SIGTRAP, &sa, NULL);
+
+    sim_register(&corePeriph);
+    sim_register(&dwtPeriph);
+    sim_gpio_init();
+    sim_ssp_init();
+    sim_i2c_init();
+    sim_timer_init();
+    sim_uart_init();
+    sim_gpdma_init();
+
+    initialized = 1;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Run firmware code on a stack below 4 GB. Returns when fn returns.
+ *
+ * Params:
+ *   [in] fn - e.g. main() of the firmware
+ *
+ *****************************************************************************/
+void sim_run(void (*fn)(void))
+{
+    static ucontext_t caller;
+    static ucontext_t fw;
+    uint32_t i = 0;
+
+    for (i = 0; i < STACK_SIZE / 4; i++) {
+        fwStack[i] = STACKMON_CANARY;
+    }
+
+    getcontext(&fw);
+    fw.uc_stack.ss_sp = fwStack;
+    fw.uc_stack.ss_size = STACK_SIZE;
+    fw.uc_link = &caller;
+    makecontext(&fw, fn, 0);
+    swapcontext(&caller, &fw);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Add a peripheral model
+ *
+ * Params:
+ *   [in] p - the model, must stay valid
+ *
+ *****************************************************************************/
+void sim_register(sim_periph_t *p)
+{
+    p->next = periphs;
+    periphs = p;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get a register for a model. The firmware sees the same memory.
+ *
+ * Params:
+ *   [in] addr - register address
+ *
+ *****************************************************************************/
+volatile uint32_t *sim_reg(uint32_t addr)
+{
+    region_t *r = findRegion(addr);
+
+    if (r == NULL) {
+        fprintf(stderr, "sim: no register at 0x%08x\n", addr);
+        abort();
+    }
+    return (volatile uint32_t *)(r->alias + (addr - r->base));
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the simulated time in ns
+ *
+ *****************************************************************************/
+uint64_t sim_now(void)
+{
+    return now;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Let time pass, e.g. for work the firmware does not do on the host
+ *
+ * Params:
+ *   [in] ns - time to add
+ *
+ *****************************************************************************/
+void sim_advance(uint64_t ns)
+{
+    runUntil(now + ns);
+    dispatch();
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Call a function once the simulated time reaches a limit
+ *
+ * Params:
+ *   [in] ns - the limit
+ *   [in] onStop - called from wherever the firmware is at that time,
+ *                 typically reports and exits
+ *
+ *****************************************************************************/
+void sim_setStopTime(uint64_t ns, void (*onStop)(void))
+{
+    stopTime = ns;
+    stopCb = onStop;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Set an interrupt pending, it runs at the next function call of the
+ *    firmware if it is enabled
+ *
+ * Params:
+ *   [in] irq - IRQn_Type of the interrupt
+ *
+ *****************************************************************************/
+void sim_irqRaise(int irq)
+{
+    if (irq >= 0 && irq < SIM_NUM_IRQS) {
+        core.pending[irq >> 5] |= 1UL << (irq & 31);
+    }
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the simulator counters
+ *
+ *****************************************************************************/
+void sim_getStats(sim_stats_t *st)
+{
+    *st = stats;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Print the simulator counters and the state of every model
+ *
+ *****************************************************************************/
+void sim_report(FILE *out)
+{
+    sim_periph_t *p = NULL;
+
+    fprintf(out, "sim time %.6f s, %llu traps, %llu calls, %llu polls skipped,"
+            " %llu irqs, %llu systicks\n", now / 1e9,
+            (unsigned long long)stats.traps, (unsigned long long)stats.calls,
+            (unsigned long long)stats.polls, (unsigned long long)stats.irqs,
+            (unsigned long long)stats.sysTicks);
+
+    for (p = periphs; p != NULL; p = p->next) {
+        if (p->reads == 0 && p->writes == 0) {
+            continue;
+        }
+        fprintf(out, "  %-12s reads %10u writes %10u", p->name, p->reads,
+                p->writes);
+        if (p->report != NULL) {
+            fprintf(out, "  ");
+            p->report(p, out);
+        }
+        fprintf(out, "\n");
+    }
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get a peripheral clock from the PCLKSEL registers
+ *
+ * Params:
+ *   [in] pclkSel - 0 for PCLKSEL0, 1 for PCLKSEL1
+ *   [in] shift - position of the two bit field
+ *
+ *****************************************************************************/
+uint32_t sim_pclk(uint32_t pclkSel, uint32_t shift)
+{
+    static const uint8_t div[4] = { 4, 1, 2, 8 };
+    uint32_t sel = *sim_reg(SC_PCLKSEL0 + 4 * pclkSel);
+
+    return SIM_CPU_HZ / div[(sel >> shift) & 3];
+}
+
+/* --- the firmware side ---------------------------------------------------- */
+
+void sim_unhandledIrq(void)
+{
+}
+
+void sim_enableIrq(void)
+{
+    primask = 0;
+    dispatch();
+}
+
+void sim_disableIrq(void)
+{
+    primask = 1;
+}
+
+void sim_waitForInterrupt(void)
+{
+    uint64_t t = nextEventTime();
+
+    runUntil((t != SIM_NEVER && t > now) ? t : now + SIM_ACCESS_NS);
+    dispatch();
+}
+
+uint32_t __get_PRIMASK(void)
+{
+    return primask;
+}
+
+void __set_PRIMASK(uint32_t priMask)
+{
+    primask = priMask & 1;
+    dispatch();
+}
+
+uint32_t SystemCoreClock = SIM_CPU_HZ;
+
+void SystemInit(void)
+{
+}
+
+void SystemCoreClockUpdate(void)
+{
+}
+
+void check_failed(uint8_t *file, uint32_t line)
+{
+    fprintf(stderr, "sim: CHECK_PARAM failed at %s:%u\n", (char *)file,
+            (unsigned)line);
+    abort();
+}
+
+void __cyg_profile_func_enter(void *fn, void *site)
+{
+    if (!initialized) {
+        return;
+    }
+    stats.calls++;
+    runUntil(now + SIM_CALL_NS);
+    dispatch();
+}
+
+void __cyg_profile_func_exit(void *fn, void *site)
+{
+}
@@ -0,0 +1,129 @@
+/*****************************************************************************
+ *   sim.h:  Header file for the host side LPC1768 peripheral simulator
+ *
+******************************************************************************/
+#ifndef __SIM_H
+#define __SIM_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define SIM_CPU_HZ      100000000UL     /* SystemCoreClock of the firmware */
+#define SIM_NEVER       UINT64_MAX
+
+/*
+ * Cost model. Firmware code is only charged for what the simulator can
+ * see: register accesses and function calls.
+ */
+#define SIM_ACCESS_NS   40      /* one peripheral register access */
+#define SIM_CALL_NS     100     /* one firmware function call */
+#define SIM_POLL_READS  3       /* reads without a side effect in a row: a polling loop */
+
+#define SIM_NUM_IRQS    35
+
+typedef struct sim_periph_s sim_periph_t;
+
+/*
+ * A simulated register block. The firmware reads and writes the block at
+ * its real address; the model sees every access through the hooks and keeps
+ * the registers up to date through sim_reg(). All hooks are optional.
+ */
+struct sim_periph_s
+{
+    const char *name;
+    uint32_t base;
+    uint32_t size;
+
+    /* before an access; returns 1 if a read has a side effect (FIFO pop) */
+    int (*access)(sim_periph_t *p, uint32_t off, int write);
+    /* after the firmware wrote val */
+    void (*written)(sim_periph_t *p, uint32_t off, uint32_t val);
+    /* catch up with the simulated time */
+    void (*update)(sim_periph_t *p, uint64_t now);
+    /* time of the next state change, SIM_NEVER if there is none */
+    uint64_t (*nextEvent)(sim_periph_t *p);
+    void (*report)(sim_periph_t *p, FILE *out);
+
+    void *ctx;
+    uint32_t reads;
+    uint32_t writes;
+    sim_periph_t *next;
+};
+
+typedef struct
+{
+    uint64_t traps;
+    uint64_t calls;
+    uint64_t polls;         /* polling loops skipped to the next event */
+    uint64_t irqs;
+    uint64_t sysTicks;
+} sim_stats_t;
+
+
+/* sim.c */
+void sim_init(void);
+void sim_run(void (*fn)(void));
+void sim_register(sim_periph_t *p);
+volatile uint32_t *sim_reg(uint32_t addr);
+uint64_t sim_now(void);
+void sim_advance(uint64_t ns);
+void sim_setStopTime(uint64_t ns, void (*onStop)(void));
+void sim_irqRaise(int irq);
+void sim_getStats(sim_stats_t *st);
+void sim_report(FILE *out);
+uint32_t sim_pclk(uint32_t pclkSel, uint32_t shift);
+
+/* sim_gpio.c */
+void sim_gpio_init(void);
+void sim_gpio_setSource(uint8_t port, uint8_t pin,
+        uint8_t (*level)(void *ctx, uint64_t now),
+        uint64_t (*nextEdge)(void *ctx, uint64_t now), void *ctx);
+void sim_gpio_setInput(uint8_t port, uint8_t pin, uint8_t level);
+void sim_gpio_watch(uint8_t port, uint8_t pin,
+        void (*changed)(void *ctx, uint8_t level), void *ctx);
+uint8_t sim_gpio_get(uint8_t port, uint8_t pin);
+
+/* sim_ssp.c */
+typedef struct
+{
+    uint8_t csPort;         /* active low chip select */
+    uint8_t csPin;
+    void (*select)(void *ctx, uint8_t active);
+    uint16_t (*xfer)(void *ctx, uint16_t out);
+    void *ctx;
+} sim_ssp_dev_t;
+
+void sim_ssp_init(void);
+void sim_ssp_attach(uint8_t ssp, sim_ssp_dev_t *dev);
+uint8_t sim_ssp_dmaTx(uint8_t ssp, uint16_t v);
+
+/* sim_i2c.c */
+typedef struct
+{
+    uint8_t addr;           /* 7 bit */
+    uint8_t (*start)(void *ctx, uint8_t read);     /* 1: ACK */
+    uint8_t (*write)(void *ctx, uint8_t b);        /* 1: ACK */
+    uint8_t (*read)(void *ctx);
+    void (*stop)(void *ctx);
+    void *ctx;
+} sim_i2c_dev_t;
+
+void sim_i2c_init(void);
+void sim_i2c_attach(uint8_t bus, sim_i2c_dev_t *dev);
+
+/* sim_timer.c */
+void sim_timer_init(void);
+
+/* sim_gpdma.c */
+void sim_gpdma_init(void);
+
+/* sim_uart.c */
+void sim_uart_init(void);
+void sim_uart_setOutput(uint8_t uart, void (*out)(void *ctx, uint8_t b),
+        void *ctx);
+uint32_t sim_uart_input(uint8_t uart, const uint8_t *data, uint32_t len);
+
+#endif /* end __SIM_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
@@ -0,0 +1,280 @@
+/*****************************************************************************
+ *   sim_gpdma.c:  GPDMA model of the host side simulator
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: Models the eight GPDMA channels for memory to peripheral transfers
+ * to the SSP0 and SSP1 transmit FIFOs, which is what oled.c uses. A
+ * channel moves a transfer unit whenever its SSP takes one
+ * (sim_ssp_dmaTx()), so the transfer runs at the SSP rate and the bus
+ * cycles of the DMA itself take no time. Linked list items are followed.
+ *
+ * The source address is a firmware pointer: the host build keeps the
+ * firmware data below 4 GB (see sim.c), so it is read in place.
+ *
+ * A channel enabled for any other transfer (the UART requests of
+ * logdump.c, peripheral sources, memory to memory) stays enabled and
+ * moves nothing, as before there was a model.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <string.h>
+#include "sim.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define GPDMA_BASE      0x50004000
+#define GPDMA_SIZE      0x200
+
+#define DMA_IRQ         26
+
+#define DMAC_INTSTAT        0x000
+#define DMAC_INTTCSTAT      0x004
+#define DMAC_INTTCCLEAR     0x008
+#define DMAC_INTERRSTAT     0x00C
+#define DMAC_INTERRCLR      0x010
+#define DMAC_RAWINTTCSTAT   0x014
+#define DMAC_RAWINTERRSTAT  0x018
+#define DMAC_ENBLDCHNS      0x01C
+
+#define NUM_CHANNELS    8
+#define CH_BASE(n)      (0x100 + 0x20 * (n))
+#define CH_SRC          0x00
+#define CH_DEST         0x04
+#define CH_LLI          0x08
+#define CH_CONTROL      0x0C
+#define CH_CONFIG       0x10
+
+#define CTRL_SIZE(c)    ((c) & 0xFFF)
+#define CTRL_SWIDTH(c)  (((c) >> 18) & 0x7)
+#define CTRL_SI         (1UL << 26)
+#define CTRL_I          (1UL << 31)
+
+#define CFG_E           (1 << 0)
+#define CFG_DEST(c)     (((c) >> 6) & 0x1F)
+#define CFG_TYPE(c)     (((c) >> 11) & 0x7)
+#define CFG_ITC         (1 << 15)
+
+#define TYPE_M2P        1
+
+/* DMA request lines of the SSP transmit FIFOs */
+#define CONN_SSP0_TX    0
+#define CONN_SSP1_TX    2
+
+#define REG(off)        (*sim_reg(GPDMA_BASE + (off)))
+
+typedef struct
+{
+    uint8_t active;             /* enabled and moving data */
+    uint8_t ssp;
+    uint32_t src;
+    uint32_t left;              /* transfer units */
+} channel_t;
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static channel_t channels[NUM_CHANNELS];
+static uint8_t rawTc = 0;
+static uint32_t transfers = 0;
+static uint32_t units = 0;
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static uint8_t tcMask(void)
+{
+    uint8_t mask = 0;
+    uint8_t n = 0;
+
+    for (n = 0; n < NUM_CHANNELS; n++) {
+        if (REG(CH_BASE(n) + CH_CONFIG) & CFG_ITC) {
+            mask |= 1 << n;
+        }
+    }
+    return mask;
+}
+
+/* takes the transfer from the channel registers, 0 if it isn't modelled */
+static uint8_t load(uint8_t n)
+{
+    channel_t *c = &channels[n];
+    uint32_t cfg = REG(CH_BASE(n) + CH_CONFIG);
+
+    if (CFG_TYPE(cfg) != TYPE_M2P) {
+        return 0;
+    }
+    if (CFG_DEST(cfg) == CONN_SSP0_TX) {
+        c->ssp = 0;
+    }
+    else if (CFG_DEST(cfg) == CONN_SSP1_TX) {
+        c->ssp = 1;
+    }
+    else {
+        return 0;
+    }
+
+    c->src = REG(CH_BASE(n) + CH_SRC);
+    c->left = CTRL_SIZE(REG(CH_BASE(n) + CH_CONTROL));
+    return 1;
+}
+
+/* loads the next linked list item, 0 at the end of the list */
+static uint8_t nextItem(uint8_t n)
+{
+    uint32_t lli = REG(CH_BASE(n) + CH_LLI);
+    const uint32_t *item = (const uint32_t *)(uintptr_t)(lli & ~3UL);
+
+    if (item == NULL) {
+        return 0;
+    }
+
+    REG(CH_BASE(n) + CH_SRC) = item[0];
+    REG(CH_BASE(n) + CH_DEST) = item[1];
+    REG(CH_BASE(n) + CH_LLI) = item[2];
+    REG(CH_BASE(n) + CH_CONTROL) = item[3];
+    return load(n);
+}
+
+static void finish(uint8_t n)
+{
+    channel_t *c = &channels[n];
+    uint32_t ctrl = REG(CH_BASE(n) + CH_CONTROL);
+
+    c->active = 0;
+    transfers++;
+    REG(CH_BASE(n) + CH_CONFIG) &= ~CFG_E;
+
+    if (ctrl & CTRL_I) {
+        rawTc |= 1 << n;
+        if (tcMask() & (1 << n)) {
+            sim_irqRaise(DMA_IRQ);
+        }
+    }
+}
+
+static void run(uint8_t n)
+{
+    channel_t *c = &channels[n];
+    uint32_t ctrl = 0;
+    uint32_t width = 0;
+    uint32_t v = 0;
+
+    while (c->active) {
+        ctrl = REG(CH_BASE(n) + CH_CONTROL);
+        width = 1 << CTRL_SWIDTH(ctrl);
+
+        if (c->left == 0) {
+            if (!nextItem(n) || c->left == 0) {
+                finish(n);
+            }
+            continue;
+        }
+
+        v = 0;
+        memcpy(&v, (const void *)(uintptr_t)c->src, width);
+        if (!sim_ssp_dmaTx(c->ssp, (uint16_t)v)) {
+            break;
+        }
+
+        if (ctrl & CTRL_SI) {
+            c->src += width;
+        }
+        c->left--;
+        units++;
+        REG(CH_BASE(n) + CH_SRC) = c->src;
+        REG(CH_BASE(n) + CH_CONTROL) = (ctrl & ~0xFFFUL) | c->left;
+    }
+}
+
+static int dmaAccess(sim_periph_t *p, uint32_t off, int write)
+{
+    uint8_t enabled = 0;
+    uint8_t n = 0;
+
+    if (write) {
+        return 0;
+    }
+
+    for (n = 0; n < NUM_CHANNELS; n++) {
+        if (REG(CH_BASE(n) + CH_CONFIG) & CFG_E) {
+            enabled |= 1 << n;
+        }
+    }
+
+    REG(DMAC_INTSTAT) = rawTc & tcMask();
+    REG(DMAC_INTTCSTAT) = rawTc & tcMask();
+    REG(DMAC_RAWINTTCSTAT) = rawTc;
+    REG(DMAC_INTERRSTAT) = 0;
+    REG(DMAC_RAWINTERRSTAT) = 0;
+    REG(DMAC_ENBLDCHNS) = enabled;
+    return 0;
+}
+
+static void dmaWritten(sim_periph_t *p, uint32_t off, uint32_t val)
+{
+    channel_t *c = NULL;
+    uint8_t n = 0;
+
+    if (off == DMAC_INTTCCLEAR) {
+        rawTc &= ~val;
+        return;
+    }
+    if (off < CH_BASE(0) || off >= CH_BASE(NUM_CHANNELS)
+            || (off - CH_BASE(0)) % 0x20 != CH_CONFIG) {
+        return;
+    }
+
+    n = (off - CH_BASE(0)) / 0x20;
+    c = &channels[n];
+
+    if (!(val & CFG_E)) {
+        c->active = 0;
+    }
+    else if (!c->active && load(n)) {
+        c->active = 1;
+        run(n);
+    }
+}
+
+static void dmaUpdate(sim_periph_t *p, uint64_t now)
+{
+    uint8_t n = 0;
+
+    for (n = 0; n < NUM_CHANNELS; n++) {
+        run(n);
+    }
+}
+
+static void dmaReport(sim_periph_t *p, FILE *out)
+{
+    fprintf(out, "transfers %u units %u", transfers, units);
+}
+
+static sim_periph_t dmaPeriph = {
+    "GPDMA", GPDMA_BASE, GPDMA_SIZE, dmaAccess, dmaWritten, dmaUpdate,
+    NULL, dmaReport, NULL
+};
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize the GPDMA model
+ *
+ *****************************************************************************/
+void sim_gpdma_init(void)
+{
+    sim_register(&dmaPeriph);
+}
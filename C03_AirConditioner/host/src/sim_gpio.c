@@ -0,0 +1,321 @@
+/*****************************************************************************
+ *   sim_gpio.c:  GPIO model of the host side simulator
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: Models the fast GPIO ports: FIODIR, FIOMASK, FIOPIN, FIOSET and
+ * FIOCLR, at word and byte width. An input pin reads its source if it has
+ * one (a function of the simulated time, e.g. the temperature sensor
+ * square wave), otherwise the level set with sim_gpio_setInput(). Board
+ * devices watch output pins, e.g. chip selects.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include "sim.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define GPIO_BASE       0x2009C000
+#define GPIO_PORTS      5
+#define GPIO_PORT_SIZE  0x20
+
+#define FIODIR          0x00
+#define FIOMASK         0x10
+#define FIOPIN          0x14
+#define FIOSET          0x18
+#define FIOCLR          0x1C
+
+#define MAX_SOURCES     8
+#define MAX_WATCHES     8
+
+#define REG(port, off) (*sim_reg(GPIO_BASE + (port) * GPIO_PORT_SIZE + (off)))
+
+typedef struct
+{
+    uint8_t port;
+    uint8_t pin;
+    uint8_t (*level)(void *ctx, uint64_t now);
+    uint64_t (*nextEdge)(void *ctx, uint64_t now);
+    void *ctx;
+} source_t;
+
+typedef struct
+{
+    uint8_t port;
+    uint8_t pin;
+    uint8_t last;
+    void (*changed)(void *ctx, uint8_t level);
+    void *ctx;
+} watch_t;
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static uint32_t latch[GPIO_PORTS];
+static uint32_t inputs[GPIO_PORTS];
+
+static source_t sources[MAX_SOURCES];
+static uint8_t numSources = 0;
+
+static watch_t watches[MAX_WATCHES];
+static uint8_t numWatches = 0;
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static uint32_t readPins(uint8_t port)
+{
+    uint32_t dir = REG(port, FIODIR);
+    uint32_t in = inputs[port];
+    uint64_t now = sim_now();
+    uint8_t i = 0;
+
+    for (i = 0; i < numSources; i++) {
+        if (sources[i].port == port) {
+            if (sources[i].level(sources[i].ctx, now)) {
+                in |= 1UL << sources[i].pin;
+            }
+            else {
+                in &= ~(1UL << sources[i].pin);
+            }
+        }
+    }
+
+    return (latch[port] & dir) | (in & ~dir);
+}
+
+static void checkWatches(void)
+{
+    watch_t *w = NULL;
+    uint8_t level = 0;
+    uint8_t i = 0;
+
+    for (i = 0; i < numWatches; i++) {
+        w = &watches[i];
+        level = (readPins(w->port) >> w->pin) & 1;
+        if (level != w->last) {
+            w->last = level;
+            w->changed(w->ctx, level);
+        }
+    }
+}
+
+static int gpioAccess(sim_periph_t *p, uint32_t off, int write)
+{
+    uint8_t port = off / GPIO_PORT_SIZE;
+    uint32_t reg = off % GPIO_PORT_SIZE;
+
+    if (port >= GPIO_PORTS) {
+        return 0;
+    }
+
+    if (write) {
+        /* a byte write to SET or CLR must not repeat the other bytes */
+        if ((reg & ~3) == FIOSET || (reg & ~3) == FIOCLR) {
+            REG(port, reg & ~3) = 0;
+        }
+        return 0;
+    }
+
+    switch (reg & ~3) {
+    case FIOPIN:
+        REG(port, FIOPIN) = readPins(port) & ~REG(port, FIOMASK);
+        break;
+    case FIOSET:
+        REG(port, FIOSET) = latch[port] & ~REG(port, FIOMASK);
+        break;
+    case FIOCLR:
+        REG(port, FIOCLR) = 0;
+        break;
+    }
+    return 0;
+}
+
+static void gpioWritten(sim_periph_t *p, uint32_t off, uint32_t val)
+{
+    uint8_t port = off / GPIO_PORT_SIZE;
+    uint32_t mask = 0;
+
+    if (port >= GPIO_PORTS) {
+        return;
+    }
+
+    mask = REG(port, FIOMASK);
+    switch (off % GPIO_PORT_SIZE) {
+    case FIOPIN:
+        latch[port] = (latch[port] & mask) | (val & ~mask);
+        break;
+    case FIOSET:
+        latch[port] |= val & ~mask;
+        break;
+    case FIOCLR:
+        latch[port] &= ~(val & ~mask);
+        break;
+    }
+
+    checkWatches();
+}
+
+static uint64_t gpioNextEvent(sim_periph_t *p)
+{
+    uint64_t now = sim_now();
+    uint64_t t = SIM_NEVER;
+    uint64_t e = 0;
+    uint8_t i = 0;
+
+    for (i = 0; i < numSources; i++) {
+        if (sources[i].nextEdge != NULL) {
+            e = sources[i].nextEdge(sources[i].ctx, now);
+            if (e < t) {
+                t = e;
+            }
+        }
+    }
+    return t;
+}
+
+static void gpioReport(sim_periph_t *p, FILE *out)
+{
+    fprintf(out, "P0 %08x P1 %08x P2 %08x", latch[0], latch[1], latch[2]);
+}
+
+static sim_periph_t gpioPeriph = {
+    "GPIO", GPIO_BASE, GPIO_PORTS * GPIO_PORT_SIZE,
+    gpioAccess, gpioWritten, NULL, gpioNextEvent, gpioReport
+};
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize the GPIO model, all pins are inputs reading high
+ *
+ *****************************************************************************/
+void sim_gpio_init(void)
+{
+    uint8_t i = 0;
+
+    for (i = 0; i < GPIO_PORTS; i++) {
+        latch[i] = 0;
+        inputs[i] = 0xFFFFFFFF;
+    }
+    numSources = 0;
+    numWatches = 0;
+    sim_register(&gpioPeriph);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Drive an input pin from a function of the simulated time
+ *
+ * Params:
+ *   [in] port - port number
+ *   [in] pin - pin number
+ *   [in] level - returns the level at a time
+ *   [in] nextEdge - returns the time of the next edge after a time, may be
+ *                   NULL; lets the simulator skip polling loops
+ *   [in] ctx - passed to the functions
+ *
+ *****************************************************************************/
+void sim_gpio_setSource(uint8_t port, uint8_t pin,
+        uint8_t (*level)(void *ctx, uint64_t now),
+        uint64_t (*nextEdge)(void *ctx, uint64_t now), void *ctx)
+{
+    source_t *s = NULL;
+
+    if (numSources >= MAX_SOURCES) {
+        return;
+    }
+
+    s = &sources[numSources++];
+    s->port = port;
+    s->pin = pin;
+    s->level = level;
+    s->nextEdge = nextEdge;
+    s->ctx = ctx;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Set the level of an input pin without a source
+ *
+ * Params:
+ *   [in] port - port number
+ *   [in] pin - pin number
+ *   [in] level - 0 or 1
+ *
+ *****************************************************************************/
+void sim_gpio_setInput(uint8_t port, uint8_t pin, uint8_t level)
+{
+    if (port >= GPIO_PORTS) {
+        return;
+    }
+
+    if (level) {
+        inputs[port] |= 1UL << pin;
+    }
+    else {
+        inputs[port] &= ~(1UL << pin);
+    }
+    checkWatches();
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get called when the level of a pin changes, e.g. a chip select
+ *
+ * Params:
+ *   [in] port - port number
+ *   [in] pin - pin number
+ *   [in] changed - called with the new level
+ *   [in] ctx - passed to changed
+ *
+ *****************************************************************************/
+void sim_gpio_watch(uint8_t port, uint8_t pin,
+        void (*changed)(void *ctx, uint8_t level), void *ctx)
+{
+    watch_t *w = NULL;
+
+    if (numWatches >= MAX_WATCHES || port >= GPIO_PORTS) {
+        return;
+    }
+
+    w = &watches[numWatches++];
+    w->port = port;
+    w->pin = pin;
+    w->changed = changed;
+    w->ctx = ctx;
+    w->last = (readPins(port) >> pin) & 1;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the level of a pin
+ *
+ * Params:
+ *   [in] port - port number
+ *   [in] pin - pin number
+ *
+ *****************************************************************************/
+uint8_t sim_gpio_get(uint8_t port, uint8_t pin)
+{
+    if (port >= GPIO_PORTS) {
+        return 0;
+    }
+    return (readPins(port) >> pin) & 1;
+}
@@ -0,0 +1,320 @@
+/*****************************************************************************
+ *   sim_i2c.c:  I2C model of the host side simulator
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: Models the I2C interfaces in master mode with the status codes of
+ * the user manual. The interface acts when the firmware clears SI, or sets
+ * STA while SI is clear: a (repeated) START, the address byte, a data byte
+ * written or a data byte read, depending on the current status. The
+ * result, with SI set, comes one bit time (START) or nine bit times (a
+ * byte) later at the rate set in SCLH and SCLL.
+ *
+ * STO takes effect at once: the addressed device sees the STOP and the
+ * status goes back to 0xF8. Slave mode and arbitration are not modelled.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include "sim.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define I2C_CONSET      0x00
+#define I2C_STAT        0x04
+#define I2C_DAT         0x08
+#define I2C_SCLH        0x10
+#define I2C_SCLL        0x14
+#define I2C_CONCLR      0x18
+
+#define CON_AA          (1 << 2)
+#define CON_SI          (1 << 3)
+#define CON_STO         (1 << 4)
+#define CON_STA         (1 << 5)
+#define CON_I2EN        (1 << 6)
+
+#define ST_START        0x08
+#define ST_RESTART      0x10
+#define ST_SLAW_ACK     0x18
+#define ST_SLAW_NACK    0x20
+#define ST_DATW_ACK     0x28
+#define ST_DATW_NACK    0x30
+#define ST_SLAR_ACK     0x40
+#define ST_SLAR_NACK    0x48
+#define ST_DATR_ACK     0x50
+#define ST_DATR_NACK    0x58
+#define ST_IDLE         0xF8
+
+#define MAX_DEVS        8
+
+typedef struct
+{
+    uint32_t base;
+    uint8_t pclkSel;
+    uint8_t pclkShift;
+    uint8_t irq;
+
+    uint32_t con;
+    uint32_t stat;
+    uint8_t active;             /* bus owned, between START and STOP */
+    sim_i2c_dev_t *dev;         /* addressed device */
+
+    uint8_t busy;               /* an action is on the wire */
+    uint64_t done;
+    uint32_t nextStat;
+    int32_t nextDat;            /* received byte, -1 for none */
+
+    sim_i2c_dev_t *devs[MAX_DEVS];
+    uint8_t numDevs;
+
+    uint32_t starts;
+    uint32_t bytes;
+    uint32_t nacks;
+} i2c_t;
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static i2c_t i2cs[3] = {
+    { 0x4001C000, 0, 14, 10 },
+    { 0x4005C000, 1, 6, 11 },
+    { 0x400A0000, 1, 20, 12 },
+};
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static uint64_t bitTime(i2c_t *b)
+{
+    uint32_t div = (*sim_reg(b->base + I2C_SCLH) & 0xFFFF)
+            + (*sim_reg(b->base + I2C_SCLL) & 0xFFFF);
+
+    if (div < 8) {
+        div = 8;
+    }
+    return (uint64_t)div * 1000000000ULL / sim_pclk(b->pclkSel, b->pclkShift);
+}
+
+static sim_i2c_dev_t *findDev(i2c_t *b, uint8_t addr)
+{
+    uint8_t i = 0;
+
+    for (i = 0; i < b->numDevs; i++) {
+        if (b->devs[i]->addr == addr) {
+            return b->devs[i];
+        }
+    }
+    return NULL;
+}
+
+static void schedule(i2c_t *b, uint32_t stat, uint32_t bits)
+{
+    b->busy = 1;
+    b->nextStat = stat;
+    b->done = sim_now() + bits * bitTime(b);
+}
+
+static void doStop(i2c_t *b)
+{
+    if (b->dev != NULL && b->dev->stop != NULL) {
+        b->dev->stop(b->dev->ctx);
+    }
+    b->dev = NULL;
+    b->active = 0;
+    b->stat = ST_IDLE;
+    b->con &= ~CON_STO;
+}
+
+static void doByte(i2c_t *b)
+{
+    uint8_t dat = *sim_reg(b->base + I2C_DAT) & 0xFF;
+    uint8_t ack = 0;
+
+    b->nextDat = -1;
+
+    switch (b->stat) {
+    case ST_START:
+    case ST_RESTART:
+        b->dev = findDev(b, dat >> 1);
+        ack = (b->dev != NULL && b->dev->start(b->dev->ctx, dat & 1));
+        if (!ack) {
+            b->dev = NULL;
+            b->nacks++;
+        }
+        if (dat & 1) {
+            schedule(b, ack ? ST_SLAR_ACK : ST_SLAR_NACK, 9);
+        }
+        else {
+            schedule(b, ack ? ST_SLAW_ACK : ST_SLAW_NACK, 9);
+        }
+        break;
+
+    case ST_SLAW_ACK:
+    case ST_SLAW_NACK:
+    case ST_DATW_ACK:
+    case ST_DATW_NACK:
+        ack = (b->dev != NULL && b->dev->write(b->dev->ctx, dat));
+        if (!ack) {
+            b->nacks++;
+        }
+        b->bytes++;
+        schedule(b, ack ? ST_DATW_ACK : ST_DATW_NACK, 9);
+        break;
+
+    case ST_SLAR_ACK:
+    case ST_DATR_ACK:
+        b->nextDat = (b->dev != NULL) ? b->dev->read(b->dev->ctx) : 0xFF;
+        b->bytes++;
+        schedule(b, (b->con & CON_AA) ? ST_DATR_ACK : ST_DATR_NACK, 9);
+        break;
+    }
+}
+
+/* the firmware changed the control bits */
+static void evaluate(i2c_t *b, uint8_t siCleared)
+{
+    if (!(b->con & CON_I2EN) || b->busy || (b->con & CON_SI)) {
+        return;
+    }
+
+    if (b->con & CON_STO) {
+        doStop(b);
+        siCleared = 0;
+    }
+
+    if (b->con & CON_STA) {
+        b->starts++;
+        schedule(b, b->active ? ST_RESTART : ST_START, 1);
+        b->active = 1;
+    }
+    else if (siCleared && b->active) {
+        doByte(b);
+    }
+}
+
+static int i2cAccess(sim_periph_t *p, uint32_t off, int write)
+{
+    i2c_t *b = (i2c_t *)p->ctx;
+
+    if (write) {
+        return 0;
+    }
+
+    switch (off) {
+    case I2C_CONSET:
+    case I2C_CONCLR:
+        *sim_reg(b->base + off) = b->con;
+        break;
+    case I2C_STAT:
+        *sim_reg(b->base + off) = b->stat;
+        break;
+    }
+    return 0;
+}
+
+static void i2cWritten(sim_periph_t *p, uint32_t off, uint32_t val)
+{
+    i2c_t *b = (i2c_t *)p->ctx;
+    uint32_t before = b->con;
+
+    if (off == I2C_CONSET) {
+        b->con |= val & (CON_AA | CON_STO | CON_STA | CON_I2EN);
+    }
+    else if (off == I2C_CONCLR) {
+        b->con &= ~(val & (CON_AA | CON_SI | CON_STA | CON_I2EN));
+    }
+    else {
+        return;
+    }
+
+    evaluate(b, (before & CON_SI) && !(b->con & CON_SI));
+}
+
+static void i2cUpdate(sim_periph_t *p, uint64_t now)
+{
+    i2c_t *b = (i2c_t *)p->ctx;
+
+    if (!b->busy || b->done > now) {
+        return;
+    }
+
+    b->busy = 0;
+    b->stat = b->nextStat;
+    if (b->nextDat >= 0) {
+        *sim_reg(b->base + I2C_DAT) = (uint32_t)b->nextDat;
+    }
+    b->con |= CON_SI;
+    sim_irqRaise(b->irq);
+}
+
+static uint64_t i2cNextEvent(sim_periph_t *p)
+{
+    i2c_t *b = (i2c_t *)p->ctx;
+
+    return b->busy ? b->done : SIM_NEVER;
+}
+
+static void i2cReport(sim_periph_t *p, FILE *out)
+{
+    i2c_t *b = (i2c_t *)p->ctx;
+
+    fprintf(out, "starts %u bytes %u nacks %u", b->starts, b->bytes, b->nacks);
+}
+
+static sim_periph_t i2cPeriphs[3] = {
+    { "I2C0", 0x4001C000, 0x1000, i2cAccess, i2cWritten, i2cUpdate,
+            i2cNextEvent, i2cReport, &i2cs[0] },
+    { "I2C1", 0x4005C000, 0x1000, i2cAccess, i2cWritten, i2cUpdate,
+            i2cNextEvent, i2cReport, &i2cs[1] },
+    { "I2C2", 0x400A0000, 0x1000, i2cAccess, i2cWritten, i2cUpdate,
+            i2cNextEvent, i2cReport, &i2cs[2] },
+};
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize the I2C models
+ *
+ *****************************************************************************/
+void sim_i2c_init(void)
+{
+    uint8_t i = 0;
+
+    for (i = 0; i < 3; i++) {
+        i2cs[i].stat = ST_IDLE;
+        sim_register(&i2cPeriphs[i]);
+    }
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Attach a device to an I2C bus
+ *
+ * Params:
+ *   [in] bus - 0, 1 or 2
+ *   [in] dev - the device, must stay valid
+ *
+ *****************************************************************************/
+void sim_i2c_attach(uint8_t bus, sim_i2c_dev_t *dev)
+{
+    i2c_t *b = NULL;
+
+    if (bus > 2 || i2cs[bus].numDevs >= MAX_DEVS) {
+        return;
+    }
+
+    b = &i2cs[bus];
+    b->devs[b->numDevs++] = dev;
+}
@@ -0,0 +1,361 @@
+/*****************************************************************************
+ *   sim_ssp.c:  SSP model of the host side simulator
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: Models SSP0 and SSP1 in SPI master mode with the 8 frame transmit
+ * and receive FIFOs. A frame takes DSS+1 bit times at
+ * PCLK / (CPSDVSR * (SCR + 1)); frames written while one is shifted out
+ * queue in the transmit FIFO. A frame that finds the receive FIFO full is
+ * lost and sets ROR.
+ *
+ * Each frame is exchanged with the attached device whose chip select (a
+ * GPIO, active low) is low at the end of the frame; without one the frame
+ * reads all ones.
+ *
+ * With TXDMAE set in DMACR the GPDMA model (sim_gpdma.c) fills the
+ * transmit FIFO through sim_ssp_dmaTx(); the receive DMA request is not
+ * modelled.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include "sim.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define SSP0_BASE       0x40088000
+#define SSP1_BASE       0x40030000
+
+#define SSP_CR0         0x00
+#define SSP_CR1         0x04
+#define SSP_DR          0x08
+#define SSP_SR          0x0C
+#define SSP_CPSR        0x10
+#define SSP_IMSC        0x14
+#define SSP_RIS         0x18
+#define SSP_MIS         0x1C
+#define SSP_ICR         0x20
+#define SSP_DMACR       0x24
+
+#define CR1_SSE         (1 << 1)
+
+#define DMACR_TXDMAE    (1 << 1)
+
+#define SR_TFE          (1 << 0)
+#define SR_TNF          (1 << 1)
+#define SR_RNE          (1 << 2)
+#define SR_RFF          (1 << 3)
+#define SR_BSY          (1 << 4)
+
+#define RIS_ROR         (1 << 0)
+#define RIS_RT          (1 << 1)
+#define RIS_RX          (1 << 2)
+#define RIS_TX          (1 << 3)
+
+#define FIFO_SIZE       8
+#define MAX_DEVS        4
+
+typedef struct
+{
+    uint16_t data[FIFO_SIZE];
+    uint8_t head;
+    uint8_t count;
+} fifo_t;
+
+typedef struct
+{
+    uint32_t base;
+    uint8_t pclkSel;            /* PCLKSEL register and field of the clock */
+    uint8_t pclkShift;
+    uint8_t irq;
+
+    fifo_t tx;
+    fifo_t rx;
+    uint8_t shifting;           /* a frame is on the wire */
+    uint16_t out;
+    uint64_t frameEnd;
+    uint32_t ris;
+
+    sim_ssp_dev_t *devs[MAX_DEVS];
+    uint8_t numDevs;
+
+    uint32_t frames;
+    uint32_t overruns;
+} ssp_t;
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static ssp_t ssps[2] = {
+    { SSP0_BASE, 1, 10, 14 },
+    { SSP1_BASE, 0, 20, 15 },
+};
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static void fifoPush(fifo_t *f, uint16_t v)
+{
+    f->data[(f->head + f->count) % FIFO_SIZE] = v;
+    f->count++;
+}
+
+static uint16_t fifoPop(fifo_t *f)
+{
+    uint16_t v = f->data[f->head];
+
+    f->head = (f->head + 1) % FIFO_SIZE;
+    f->count--;
+    return v;
+}
+
+static uint64_t frameTime(ssp_t *s)
+{
+    uint32_t cr0 = *sim_reg(s->base + SSP_CR0);
+    uint32_t cpsr = *sim_reg(s->base + SSP_CPSR) & 0xFE;
+    uint32_t bits = (cr0 & 0xF) + 1;
+    uint64_t div = 0;
+
+    if (cpsr == 0) {
+        cpsr = 2;
+    }
+    div = (uint64_t)cpsr * (((cr0 >> 8) & 0xFF) + 1);
+
+    return bits * div * 1000000000ULL / sim_pclk(s->pclkSel, s->pclkShift);
+}
+
+static void startFrame(ssp_t *s, uint64_t at)
+{
+    if (s->shifting || s->tx.count == 0
+            || !(*sim_reg(s->base + SSP_CR1) & CR1_SSE)) {
+        return;
+    }
+    s->out = fifoPop(&s->tx);
+    s->shifting = 1;
+    s->frameEnd = at + frameTime(s);
+}
+
+static void endFrame(ssp_t *s)
+{
+    uint32_t mask = (1UL << ((*sim_reg(s->base + SSP_CR0) & 0xF) + 1)) - 1;
+    sim_ssp_dev_t *d = NULL;
+    uint16_t in = 0xFFFF;
+    uint8_t i = 0;
+
+    for (i = 0; i < s->numDevs; i++) {
+        d = s->devs[i];
+        if (sim_gpio_get(d->csPort, d->csPin) == 0) {
+            in = d->xfer(d->ctx, s->out & mask);
+            break;
+        }
+    }
+
+    s->frames++;
+    s->shifting = 0;
+    if (s->rx.count < FIFO_SIZE) {
+        fifoPush(&s->rx, in & mask);
+    }
+    else {
+        s->ris |= RIS_ROR;
+        s->overruns++;
+    }
+}
+
+static int sspAccess(sim_periph_t *p, uint32_t off, int write)
+{
+    ssp_t *s = (ssp_t *)p->ctx;
+    uint32_t sr = 0;
+
+    if (write) {
+        return 0;
+    }
+
+    switch (off) {
+    case SSP_DR:
+        if (s->rx.count > 0) {
+            *sim_reg(s->base + SSP_DR) = fifoPop(&s->rx);
+            return 1;
+        }
+        break;
+    case SSP_SR:
+        if (s->tx.count == 0) {
+            sr |= SR_TFE;
+        }
+        if (s->tx.count < FIFO_SIZE) {
+            sr |= SR_TNF;
+        }
+        if (s->rx.count > 0) {
+            sr |= SR_RNE;
+        }
+        if (s->rx.count == FIFO_SIZE) {
+            sr |= SR_RFF;
+        }
+        if (s->shifting || s->tx.count > 0) {
+            sr |= SR_BSY;
+        }
+        *sim_reg(s->base + SSP_SR) = sr;
+        break;
+    case SSP_RIS:
+    case SSP_MIS:
+        sr = s->ris;
+        if (s->rx.count >= FIFO_SIZE / 2) {
+            sr |= RIS_RX;
+        }
+        if (s->tx.count <= FIFO_SIZE / 2) {
+            sr |= RIS_TX;
+        }
+        if (off == SSP_MIS) {
+            sr &= *sim_reg(s->base + SSP_IMSC);
+        }
+        *sim_reg(s->base + off) = sr;
+        break;
+    }
+    return 0;
+}
+
+static void sspWritten(sim_periph_t *p, uint32_t off, uint32_t val)
+{
+    ssp_t *s = (ssp_t *)p->ctx;
+
+    switch (off) {
+    case SSP_DR:
+        if (s->tx.count < FIFO_SIZE) {
+            fifoPush(&s->tx, (uint16_t)val);
+        }
+        startFrame(s, sim_now());
+        break;
+    case SSP_CR1:
+        startFrame(s, sim_now());
+        break;
+    case SSP_ICR:
+        s->ris &= ~(val & (RIS_ROR | RIS_RT));
+        break;
+    }
+}
+
+static void sspUpdate(sim_periph_t *p, uint64_t now)
+{
+    ssp_t *s = (ssp_t *)p->ctx;
+    uint64_t end = 0;
+
+    while (s->shifting && s->frameEnd <= now) {
+        end = s->frameEnd;
+        endFrame(s);
+        startFrame(s, end);
+    }
+
+    if ((s->ris | (s->rx.count >= FIFO_SIZE / 2 ? RIS_RX : 0))
+            & *sim_reg(s->base + SSP_IMSC)) {
+        sim_irqRaise(s->irq);
+    }
+}
+
+static uint64_t sspNextEvent(sim_periph_t *p)
+{
+    ssp_t *s = (ssp_t *)p->ctx;
+
+    return s->shifting ? s->frameEnd : SIM_NEVER;
+}
+
+static void sspReport(sim_periph_t *p, FILE *out)
+{
+    ssp_t *s = (ssp_t *)p->ctx;
+
+    fprintf(out, "frames %u overruns %u", s->frames, s->overruns);
+}
+
+static sim_periph_t sspPeriphs[2] = {
+    { "SSP0", SSP0_BASE, 0x1000, sspAccess, sspWritten, sspUpdate,
+            sspNextEvent, sspReport, &ssps[0] },
+    { "SSP1", SSP1_BASE, 0x1000, sspAccess, sspWritten, sspUpdate,
+            sspNextEvent, sspReport, &ssps[1] },
+};
+
+static void csChanged(void *ctx, uint8_t level)
+{
+    sim_ssp_dev_t *d = (sim_ssp_dev_t *)ctx;
+
+    if (d->select != NULL) {
+        d->select(d->ctx, level == 0);
+    }
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize the SSP models
+ *
+ *****************************************************************************/
+void sim_ssp_init(void)
+{
+    sim_register(&sspPeriphs[0]);
+    sim_register(&sspPeriphs[1]);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Attach a device to an SSP
+ *
+ * Params:
+ *   [in] ssp - 0 or 1
+ *   [in] dev - the device, must stay valid
+ *
+ *****************************************************************************/
+void sim_ssp_attach(uint8_t ssp, sim_ssp_dev_t *dev)
+{
+    ssp_t *s = NULL;
+
+    if (ssp > 1 || ssps[ssp].numDevs >= MAX_DEVS) {
+        return;
+    }
+
+    s = &ssps[ssp];
+    s->devs[s->numDevs++] = dev;
+    sim_gpio_watch(dev->csPort, dev->csPin, csChanged, dev);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Transmit DMA request of an SSP: write a frame to the transmit FIFO if
+ *    TXDMAE is set and the FIFO has room
+ *
+ * Params:
+ *   [in] ssp - 0 or 1
+ *   [in] v - frame
+ *
+ * Returns:
+ *   1 if the frame was taken
+ *
+ *****************************************************************************/
+uint8_t sim_ssp_dmaTx(uint8_t ssp, uint16_t v)
+{
+    ssp_t *s = NULL;
+
+    if (ssp > 1) {
+        return 0;
+    }
+
+    s = &ssps[ssp];
+    if (!(*sim_reg(s->base + SSP_DMACR) & DMACR_TXDMAE)
+            || s->tx.count >= FIFO_SIZE) {
+        return 0;
+    }
+
+    fifoPush(&s->tx, v);
+    startFrame(s, sim_now());
+    return 1;
+}
@@ -0,0 +1,300 @@
+/*****************************************************************************
+ *   sim_timer.c:  Timer model of the host side simulator
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: Models TIMER0..3 in timer mode: the prescaler, the timer counter
+ * and the four match registers with interrupt, reset and stop on match.
+ * The counter is brought up to date when the firmware accesses the timer
+ * and when the simulated time moves on, so matches are handled in between
+ * ticks in one step rather than tick by tick.
+ *
+ * As on the chip, a reset on match clears the counter one tick after the
+ * match, so the period is MR + 1 ticks. Capture, the external match
+ * outputs and counter mode are not modelled.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include "sim.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define TIM_IR          0x00
+#define TIM_TCR         0x04
+#define TIM_TC          0x08
+#define TIM_PR          0x0C
+#define TIM_PC          0x10
+#define TIM_MCR         0x14
+#define TIM_MR0         0x18
+
+#define TCR_ENABLE      (1 << 0)
+#define TCR_RESET       (1 << 1)
+
+#define MCR_INT(n)      (1 << (3 * (n)))
+#define MCR_RESET(n)    (1 << (3 * (n) + 1))
+#define MCR_STOP(n)     (1 << (3 * (n) + 2))
+#define MCR_ANY(n)      (7 << (3 * (n)))
+
+#define REG(t, off)     (*sim_reg((t)->base + (off)))
+
+typedef struct
+{
+    uint32_t base;
+    uint8_t pclkSel;
+    uint8_t pclkShift;
+    uint8_t irq;
+
+    uint32_t tc;
+    uint32_t pc;
+    uint32_t ir;
+    uint64_t lastCycle;         /* PCLK cycle the counter is up to date with */
+
+    uint32_t matches;
+} tim_t;
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static tim_t timers[4] = {
+    { 0x40004000, 0, 2, 1 },
+    { 0x40008000, 0, 4, 2 },
+    { 0x40090000, 1, 12, 3 },
+    { 0x40094000, 1, 14, 4 },
+};
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static uint64_t toCycles(tim_t *t, uint64_t ns)
+{
+    return (uint64_t)((unsigned __int128)ns * sim_pclk(t->pclkSel,
+            t->pclkShift) / 1000000000U);
+}
+
+static uint64_t toNs(tim_t *t, uint64_t cycles)
+{
+    uint32_t pclk = sim_pclk(t->pclkSel, t->pclkShift);
+
+    return (uint64_t)(((unsigned __int128)cycles * 1000000000U + pclk - 1)
+            / pclk);
+}
+
+/* a channel matched at the last tick and resets the counter at the next */
+static uint8_t resetPending(tim_t *t)
+{
+    uint32_t mcr = REG(t, TIM_MCR);
+    uint8_t n = 0;
+
+    for (n = 0; n < 4; n++) {
+        if ((mcr & MCR_RESET(n)) && t->tc == REG(t, TIM_MR0 + 4 * n)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void checkMatch(tim_t *t)
+{
+    uint32_t mcr = REG(t, TIM_MCR);
+    uint8_t n = 0;
+
+    for (n = 0; n < 4; n++) {
+        if (!(mcr & MCR_ANY(n)) || t->tc != REG(t, TIM_MR0 + 4 * n)) {
+            continue;
+        }
+        t->matches++;
+        if (mcr & MCR_INT(n)) {
+            t->ir |= 1 << n;
+            sim_irqRaise(t->irq);
+        }
+        if (mcr & MCR_STOP(n)) {
+            REG(t, TIM_TCR) &= ~TCR_ENABLE;
+        }
+    }
+}
+
+/* ticks until the next match, 0 if there is none */
+static uint64_t ticksToMatch(tim_t *t)
+{
+    uint32_t mcr = REG(t, TIM_MCR);
+    uint64_t best = 0;
+    uint64_t d = 0;
+    uint32_t mr = 0;
+    uint8_t reset = resetPending(t);
+    uint8_t n = 0;
+
+    for (n = 0; n < 4; n++) {
+        if (!(mcr & MCR_ANY(n))) {
+            continue;
+        }
+        mr = REG(t, TIM_MR0 + 4 * n);
+        if (reset) {
+            d = (uint64_t)mr + 1;
+        }
+        else {
+            d = (uint32_t)(mr - t->tc);
+            if (d == 0) {
+                d = 0x100000000ULL;
+            }
+        }
+        if (best == 0 || d < best) {
+            best = d;
+        }
+    }
+    return best;
+}
+
+static void advance(tim_t *t, uint64_t ticks)
+{
+    uint64_t d = 0;
+
+    while (ticks > 0 && (REG(t, TIM_TCR) & TCR_ENABLE)) {
+        if (resetPending(t)) {
+            t->tc = 0;
+            ticks--;
+            checkMatch(t);
+            continue;
+        }
+
+        d = ticksToMatch(t);
+        if (d == 0 || d > ticks) {
+            t->tc += (uint32_t)ticks;
+            break;
+        }
+        t->tc += (uint32_t)d;
+        ticks -= d;
+        checkMatch(t);
+    }
+}
+
+static void sync(tim_t *t, uint64_t now)
+{
+    uint64_t cycle = toCycles(t, now);
+    uint64_t total = 0;
+    uint32_t pr = REG(t, TIM_PR) + 1;
+
+    if (cycle <= t->lastCycle) {
+        return;
+    }
+
+    if ((REG(t, TIM_TCR) & (TCR_ENABLE | TCR_RESET)) == TCR_ENABLE) {
+        total = t->pc + (cycle - t->lastCycle);
+        t->pc = total % pr;
+        advance(t, total / pr);
+    }
+    t->lastCycle = cycle;
+}
+
+static int timerAccess(sim_periph_t *p, uint32_t off, int write)
+{
+    tim_t *t = (tim_t *)p->ctx;
+
+    sync(t, sim_now());
+
+    if (write) {
+        return 0;
+    }
+
+    switch (off) {
+    case TIM_IR:
+        REG(t, TIM_IR) = t->ir;
+        break;
+    case TIM_TC:
+        REG(t, TIM_TC) = t->tc;
+        break;
+    case TIM_PC:
+        REG(t, TIM_PC) = t->pc;
+        break;
+    }
+    return 0;
+}
+
+static void timerWritten(sim_periph_t *p, uint32_t off, uint32_t val)
+{
+    tim_t *t = (tim_t *)p->ctx;
+
+    switch (off) {
+    case TIM_IR:
+        t->ir &= ~val;
+        break;
+    case TIM_TCR:
+        if (val & TCR_RESET) {
+            t->tc = 0;
+            t->pc = 0;
+        }
+        break;
+    case TIM_TC:
+        t->tc = val;
+        break;
+    case TIM_PC:
+        t->pc = val;
+        break;
+    }
+}
+
+static void timerUpdate(sim_periph_t *p, uint64_t now)
+{
+    sync((tim_t *)p->ctx, now);
+}
+
+static uint64_t timerNextEvent(sim_periph_t *p)
+{
+    tim_t *t = (tim_t *)p->ctx;
+    uint64_t ticks = 0;
+    uint32_t pr = REG(t, TIM_PR) + 1;
+
+    if ((REG(t, TIM_TCR) & (TCR_ENABLE | TCR_RESET)) != TCR_ENABLE) {
+        return SIM_NEVER;
+    }
+
+    ticks = ticksToMatch(t);
+    if (ticks == 0) {
+        return SIM_NEVER;
+    }
+    return toNs(t, t->lastCycle + ticks * pr - t->pc);
+}
+
+static void timerReport(sim_periph_t *p, FILE *out)
+{
+    tim_t *t = (tim_t *)p->ctx;
+
+    fprintf(out, "tc %u matches %u", t->tc, t->matches);
+}
+
+static sim_periph_t timerPeriphs[4] = {
+    { "TIMER0", 0x40004000, 0x1000, timerAccess, timerWritten, timerUpdate,
+            timerNextEvent, timerReport, &timers[0] },
+    { "TIMER1", 0x40008000, 0x1000, timerAccess, timerWritten, timerUpdate,
+            timerNextEvent, timerReport, &timers[1] },
+    { "TIMER2", 0x40090000, 0x1000, timerAccess, timerWritten, timerUpdate,
+            timerNextEvent, timerReport, &timers[2] },
+    { "TIMER3", 0x40094000, 0x1000, timerAccess, timerWritten, timerUpdate,
+            timerNextEvent, timerReport, &timers[3] },
+};
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize the timer models
+ *
+ *****************************************************************************/
+void sim_timer_init(void)
+{
+    uint8_t i = 0;
+
+    for (i = 0; i < 4; i++) {
+        sim_register(&timerPeriphs[i]);
+    }
+}
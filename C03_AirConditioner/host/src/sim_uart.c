@@ -0,0 +1,440 @@
+/*****************************************************************************
+ *   sim_uart.c:  UART model of the host side simulator
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: Models UART0..3 with the 16 byte FIFOs, the divisor latch and the
+ * fractional divider, the line status and the RDA, CTI and THRE
+ * interrupts. A character takes 10 bit times at the programmed rate.
+ *
+ * Transmitted characters go to the output function set with
+ * sim_uart_setOutput() as they leave the shift register. Characters given
+ * to sim_uart_input() arrive one character time apart. The modem lines,
+ * line errors and the DMA requests are not modelled.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include "sim.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define U_RBR           0x00        /* THR, DLL */
+#define U_IER           0x04        /* DLM */
+#define U_IIR           0x08        /* FCR */
+#define U_LCR           0x0C
+#define U_LSR           0x14
+#define U_FDR           0x28
+#define U_TER           0x30
+
+#define IER_RBR         (1 << 0)
+#define IER_THRE        (1 << 1)
+
+#define IIR_NONE        0x01
+#define IIR_THRE        0x02
+#define IIR_RDA         0x04
+#define IIR_CTI         0x0C
+#define IIR_FIFO        0xC0
+
+#define FCR_RX_RESET    (1 << 1)
+#define FCR_TX_RESET    (1 << 2)
+
+#define LCR_DLAB        (1 << 7)
+
+#define LSR_RDR         (1 << 0)
+#define LSR_THRE        (1 << 5)
+#define LSR_TEMT        (1 << 6)
+
+#define TER_TXEN        (1 << 7)
+
+#define FIFO_SIZE       16
+#define INPUT_SIZE      4096
+#define CTI_CHARS       4           /* character timeout */
+
+#define REG(u, off)     (*sim_reg((u)->base + (off)))
+
+typedef struct
+{
+    uint8_t data[FIFO_SIZE];
+    uint8_t head;
+    uint8_t count;
+} fifo_t;
+
+typedef struct
+{
+    uint32_t base;
+    uint8_t pclkSel;
+    uint8_t pclkShift;
+    uint8_t irq;
+
+    uint16_t dl;
+    uint8_t ier;
+    uint8_t fcr;
+    fifo_t tx;
+    fifo_t rx;
+    uint8_t shifting;
+    uint8_t tsr;
+    uint64_t txEnd;
+    uint8_t threPending;
+    uint64_t lastRx;            /* time of the last receive FIFO activity */
+
+    uint8_t input[INPUT_SIZE];
+    uint32_t inHead;
+    uint32_t inCount;
+    uint64_t nextIn;
+
+    void (*out)(void *ctx, uint8_t b);
+    void *outCtx;
+
+    uint32_t txChars;
+    uint32_t rxChars;
+    uint32_t rxOverruns;
+} uart_t;
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static uart_t uarts[4] = {
+    { 0x4000C000, 0, 6, 5 },
+    { 0x40010000, 0, 8, 6 },
+    { 0x40098000, 1, 16, 7 },
+    { 0x4009C000, 1, 18, 8 },
+};
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static void fifoPush(fifo_t *f, uint8_t v)
+{
+    f->data[(f->head + f->count) % FIFO_SIZE] = v;
+    f->count++;
+}
+
+static uint8_t fifoPop(fifo_t *f)
+{
+    uint8_t v = f->data[f->head];
+
+    f->head = (f->head + 1) % FIFO_SIZE;
+    f->count--;
+    return v;
+}
+
+static uint64_t charTime(uart_t *u)
+{
+    uint32_t fdr = REG(u, U_FDR);
+    uint32_t divAdd = fdr & 0xF;
+    uint32_t mul = (fdr >> 4) & 0xF;
+    uint64_t t = 0;
+
+    if (mul == 0) {
+        mul = 1;
+        divAdd = 0;
+    }
+
+    /* 10 bits of 16 PCLK / (DL * (1 + DivAddVal / MulVal)) */
+    t = 10ULL * 16 * (u->dl ? u->dl : 1) * 1000000000ULL * (mul + divAdd)
+            / mul / sim_pclk(u->pclkSel, u->pclkShift);
+    return t;
+}
+
+static uint8_t rxTrigger(uart_t *u)
+{
+    static const uint8_t level[4] = { 1, 4, 8, 14 };
+
+    return level[(u->fcr >> 6) & 3];
+}
+
+static uint8_t ctiPending(uart_t *u)
+{
+    return u->rx.count > 0
+            && sim_now() >= u->lastRx + CTI_CHARS * charTime(u);
+}
+
+/* interrupt identification, by priority */
+static uint8_t intId(uart_t *u)
+{
+    if ((u->ier & IER_RBR) && u->rx.count >= rxTrigger(u)) {
+        return IIR_RDA;
+    }
+    if ((u->ier & IER_RBR) && ctiPending(u)) {
+        return IIR_CTI;
+    }
+    if ((u->ier & IER_THRE) && u->threPending) {
+        return IIR_THRE;
+    }
+    return IIR_NONE;
+}
+
+static void startTx(uart_t *u, uint64_t at)
+{
+    if (u->shifting || u->tx.count == 0 || !(REG(u, U_TER) & TER_TXEN)) {
+        return;
+    }
+
+    u->tsr = fifoPop(&u->tx);
+    u->shifting = 1;
+    u->txEnd = at + charTime(u);
+    if (u->tx.count == 0) {
+        u->threPending = 1;
+    }
+}
+
+static void checkIrq(uart_t *u)
+{
+    if (intId(u) != IIR_NONE) {
+        sim_irqRaise(u->irq);
+    }
+}
+
+static int uartAccess(sim_periph_t *p, uint32_t off, int write)
+{
+    uart_t *u = (uart_t *)p->ctx;
+    uint8_t dlab = (REG(u, U_LCR) & LCR_DLAB) != 0;
+    uint8_t id = 0;
+    uint8_t lsr = 0;
+
+    if (write) {
+        return 0;
+    }
+
+    switch (off) {
+    case U_RBR:
+        if (dlab) {
+            REG(u, U_RBR) = u->dl & 0xFF;
+        }
+        else if (u->rx.count > 0) {
+            REG(u, U_RBR) = fifoPop(&u->rx);
+            u->lastRx = sim_now();
+            return 1;
+        }
+        break;
+    case U_IER:
+        REG(u, U_IER) = dlab ? (u->dl >> 8) : u->ier;
+        break;
+    case U_IIR:
+        id = intId(u);
+        REG(u, U_IIR) = id | IIR_FIFO;
+        if (id == IIR_THRE) {
+            /* reading the identification clears THRE */
+            u->threPending = 0;
+            return 1;
+        }
+        break;
+    case U_LSR:
+        if (u->rx.count > 0) {
+            lsr |= LSR_RDR;
+        }
+        if (u->tx.count == 0) {
+            lsr |= LSR_THRE;
+            if (!u->shifting) {
+                lsr |= LSR_TEMT;
+            }
+        }
+        REG(u, U_LSR) = lsr;
+        break;
+    }
+    return 0;
+}
+
+static void uartWritten(sim_periph_t *p, uint32_t off, uint32_t val)
+{
+    uart_t *u = (uart_t *)p->ctx;
+    uint8_t dlab = (REG(u, U_LCR) & LCR_DLAB) != 0;
+
+    switch (off) {
+    case U_RBR:
+        if (dlab) {
+            u->dl = (u->dl & 0xFF00) | (val & 0xFF);
+        }
+        else {
+            if (u->tx.count < FIFO_SIZE) {
+                fifoPush(&u->tx, val & 0xFF);
+            }
+            u->threPending = 0;
+            startTx(u, sim_now());
+        }
+        break;
+    case U_IER:
+        if (dlab) {
+            u->dl = (u->dl & 0x00FF) | ((val & 0xFF) << 8);
+        }
+        else {
+            if ((val & IER_THRE) && !(u->ier & IER_THRE) && u->tx.count == 0) {
+                u->threPending = 1;
+            }
+            u->ier = val & 0x307;
+        }
+        break;
+    case U_IIR:
+        u->fcr = val;
+        if (val & FCR_RX_RESET) {
+            u->rx.count = 0;
+        }
+        if (val & FCR_TX_RESET) {
+            u->tx.count = 0;
+        }
+        break;
+    case U_TER:
+        startTx(u, sim_now());
+        break;
+    }
+
+    checkIrq(u);
+}
+
+static void uartUpdate(sim_periph_t *p, uint64_t now)
+{
+    uart_t *u = (uart_t *)p->ctx;
+    uint64_t end = 0;
+
+    while (u->shifting && u->txEnd <= now) {
+        end = u->txEnd;
+        u->shifting = 0;
+        u->txChars++;
+        if (u->out != NULL) {
+            u->out(u->outCtx, u->tsr);
+        }
+        startTx(u, end);
+    }
+
+    while (u->inCount > 0 && u->nextIn <= now) {
+        if (u->rx.count < FIFO_SIZE) {
+            fifoPush(&u->rx, u->input[u->inHead]);
+            u->rxChars++;
+        }
+        else {
+            u->rxOverruns++;
+        }
+        u->inHead = (u->inHead + 1) % INPUT_SIZE;
+        u->inCount--;
+        u->lastRx = u->nextIn;
+        u->nextIn += charTime(u);
+    }
+
+    checkIrq(u);
+}
+
+static uint64_t uartNextEvent(sim_periph_t *p)
+{
+    uart_t *u = (uart_t *)p->ctx;
+    uint64_t t = SIM_NEVER;
+    uint64_t cti = 0;
+
+    if (u->shifting) {
+        t = u->txEnd;
+    }
+    if (u->inCount > 0 && u->nextIn < t) {
+        t = u->nextIn;
+    }
+    if ((u->ier & IER_RBR) && u->rx.count > 0 && u->rx.count < rxTrigger(u)) {
+        cti = u->lastRx + CTI_CHARS * charTime(u);
+        if (cti > sim_now() && cti < t) {
+            t = cti;
+        }
+    }
+    return t;
+}
+
+static void uartReport(sim_periph_t *p, FILE *out)
+{
+    uart_t *u = (uart_t *)p->ctx;
+
+    fprintf(out, "tx %u rx %u rx overruns %u", u->txChars, u->rxChars,
+            u->rxOverruns);
+}
+
+static sim_periph_t uartPeriphs[4] = {
+    { "UART0", 0x4000C000, 0x1000, uartAccess, uartWritten, uartUpdate,
+            uartNextEvent, uartReport, &uarts[0] },
+    { "UART1", 0x40010000, 0x1000, uartAccess, uartWritten, uartUpdate,
+            uartNextEvent, uartReport, &uarts[1] },
+    { "UART2", 0x40098000, 0x1000, uartAccess, uartWritten, uartUpdate,
+            uartNextEvent, uartReport, &uarts[2] },
+    { "UART3", 0x4009C000, 0x1000, uartAccess, uartWritten, uartUpdate,
+            uartNextEvent, uartReport, &uarts[3] },
+};
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize the UART models
+ *
+ *****************************************************************************/
+void sim_uart_init(void)
+{
+    uint8_t i = 0;
+
+    for (i = 0; i < 4; i++) {
+        /* reset values: transmitter enabled */
+        *sim_reg(uarts[i].base + U_TER) = TER_TXEN;
+        *sim_reg(uarts[i].base + U_FDR) = 0x10;
+        uarts[i].dl = 1;
+        sim_register(&uartPeriphs[i]);
+    }
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Set where the transmitted characters of a UART go
+ *
+ * Params:
+ *   [in] uart - 0..3
+ *   [in] out - called with each character, NULL to drop them
+ *   [in] ctx - passed to out
+ *
+ *****************************************************************************/
+void sim_uart_setOutput(uint8_t uart, void (*out)(void *ctx, uint8_t b),
+        void *ctx)
+{
+    if (uart < 4) {
+        uarts[uart].out = out;
+        uarts[uart].outCtx = ctx;
+    }
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Send characters to a UART. They arrive one character time apart,
+ *    starting now.
+ *
+ * Params:
+ *   [in] uart - 0..3
+ *   [in] data - the characters
+ *   [in] len - number of characters
+ *
+ * Returns:
+ *    The number of characters queued
+ *
+ *****************************************************************************/
+uint32_t sim_uart_input(uint8_t uart, const uint8_t *data, uint32_t len)
+{
+    uart_t *u = NULL;
+    uint32_t i = 0;
+
+    if (uart >= 4) {
+        return 0;
+    }
+
+    u = &uarts[uart];
+    if (u->inCount == 0) {
+        u->nextIn = sim_now() + charTime(u);
+    }
+    for (i = 0; i < len && u->inCount < INPUT_SIZE; i++) {
+        u->input[(u->inHead + u->inCount) % INPUT_SIZE] = data[i];
+        u->inCount++;
+    }
+    return i;
+}
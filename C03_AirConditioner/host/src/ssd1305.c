@@ -0,0 +1,410 @@
+/*****************************************************************************
+ *   ssd1305.c:  Simulated SSD1305 OLED controller of the base board
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: The display oled.c drives: an SSD1305 on SSP1 with its chip select
+ * on P0.6 and D/C on P2.7 (high for data). Bytes are commands or data by
+ * the level of D/C as they arrive.
+ *
+ * The display RAM is 8 pages of 132 columns; the 96 columns of the panel
+ * start at column 18 (X_OFFSET in oled.c). Page addressing is modelled:
+ * 0xB0..0xB7 and the low and high column nibbles set the address, data
+ * increments the column and wraps to column 0 of the same page. Display
+ * on and off, entire display on and normal / inverse (0xA6 / 0xA7) are
+ * applied to the rendered frame. The other commands of the init sequence
+ * (contrast, multiplex ratio, segment remap, COM scan direction, display
+ * offset, clocks, look up table) are parsed with their arguments and kept;
+ * remap and scan direction only undo the wiring of the panel and are not
+ * applied, nor is the start line or scrolling.
+ *
+ * A frame is a burst of bus traffic: it ends when the chip select is
+ * asserted after FRAME_GAP_NS without traffic, or with
+ * sim_ssd1305_endFrame(). The function set with sim_ssd1305_onFrame()
+ * gets the counters of each frame with the display RAM as the frame left
+ * it.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "sim.h"
+#include "ssd1305.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define OLED_CS_PORT    0
+#define OLED_CS_PIN     6
+#define OLED_DC_PORT    2
+#define OLED_DC_PIN     7
+
+#define RAM_PAGES       8
+#define RAM_COLUMNS     132
+#define X_OFFSET        18
+
+#define FRAME_GAP_NS    5000000ULL  /* 5 ms */
+
+#define MAX_ARGS        6
+
+typedef struct
+{
+    uint8_t ram[RAM_PAGES][RAM_COLUMNS];
+    uint8_t page;
+    uint8_t column;
+
+    uint8_t cmd;                /* command waiting for arguments */
+    uint8_t args[MAX_ARGS];
+    uint8_t numArgs;
+    uint8_t needArgs;
+
+    uint8_t displayOn;
+    uint8_t entireOn;
+    uint8_t inverse;
+    uint8_t startLine;
+    uint8_t contrast;
+    uint8_t segRemap;
+    uint8_t comRemap;
+    uint8_t multiplex;
+    uint8_t offset;
+
+    uint8_t open;               /* a frame has traffic */
+    uint64_t lastByte;
+    ssd1305_frame_t frame;
+
+    void (*onFrame)(const ssd1305_frame_t *f, void *ctx);
+    void *onFrameCtx;
+} ssd1305_t;
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static ssd1305_t oled;
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+/* number of argument bytes that follow a command */
+static uint8_t argCount(uint8_t cmd)
+{
+    switch (cmd) {
+    case 0x20:                  /* memory addressing mode */
+    case 0x81:                  /* contrast */
+    case 0x82:                  /* brightness */
+    case 0xA8:                  /* multiplex ratio */
+    case 0xAD:                  /* DC-DC on / off */
+    case 0xD3:                  /* display offset */
+    case 0xD5:                  /* clock divide and frequency */
+    case 0xD8:                  /* area color and low power */
+    case 0xD9:                  /* precharge period */
+    case 0xDA:                  /* COM pins */
+    case 0xDB:                  /* VCOMH level */
+        return 1;
+    case 0x21:                  /* column address */
+    case 0x22:                  /* page address */
+    case 0xA3:                  /* vertical scroll area */
+        return 2;
+    case 0x91:                  /* look up table */
+    case 0x92:                  /* bank colors */
+    case 0x93:
+    case 0xAB:                  /* dim mode */
+        return 4;
+    case 0x29:                  /* scroll setup */
+    case 0x2A:
+        return 5;
+    case 0x26:
+    case 0x27:
+        return 6;
+    }
+    return 0;
+}
+
+static void runCommand(void)
+{
+    uint8_t cmd = oled.cmd;
+
+    if (cmd <= 0x0F) {
+        oled.column = (oled.column & 0xF0) | cmd;
+    }
+    else if (cmd <= 0x1F) {
+        oled.column = (oled.column & 0x0F) | ((cmd & 0x0F) << 4);
+    }
+    else if (cmd >= 0x40 && cmd <= 0x7F) {
+        oled.startLine = cmd & 0x3F;
+    }
+    else if (cmd >= 0xB0 && cmd <= 0xB7) {
+        oled.page = cmd & 0x07;
+    }
+
+    switch (cmd) {
+    case 0x81:
+        oled.contrast = oled.args[0];
+        break;
+    case 0xA0:
+    case 0xA1:
+        oled.segRemap = cmd & 1;
+        break;
+    case 0xA4:
+    case 0xA5:
+        oled.entireOn = cmd & 1;
+        break;
+    case 0xA6:
+    case 0xA7:
+        oled.inverse = cmd & 1;
+        break;
+    case 0xA8:
+        oled.multiplex = oled.args[0] & 0x3F;
+        break;
+    case 0xAE:
+    case 0xAF:
+        oled.displayOn = cmd & 1;
+        break;
+    case 0xC0:
+    case 0xC8:
+        oled.comRemap = (cmd & 0x08) != 0;
+        break;
+    case 0xD3:
+        oled.offset = oled.args[0] & 0x3F;
+        break;
+    }
+}
+
+static void command(uint8_t b)
+{
+    if (oled.needArgs > 0) {
+        if (oled.numArgs < MAX_ARGS) {
+            oled.args[oled.numArgs++] = b;
+        }
+        if (--oled.needArgs == 0) {
+            runCommand();
+        }
+        return;
+    }
+
+    oled.cmd = b;
+    oled.numArgs = 0;
+    oled.needArgs = argCount(b);
+    if (oled.needArgs == 0) {
+        runCommand();
+    }
+}
+
+static void data(uint8_t b)
+{
+    if (oled.column < RAM_COLUMNS) {
+        oled.ram[oled.page][oled.column] = b;
+    }
+    oled.column++;
+    if (oled.column >= RAM_COLUMNS) {
+        oled.column = 0;
+    }
+}
+
+static void closeFrame(void)
+{
+    if (!oled.open) {
+        return;
+    }
+
+    oled.frame.end = oled.lastByte;
+    if (oled.onFrame != NULL) {
+        oled.onFrame(&oled.frame, oled.onFrameCtx);
+    }
+    oled.open = 0;
+}
+
+static void openFrame(void)
+{
+    uint32_t n = oled.frame.frame;
+
+    if (oled.open) {
+        return;
+    }
+
+    memset(&oled.frame, 0, sizeof(oled.frame));
+    oled.frame.frame = n + 1;
+    oled.frame.start = sim_now();
+    oled.open = 1;
+}
+
+static void oledSelect(void *ctx, uint8_t active)
+{
+    if (!active) {
+        return;
+    }
+
+    if (oled.open && sim_now() - oled.lastByte >= FRAME_GAP_NS) {
+        closeFrame();
+    }
+    openFrame();
+    oled.frame.csToggles++;
+    oled.lastByte = sim_now();
+}
+
+static uint16_t oledXfer(void *ctx, uint16_t out)
+{
+    openFrame();
+    if (sim_gpio_get(OLED_DC_PORT, OLED_DC_PIN)) {
+        data(out);
+        oled.frame.dataBytes++;
+    }
+    else {
+        command(out);
+        oled.frame.cmdBytes++;
+    }
+    oled.lastByte = sim_now();
+
+    /* the controller does not drive MISO in the serial mode */
+    return 0xFF;
+}
+
+static sim_ssp_dev_t oledDev = {
+    OLED_CS_PORT, OLED_CS_PIN, oledSelect, oledXfer, NULL
+};
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Attach the display to SSP1. The display RAM starts cleared and the
+ *    display off, as after a reset.
+ *
+ *****************************************************************************/
+void sim_ssd1305_init(void)
+{
+    memset(&oled, 0, sizeof(oled));
+    oled.contrast = 0x80;
+    oled.multiplex = 0x3F;
+    sim_ssp_attach(1, &oledDev);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Set the function that gets each frame
+ *
+ * Params:
+ *   [in] cb - called when a frame ends, NULL for none
+ *   [in] ctx - passed to cb
+ *
+ *****************************************************************************/
+void sim_ssd1305_onFrame(void (*cb)(const ssd1305_frame_t *f, void *ctx),
+        void *ctx)
+{
+    oled.onFrame = cb;
+    oled.onFrameCtx = ctx;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    End the current frame now
+ *
+ * Params:
+ *   [out] f - the counters of the frame, all zero but the frame number if
+ *             there was no traffic since the last frame. May be NULL.
+ *
+ *****************************************************************************/
+void sim_ssd1305_endFrame(ssd1305_frame_t *f)
+{
+    uint8_t wasOpen = oled.open;
+
+    closeFrame();
+    if (f == NULL) {
+        return;
+    }
+
+    if (wasOpen) {
+        *f = oled.frame;
+    }
+    else {
+        memset(f, 0, sizeof(*f));
+        f->frame = oled.frame.frame;
+    }
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Render what the panel shows
+ *
+ * Params:
+ *   [out] pix - 1 for a lit pixel, by row and column
+ *
+ *****************************************************************************/
+void sim_ssd1305_render(uint8_t pix[SSD1305_HEIGHT][SSD1305_WIDTH])
+{
+    uint8_t x = 0;
+    uint8_t y = 0;
+    uint8_t on = 0;
+
+    for (y = 0; y < SSD1305_HEIGHT; y++) {
+        for (x = 0; x < SSD1305_WIDTH; x++) {
+            on = (oled.ram[y / 8][x + X_OFFSET] >> (y % 8)) & 1;
+            if (oled.entireOn) {
+                on = 1;
+            }
+            else if (oled.inverse) {
+                on = !on;
+            }
+            pix[y][x] = oled.displayOn ? on : 0;
+        }
+    }
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Write what the panel shows as a plain PBM image, lit pixels black
+ *
+ * Params:
+ *   [in] path - file to write
+ *
+ * Returns:
+ *    0 on success, -1 if the file could not be written
+ *
+ *****************************************************************************/
+int sim_ssd1305_writePbm(const char *path)
+{
+    uint8_t pix[SSD1305_HEIGHT][SSD1305_WIDTH];
+    FILE *f = NULL;
+    uint8_t x = 0;
+    uint8_t y = 0;
+
+    f = fopen(path, "w");
+    if (f == NULL) {
+        return -1;
+    }
+
+    sim_ssd1305_render(pix);
+    fprintf(f, "P1\n%d %d\n", SSD1305_WIDTH, SSD1305_HEIGHT);
+    for (y = 0; y < SSD1305_HEIGHT; y++) {
+        for (x = 0; x < SSD1305_WIDTH; x++) {
+            fputc(pix[y][x] ? '1' : '0', f);
+        }
+        fputc('\n', f);
+    }
+
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get whether the display is inverted (0xA7)
+ *
+ *****************************************************************************/
+uint8_t sim_ssd1305_isInverse(void)
+{
+    return oled.inverse;
+}
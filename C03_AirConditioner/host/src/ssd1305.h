@@ -0,0 +1,35 @@
+/*****************************************************************************
+ *   ssd1305.h:  Header file for the simulated SSD1305 OLED controller
+ *
+ ******************************************************************************/
+#ifndef __SSD1305_H
+#define __SSD1305_H
+
+#include <stdint.h>
+
+#define SSD1305_WIDTH   96      /* the panel of the base board */
+#define SSD1305_HEIGHT  64
+
+/* the bus traffic of one frame: a burst of activity on the display */
+typedef struct
+{
+    uint32_t frame;             /* counts from 1 */
+    uint64_t start;             /* simulated ns of the first chip select */
+    uint64_t end;               /* simulated ns of the last byte */
+    uint32_t dataBytes;
+    uint32_t cmdBytes;          /* commands with their arguments */
+    uint32_t csToggles;         /* chip select assertions */
+} ssd1305_frame_t;
+
+void sim_ssd1305_init(void);
+void sim_ssd1305_onFrame(void (*cb)(const ssd1305_frame_t *f, void *ctx),
+        void *ctx);
+void sim_ssd1305_endFrame(ssd1305_frame_t *f);
+void sim_ssd1305_render(uint8_t pix[SSD1305_HEIGHT][SSD1305_WIDTH]);
+int sim_ssd1305_writePbm(const char *path);
+uint8_t sim_ssd1305_isInverse(void);
+
+#endif /* end __SSD1305_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
@@ -49,6 +49,8 @@ extern "C" {
 #include "system_LPC17xx.h"
 #endif
 
+#include "stackmon.h"
+
 //*****************************************************************************
 #if defined (__cplusplus)
 extern "C" {
@@ -206,16 +208,44 @@ void (* const g_pfnVectors[])(void) = {
 
 //*****************************************************************************
 //
-// The following are constructs created by the linker, indicating where the
-// the "data" and "bss" segments reside in memory.  The initializers for the
-// for the "data" segment resides immediately following the "text" segment.
+// The following are constructs created by the linker. The global section
+// table lists each section to initialize as load address, run address and
+// length in bytes: the main "data" section, which also holds the code
+// placed in RAM with __RAMFUNC(RAM), and the data of the AHB SRAM banks
+// (__DATA(RAM2)). The bss table lists run address and length of the main
+// "bss" and of the AHB SRAM bss (__BSS(RAM2)).
+//
+//*****************************************************************************
+extern unsigned long __data_section_table;
+extern unsigned long __data_section_table_end;
+extern unsigned long __bss_section_table;
+extern unsigned long __bss_section_table_end;
+extern unsigned long _pvHeapStart;
+
+//*****************************************************************************
+//
+// Copy one section from flash to RAM, and zero fill one section.
 //
 //*****************************************************************************
-extern unsigned long _etext;
-extern unsigned long _data;
-extern unsigned long _edata;
-extern unsigned long _bss;
-extern unsigned long _ebss;
+static void data_init(unsigned long romstart, unsigned long start,
+        unsigned long len) {
+    unsigned long *pulDest = (unsigned long *) start;
+    unsigned long *pulSrc = (unsigned long *) romstart;
+    unsigned long loop;
+
+    for (loop = 0; loop < len; loop = loop + 4) {
+        *pulDest++ = *pulSrc++;
+    }
+}
+
+static void bss_init(unsigned long start, unsigned long len) {
+    unsigned long *pulDest = (unsigned long *) start;
+    unsigned long loop;
+
+    for (loop = 0; loop < len; loop = loop + 4) {
+        *pulDest++ = 0;
+    }
+}
 
 //*****************************************************************************
 // Reset entry point for your code.
@@ -225,30 +255,45 @@ extern unsigned long _ebss;
 //*****************************************************************************
 void
 ResetISR(void) {
-    unsigned long *pulSrc, *pulDest;
+    unsigned long *pulDest;
+    unsigned long *SectionTableAddr;
+    unsigned long LoadAddr, ExeAddr, SectionLen;
 
     //
-    // Copy the data segment initializers from flash to SRAM.
+    // Copy the data sections, and with them the RAM code, from flash to
+    // SRAM. Nothing placed in RAM may run before this.
     //
-    pulSrc = &_etext;
-    for(pulDest = &_data; pulDest < &_edata; )
-    {
-        *pulDest++ = *pulSrc++;
+    SectionTableAddr = &__data_section_table;
+    while (SectionTableAddr < &__data_section_table_end) {
+        LoadAddr = *SectionTableAddr++;
+        ExeAddr = *SectionTableAddr++;
+        SectionLen = *SectionTableAddr++;
+        data_init(LoadAddr, ExeAddr, SectionLen);
+    }
+
+    //
+    // Zero fill the bss sections, which follow in the same table.
+    //
+    while (SectionTableAddr < &__bss_section_table_end) {
+        ExeAddr = *SectionTableAddr++;
+        SectionLen = *SectionTableAddr++;
+        bss_init(ExeAddr, SectionLen);
     }
 
     //
-    // Zero fill the bss segment.  This is done with inline assembly since this
-    // will clear the value of pulDest if it is not kept in a register.
+    // Paint the free RAM from the heap start up to the stack pointer with
+    // the canary, for the stack high-water mark (stackmon.c). Done in
+    // assembly too, as it writes right up to the stack of this function.
     //
-    __asm("    ldr     r0, =_bss\n"
-          "    ldr     r1, =_ebss\n"
-          "    mov     r2, #0\n"
+    pulDest = &_pvHeapStart;
+    __asm volatile ("    mov     r1, sp\n"
           "    .thumb_func\n"
-          "zero_loop:\n"
-          "        cmp     r0, r1\n"
+          "paint_loop:\n"
+          "        cmp     %0, r1\n"
           "        it      lt\n"
-          "        strlt   r2, [r0], #4\n"
-          "        blt     zero_loop");
+          "        strlt   %1, [%0], #4\n"
+          "        blt     paint_loop"
+          : "+r" (pulDest) : "r" (STACKMON_CANARY) : "r1", "cc", "memory");
 
 #ifdef __USE_CMSIS
 	SystemInit();
@@ -0,0 +1,262 @@
+/*****************************************************************************
+ *   fan.c:  Fan drive, PWM1 or motor control PWM (BLDC) backend
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: With the PWM1 backend pwm_out_init() must have been called first and
+ * fan_setDuty() only stages the duty; it is applied, together with the
+ * other PWM1 channels, by the next pwm_out_commit().
+ *
+ * With the MCPWM backend the fan is a 3-phase BLDC motor driven in 3-phase
+ * DC mode. Channel 0 generates a center aligned PWM with dead time, and the
+ * commutation pattern register (MCCCP) routes it to the two bridge switches
+ * selected by the hall sensors on MCI0..2. Every hall edge is captured by the
+ * MCPWM and the capture interrupt steps the commutation table, so the CPU
+ * only does a table lookup per step.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include "lpc17xx_pinsel.h"
+#include "lpc17xx_clkpwr.h"
+#include "lpc17xx_mcpwm.h"
+#include "lpc17xx_trace.h"
+#include "pwm_out.h"
+#include "fan.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define FAN_PWM_CH 1            /* PWM1.1 on P2.0 */
+
+#define MC_DEV LPC_MCPWM
+
+#define MC_PWM_FREQ    20000    /* Hz, above the audible range */
+#define MC_DEADTIME_NS 500      /* gate driver dead time */
+
+/*
+ * Hall inputs MCI0..2 are on P1.20, P1.23 and P1.24. The pins are read back
+ * through the GPIO block to get the full hall state on every edge.
+ */
+#define HALL_STATE() \
+    ((((LPC_GPIO1->FIOPIN >> 20) & 1) << 0) | \
+     (((LPC_GPIO1->FIOPIN >> 23) & 1) << 1) | \
+     (((LPC_GPIO1->FIOPIN >> 24) & 1) << 2))
+
+#define MC_CAP_INTS (MCPWM_INTFLAG_CAP0 | MCPWM_INTFLAG_CAP1 | MCPWM_INTFLAG_CAP2)
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static volatile uint32_t fanDuty = 0;
+static volatile uint32_t commutations = 0;
+
+#ifdef FAN_USE_MCPWM
+
+/*
+ * Six-step commutation table indexed by hall state. Each entry selects the
+ * high side (MCOAn) of the driven phase and the low side (MCOBn) of the
+ * return phase. States 0 and 7 are invalid and switch everything off.
+ */
+static const uint32_t commutation[8] = {
+    0,                              /* 000: invalid */
+    MCPWM_CP_A2 | MCPWM_CP_B1,      /* 001: W+ V- */
+    MCPWM_CP_A1 | MCPWM_CP_B0,      /* 010: V+ U- */
+    MCPWM_CP_A2 | MCPWM_CP_B0,      /* 011: W+ U- */
+    MCPWM_CP_A0 | MCPWM_CP_B2,      /* 100: U+ W- */
+    MCPWM_CP_A0 | MCPWM_CP_B1,      /* 101: U+ V- */
+    MCPWM_CP_A1 | MCPWM_CP_B2,      /* 110: V+ W- */
+    0                               /* 111: invalid */
+};
+
+static uint32_t mcPeriod = 0;
+
+#endif
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+#ifdef FAN_USE_MCPWM
+
+static void commutate(void)
+{
+    MC_DEV->MCCCP = (fanDuty != 0) ? commutation[HALL_STATE()] : 0;
+}
+
+static void mcpwmInit(void)
+{
+    static const uint8_t outPins[6] = {19, 22, 25, 26, 28, 29};
+    static const uint8_t hallPins[3] = {20, 23, 24};
+    MCPWM_CHANNEL_CFG_Type chCfg;
+    MCPWM_CAPTURE_CFG_Type capCfg;
+    PINSEL_CFG_Type pinCfg;
+    uint32_t pclk = 0;
+    uint32_t i = 0;
+
+    pinCfg.Funcnum = 1;
+    pinCfg.OpenDrain = 0;
+    pinCfg.Pinmode = 0;
+    pinCfg.Portnum = 1;
+    for (i = 0; i < 6; i++) {
+        pinCfg.Pinnum = outPins[i];
+        PINSEL_ConfigPin(&pinCfg);
+    }
+    for (i = 0; i < 3; i++) {
+        pinCfg.Pinnum = hallPins[i];
+        PINSEL_ConfigPin(&pinCfg);
+    }
+
+    MCPWM_Init(MC_DEV);
+    pclk = CLKPWR_GetPCLK(CLKPWR_PCLKSEL_MC);
+
+    /* center aligned: the timer counts up and down, two ticks per count */
+    mcPeriod = pclk / (2 * MC_PWM_FREQ);
+
+    chCfg.channelType = MCPWM_CHANNEL_CENTER_MODE;
+    chCfg.channelPolarity = MCPWM_CHANNEL_PASSIVE_LO;
+    chCfg.channelDeadtimeEnable = ENABLE;
+    chCfg.channelDeadtimeValue = (pclk / 1000000) * MC_DEADTIME_NS / 1000;
+    chCfg.channelUpdateEnable = ENABLE;
+    chCfg.channelTimercounterValue = 0;
+    chCfg.channelPeriodValue = mcPeriod;
+    chCfg.channelPulsewidthValue = mcPeriod;    /* 0% in center mode */
+    MCPWM_ConfigChannel(MC_DEV, 0, &chCfg);
+
+    MCPWM_DCMode(MC_DEV, ENABLE, DISABLE, 0);
+
+    for (i = 0; i < 3; i++) {
+        capCfg.captureChannel = i;
+        capCfg.captureRising = ENABLE;
+        capCfg.captureFalling = ENABLE;
+        capCfg.timerReset = DISABLE;
+        capCfg.hnfEnable = ENABLE;
+        MCPWM_ConfigCapture(MC_DEV, i, &capCfg);
+    }
+    MCPWM_IntConfig(MC_DEV, MC_CAP_INTS, ENABLE);
+    NVIC_EnableIRQ(MCPWM_IRQn);
+
+    MCPWM_Start(MC_DEV, ENABLE, DISABLE, DISABLE);
+}
+
+#endif
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize the fan drive. The fan is stopped.
+ *
+ *****************************************************************************/
+void fan_init(void)
+{
+    fanDuty = 0;
+    commutations = 0;
+
+#ifdef FAN_USE_MCPWM
+    mcpwmInit();
+#else
+    pwm_out_open(FAN_PWM_CH, PWM_OUT_SINGLE_EDGE, PWM_OUT_PIN_P2);
+#endif
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Set the fan drive duty
+ *
+ * Params:
+ *   [in] duty - 0..FAN_DUTY_MAX
+ *
+ *****************************************************************************/
+void fan_setDuty(uint32_t duty)
+{
+#ifdef FAN_USE_MCPWM
+    MCPWM_CHANNEL_CFG_Type chCfg;
+    uint32_t wasStopped = (fanDuty == 0);
+#endif
+
+    if (duty > FAN_DUTY_MAX) {
+        duty = FAN_DUTY_MAX;
+    }
+    fanDuty = duty;
+
+#ifdef FAN_USE_MCPWM
+    /*
+     * In center aligned mode the output is active while the timer is above
+     * the pulse width, so the pulse width counts down with the duty. The
+     * shadow registers are transferred at the end of the current period.
+     */
+    chCfg.channelPeriodValue = mcPeriod;
+    chCfg.channelPulsewidthValue = mcPeriod - (mcPeriod * duty) / FAN_DUTY_MAX;
+    MCPWM_WriteToShadow(MC_DEV, 0, &chCfg);
+
+    /* no hall edges while stationary, so kick the first step here */
+    if (wasStopped || duty == 0) {
+        NVIC_DisableIRQ(MCPWM_IRQn);
+        commutate();
+        NVIC_EnableIRQ(MCPWM_IRQn);
+    }
+#else
+    pwm_out_setDuty(FAN_PWM_CH, (duty * pwm_out_getPeriod()) / FAN_DUTY_MAX);
+#endif
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the fan drive duty
+ *
+ * Returns:
+ *    0..FAN_DUTY_MAX
+ *
+ *****************************************************************************/
+uint32_t fan_getDuty(void)
+{
+    return fanDuty;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the number of commutation steps since init. Always 0 with the
+ *    PWM1 backend.
+ *
+ *****************************************************************************/
+uint32_t fan_getCommutations(void)
+{
+    return commutations;
+}
+
+#ifdef FAN_USE_MCPWM
+/******************************************************************************
+ *
+ * Description:
+ *    Motor control PWM interrupt handler. A hall edge was captured on one
+ *    of MCI0..2; step the commutation table.
+ *
+ *****************************************************************************/
+void MCPWM_IRQHandler(void)
+{
+    uint32_t flags = MC_DEV->MCINTFLAG & MC_CAP_INTS;
+    TRACE_ISR_ENTER(TRACE_ISR_MCPWM);
+
+    if (flags == 0) {
+        TRACE_ISR_EXIT(TRACE_ISR_MCPWM);
+        return;
+    }
+    MCPWM_IntClear(MC_DEV, flags);
+
+    commutate();
+    commutations++;
+    TRACE_ISR_EXIT(TRACE_ISR_MCPWM);
+}
+#endif
@@ -0,0 +1,28 @@
+/*****************************************************************************
+ *   fan.h:  Header file for the fan drive
+ *
+******************************************************************************/
+#ifndef __FAN_H
+#define __FAN_H
+
+#include <stdint.h>
+
+/*
+ * Select the fan drive backend. By default the fan is a single PWM line on
+ * PWM1.1 (P2.0). Define FAN_USE_MCPWM to drive a 3-phase BLDC fan from the
+ * motor control PWM with hall sensor commutation instead.
+ */
+//#define FAN_USE_MCPWM
+
+#define FAN_DUTY_MAX 1000   /* full speed, duties are in per mille */
+
+
+void fan_init(void);
+void fan_setDuty(uint32_t duty);
+uint32_t fan_getDuty(void);
+uint32_t fan_getCommutations(void);
+
+#endif /* end __FAN_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
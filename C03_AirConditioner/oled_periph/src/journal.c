@@ -0,0 +1,364 @@
+/*****************************************************************************
+ *   journal.c:  Event journal in dataflash, state kept over resets in GPREG
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: Events are 8 byte records with an RTC timestamp (rtclock.c):
+ *
+ *   sec(32)  seconds since 1970
+ *   ms(10) | event(6)
+ *   arg(16)
+ *
+ * journal_log() may be called from interrupt handlers; it only queues the
+ * record. journal_poll() appends queued records to the current journal
+ * page, kept in RAM since the dataflash only programs whole pages. The
+ * page is programmed when it is full, or JOURNAL_FLUSH_MS after its first
+ * unwritten record, so a page sees a few program cycles instead of one
+ * per record. journal_flush() writes it at once, the supervisor calls it
+ * before a watchdog reset. JOURNAL_PAGES pages are used as a ring, 32
+ * records of each page.
+ *
+ * The RTC general purpose registers are battery backed and survive any
+ * reset, so they hold the state that must outlive a crash:
+ *
+ *   GPREG0  GPREG_MAGIC | boot count
+ *   GPREG1  last fault, written by the supervisor before a reset
+ *   GPREG2  journal head, number of records in the dataflash; records
+ *           still in the RAM page are lost on a reset without a flush
+ *
+ * Without the magic (battery removed) everything starts from zero.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <string.h>
+#include "lpc17xx_rtc.h"
+#include "flash.h"
+#include "rtclock.h"
+#include "journal.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define GPREG_BOOT      0
+#define GPREG_FAULT     1
+#define GPREG_HEAD      2
+
+#define GPREG_MAGIC     0xAC000000
+#define GPREG_MAGIC_MASK 0xFFFF0000
+
+#define RECORD_SIZE     8
+#define PAGE_BYTES      256     /* used part of a dataflash page */
+#define RECORDS_PER_PAGE (PAGE_BYTES / RECORD_SIZE)
+#define CAPACITY        (JOURNAL_PAGES * RECORDS_PER_PAGE)
+
+/* records waiting for journal_poll(), must be a power of two */
+#define QUEUE_SIZE      16
+#define QUEUE_MASK      (QUEUE_SIZE - 1)
+
+#define RSID_MASK       0x0F    /* POR, EXTR, WDTR, BODR */
+
+#define JOURNAL_FLUSH_MS 10000  /* longest time a record waits in RAM */
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static uint8_t queue[QUEUE_SIZE][RECORD_SIZE];
+static volatile uint32_t qHead = 0;     /* written by journal_log() */
+static volatile uint32_t qTail = 0;     /* written by journal_poll() */
+static volatile uint32_t dropped = 0;
+
+static uint8_t page[PAGE_BYTES];        /* holds records from head & ~31 */
+static uint8_t pageDirty = 0;
+static uint32_t dirtySince = 0;         /* ms, first unwritten record */
+static volatile uint8_t polling = 0;    /* journal_poll() is moving records */
+static uint32_t head = 0;
+static uint16_t flashPageSize = 0;
+
+static uint32_t (*getTicks)(void) = NULL;
+
+static uint32_t bootCount = 0;
+static uint32_t resetSource = 0;
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static uint32_t pageOffset(uint32_t index)
+{
+    return (JOURNAL_FIRST_PAGE + (index / RECORDS_PER_PAGE) % JOURNAL_PAGES)
+            * flashPageSize;
+}
+
+static void unpack(const uint8_t *r, journal_entry_t *e)
+{
+    uint16_t w = (uint16_t)(r[4] | (r[5] << 8));
+
+    e->sec = r[0] | (r[1] << 8) | (r[2] << 16) | ((uint32_t)r[3] << 24);
+    e->ms = w & 0x3FF;
+    e->event = (uint8_t)(w >> 10);
+    e->arg = (int16_t)(r[6] | (r[7] << 8));
+}
+
+static void writePage(void)
+{
+    /* on a busy timeout the page stays dirty and is written again later */
+    if (flash_write(page, pageOffset(head - 1), PAGE_BYTES) == PAGE_BYTES) {
+        RTC_WriteGPREG(LPC_RTC, GPREG_HEAD, head);
+        pageDirty = 0;
+    }
+}
+
+/* move the queued records into the RAM page, programming full pages */
+static void drainQueue(void)
+{
+    while (qTail != qHead) {
+        memcpy(&page[(head % RECORDS_PER_PAGE) * RECORD_SIZE],
+                queue[qTail & QUEUE_MASK], RECORD_SIZE);
+        qTail++;
+        head++;
+        if (!pageDirty) {
+            pageDirty = 1;
+            dirtySince = getTicks();
+        }
+
+        if ((head % RECORDS_PER_PAGE) == 0) {
+            /* page full, program it and start the next one; if the
+               dataflash stays busy the full page is lost */
+            writePage();
+            memset(page, 0xFF, PAGE_BYTES);
+            pageDirty = 0;
+        }
+    }
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Count the boot, take the reset source and reload the journal page.
+ *    The dataflash (flash_init()) and rtclock_init() must be initialized.
+ *
+ * Params:
+ *   [in] getMsTicks - callback function for retrieving number of elapsed
+ *                     ticks in milliseconds
+ *
+ *****************************************************************************/
+void journal_init(uint32_t (*getMsTicks)(void))
+{
+    uint32_t boot = RTC_ReadGPREG(LPC_RTC, GPREG_BOOT);
+
+    if ((boot & GPREG_MAGIC_MASK) != GPREG_MAGIC) {
+        boot = 0;
+        RTC_WriteGPREG(LPC_RTC, GPREG_FAULT, 0);
+        RTC_WriteGPREG(LPC_RTC, GPREG_HEAD, 0);
+    }
+    bootCount = (boot + 1) & ~GPREG_MAGIC_MASK;
+    RTC_WriteGPREG(LPC_RTC, GPREG_BOOT, GPREG_MAGIC | bootCount);
+
+    resetSource = LPC_SC->RSID & RSID_MASK;
+    LPC_SC->RSID = resetSource;
+
+    getTicks = getMsTicks;
+    flashPageSize = flash_getPageSize();
+    head = RTC_ReadGPREG(LPC_RTC, GPREG_HEAD);
+    if (head % RECORDS_PER_PAGE) {
+        flash_read(page, pageOffset(head), PAGE_BYTES);
+    }
+    else {
+        memset(page, 0xFF, PAGE_BYTES);
+    }
+    pageDirty = 0;
+
+    journal_log(JOURNAL_EV_RESET, (int16_t)resetSource);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Record an event with the current time. Never blocks and may be
+ *    called from interrupt handlers; the record is written by
+ *    journal_poll().
+ *
+ * Params:
+ *   [in] event - JOURNAL_EV_*
+ *   [in] arg - event argument
+ *
+ *****************************************************************************/
+void journal_log(uint8_t event, int16_t arg)
+{
+    uint64_t t = rtclock_now();
+    uint32_t sec = (uint32_t)(t / RTCLOCK_US_PER_SEC);
+    uint16_t w = (uint16_t)(((t % RTCLOCK_US_PER_SEC) / 1000)
+            | ((uint32_t)event << 10));
+    uint32_t primask = __get_PRIMASK();
+    uint8_t *r = NULL;
+
+    __disable_irq();
+    if (qHead - qTail < QUEUE_SIZE) {
+        r = queue[qHead & QUEUE_MASK];
+        r[0] = (uint8_t)sec;
+        r[1] = (uint8_t)(sec >> 8);
+        r[2] = (uint8_t)(sec >> 16);
+        r[3] = (uint8_t)(sec >> 24);
+        r[4] = (uint8_t)w;
+        r[5] = (uint8_t)(w >> 8);
+        r[6] = (uint8_t)arg;
+        r[7] = (uint8_t)((uint16_t)arg >> 8);
+        qHead++;
+    }
+    else {
+        dropped++;
+    }
+    __set_PRIMASK(primask);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Move queued records into the journal page and program it when it is
+ *    full or has waited JOURNAL_FLUSH_MS. Programming a page takes about
+ *    20 ms, at most two pages are programmed per call.
+ *
+ *****************************************************************************/
+void journal_poll(void)
+{
+    polling = 1;
+    drainQueue();
+
+    if (pageDirty && (getTicks() - dirtySince) >= JOURNAL_FLUSH_MS) {
+        writePage();
+    }
+    polling = 0;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Program the journal page now, with all queued records. For the
+ *    supervisor fault callback, just before the watchdog reset: may be
+ *    called from an interrupt, and then blocks it for up to ~40 ms. Does
+ *    nothing if it interrupted journal_poll(), whose page is half updated.
+ *
+ *****************************************************************************/
+void journal_flush(void)
+{
+    if (polling) {
+        return;
+    }
+    drainQueue();
+    if (pageDirty) {
+        writePage();
+    }
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Read a record from the journal
+ *
+ * Params:
+ *   [in] back - 0 for the newest record, 1 for the one before, ...
+ *   [out] entry - the record
+ *
+ * Returns:
+ *    1 on success, 0 if there is no such record
+ *
+ *****************************************************************************/
+uint8_t journal_get(uint32_t back, journal_entry_t *entry)
+{
+    uint8_t r[RECORD_SIZE];
+    uint32_t index = 0;
+
+    if (back >= head || back >= CAPACITY) {
+        return 0;
+    }
+    index = head - 1 - back;
+
+    if (index / RECORDS_PER_PAGE == head / RECORDS_PER_PAGE) {
+        unpack(&page[(index % RECORDS_PER_PAGE) * RECORD_SIZE], entry);
+    }
+    else {
+        flash_read(r, pageOffset(index)
+                + (index % RECORDS_PER_PAGE) * RECORD_SIZE, RECORD_SIZE);
+        unpack(r, entry);
+    }
+    return 1;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the number of records ever written
+ *
+ *****************************************************************************/
+uint32_t journal_getCount(void)
+{
+    return head;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the number of records lost because the queue was full
+ *
+ *****************************************************************************/
+uint32_t journal_getDropped(void)
+{
+    return dropped;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the number of boots since the backup battery was connected
+ *
+ *****************************************************************************/
+uint32_t journal_getBootCount(void)
+{
+    return bootCount;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the RSID reset source bits of the last reset
+ *
+ *****************************************************************************/
+uint32_t journal_getResetSource(void)
+{
+    return resetSource;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Keep a fault code over the next reset
+ *
+ * Params:
+ *   [in] fault - fault code, 0 for none
+ *
+ *****************************************************************************/
+void journal_setLastFault(uint32_t fault)
+{
+    RTC_WriteGPREG(LPC_RTC, GPREG_FAULT, fault);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the fault code kept by journal_setLastFault()
+ *
+ *****************************************************************************/
+uint32_t journal_getLastFault(void)
+{
+    return RTC_ReadGPREG(LPC_RTC, GPREG_FAULT);
+}
@@ -0,0 +1,53 @@
+/*****************************************************************************
+ *   journal.h:  Header file for the event journal and reset persistent state
+ *
+******************************************************************************/
+#ifndef __JOURNAL_H
+#define __JOURNAL_H
+
+#include <stdint.h>
+
+/* event ids, 6 bits */
+#define JOURNAL_EV_RESET        1   /* arg: RSID reset source bits */
+#define JOURNAL_EV_OVERTEMP     2   /* arg: temperature, 10 x T(C) */
+#define JOURNAL_EV_TEMP_OK      3   /* arg: temperature, 10 x T(C) */
+#define JOURNAL_EV_STALL        4   /* arg: fan speed, RPM */
+#define JOURNAL_EV_UNDERSPEED   5   /* arg: fan speed, RPM */
+#define JOURNAL_EV_FAN_OK       6   /* arg: fan speed, RPM */
+#define JOURNAL_EV_SETPOINT     7   /* arg: new setpoint, 10 x T(C) */
+#define JOURNAL_EV_TIME_SET     8   /* arg: step in seconds, saturated */
+#define JOURNAL_EV_WATCHDOG     9   /* arg: supervisor task id, -1 if unknown */
+#define JOURNAL_EV_SENSOR_FAIL  10  /* arg: sensor id */
+#define JOURNAL_EV_SENSOR_OK    11  /* arg: sensor id */
+#define JOURNAL_EV_BOOT         12  /* arg: ms to the first valid control output, saturated */
+
+/* dataflash area of the journal, the last 64 pages of the AT45DB081 */
+#define JOURNAL_FIRST_PAGE      4032
+#define JOURNAL_PAGES           64
+
+typedef struct
+{
+    uint32_t sec;       /* seconds since 1970 */
+    uint16_t ms;        /* milliseconds */
+    uint8_t event;      /* JOURNAL_EV_* */
+    int16_t arg;
+} journal_entry_t;
+
+
+void journal_init(uint32_t (*getMsTicks)(void));
+void journal_log(uint8_t event, int16_t arg);
+void journal_poll(void);
+void journal_flush(void);
+uint8_t journal_get(uint32_t back, journal_entry_t *entry);
+uint32_t journal_getCount(void);
+uint32_t journal_getDropped(void);
+
+uint32_t journal_getBootCount(void);
+uint32_t journal_getResetSource(void);
+void journal_setLastFault(uint32_t fault);
+uint32_t journal_getLastFault(void);
+
+#endif /* end __JOURNAL_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
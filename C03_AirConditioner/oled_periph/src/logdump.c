@@ -0,0 +1,329 @@
+/*****************************************************************************
+ *   logdump.c:  Stream the dataflash log out over a UART using GPDMA
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: Two chunk buffers are used in turn. While GPDMA moves one of them
+ * into the UART THR, logdump_poll() reads the next part of the log from
+ * the dataflash into the other one over SSP. The flash read is done from
+ * the main loop because SSP1 is shared with the OLED, only the DMA
+ * terminal count interrupt runs in the background.
+ *
+ * At 115200 baud one chunk takes ~180 ms on the wire, so the line stays
+ * busy as long as the main loop polls at least once per two chunks.
+ *
+ * The dump takes over the transmitter: it holds the serial driver, waits
+ * for queued data to go out, and gives the port back once the last byte of
+ * the dump has left the FIFO.
+ *
+ * The interrupt side runs from RAM and only touches the GPDMA registers:
+ * logdump_init() sets the channel up once with GPDMA_Setup() and keeps its
+ * control and config words, startDma() then only loads the source address
+ * and size. The GPDMA driver functions stay in flash and are not called
+ * from the interrupt.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <cr_section_macros.h>
+#include "lpc17xx_gpdma.h"
+#include "flash.h"
+#include "logdump.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define CH_BIT      (1UL << LOGDUMP_DMA_CH)
+#define CH_REGS     ((LPC_GPDMACH_TypeDef *)(LPC_GPDMACH0_BASE + 0x20 * LOGDUMP_DMA_CH))
+
+typedef enum
+{
+    DUMP_IDLE,
+    DUMP_DRAINING,      /* waiting for the serial driver to empty its FIFO */
+    DUMP_RUNNING,
+    DUMP_FLUSHING       /* all chunks sent, waiting for the FIFO to empty */
+} dump_state_t;
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static serial_port_t dumpPort = SERIAL_UART3;
+static uint32_t dmaConn = GPDMA_CONN_UART3_Tx;
+static uint32_t dmaControl = 0;         /* channel words from GPDMA_Setup() */
+static uint32_t dmaConfig = 0;
+
+/* in the AHB SRAM, so the DMA reads do not contend with the CPU */
+__BSS(RAM2) static uint8_t chunk[2][LOGDUMP_CHUNK_SIZE];
+static volatile uint16_t chunkLen[2];
+static volatile uint8_t chunkFull[2];
+
+static uint8_t fillIdx = 0;             /* next buffer to read flash into */
+static volatile uint8_t sendIdx = 0;    /* next buffer to transmit */
+static volatile uint8_t dmaBusy = 0;
+static volatile uint8_t dmaError = 0;
+
+static volatile dump_state_t state = DUMP_IDLE;
+static uint32_t readOffset = 0;
+static uint32_t remaining = 0;
+static volatile uint32_t sent = 0;
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+/* set the channel up for the UART once, startDma() reuses the words */
+static void setupDma(void)
+{
+    GPDMA_Channel_CFG_Type dmaCfg;
+
+    dmaCfg.ChannelNum = LOGDUMP_DMA_CH;
+    dmaCfg.TransferSize = 0;
+    dmaCfg.TransferWidth = 0;
+    dmaCfg.SrcMemAddr = (uint32_t)chunk[0];
+    dmaCfg.DstMemAddr = 0;
+    dmaCfg.TransferType = GPDMA_TRANSFERTYPE_M2P;
+    /* not used for M2P, but GPDMA_Setup() derives DMAREQSEL from it too */
+    dmaCfg.SrcConn = dmaConn;
+    dmaCfg.DstConn = dmaConn;
+    dmaCfg.DMALLI = 0;
+
+    GPDMA_Setup(&dmaCfg);
+    dmaControl = CH_REGS->DMACCControl & ~GPDMA_DMACCxControl_TransferSize(0xFFF);
+    dmaConfig = CH_REGS->DMACCConfig & ~GPDMA_DMACCxConfig_E;
+}
+
+__RAMFUNC(RAM) static void startDma(uint8_t idx)
+{
+    LPC_GPDMA->DMACIntTCClear = CH_BIT;
+    LPC_GPDMA->DMACIntErrClr = CH_BIT;
+
+    CH_REGS->DMACCSrcAddr = (uint32_t)chunk[idx];
+    CH_REGS->DMACCLLI = 0;
+    CH_REGS->DMACCControl = dmaControl
+            | GPDMA_DMACCxControl_TransferSize((uint32_t)chunkLen[idx]);
+    dmaBusy = 1;
+    CH_REGS->DMACCConfig = dmaConfig | GPDMA_DMACCxConfig_E;
+}
+
+/*
+ * Start the next transfer if the DMA is idle and the next buffer in turn
+ * has been filled. The DMA interrupt does the same when a transfer ends.
+ */
+static void kickDma(void)
+{
+    NVIC_DisableIRQ(DMA_IRQn);
+    if (!dmaBusy && chunkFull[sendIdx]) {
+        startDma(sendIdx);
+    }
+    NVIC_EnableIRQ(DMA_IRQn);
+}
+
+/* stop feeding the UART, the port is released once the FIFO is empty */
+static void stopDma(void)
+{
+    NVIC_DisableIRQ(DMA_IRQn);
+    CH_REGS->DMACCConfig = dmaConfig;
+    dmaBusy = 0;
+    chunkFull[0] = 0;
+    chunkFull[1] = 0;
+    NVIC_EnableIRQ(DMA_IRQn);
+
+    remaining = 0;
+    state = DUMP_FLUSHING;
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize the log dump. The serial port and the dataflash must
+ *    already be initialized, and the display transfer of oled_initDma()
+ *    finished: this resets the GPDMA controller.
+ *
+ * Params:
+ *   [in] port - serial port the log is sent on
+ *
+ *****************************************************************************/
+void logdump_init(serial_port_t port)
+{
+    dumpPort = port;
+    dmaConn = (port == SERIAL_UART0) ? GPDMA_CONN_UART0_Tx
+            : GPDMA_CONN_UART3_Tx;
+
+    GPDMA_Init();
+    setupDma();
+    NVIC_EnableIRQ(DMA_IRQn);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Start dumping a part of the dataflash. The dump runs in the
+ *    background, logdump_poll() must be called regularly until
+ *    logdump_isBusy() returns 0.
+ *
+ * Params:
+ *   [in] offset - offset into the flash
+ *   [in] len - number of bytes to send
+ *
+ * Returns:
+ *   1 if the dump was started, 0 if a dump is already running
+ *
+ *****************************************************************************/
+uint8_t logdump_start(uint32_t offset, uint32_t len)
+{
+    if (state != DUMP_IDLE || len == 0) {
+        return 0;
+    }
+
+    readOffset = offset;
+    remaining = len;
+    sent = 0;
+    fillIdx = 0;
+    sendIdx = 0;
+    chunkFull[0] = 0;
+    chunkFull[1] = 0;
+    dmaError = 0;
+
+    serial_txHold(dumpPort);
+    state = DUMP_DRAINING;
+
+    return 1;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Refill the free chunk buffers from the dataflash. Called from the
+ *    main loop, never from an interrupt.
+ *
+ *****************************************************************************/
+void logdump_poll(void)
+{
+    uint32_t n = 0;
+
+    if (state == DUMP_IDLE) {
+        return;
+    }
+
+    if (state == DUMP_DRAINING) {
+        if (!serial_txDrained(dumpPort)) {
+            return;
+        }
+        state = DUMP_RUNNING;
+    }
+
+    if (state == DUMP_RUNNING && dmaError) {
+        stopDma();
+    }
+
+    while (state == DUMP_RUNNING && remaining > 0 && !chunkFull[fillIdx]) {
+        n = MIN(remaining, LOGDUMP_CHUNK_SIZE);
+        if (flash_read(chunk[fillIdx], readOffset, n) != n) {
+            /* out of range or flash not initialized */
+            remaining = 0;
+            break;
+        }
+
+        chunkLen[fillIdx] = n;
+        chunkFull[fillIdx] = 1;
+        fillIdx ^= 1;
+        readOffset += n;
+        remaining -= n;
+
+        kickDma();
+    }
+
+    if (state == DUMP_RUNNING && remaining == 0
+            && !dmaBusy && !chunkFull[0] && !chunkFull[1]) {
+        state = DUMP_FLUSHING;
+    }
+
+    if (state == DUMP_FLUSHING && serial_txDrained(dumpPort)) {
+        state = DUMP_IDLE;
+        serial_txRelease(dumpPort);
+    }
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Stop a running dump. The port is given back to the serial driver by
+ *    logdump_poll() once the bytes already in the FIFO have been sent.
+ *
+ *****************************************************************************/
+void logdump_abort(void)
+{
+    if (state == DUMP_RUNNING) {
+        stopDma();
+    }
+    else if (state == DUMP_DRAINING) {
+        state = DUMP_FLUSHING;
+    }
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Check if a dump is in progress
+ *
+ *****************************************************************************/
+uint8_t logdump_isBusy(void)
+{
+    return (state != DUMP_IDLE);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the number of bytes handed to the UART by the current or last dump
+ *
+ *****************************************************************************/
+uint32_t logdump_getSent(void)
+{
+    return sent;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    GPDMA interrupt work of the dump, called from the DMA interrupt
+ *    handler. A chunk has been moved to the UART; free its buffer and
+ *    continue with the other one if it is ready. Only looks at
+ *    LOGDUMP_DMA_CH.
+ *
+ *****************************************************************************/
+__RAMFUNC(RAM) void logdump_dmaIrq(void)
+{
+    if (!(LPC_GPDMA->DMACIntStat & CH_BIT)) {
+        return;
+    }
+
+    if (LPC_GPDMA->DMACIntErrStat & CH_BIT) {
+        LPC_GPDMA->DMACIntErrClr = CH_BIT;
+        dmaBusy = 0;
+        dmaError = 1;
+        return;
+    }
+
+    if (LPC_GPDMA->DMACIntTCStat & CH_BIT) {
+        LPC_GPDMA->DMACIntTCClear = CH_BIT;
+
+        sent += chunkLen[sendIdx];
+        chunkFull[sendIdx] = 0;
+        sendIdx ^= 1;
+        dmaBusy = 0;
+
+        if (chunkFull[sendIdx]) {
+            startDma(sendIdx);
+        }
+    }
+}
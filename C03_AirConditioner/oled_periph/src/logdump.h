@@ -0,0 +1,29 @@
+/*****************************************************************************
+ *   logdump.h:  Header file for the DMA driven dataflash log dump
+ *
+******************************************************************************/
+#ifndef __LOGDUMP_H
+#define __LOGDUMP_H
+
+#include <stdint.h>
+#include "serial.h"
+
+/* bytes per DMA transfer, at most 4095 (GPDMA transfer size field) */
+#define LOGDUMP_CHUNK_SIZE 2048
+
+/* GPDMA channel used for the dump, 7 has the lowest priority */
+#define LOGDUMP_DMA_CH     7
+
+
+void logdump_init(serial_port_t port);
+uint8_t logdump_start(uint32_t offset, uint32_t len);
+void logdump_poll(void);
+void logdump_abort(void);
+uint8_t logdump_isBusy(void);
+uint32_t logdump_getSent(void);
+void logdump_dmaIrq(void);
+
+#endif /* end __LOGDUMP_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
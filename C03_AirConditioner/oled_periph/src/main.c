@@ -1,22 +1,183 @@
+#include <stdio.h>
+#include <string.h>
+#include <cr_section_macros.h>
 #include "lpc17xx_pinsel.h"
 #include "lpc17xx_i2c.h"
 #include "lpc17xx_gpio.h"
 #include "lpc17xx_timer.h"
 #include "lpc17xx_ssp.h"
+#include "lpc17xx_prof.h"
+#include "lpc17xx_trace.h"
+#include "lpc17xx_stats.h"
 #include "light.h"
+#include "acc.h"
 #include "oled.h"
 #include "temp.h"
 #include "rgb.h"
+#include "pid.h"
+#include "pwm_out.h"
+#include "fan.h"
+#include "tach.h"
+#include "serial.h"
+#include "flash.h"
+#include "logdump.h"
+#include "telem.h"
+#include "shell.h"
+#include "zone.h"
+#include "netif.h"
+#include "net.h"
+#include "rtclock.h"
+#include "journal.h"
+#include "supervisor.h"
+#include "sensrec.h"
+#include "stackmon.h"
 
-static uint32_t msTicks = 0;  /* Initialize the static variable msTicks to 0 */
+#define TELEMETRY_PORT    SERIAL_UART3
+#define TELEMETRY_BAUD    115200
+
+/* defaults, all of these can be changed from the shell */
+#define TELEMETRY_PERIOD_MS 50  /* 20 Hz binary telemetry frames */
+#define LOOP_PERIOD_MS    200   /* display/sensor loop period */
+#define CONTROL_PERIOD_MS 500   /* PID update period */
+#define LUX_DARK          10    /* below this the display is not inverted */
+#define LEVEL_HIGH_DUTY   900   /* RGB power level thresholds */
+#define LEVEL_MID_DUTY    650
+
+#define PERIOD_MAX_MS     10000 /* longest period accepted from the shell */
+#define PID_GAIN_MAX      1000  /* largest PID gain accepted from the shell */
+#define SETPOINT_DEFAULT  245   /* 24.5 C, 10 x T(C) */
+#define SETPOINT_MIN      100   /* 10.0 C, setpoint range accepted by changeSetpoint() */
+#define SETPOINT_MAX      350   /* 35.0 C */
+#define OVERTEMP_LIMIT    350   /* 35.0 C, journaled when reached */
+#define OVERTEMP_HYST     20    /* and again when 2.0 C below */
+#define PWM_DUTY_MIN      400   /* lowest duty the compressor runs at */
+#define PWM_PERIOD_US     1000  /* 1 kHz */
+#define PWM_DUTY_MAX      PWM_PERIOD_US  /* 100% */
+#define PWM_RAMP_PERIODS  100   /* spread duty changes over 100 ms */
+#define PWM_LOUVRE_DUTY   500   /* fixed louvre position */
+#define PWM_DUTY_SAFE     PWM_DUTY_MIN   /* without a valid reading: lowest compressor duty, fan running */
+
+/* supervisor: task deadlines on top of the task periods, watchdog timeout */
+#define CONTROL_SLACK_MS  200
+#define LOOP_SLACK_MS     2000  /* temp_read alone may take up to 1 s */
+#define COMMS_DEADLINE_MS 2000
+#define WDT_TIMEOUT_MS    500
+#define RECOVERY_HOLD_MS  30000 /* safe duty after a watchdog reset */
+#define RSID_WDTR         (1 << 2)
+#define DISPLAY_DMA_TIMEOUT_MS 100  /* then the display is brought up polled */
+#define TRACE_SWO_BAUD    2000000  /* ITM trace on SWO, 0 keeps the debugger setup */
+
+/* sensor ids in the journal */
+#define SENSOR_TEMP       1
+#define SENSOR_ACC        2
+
+#define FAN_TACH_PPR      2     /* tach pulses per revolution */
+#define FAN_RPM_FULL      3000  /* nominal fan speed at 100% duty */
+
+#define ZONE_ID           1     /* building zone of this unit */
+#define ZONE_NODE         0     /* node id, unique within the zone */
+
+/* Ethernet telemetry, the MAC is locally administered: 02:00:00:00:zone:node */
+#define NET_ADDRESS       NET_IP(192, 168, 1, 100 + ZONE_NODE)
+#define NET_MASK          NET_IP(255, 255, 255, 0)
+#define NET_GATEWAY       NET_IP(192, 168, 1, 1)
+#define NET_COLLECTOR     NET_IP(192, 168, 1, 2)  /* telemetry collector */
+
+/*
+ * Config push on NET_GROUP_CONFIG: 4 byte records of zone, item and a
+ * 16 bit big endian value. Zone CONFIG_ALL_ZONES addresses every unit.
+ */
+#define CONFIG_ALL_ZONES  0xFF
+#define CONFIG_SETPOINT   1     /* 10 x T(C) */
+#define CONFIG_TELEM_MS   2     /* telemetry period */
+#define CONFIG_RECORD_LEN 4
+
+#define PWM_CH_COMPRESSOR 5     /* PWM1.5 on P2.4 */
+#define PWM_CH_LOUVRE     6     /* PWM1.6 on P2.5 */
+
+static volatile uint32_t msTicks = 0;  /* Initialize the static variable msTicks to 0 */
+
+static pid_ctrl_t tempPid;              /* Compressor/fan PID controller */
+static volatile int32_t lastTemp = 0;   /* Latest temperature, 10 x T(C) */
+static volatile uint8_t tempValid = 0;  /* Set once lastTemp holds a reading */
+static volatile int32_t demand = PWM_DUTY_MIN; /* Controller output before load sharing */
+static volatile int32_t duty = PWM_DUTY_MIN; /* Current fan/compressor duty */
+static uint32_t lastLux = 0;            /* Latest light reading */
+static int8_t lastAcc[3];               /* Latest accelerometer reading */
+static uint8_t accValid = 0;            /* Set if it succeeded */
+static uint8_t overTemp = 0;            /* Set above OVERTEMP_LIMIT */
+static volatile uint32_t safeUntil = 0; /* Safe duty until this msTicks */
+static uint8_t sensorFaults = 0;        /* Bit per failing sensor id */
+static uint32_t tempFailures = 0;       /* Failed temperature reads */
+static uint32_t accFailures = 0;        /* Failed accelerometer reads */
+
+static uint8_t taskControl = 0;         /* Supervised task ids */
+static uint8_t taskComms = 0;
+static uint8_t taskLoop = 0;
+static uint32_t bootFault = 0;          /* Supervisor fault kept over the last reset */
+
+static telem_state_t telemState;        /* Telemetry frame encoder */
+static uint8_t telemEnabled = 1;        /* Binary telemetry on/off */
+static telem_state_t netTelemState;     /* Telemetry frame encoder, UDP */
+static uint8_t netUp = 0;               /* Set if the EMAC came up */
+static uint32_t netTimeSec = 0;         /* Last time sync, seconds since 1970 */
+static uint32_t netTimeTicks = 0;       /* msTicks when it was received */
+static uint32_t configCount = 0;        /* Config records applied */
+static const uint8_t netMac[6] = { 0x02, 0x00, 0x00, 0x00, ZONE_ID, ZONE_NODE };
+
+static volatile uint32_t controlPeriod = CONTROL_PERIOD_MS;
+static uint32_t loopPeriod = LOOP_PERIOD_MS;
+static uint32_t telemPeriod = TELEMETRY_PERIOD_MS;
+static uint32_t luxDark = LUX_DARK;
+static int32_t levelHigh = LEVEL_HIGH_DUTY;
+static int32_t levelMid = LEVEL_MID_DUTY;
+
+static volatile uint8_t controlNow = 0; /* Run the controller at the next tick */
+
+/* boot milestones, msTicks; SysTick starts right after the outputs are safe */
+static volatile uint32_t bootControlMs = 0; /* First controller output from a valid reading */
+static volatile uint32_t bootDisplayMs = 0; /* Display initialized and cleared */
+static volatile uint8_t displayDma = 0; /* Display bring-up transfer running */
+static uint32_t bootLoopMs = 0;         /* Main loop running */
+static uint8_t bootLogged = 0;          /* bootControlMs journaled */
+
+static uint32_t loopCount = 0;          /* Display/sensor loop passes */
+static uint32_t telemFrames = 0;        /* Telemetry frames queued */
+
+static void controlStep(void);
 
 /*!
 
 @brief SysTick interrupt handler.
-This function is the interrupt handler for the SysTick timer. It increments the value of the system tick counter.
+This function is the interrupt handler for the SysTick timer. It increments the value of the system tick counter and runs the temperature controller every controlPeriod milliseconds, or at once when a valid reading follows a fallback (controlNow). It runs from SRAM, without the flash wait states, as it is taken every millisecond.
 */
-void SysTick_Handler(void) {
+__RAMFUNC(RAM) void SysTick_Handler(void) {
+    TRACE_ISR_ENTER(TRACE_ISR_SYSTICK);
     msTicks++;
+
+    if ((msTicks % controlPeriod) == 0 || controlNow) {
+        controlNow = 0;
+        controlStep();
+    }
+    TRACE_ISR_EXIT(TRACE_ISR_SYSTICK);
+}
+
+/*!
+
+@brief GPDMA interrupt handler.
+The display bring-up at boot and the log dump each use their own channel; their handlers only look at that channel. Once the display is up only RAM code runs here: oled_dmaIrq() stays in flash, it is only called during the boot.
+*/
+__RAMFUNC(RAM) void DMA_IRQHandler(void) {
+    TRACE_ISR_ENTER(TRACE_ISR_DMA);
+    if (displayDma) {
+        oled_dmaIrq();
+        if (!oled_isDmaBusy()) {
+            displayDma = 0;
+            bootDisplayMs = msTicks;
+        }
+    }
+    logdump_dmaIrq();
+    TRACE_ISR_EXIT(TRACE_ISR_DMA);
 }
 
 /*!
@@ -105,69 +266,460 @@ static void init_i2c(void)
 /*!
 
 @brief Initializes the PWM (Pulse Width Modulation) module.
-This function initializes the PWM peripheral by setting up the necessary configuration registers and enabling the PWM peripheral.
+This function sets up PWM1 with a 1 kHz period, opens the compressor and louvre channels through the PWM output driver and initializes the fan drive. Duty changes are ramped over PWM_RAMP_PERIODS periods.
+@param None
+@return None
+@side effects None
+*/
+static void init_pwm(void)
+{
+	pwm_out_init(PWM_PERIOD_US);
+	pwm_out_setRamp(PWM_RAMP_PERIODS);
+
+	pwm_out_open(PWM_CH_COMPRESSOR, PWM_OUT_SINGLE_EDGE, PWM_OUT_PIN_P2);
+	pwm_out_open(PWM_CH_LOUVRE, PWM_OUT_SINGLE_EDGE, PWM_OUT_PIN_P2);
+	fan_init();
+
+	pwm_out_setDuty(PWM_CH_LOUVRE, PWM_LOUVRE_DUTY);
+	pwm_out_commit();
+}
+
+/*!
+
+@brief Initializes the temperature controller.
+This function configures the PID controller that drives the compressor/fan PWM duty from the temperature reading.
+@param None
+@return None
+@side effects None
+*/
+static void init_control(void)
+{
+	pid_init(&tempPid, PWM_DUTY_MIN, PWM_DUTY_MAX);
+	pid_setGains(&tempPid, PID_GAIN(15), PID_GAIN(0.5), PID_GAIN(0));
+	pid_setSetpoint(&tempPid, SETPOINT_DEFAULT);
+	pid_setDeadband(&tempPid, 2);       /* +/- 0.2 C */
+	pid_setSlewRate(&tempPid, 50);      /* 5% of full scale per update */
+}
+
+/*!
+
+@brief Moves the fan and compressor to a new duty together.
+@param d The PWM duty cycle.
+@return None
+@side effects Changes the PWM output.
+*/
+static void applyDuty(int32_t d)
+{
+	duty = d;
+	TRACE_VALUE(TRACE_VAL_DUTY, d);
+	fan_setDuty((d * FAN_DUTY_MAX) / PWM_PERIOD_US);
+	pwm_out_setDuty(PWM_CH_COMPRESSOR, d);
+	pwm_out_commit();
+}
+
+/*!
+
+@brief Runs one temperature controller step.
+This function is called from the SysTick handler at a fixed rate. It updates the PID controller with the latest temperature, applies the zone load sharing and moves the fan and compressor to the new duty together. Without a valid temperature, and for RECOVERY_HOLD_MS after a watchdog reset, the outputs are held at PWM_DUTY_SAFE.
+@param None
+@return None
+@side effects Changes the PWM output.
+*/
+static void controlStep(void)
+{
+	PROF_BEGIN(PROF_ID_CONTROL_STEP);
+	TRACE_TASK_BEGIN(TRACE_TASK_CONTROL);
+
+	supervisor_checkIn(taskControl);
+
+	if (!tempValid || (int32_t)(msTicks - safeUntil) < 0) {
+		applyDuty(PWM_DUTY_SAFE);
+	}
+	else {
+		demand = pid_update(&tempPid, lastTemp);
+		applyDuty(zone_shareDuty(demand));
+		if (bootControlMs == 0) {
+			bootControlMs = msTicks;    /* Time to the first valid output */
+		}
+	}
+
+	TRACE_TASK_END(TRACE_TASK_CONTROL);
+	PROF_END(PROF_ID_CONTROL_STEP);
+}
+
+/*!
+
+@brief Waits for the display bring-up started with oled_initDma().
+Falls back to the polled oled_init() and oled_clearScreen() if the transfer hasn't finished within DISPLAY_DMA_TIMEOUT_MS, so a DMA fault costs boot time, not the display.
+@param None
+@return None
+@side effects SSP1 is free for the dataflash afterwards.
+*/
+static void waitDisplay(void)
+{
+	uint32_t start = msTicks;
+
+	while (oled_isDmaBusy()) {
+		if ((msTicks - start) > DISPLAY_DMA_TIMEOUT_MS) {
+			displayDma = 0;
+			oled_init();
+			oled_clearScreen(OLED_COLOR_WHITE);
+			bootDisplayMs = msTicks;
+			return;
+		}
+		__WFI();
+	}
+}
+
+/*!
+
+@brief Handles a missed supervisor deadline.
+This function is called from the supervisor interrupt just before the watchdog reset. It drives the fan and compressor to the safe duty and writes the journal records still in RAM.
+@param task Id of the task that missed its deadline.
+@return None
+@side effects Changes the PWM output, programs the dataflash.
+*/
+static void supervisorFault(uint8_t task)
+{
+	applyDuty(PWM_DUTY_SAFE);
+	journal_flush();
+}
+
+/*!
+
+@brief Records a sensor read result.
+This function counts failed reads and journals when a sensor starts or stops failing.
+@param sensor SENSOR_TEMP or SENSOR_ACC.
+@param ok Non-zero if the read succeeded.
+@return None
+@side effects None
+*/
+static void sensorResult(uint8_t sensor, uint8_t ok)
+{
+	uint8_t bit = 1 << sensor;
+
+	if (!ok) {
+		if (sensor == SENSOR_TEMP) {
+			tempFailures++;
+		}
+		else {
+			accFailures++;
+		}
+	}
+
+	if (!ok && !(sensorFaults & bit)) {
+		sensorFaults |= bit;
+		journal_log(JOURNAL_EV_SENSOR_FAIL, sensor);
+	}
+	else if (ok && (sensorFaults & bit)) {
+		sensorFaults &= ~bit;
+		journal_log(JOURNAL_EV_SENSOR_OK, sensor);
+	}
+}
+
+/*!
+
+@brief Sends one binary telemetry frame.
+This function takes one snapshot of the sensor and actuator state, encodes it as a telemetry frame and queues it on the telemetry UART, between two 0 delimiters since the shell shares the port. The values updated from interrupts are read with interrupts disabled so they belong together.
 @param None
 @return None
+@side effects Reads the accelerometer over I2C. A failed read sends zeros.
+*/
+static void sendTelemetry(void)
+{
+	telem_sample_t s;
+	uint8_t frame[TELEM_FRAME_MAX + 1];
+	uint8_t *payload = NULL;
+	uint32_t len = 0;
+	int8_t x = 0, y = 0, z = 0;
+
+	TRACE_TASK_BEGIN(TRACE_TASK_TELEMETRY);
+	accValid = acc_read(&x, &y, &z);
+	sensorResult(SENSOR_ACC, accValid);
+	lastAcc[0] = x;
+	lastAcc[1] = y;
+	lastAcc[2] = z;
+	s.accX = x;
+	s.accY = y;
+	s.accZ = z;
+	s.lux = (uint16_t)lastLux;
+
+	__disable_irq();
+	s.uptime = msTicks;
+	s.temp = (int16_t)lastTemp;
+	s.duty = (uint16_t)duty;
+	s.rpm = (uint16_t)tach_getRpm();
+	__enable_irq();
+
+	if (shell_takeOutput()) {
+		/* a decoder may have lost sync on the shell text, restart from a key frame */
+		telem_forceKey(&telemState);
+	}
+	/* a leading 0 too: shell text sent before the frame ends on its own */
+	frame[0] = 0;
+	len = telem_encode(&telemState, &s, &frame[1]) + 1;
+	if (serial_write(TELEMETRY_PORT, frame, len) != len) {
+		/* the decoder loses sync on a cut frame, resync with a key frame */
+		telem_forceKey(&telemState);
+	}
+
+	if (netUp) {
+		/* encoded straight into the EMAC TX buffer */
+		payload = net_udpBegin(NET_COLLECTOR, TELEM_UDP_PORT, TELEM_UDP_PORT);
+		if (payload != NULL) {
+			net_udpSend(telem_encode(&netTelemState, &s, payload));
+		}
+		else {
+			telem_forceKey(&netTelemState);
+		}
+	}
+	telemFrames++;
+	TRACE_TASK_END(TRACE_TASK_TELEMETRY);
+}
+
+/*!
+
+@brief Changes the temperature setpoint.
+This function sets the controller setpoint and records the change in the journal. Setpoints outside SETPOINT_MIN..SETPOINT_MAX are ignored.
+@param sp New setpoint, 10 x T(C).
+@param share Non-zero to pass the change on to the other units of the zone.
+@return 1 if the setpoint was changed, 0 if it is out of range.
+@side effects None
+*/
+static uint8_t changeSetpoint(int32_t sp, uint8_t share)
+{
+	if (sp < SETPOINT_MIN || sp > SETPOINT_MAX) {
+		return 0;
+	}
+
+	__disable_irq();
+	pid_setSetpoint(&tempPid, sp);
+	__enable_irq();
+	if (share) {
+		zone_setSetpoint(sp);
+	}
+	journal_log(JOURNAL_EV_SETPOINT, (int16_t)sp);
+	return 1;
+}
+
+/*!
+
+@brief Records temperature and fan events in the journal.
+This function journals the start and end of an overtemperature and the fan tachometer events.
+@param t Latest temperature, 10 x T(C).
+@return None
+@side effects None
+*/
+static void journalEvents(int32_t t)
+{
+	uint32_t ev = tach_getEvents();
+	int16_t rpm = (int16_t)tach_getRawRpm();
+
+	if (!overTemp && t >= OVERTEMP_LIMIT) {
+		overTemp = 1;
+		journal_log(JOURNAL_EV_OVERTEMP, (int16_t)t);
+	}
+	else if (overTemp && t < OVERTEMP_LIMIT - OVERTEMP_HYST) {
+		overTemp = 0;
+		journal_log(JOURNAL_EV_TEMP_OK, (int16_t)t);
+	}
+
+	if (ev & TACH_EVENT_STALL) {
+		journal_log(JOURNAL_EV_STALL, rpm);
+	}
+	if (ev & TACH_EVENT_UNDERSPEED) {
+		journal_log(JOURNAL_EV_UNDERSPEED, rpm);
+	}
+	if (ev & TACH_EVENT_RECOVERED) {
+		journal_log(JOURNAL_EV_FAN_OK, rpm);
+	}
+}
+
+/*!
+
+@brief Adds the readings of a loop pass to the sensor trace.
+This function records the raw temperature and light readings of the pass, the latest accelerometer reading, the controller output and the setpoint while a recording runs.
+@param t Temperature reading, TEMP_READ_ERROR if the read failed.
+@param l Light reading.
+@return None
+@side effects Programs a dataflash page every 16 records.
+*/
+static void recordSensors(int32_t t, uint32_t l)
+{
+	sensrec_record_t r;
+
+	if (!sensrec_isRecording()) {
+		return;
+	}
+
+	r.uptime = msTicks;
+	r.temp = (t == TEMP_READ_ERROR) ? SENSREC_NO_TEMP : (int16_t)t;
+	r.lux = (uint16_t)((l > UINT16_MAX) ? UINT16_MAX : l);
+	r.accX = lastAcc[0];
+	r.accY = lastAcc[1];
+	r.accZ = lastAcc[2];
+	r.flags = accValid ? SENSREC_ACC_VALID : 0;
+	r.duty = (uint16_t)duty;
+	r.setpoint = (int16_t)tempPid.setpoint;
+	sensrec_add(&r);
+}
+
+/*!
+
+@brief Waits in the idle task.
+This function waits for the given time while serving the background work: the command shell, the CAN zone protocol, the network stack, telemetry frames every telemPeriod milliseconds, the log dump and the event journal.
+@param ms Time to wait in milliseconds.
+@return None
 @side effects None
 */
-void PWM_Init(){
-	LPC_SC->PCONP |= (1<<6);
-	LPC_PWM1->PR = 0x18;
-	LPC_PWM1->MR0 = 0x3e8;
-	LPC_PWM1->MR1 = 0x0;
-	LPC_PINCON->PINSEL4 |= (1<<0);
-	LPC_PWM1->PCR |= (1<<9);
-	LPC_PWM1->TCR = 0x9;
-	LPC_PWM1->PC = 0x1;
-	LPC_PWM1->LER = 0x3;
+static void idleWait(uint32_t ms)
+{
+	static uint32_t lastTelemetry = 0;
+	uint32_t start = msTicks;
+	int32_t sp = 0;
+
+	while ((msTicks - start) < ms) {
+		supervisor_checkIn(taskComms);
+		shell_poll();
+
+		zone_poll(demand, lastTemp);
+		if (zone_takeSetpoint(&sp)) {
+			/* another unit in the zone changed the setpoint */
+			changeSetpoint(sp, 0);
+		}
+
+		if (netUp) {
+			net_poll();
+		}
+
+		if (telemEnabled && (msTicks - lastTelemetry) >= telemPeriod
+				&& !logdump_isBusy()) {
+			lastTelemetry = msTicks;
+			sendTelemetry();
+		}
+
+		logdump_poll();
+		journal_poll();
+	}
+}
+
+/*!
+
+@brief Handles a config push datagram.
+This function applies the records of a config push sent to NET_GROUP_CONFIG. Records for other zones and out of range values are skipped.
+@param srcIp Sender address.
+@param srcPort Sender port.
+@param data Datagram payload.
+@param len Payload length in bytes.
+@return None
+@side effects May change the setpoint and the telemetry period.
+*/
+static void configHandler(uint32_t srcIp, uint16_t srcPort,
+		const uint8_t *data, uint32_t len)
+{
+	int32_t v = 0;
+
+	for (; len >= CONFIG_RECORD_LEN; len -= CONFIG_RECORD_LEN, data += CONFIG_RECORD_LEN) {
+		if (data[0] != ZONE_ID && data[0] != CONFIG_ALL_ZONES) {
+			continue;
+		}
+		v = (int16_t)((data[2] << 8) | data[3]);
+
+		if (data[1] == CONFIG_SETPOINT && changeSetpoint(v, 1)) {
+			configCount++;
+		}
+		else if (data[1] == CONFIG_TELEM_MS && v > 0 && v <= PERIOD_MAX_MS) {
+			telemPeriod = v;
+			configCount++;
+		}
+	}
+}
+
+/*!
+
+@brief Handles a time sync datagram.
+This function sets the RTC from the time sent to NET_GROUP_TIME: seconds since 1970, 32 bit big endian. Differences of a second or less are ignored.
+@param srcIp Sender address.
+@param srcPort Sender port.
+@param data Datagram payload.
+@param len Payload length in bytes.
+@return None
+@side effects Sets the RTC.
+*/
+static void timeHandler(uint32_t srcIp, uint16_t srcPort,
+		const uint8_t *data, uint32_t len)
+{
+	int32_t step = 0;
+
+	if (len < 4) {
+		return;
+	}
+	netTimeSec = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16)
+			| ((uint32_t)data[2] << 8) | data[3];
+	netTimeTicks = msTicks;
+
+	step = (int32_t)(netTimeSec - rtclock_getSeconds());
+	if (step > 1 || step < -1) {
+		rtclock_setTime(netTimeSec);
+		journal_log(JOURNAL_EV_TIME_SET,
+				(int16_t)((step > INT16_MAX) ? INT16_MAX : (step < INT16_MIN) ? INT16_MIN : step));
+	}
 }
 
 /*!
 
-@brief Changes the PWM output and LED color based on the temperature value.
-This function adjusts the PWM output and LED color based on the temperature value. It sets different power levels and corresponding PWM duty cycles, as well as LED colors, based on temperature ranges.
-@param t The temperature value.
+@brief Changes the LED color based on the compressor power.
+This function shows the current PWM duty as a power level on the RGB LED.
+@param d The PWM duty cycle.
 @return None
-@side effects Changes the PWM output and LED colors.
+@side effects Changes the LED colors.
 */
-void changePwmBasedOnTemp(int32_t t)
+void showPowerLevel(int32_t d)
 {
 	// power level 3 -> blue rgb
-	if(t >= 265)
+	if (d >= levelHigh)
 	{
 		rgb_setLeds(0x06);
-	    LPC_PWM1->MR1 = 1000;
-	    LPC_PWM1->LER = 0x2;
 	}
-
 	// power level 2 -> green rgb
-	if (t >= 245 && t < 265)
+	else if (d >= levelMid)
 	{
-	    rgb_setLeds(0x04);
-	    LPC_PWM1->MR1 = 750;
-	    LPC_PWM1->LER = 0x2;
+		rgb_setLeds(0x04);
 	}
-
 	// power level 1 -> yellow rgb
-	if(t<245)
+	else
 	{
-	    rgb_setLeds(0x05);
-	    LPC_PWM1->MR1 = 400;
-	    LPC_PWM1->LER = 0x2;
+		rgb_setLeds(0x05);
 	}
 }
 
 /*!
 
+@brief Signals a fan fault on the RGB LED.
+This function toggles the blue LED on every call, so it blinks at the loop rate. The red LED can't be used: P2.0 is the fan PWM output. Green stays on, P2.1 also powers the OLED.
+@param None
+@return None
+@side effects Changes the LED colors.
+*/
+static void showFanFault(void)
+{
+	static uint8_t blink = 0;
+
+	blink ^= 1;
+	rgb_setLeds(blink ? (RGB_BLUE | RGB_GREEN) : RGB_GREEN);
+}
+
+/*!
+
 @brief Inverses the colors on the OLED display based on the lux value.
-This function inverses the colors on the OLED display based on the lux value. If the lux value is less than 10, it sets the OLED display to non-inverse mode. Otherwise, it sets the OLED display to inverse mode.
+This function inverses the colors on the OLED display based on the lux value. If the lux value is less than luxDark, it sets the OLED display to non-inverse mode. Otherwise, it sets the OLED display to inverse mode.
 @param l The lux value.
 @return None
 @side effects Changes the display color inversion on the OLED display.
 */
 void inverseColorsBasedOnLux(uint32_t l)
 {
-	if(l < 10)
+	if(l < luxDark)
 	{
 		oled_inverse(0); /*text - white, background - black */
 	}
@@ -177,24 +729,556 @@ void inverseColorsBasedOnLux(uint32_t l)
 	}
 }
 
+/*!
+
+@brief Prints a PID gain.
+This function prints a Q8 fixed-point gain with three decimals.
+@param name Name of the gain.
+@param q The gain, Q8.
+@return None
+@side effects None
+*/
+static void printGain(const char *name, int32_t q)
+{
+	int32_t milli = (q * 1000) >> PID_Q;
+
+	shell_printf("%s=%d.%03d ", name, (int)(milli / 1000), (int)(milli % 1000));
+}
+
+/*!
+
+@brief Shell command: sensors.
+Prints the latest sensor readings and the controller output.
+*/
+static void cmdSensors(int argc, char **argv)
+{
+	int8_t x = 0, y = 0, z = 0;
+	uint32_t accOk = acc_read(&x, &y, &z);
+
+	shell_printf("temp=%d%s lux=%u duty=%d\r\n", (int)lastTemp,
+			tempValid ? "" : " (invalid)", (unsigned)lastLux, (int)duty);
+	shell_printf("rpm=%u raw=%u fault=%u acc=%d,%d,%d%s\r\n",
+			(unsigned)tach_getRpm(), (unsigned)tach_getRawRpm(),
+			tach_isFaulted(), x, y, z, accOk ? "" : " (failed)");
+}
+
+/*!
+
+@brief Shell command: setpoint [C].
+Shows or sets the temperature setpoint, e.g. "setpoint 23.5".
+*/
+static void cmdSetpoint(int argc, char **argv)
+{
+	int32_t sp = 0;
+
+	if (argc > 1) {
+		if (!shell_parseFixed(argv[1], 1, &sp) || !changeSetpoint(sp, 1)) {
+			shell_printf("bad value\r\n");
+			return;
+		}
+	}
+	shell_printf("setpoint=%d\r\n", (int)tempPid.setpoint);
+}
+
+/*!
+
+@brief Shell command: pid [kp ki kd].
+Shows or sets the PID gains, e.g. "pid 15 0.5 0".
+*/
+static void cmdPid(int argc, char **argv)
+{
+	int32_t g[3];
+	int i = 0;
+
+	if (argc == 4) {
+		for (i = 0; i < 3; i++) {
+			if (!shell_parseFixed(argv[i + 1], 3, &g[i])
+					|| g[i] < 0 || g[i] > PID_GAIN_MAX * 1000) {
+				shell_printf("bad value\r\n");
+				return;
+			}
+			g[i] = (g[i] << PID_Q) / 1000;
+		}
+		__disable_irq();
+		pid_setGains(&tempPid, g[0], g[1], g[2]);
+		__enable_irq();
+	}
+	else if (argc != 1) {
+		shell_printf("usage: pid [kp ki kd]\r\n");
+		return;
+	}
+
+	printGain("kp", tempPid.kp);
+	printGain("ki", tempPid.ki);
+	printGain("kd", tempPid.kd);
+	shell_printf("\r\n");
+}
+
+/*!
+
+@brief Shell command: period [control|loop|telem ms].
+Shows or sets the task periods in milliseconds.
+*/
+static void cmdPeriod(int argc, char **argv)
+{
+	int32_t ms = 0;
+
+	if (argc == 3) {
+		if (!shell_parseFixed(argv[2], 0, &ms) || ms <= 0 || ms > PERIOD_MAX_MS) {
+			shell_printf("bad value\r\n");
+			return;
+		}
+		if (strcmp(argv[1], "control") == 0) {
+			controlPeriod = ms;
+			supervisor_setDeadline(taskControl, 2 * ms + CONTROL_SLACK_MS);
+		}
+		else if (strcmp(argv[1], "loop") == 0) {
+			loopPeriod = ms;
+			supervisor_setDeadline(taskLoop, ms + LOOP_SLACK_MS);
+		}
+		else if (strcmp(argv[1], "telem") == 0) {
+			telemPeriod = ms;
+		}
+		else {
+			shell_printf("unknown task '%s'\r\n", argv[1]);
+			return;
+		}
+	}
+	else if (argc != 1) {
+		shell_printf("usage: period [control|loop|telem ms]\r\n");
+		return;
+	}
+
+	shell_printf("control=%u loop=%u telem=%u\r\n", (unsigned)controlPeriod,
+			(unsigned)loopPeriod, (unsigned)telemPeriod);
+}
+
+/*!
+
+@brief Shell command: lux [value].
+Shows or sets the light level below which the display is not inverted.
+*/
+static void cmdLux(int argc, char **argv)
+{
+	int32_t v = 0;
+
+	if (argc > 1) {
+		if (!shell_parseFixed(argv[1], 0, &v) || v < 0) {
+			shell_printf("bad value\r\n");
+			return;
+		}
+		luxDark = v;
+	}
+	shell_printf("dark below %u lux\r\n", (unsigned)luxDark);
+}
+
+/*!
+
+@brief Shell command: level [high mid].
+Shows or sets the duty thresholds of the RGB power level indication.
+*/
+static void cmdLevel(int argc, char **argv)
+{
+	int32_t hi = 0;
+	int32_t mid = 0;
+
+	if (argc == 3) {
+		if (!shell_parseFixed(argv[1], 0, &hi) || !shell_parseFixed(argv[2], 0, &mid)
+				|| mid > hi) {
+			shell_printf("bad value\r\n");
+			return;
+		}
+		levelHigh = hi;
+		levelMid = mid;
+	}
+	else if (argc != 1) {
+		shell_printf("usage: level [high mid]\r\n");
+		return;
+	}
+	shell_printf("high=%d mid=%d\r\n", (int)levelHigh, (int)levelMid);
+}
+
+/*!
+
+@brief Shell command: telem [on|off].
+Turns the binary telemetry stream on or off. It shares the UART with the shell, so turn it off for interactive use.
+*/
+static void cmdTelem(int argc, char **argv)
+{
+	if (argc > 1) {
+		if (strcmp(argv[1], "on") == 0) {
+			telemEnabled = 1;
+			telem_forceKey(&telemState);
+			telem_forceKey(&netTelemState);
+		}
+		else if (strcmp(argv[1], "off") == 0) {
+			telemEnabled = 0;
+		}
+	}
+	shell_printf("telemetry %s\r\n", telemEnabled ? "on" : "off");
+}
+
+/*!
+
+@brief Shell command: dump offset len.
+Starts a background dump of the dataflash log.
+*/
+static void cmdDump(int argc, char **argv)
+{
+	int32_t offset = 0;
+	int32_t len = 0;
+
+	if (argc != 3 || !shell_parseFixed(argv[1], 0, &offset)
+			|| !shell_parseFixed(argv[2], 0, &len) || offset < 0 || len <= 0) {
+		shell_printf("usage: dump offset len\r\n");
+		return;
+	}
+	if (!logdump_start(offset, len)) {
+		shell_printf("dump already running\r\n");
+	}
+}
+
+/*!
+
+@brief Shell command: counters.
+Prints the loop, telemetry and driver counters.
+*/
+static void cmdCounters(int argc, char **argv)
+{
+	shell_printf("uptime=%u loops=%u frames=%u\r\n", (unsigned)msTicks,
+			(unsigned)loopCount, (unsigned)telemFrames);
+	shell_printf("uart tx_drop=%u rx_drop=%u dump_sent=%u\r\n",
+			(unsigned)serial_getTxDropped(TELEMETRY_PORT),
+			(unsigned)serial_getRxDropped(TELEMETRY_PORT),
+			(unsigned)logdump_getSent());
+	shell_printf("sensor temp_fail=%u acc_fail=%u\r\n",
+			(unsigned)tempFailures, (unsigned)accFailures);
+#ifdef _TRACE
+	shell_printf("trace lost=%u\r\n", (unsigned)TRACE_GetLost());
+#endif
+}
+
+/*!
+
+@brief Shell command: zone [test].
+Prints the zone nodes and the leader, or runs the CAN self test.
+*/
+static void cmdZone(int argc, char **argv)
+{
+	zone_node_t node;
+	uint8_t i = 0;
+
+	if (argc > 1 && strcmp(argv[1], "test") == 0) {
+		shell_printf("self test %s\r\n", zone_selfTest() ? "passed" : "FAILED");
+		return;
+	}
+
+	shell_printf("zone %d node %d leader %d\r\n", ZONE_ID,
+			zone_getNodeId(), zone_getLeader());
+	for (i = 0; i < ZONE_MAX_NODES; i++) {
+		zone_getNode(i, &node);
+		if (node.alive) {
+			shell_printf(" %d: temp=%d demand=%u\r\n", i, node.temp,
+					node.demand);
+		}
+	}
+	shell_printf("rx=%u drop=%u txfail=%u\r\n", (unsigned)zone_getRxCount(),
+			(unsigned)zone_getRxDropped(), (unsigned)zone_getTxFailed());
+}
+
+/*!
+
+@brief Shell command: net [audit on|off].
+Prints the Ethernet link state and the network stack counters. Audit mode passes the frames the MAC filter rejects to software so they can be counted.
+*/
+static void cmdNet(int argc, char **argv)
+{
+	net_stats_t st;
+
+	if (!netUp) {
+		shell_printf("ethernet down\r\n");
+		return;
+	}
+	if (argc == 3 && strcmp(argv[1], "audit") == 0) {
+		netif_setFilterAudit(strcmp(argv[2], "on") == 0);
+	}
+	net_getStats(&st);
+	shell_printf("rx=%u ignored=%u errors=%u\r\n", (unsigned)st.rxFrames,
+			(unsigned)st.rxIgnored, (unsigned)st.rxErrors);
+	shell_printf("filtered=%u hash_miss=%u config=%u\r\n",
+			(unsigned)st.rxFiltered, (unsigned)st.rxHashMiss,
+			(unsigned)configCount);
+	shell_printf("tx=%u busy=%u arp_miss=%u\r\n", (unsigned)st.txFrames,
+			(unsigned)st.txBusy, (unsigned)st.arpMiss);
+	if (netTimeTicks != 0) {
+		shell_printf("time=%u (%u ms ago)\r\n", (unsigned)netTimeSec,
+				(unsigned)(msTicks - netTimeTicks));
+	}
+}
+
+/*!
+
+@brief Shell command: time [sec].
+Shows the RTC time or sets it, in seconds since 1970.
+*/
+static void cmdTime(int argc, char **argv)
+{
+	int32_t sec = 0;
+	uint64_t t = 0;
+
+	if (argc > 1) {
+		if (!shell_parseFixed(argv[1], 0, &sec) || sec < 0) {
+			shell_printf("bad value\r\n");
+			return;
+		}
+		rtclock_setTime(sec);
+		journal_log(JOURNAL_EV_TIME_SET, 0);
+	}
+	t = rtclock_now();
+	shell_printf("time=%u.%06u%s boot=%u reset=0x%x fault=%u\r\n",
+			(unsigned)(t / RTCLOCK_US_PER_SEC), (unsigned)(t % RTCLOCK_US_PER_SEC),
+			rtclock_isSet() ? "" : " (not set)", (unsigned)journal_getBootCount(),
+			(unsigned)journal_getResetSource(), (unsigned)bootFault);
+}
+
+/*!
+
+@brief Shell command: journal [n].
+Prints the last n journal records, newest first.
+*/
+static void cmdJournal(int argc, char **argv)
+{
+	journal_entry_t e;
+	int32_t n = 10;
+	int32_t i = 0;
+
+	if (argc > 1 && (!shell_parseFixed(argv[1], 0, &n) || n <= 0)) {
+		shell_printf("usage: journal [n]\r\n");
+		return;
+	}
+	for (i = 0; i < n && journal_get(i, &e); i++) {
+		shell_printf("%u.%03u ev=%u arg=%d\r\n", (unsigned)e.sec,
+				(unsigned)e.ms, e.event, e.arg);
+	}
+	shell_printf("%u records, %u dropped\r\n", (unsigned)journal_getCount(),
+			(unsigned)journal_getDropped());
+}
+
+/*!
+
+@brief Shell command: boot.
+Prints the boot milestones in ms since SysTick started: display up, main loop running and the first controller output from a valid temperature reading.
+*/
+static void cmdBoot(int argc, char **argv)
+{
+	shell_printf("display=%u loop=%u ", (unsigned)bootDisplayMs,
+			(unsigned)bootLoopMs);
+	if (bootControlMs != 0) {
+		shell_printf("control=%u ms\r\n", (unsigned)bootControlMs);
+	}
+	else {
+		shell_printf("control=pending\r\n");
+	}
+}
+
+/*!
+
+@brief Shell command: tasks.
+Prints the supervised tasks with their deadlines and the longest time seen between check-ins.
+*/
+static void cmdTasks(int argc, char **argv)
+{
+	supervisor_task_t t;
+	uint8_t i = 0;
+
+	for (i = 0; i < supervisor_getTaskCount(); i++) {
+		supervisor_getTask(i, &t);
+		shell_printf("%d %-8s deadline=%u worst=%u checkins=%u\r\n", i, t.name,
+				(unsigned)t.deadline, (unsigned)t.worst, (unsigned)t.checkIns);
+	}
+	shell_printf("last watchdog task=%d\r\n", (int)SUPERVISOR_FAULT_ID(bootFault));
+}
+
+/*!
+
+@brief Shell command: rec [on [n]|off].
+Starts recording the sensor readings of every n-th loop pass to the dataflash, or stops. Prints the dump command that reads the trace out.
+*/
+static void cmdRec(int argc, char **argv)
+{
+	int32_t n = 1;
+	uint32_t pages = 0;
+
+	if (argc > 1 && strcmp(argv[1], "on") == 0) {
+		if (argc > 2 && (!shell_parseFixed(argv[2], 0, &n) || n <= 0)) {
+			shell_printf("bad value\r\n");
+			return;
+		}
+		if (!sensrec_start(n)) {
+			shell_printf("already recording\r\n");
+			return;
+		}
+	}
+	else if (argc > 1 && strcmp(argv[1], "off") == 0) {
+		sensrec_stop();
+	}
+	else if (argc != 1) {
+		shell_printf("usage: rec [on [n]|off]\r\n");
+		return;
+	}
+
+	/* the pages of the trace and the one with its end */
+	pages = sensrec_getCount() / SENSREC_RECORDS_PER_PAGE + 1;
+	shell_printf("%s records=%u lost=%u\r\n",
+			sensrec_isRecording() ? "recording" : "stopped",
+			(unsigned)sensrec_getCount(), (unsigned)sensrec_getLost());
+	shell_printf("dump %u %u\r\n", (unsigned)sensrec_getOffset(),
+			(unsigned)(pages * flash_getPageSize()));
+}
+
+/*!
+
+@brief Shell command: mem.
+Prints the stack high-water mark since reset and the newlib heap usage, in bytes.
+*/
+static void cmdMem(int argc, char **argv)
+{
+	stackmon_info_t m;
+
+	stackmon_get(&m);
+	shell_printf("stack used=%u free=%u\r\n", (unsigned)m.stackUsed,
+			(unsigned)(m.stackSize - m.stackUsed));
+	shell_printf("heap sbrk=%u in_use=%u\r\n", (unsigned)m.heapArena,
+			(unsigned)m.heapUsed);
+}
+
+#ifdef _PROF
+/*!
+
+@brief Shell command: prof [reset].
+Prints the profiler table in CPU cycles and microseconds, or clears it.
+*/
+static void cmdProf(int argc, char **argv)
+{
+	PROF_ENTRY_Type e;
+	uint32_t mhz = SystemCoreClock / 1000000;
+	uint8_t i = 0;
+
+	if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+		PROF_Reset();
+		return;
+	}
+
+	shell_printf("%-15s %8s %10s %10s %10s %8s\r\n", "probe", "count",
+			"min", "mean", "max", "mean_us");
+	for (i = 0; i < PROF_NUM_IDS; i++) {
+		PROF_GetEntry((PROF_ID_Type)i, &e);
+		shell_printf("%-15s %8u %10u %10u %10u %8u\r\n", e.name,
+				(unsigned)e.count, (unsigned)e.min, (unsigned)e.mean,
+				(unsigned)e.max, (unsigned)(e.mean / mhz));
+	}
+	shell_printf("cycles, probe overhead %u subtracted\r\n",
+			(unsigned)PROF_GetOverhead());
+}
+#endif
+
+#ifdef _STATS
+/*!
+
+@brief Shell command: stats [reset].
+Prints a snapshot of the driver runtime counters, or clears them. The counters are copied at one instant, so they can be compared with each other.
+*/
+static void cmdStats(int argc, char **argv)
+{
+	STATS_Type s;
+
+	if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+		STATS_Reset();
+		return;
+	}
+
+	STATS_Snapshot(&s);
+	shell_printf("i2c transfers=%u nacks=%u timeouts=%u retries=%u errors=%u\r\n",
+			(unsigned)s.i2c_transfers, (unsigned)s.i2c_nacks, (unsigned)s.i2c_timeouts,
+			(unsigned)s.i2c_retries, (unsigned)s.i2c_errors);
+	shell_printf("ssp bytes=%u overruns=%u\r\n", (unsigned)s.ssp_bytes,
+			(unsigned)s.ssp_overruns);
+	shell_printf("temp timeouts=%u\r\n", (unsigned)s.temp_timeouts);
+	shell_printf("flash busy_polls=%u\r\n", (unsigned)s.flash_busy_polls);
+	shell_printf("eeprom writes=%u\r\n", (unsigned)s.eeprom_writes);
+	shell_printf("loop overruns=%u\r\n", (unsigned)s.loop_overruns);
+}
+#endif
+
+static const shell_cmd_t shellCmds[] = {
+	{ "sensors",  "read all sensors",              cmdSensors },
+	{ "setpoint", "[C] temperature setpoint",      cmdSetpoint },
+	{ "pid",      "[kp ki kd] controller gains",   cmdPid },
+	{ "period",   "[task ms] task periods",        cmdPeriod },
+	{ "lux",      "[lux] display inversion level", cmdLux },
+	{ "level",    "[high mid] RGB duty levels",    cmdLevel },
+	{ "telem",    "[on|off] binary telemetry",     cmdTelem },
+	{ "dump",     "offset len: dump flash log",    cmdDump },
+	{ "counters", "loop and driver counters",      cmdCounters },
+	{ "zone",     "[test] CAN zone state",         cmdZone },
+	{ "net",      "[audit on|off] ethernet state", cmdNet },
+	{ "time",     "[sec] RTC time, boot count",    cmdTime },
+	{ "journal",  "[n] last journal records",      cmdJournal },
+	{ "tasks",    "supervised tasks",              cmdTasks },
+	{ "boot",     "boot milestones",               cmdBoot },
+	{ "rec",      "[on [n]|off] sensor trace",     cmdRec },
+	{ "mem",      "stack and heap usage",          cmdMem },
+#ifdef _PROF
+	{ "prof",     "[reset] cycle profiler table",  cmdProf },
+#endif
+#ifdef _STATS
+	{ "stats",    "[reset] driver runtime counters", cmdStats },
+#endif
+};
+
 int main (void)
 {
 
     int32_t temp = 0;        /* Variable to store temperature reading */
     uint32_t lux = 0;        /* Variable to store light reading */
+    uint32_t passStart = 0;  /* msTicks at the start of a loop pass */
 
-    init_i2c();              /* Initialize I2C communication */
-	init_ssp();              /* Initialize SSP (SPI) communication */
-    rgb_init();              /* Initialize RGB LED */
-    oled_init();             /* Initialize OLED display */
-    light_init();            /* Initialize light sensor */
-    temp_init (&getTicks);   /* Initialize temperature sensor */
-    PWM_Init();              /* Initialize PWM */
+    PROF_Init();             /* DWT cycle counter for the profiler probes */
+    TRACE_Init(TRACE_SWO_BAUD); /* ITM event trace */
+
+    /*
+     * Stage 1: outputs in a safe state and the watchdog running before
+     * anything that can take long. The controller holds PWM_DUTY_SAFE
+     * until there is a valid reading.
+     */
+    init_pwm();              /* Initialize PWM */
+    applyDuty(PWM_DUTY_SAFE); /* Lowest compressor duty, fan running */
+    init_control();          /* Initialize temperature controller */
+    if (LPC_SC->RSID & RSID_WDTR) {
+        /* hold the safe duty for a while after a watchdog reset */
+        safeUntil = RECOVERY_HOLD_MS;
+    }
+    supervisor_init(&supervisorFault);
+    taskControl = supervisor_register("control", 2 * controlPeriod + CONTROL_SLACK_MS);
+    supervisor_start(WDT_TIMEOUT_MS);    /* Feed only while all tasks check in */
  
 	if (SysTick_Config(SystemCoreClock / 1000)) {
 		    while (1);  /* Capture error if SysTick configuration fails */
 	}
 
+    /*
+     * Stage 2: the display init sequence and first clear go out over
+     * GPDMA while the I2C sensors are set up and give the first reading.
+     */
+	init_ssp();              /* Initialize SSP (SPI) communication */
+    displayDma = 1;
+    oled_initDma(OLED_COLOR_WHITE); /* Init and clear the OLED in the background */
+    init_i2c();              /* Initialize I2C communication */
+    rgb_init();              /* Initialize RGB LED */
+    light_init();            /* Initialize light sensor */
+    acc_init();              /* Initialize accelerometer */
+    temp_init (&getTicks);   /* Initialize temperature sensor */
+
     /*
      * Assume base board in zero-g position when reading first value.
      */
@@ -202,38 +1286,121 @@ int main (void)
 	LPC_GPIO2->FIODIR &= ~(1<<10);
 	LPC_GPIO2->FIOPIN |=(1<<10);
 
-
     light_enable();                      /* Enable light sensor */
     light_setRange(LIGHT_RANGE_4000);    /* Set light range to 4000 */
+    tach_init(FAN_TACH_PPR, FAN_RPM_FULL); /* Initialize fan tachometer */
+    serial_init(TELEMETRY_PORT, TELEMETRY_BAUD); /* Initialize telemetry UART */
+    rtclock_init();          /* RTC and microsecond timestamps */
 
-    oled_clearScreen(OLED_COLOR_WHITE);  /* Clear OLED screen */
+    temp = temp_read();      /* First reading, the controller takes it at once */
+    if (temp != TEMP_READ_ERROR) {
+        lastTemp = temp;
+        tempValid = 1;
+        controlNow = 1;
+    }
+
+    /*
+     * Stage 3: SSP1 is shared by the OLED and the dataflash, everything
+     * else waits for the display.
+     */
+    waitDisplay();
+    flash_init();            /* Initialize dataflash (log storage) */
+    journal_init(&getTicks); /* Count the boot, journal the reset source */
+    sensrec_init();          /* Sensor trace recorder, off until "rec on" */
+    bootFault = journal_getLastFault();
+    journal_setLastFault(0); /* a later reset the supervisor did not cause finds none */
+    if (journal_getResetSource() & RSID_WDTR) {
+        journal_log(JOURNAL_EV_WATCHDOG, (int16_t)SUPERVISOR_FAULT_ID(bootFault));
+    }
+    logdump_init(TELEMETRY_PORT); /* Log dumps go out on the telemetry UART */
+    telem_initState(&telemState);
+    zone_init(ZONE_ID, ZONE_NODE, SETPOINT_DEFAULT, SETPOINT_MIN, SETPOINT_MAX,
+            &getTicks);          /* Join the CAN zone */
+    netUp = netif_init(netMac);  /* Bring up the EMAC and PHY */
+    if (netUp) {
+        net_init(netMac, NET_ADDRESS, NET_MASK, NET_GATEWAY, &getTicks);
+        net_udpBind(NET_PORT_CONFIG, &configHandler);
+        net_udpBind(NET_PORT_TIME, &timeHandler);
+        net_joinGroup(NET_GROUP_CONFIG);  /* Only these reach the CPU */
+        net_joinGroup(NET_GROUP_TIME);
+    }
+    telem_initState(&netTelemState);
+    shell_init(TELEMETRY_PORT, shellCmds, sizeof(shellCmds) / sizeof(shellCmds[0]));
 
     oled_putString(1, 1 , (uint8_t*)"Temp   : ", OLED_COLOR_BLACK, OLED_COLOR_WHITE);   /* Display temperature label */
     oled_putString(1, 20, (uint8_t*)"Swiatlo: ", OLED_COLOR_BLACK, OLED_COLOR_WHITE );  /* Display light label */
+    oled_putString(1, 39, (uint8_t*)"Wiatrak: ", OLED_COLOR_BLACK, OLED_COLOR_WHITE );  /* Display fan speed label */
 
     char str[10];   /* String variable to store temperature value */
     char str2[10];  /* String variable to store light value */
+    char str3[10];  /* String variable to store fan speed */
 
+    /* the loop deadlines start with the loop */
+    taskComms = supervisor_register("comms", COMMS_DEADLINE_MS);
+    taskLoop = supervisor_register("loop", loopPeriod + LOOP_SLACK_MS);
+    bootLoopMs = msTicks;
 
     while(1) {
+    	PROF_BEGIN(PROF_ID_MAIN_LOOP);
+    	TRACE_TASK_BEGIN(TRACE_TASK_MAIN_LOOP);
+    	supervisor_checkIn(taskComms);   /* Back from idleWait */
+    	passStart = msTicks;
 		
         /* Temperature */
     	temp = temp_read();              /* Read temperature value */
-    	sprintf(str,"%.1f", temp/10.0);  /* Convert temperature value to string */
+    	if (temp != TEMP_READ_ERROR) {
+    		lastTemp = temp;             /* Hand it over to the controller */
+    		if (!tempValid) {
+    			tempValid = 1;
+    			controlNow = 1;          /* Leave the safe duty at the next tick */
+    		}
+    		TRACE_VALUE(TRACE_VAL_TEMP, temp);
+    		journalEvents(temp);         /* Overtemperature and fan events */
+    		sprintf(str,"%.1f", temp/10.0);  /* Convert temperature value to string */
+    	}
+    	else {
+    		tempValid = 0;               /* Controller falls back to the safe duty */
+    		sprintf(str, "----");
+    	}
+    	sensorResult(SENSOR_TEMP, temp != TEMP_READ_ERROR);
+    	if (bootControlMs != 0 && !bootLogged) {
+    		/* time to the first valid control output, once per boot */
+    		journal_log(JOURNAL_EV_BOOT,
+    				(int16_t)((bootControlMs > INT16_MAX) ? INT16_MAX : bootControlMs));
+    		bootLogged = 1;
+    	}
 
         /* light */
         lux = light_read();              /* Read light value */
+        lastLux = lux;
         sprintf(str2, "%3d", lux);       /* Convert light value to string */
+        recordSensors(temp, lux);        /* Sensor trace, when recording */
 
         oled_fillRect((1+9*6),1, 80, 8, OLED_COLOR_WHITE);                    /* Clear previous temperature value on OLED screen */
         oled_putString((1+9*6),1, str, OLED_COLOR_BLACK, OLED_COLOR_WHITE);   /* Display new temperature value */
         oled_putString((1+9*6),20, str2, OLED_COLOR_BLACK, OLED_COLOR_WHITE); /* Display light value */
 
-        changePwmBasedOnTemp(temp);    /* Adjust PWM and RGB-LED based on temperature value */
+        /* fan */
+        if (tach_isFaulted()) {
+            sprintf(str3, "STOP");                  /* Fan stalled or too slow */
+            showFanFault();                         /* Blink blue on RGB-LED */
+        }
+        else {
+            sprintf(str3, "%4d", tach_getRpm());    /* Convert fan speed to string */
+            showPowerLevel(duty);                   /* Show controller output on RGB-LED */
+        }
+        oled_putString((1+9*6),39, str3, OLED_COLOR_BLACK, OLED_COLOR_WHITE); /* Display fan speed */
 
         inverseColorsBasedOnLux(lux);  /* Invert colors on OLED based on light value */
 
-        Timer0_Wait(200);              /* Wait for 200 milliseconds */
+        supervisor_checkIn(taskLoop);
+        loopCount++;
+        if ((msTicks - passStart) > loopPeriod) {
+            STATS_INC(loop_overruns);    /* The pass alone took a whole period */
+        }
+        TRACE_TASK_END(TRACE_TASK_MAIN_LOOP);
+        PROF_END(PROF_ID_MAIN_LOOP);
+        idleWait(loopPeriod);      /* Telemetry and log dump until the next pass */
     }
 
 }
@@ -0,0 +1,809 @@
+/*****************************************************************************
+ *   net.c:  Minimal ARP/IPv4/UDP stack
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: Just enough IP to send telemetry over Ethernet and take UDP
+ * messages: ARP (with a small cache), IPv4 without fragments or options
+ * on transmit, ICMP echo so a unit can be pinged, and UDP.
+ *
+ * Multicast: joining a group sets its bit in the MAC hash filter, so the
+ * traffic of groups nobody joined never reaches the CPU. The hash is
+ * imperfect and 32 groups share each MAC address, so a multicast that
+ * gets through is checked against the joined groups once more
+ * (rxHashMiss). IGMP is not implemented; on switches with IGMP snooping
+ * the groups have to be configured statically.
+ *
+ * Nothing is copied through intermediate buffers. Received frames are
+ * parsed where the interface put them (netif.h) and UDP handlers get a
+ * pointer into the receive buffer. To send, net_udpBegin() returns the
+ * payload area of the TX buffer itself; the caller writes the payload
+ * there and net_udpSend() fills in lengths and checksums. No net_poll()
+ * may run between the two calls.
+ *
+ * Headers are read and written byte by byte in network order, frames
+ * don't have to be aligned and the code also runs on the host
+ * (tools/netsim.c).
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <string.h>
+#include "netif.h"
+#include "net.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define ETH_HLEN        14
+#define ETH_DST         0
+#define ETH_SRC         6
+#define ETH_TYPE        12
+#define ETHTYPE_IP      0x0800
+#define ETHTYPE_ARP     0x0806
+
+#define ARP_LEN         28
+#define ARP_HTYPE       0
+#define ARP_PTYPE       2
+#define ARP_HLEN        4
+#define ARP_PLEN        5
+#define ARP_OPER        6
+#define ARP_SHA         8
+#define ARP_SPA         14
+#define ARP_THA         18
+#define ARP_TPA         24
+#define ARP_REQUEST     1
+#define ARP_REPLY       2
+
+#define IP_HLEN         20
+#define IP_VIHL         0
+#define IP_TOTLEN       2
+#define IP_ID           4
+#define IP_FRAG         6
+#define IP_TTL          8
+#define IP_PROTO        9
+#define IP_CSUM         10
+#define IP_SRC          12
+#define IP_DST          16
+#define IP_MF_OFFSET    0x3FFF  /* more fragments flag and fragment offset */
+#define IP_DEF_TTL      64
+#define PROTO_ICMP      1
+#define PROTO_UDP       17
+
+#define ICMP_HLEN       8
+#define ICMP_ECHO_REPLY 0
+#define ICMP_ECHO       8
+
+#define UDP_HLEN        8
+#define UDP_SPORT       0
+#define UDP_DPORT       2
+#define UDP_LEN         4
+#define UDP_CSUM        6
+
+#define UDP_OFFSET      (ETH_HLEN + IP_HLEN + UDP_HLEN)
+
+#define ARP_TIMEOUT_MS  60000   /* cache entries are refreshed after this */
+#define ARP_RETRY_MS    1000    /* at most one request per address per second */
+
+/* frames handled per net_poll() call, one per receive descriptor */
+#define RX_BUDGET       4
+
+#define IP_BROADCAST    0xFFFFFFFF
+#define IP_IS_MCAST(ip) (((ip) >> 28) == 0xE)
+
+typedef struct
+{
+    uint32_t ip;        /* 0 if the entry is unused */
+    uint8_t mac[6];
+    uint32_t stamp;
+} arp_entry_t;
+
+typedef struct
+{
+    uint16_t port;      /* 0 if the slot is unused */
+    net_udp_handler_t handler;
+} udp_bind_t;
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static const uint8_t macBroadcast[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+static uint8_t myMac[6];
+static uint32_t myIp = 0;
+static uint32_t netMask = 0;
+static uint32_t gateway = 0;
+static uint32_t (*getTicks)(void) = NULL;
+
+static arp_entry_t arpCache[NET_ARP_ENTRIES];
+static uint32_t arpPendingIp = 0;
+static uint32_t arpPendingStamp = 0;
+
+static udp_bind_t udpPorts[NET_UDP_PORTS];
+static uint32_t groups[NET_GROUPS];     /* 0 if the slot is unused */
+
+/* frame opened by net_udpBegin() */
+static uint8_t *txOpen = NULL;
+static uint16_t ipId = 0;
+
+static net_stats_t stats;
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static uint16_t get16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16)
+            | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+/*
+ * Internet checksum, RFC 1071. Partial sums are kept in 32 bits; only the
+ * last block added may have an odd length.
+ */
+static uint32_t csumAdd(uint32_t sum, const uint8_t *p, uint32_t len)
+{
+    while (len > 1) {
+        sum += (uint32_t)((p[0] << 8) | p[1]);
+        p += 2;
+        len -= 2;
+    }
+    if (len > 0) {
+        sum += (uint32_t)(p[0] << 8);
+    }
+    return sum;
+}
+
+static uint16_t csumFold(uint32_t sum)
+{
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return (uint16_t)~sum;
+}
+
+static uint32_t csumPseudo(uint32_t src, uint32_t dst, uint8_t proto,
+        uint32_t len)
+{
+    return (src >> 16) + (src & 0xFFFF) + (dst >> 16) + (dst & 0xFFFF)
+            + proto + len;
+}
+
+static uint8_t isLocalBroadcast(uint32_t ip)
+{
+    return (ip == IP_BROADCAST || ip == (myIp | ~netMask));
+}
+
+/*
+ * RFC 1112: 01:00:5E followed by the low 23 bits of the group address
+ */
+static void mcastMac(uint32_t group, uint8_t *mac)
+{
+    mac[0] = 0x01;
+    mac[1] = 0x00;
+    mac[2] = 0x5E;
+    mac[3] = (uint8_t)((group >> 16) & 0x7F);
+    mac[4] = (uint8_t)(group >> 8);
+    mac[5] = (uint8_t)group;
+}
+
+static uint8_t isJoined(uint32_t group)
+{
+    uint32_t i = 0;
+
+    for (i = 0; i < NET_GROUPS; i++) {
+        if (groups[i] == group) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Check a multicast destination MAC against the joined groups
+ */
+static uint8_t isJoinedMac(const uint8_t *mac)
+{
+    uint8_t m[6];
+    uint32_t i = 0;
+
+    for (i = 0; i < NET_GROUPS; i++) {
+        if (groups[i] != 0) {
+            mcastMac(groups[i], m);
+            if (memcmp(m, mac, 6) == 0) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void fillEth(uint8_t *f, const uint8_t *dst, uint16_t type)
+{
+    memcpy(&f[ETH_DST], dst, 6);
+    memcpy(&f[ETH_SRC], myMac, 6);
+    put16(&f[ETH_TYPE], type);
+}
+
+/*
+ * Fill in an IPv4 header without options, checksum included.
+ */
+static void fillIp(uint8_t *ip, uint32_t dst, uint8_t proto, uint32_t len)
+{
+    ip[IP_VIHL] = 0x45;
+    ip[1] = 0;
+    put16(&ip[IP_TOTLEN], (uint16_t)(IP_HLEN + len));
+    put16(&ip[IP_ID], ipId++);
+    put16(&ip[IP_FRAG], 0);
+    ip[IP_TTL] = IP_DEF_TTL;
+    ip[IP_PROTO] = proto;
+    put16(&ip[IP_CSUM], 0);
+    put32(&ip[IP_SRC], myIp);
+    put32(&ip[IP_DST], dst);
+    put16(&ip[IP_CSUM], csumFold(csumAdd(0, ip, IP_HLEN)));
+}
+
+/*
+ * Get a TX buffer for a frame built inside net_poll()
+ */
+static uint8_t *txFrame(void)
+{
+    uint8_t *f = NULL;
+
+    if (txOpen == NULL) {
+        f = netif_txFrame();
+    }
+    if (f == NULL) {
+        stats.txBusy++;
+    }
+    return f;
+}
+
+static void txSend(uint32_t len)
+{
+    netif_txSend(len);
+    stats.txFrames++;
+}
+
+static arp_entry_t *arpFind(uint32_t ip)
+{
+    uint32_t i = 0;
+
+    for (i = 0; i < NET_ARP_ENTRIES; i++) {
+        if (arpCache[i].ip == ip) {
+            return &arpCache[i];
+        }
+    }
+    return NULL;
+}
+
+static void arpStore(uint32_t ip, const uint8_t *mac)
+{
+    arp_entry_t *e = arpFind(ip);
+    uint32_t now = getTicks();
+    uint32_t i = 0;
+
+    if (e == NULL) {
+        /* take a free entry or the oldest one */
+        e = &arpCache[0];
+        for (i = 0; i < NET_ARP_ENTRIES && e->ip != 0; i++) {
+            if (arpCache[i].ip == 0
+                    || (now - arpCache[i].stamp) > (now - e->stamp)) {
+                e = &arpCache[i];
+            }
+        }
+    }
+
+    e->ip = ip;
+    memcpy(e->mac, mac, 6);
+    e->stamp = now;
+
+    if (ip == arpPendingIp) {
+        arpPendingIp = 0;
+    }
+}
+
+static void arpRequest(uint32_t ip)
+{
+    uint32_t now = getTicks();
+    uint8_t *f = NULL;
+    uint8_t *a = NULL;
+
+    if (ip == arpPendingIp && (now - arpPendingStamp) < ARP_RETRY_MS) {
+        return;
+    }
+
+    f = txFrame();
+    if (f == NULL) {
+        return;
+    }
+
+    arpPendingIp = ip;
+    arpPendingStamp = now;
+
+    fillEth(f, macBroadcast, ETHTYPE_ARP);
+    a = &f[ETH_HLEN];
+    put16(&a[ARP_HTYPE], 1);
+    put16(&a[ARP_PTYPE], ETHTYPE_IP);
+    a[ARP_HLEN] = 6;
+    a[ARP_PLEN] = 4;
+    put16(&a[ARP_OPER], ARP_REQUEST);
+    memcpy(&a[ARP_SHA], myMac, 6);
+    put32(&a[ARP_SPA], myIp);
+    memset(&a[ARP_THA], 0, 6);
+    put32(&a[ARP_TPA], ip);
+    txSend(ETH_HLEN + ARP_LEN);
+}
+
+static void handleArp(const uint8_t *f, uint32_t len)
+{
+    const uint8_t *a = &f[ETH_HLEN];
+    uint32_t spa = 0;
+    uint8_t *t = NULL;
+    uint8_t *r = NULL;
+
+    if (len < ETH_HLEN + ARP_LEN) {
+        stats.rxErrors++;
+        return;
+    }
+    if (get16(&a[ARP_HTYPE]) != 1 || get16(&a[ARP_PTYPE]) != ETHTYPE_IP
+            || a[ARP_HLEN] != 6 || a[ARP_PLEN] != 4) {
+        stats.rxIgnored++;
+        return;
+    }
+
+    spa = get32(&a[ARP_SPA]);
+    if (get32(&a[ARP_TPA]) != myIp) {
+        /* not for us, but keep a known entry up to date (RFC 826) */
+        if (spa != 0 && arpFind(spa) != NULL) {
+            arpStore(spa, &a[ARP_SHA]);
+        }
+        stats.rxIgnored++;
+        return;
+    }
+
+    if (spa != 0) {
+        arpStore(spa, &a[ARP_SHA]);
+    }
+    if (get16(&a[ARP_OPER]) != ARP_REQUEST) {
+        return;
+    }
+
+    t = txFrame();
+    if (t == NULL) {
+        return;
+    }
+    fillEth(t, &a[ARP_SHA], ETHTYPE_ARP);
+    r = &t[ETH_HLEN];
+    put16(&r[ARP_HTYPE], 1);
+    put16(&r[ARP_PTYPE], ETHTYPE_IP);
+    r[ARP_HLEN] = 6;
+    r[ARP_PLEN] = 4;
+    put16(&r[ARP_OPER], ARP_REPLY);
+    memcpy(&r[ARP_SHA], myMac, 6);
+    put32(&r[ARP_SPA], myIp);
+    memcpy(&r[ARP_THA], &a[ARP_SHA], 6);
+    put32(&r[ARP_TPA], spa);
+    txSend(ETH_HLEN + ARP_LEN);
+}
+
+static void handleIcmp(const uint8_t *f, const uint8_t *ip, uint32_t ihl,
+        uint32_t len)
+{
+    const uint8_t *icmp = &ip[ihl];
+    uint8_t *t = NULL;
+    uint8_t *r = NULL;
+
+    if (len < ICMP_HLEN || csumFold(csumAdd(0, icmp, len)) != 0) {
+        stats.rxErrors++;
+        return;
+    }
+    if (icmp[0] != ICMP_ECHO || icmp[1] != 0
+            || ETH_HLEN + IP_HLEN + len > NETIF_MTU_FRAME) {
+        stats.rxIgnored++;
+        return;
+    }
+
+    /* the echo data is the one thing that has to be copied */
+    t = txFrame();
+    if (t == NULL) {
+        return;
+    }
+    fillEth(t, &f[ETH_SRC], ETHTYPE_IP);
+    fillIp(&t[ETH_HLEN], get32(&ip[IP_SRC]), PROTO_ICMP, len);
+    r = &t[ETH_HLEN + IP_HLEN];
+    memcpy(r, icmp, len);
+    r[0] = ICMP_ECHO_REPLY;
+    put16(&r[2], 0);
+    put16(&r[2], csumFold(csumAdd(0, r, len)));
+    txSend(ETH_HLEN + IP_HLEN + len);
+}
+
+static void handleUdp(const uint8_t *ip, uint32_t ihl, uint32_t len)
+{
+    const uint8_t *udp = &ip[ihl];
+    uint32_t src = get32(&ip[IP_SRC]);
+    uint32_t ulen = 0;
+    uint16_t port = 0;
+    uint32_t i = 0;
+
+    if (len < UDP_HLEN) {
+        stats.rxErrors++;
+        return;
+    }
+    ulen = get16(&udp[UDP_LEN]);
+    if (ulen < UDP_HLEN || ulen > len) {
+        stats.rxErrors++;
+        return;
+    }
+    if (get16(&udp[UDP_CSUM]) != 0
+            && csumFold(csumAdd(csumPseudo(src, get32(&ip[IP_DST]),
+                    PROTO_UDP, ulen), udp, ulen)) != 0) {
+        stats.rxErrors++;
+        return;
+    }
+
+    port = get16(&udp[UDP_DPORT]);
+    for (i = 0; i < NET_UDP_PORTS; i++) {
+        if (udpPorts[i].port == port) {
+            udpPorts[i].handler(src, get16(&udp[UDP_SPORT]),
+                    &udp[UDP_HLEN], ulen - UDP_HLEN);
+            return;
+        }
+    }
+    stats.rxIgnored++;
+}
+
+static void handleIp(const uint8_t *f, uint32_t len)
+{
+    const uint8_t *ip = &f[ETH_HLEN];
+    uint32_t ihl = 0;
+    uint32_t total = 0;
+    uint32_t dst = 0;
+
+    if (len < ETH_HLEN + IP_HLEN || (ip[IP_VIHL] >> 4) != 4) {
+        stats.rxErrors++;
+        return;
+    }
+    ihl = (ip[IP_VIHL] & 0x0F) * 4;
+    total = get16(&ip[IP_TOTLEN]);
+    if (ihl < IP_HLEN || total < ihl || total > len - ETH_HLEN
+            || csumFold(csumAdd(0, ip, ihl)) != 0) {
+        stats.rxErrors++;
+        return;
+    }
+    if (get16(&ip[IP_FRAG]) & IP_MF_OFFSET) {
+        /* fragments are not reassembled */
+        stats.rxErrors++;
+        return;
+    }
+
+    dst = get32(&ip[IP_DST]);
+    if (IP_IS_MCAST(dst) && !isJoined(dst)) {
+        /* another group on the same MAC address */
+        stats.rxHashMiss++;
+    }
+    else if (dst == myIp && ip[IP_PROTO] == PROTO_ICMP) {
+        handleIcmp(f, ip, ihl, total - ihl);
+    }
+    else if ((dst == myIp || isLocalBroadcast(dst) || IP_IS_MCAST(dst))
+            && ip[IP_PROTO] == PROTO_UDP) {
+        handleUdp(ip, ihl, total - ihl);
+    }
+    else {
+        stats.rxIgnored++;
+    }
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize the stack. The interface (netif_init()) must be up.
+ *
+ * Params:
+ *   [in] mac - station address, 6 bytes
+ *   [in] ip - own address
+ *   [in] mask - subnet mask
+ *   [in] gw - gateway for addresses outside the subnet, 0 if none
+ *   [in] getMsTicks - callback function for retrieving number of elapsed
+ *                     ticks in milliseconds
+ *
+ *****************************************************************************/
+void net_init(const uint8_t *mac, uint32_t ip, uint32_t mask, uint32_t gw,
+        uint32_t (*getMsTicks)(void))
+{
+    memcpy(myMac, mac, 6);
+    myIp = ip;
+    netMask = mask;
+    gateway = gw;
+    getTicks = getMsTicks;
+
+    memset(arpCache, 0, sizeof(arpCache));
+    memset(udpPorts, 0, sizeof(udpPorts));
+    memset(groups, 0, sizeof(groups));
+    memset(&stats, 0, sizeof(stats));
+    arpPendingIp = 0;
+    txOpen = NULL;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Handle received frames. Call this from the idle loop.
+ *
+ *****************************************************************************/
+void net_poll(void)
+{
+    uint8_t *f = NULL;
+    uint32_t len = 0;
+    uint32_t n = 0;
+
+    for (n = 0; n < RX_BUDGET; n++) {
+        f = netif_rxFrame(&len);
+        if (f == NULL) {
+            break;
+        }
+        stats.rxFrames++;
+
+        if (len < ETH_HLEN) {
+            stats.rxErrors++;
+        }
+        else if ((f[ETH_DST] & 0x01) && memcmp(&f[ETH_DST], macBroadcast, 6) != 0
+                && !isJoinedMac(&f[ETH_DST])) {
+            /* multicast that only shares a hash bit with a joined group */
+            stats.rxHashMiss++;
+        }
+        else if (get16(&f[ETH_TYPE]) == ETHTYPE_ARP) {
+            handleArp(f, len);
+        }
+        else if (get16(&f[ETH_TYPE]) == ETHTYPE_IP) {
+            handleIp(f, len);
+        }
+        else {
+            stats.rxIgnored++;
+        }
+
+        netif_rxRelease();
+    }
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Deliver datagrams sent to a UDP port to a handler
+ *
+ * Params:
+ *   [in] port - local port
+ *   [in] handler - called from net_poll() for each datagram
+ *
+ * Returns:
+ *    1 on success, 0 if all NET_UDP_PORTS slots are taken
+ *
+ *****************************************************************************/
+uint8_t net_udpBind(uint16_t port, net_udp_handler_t handler)
+{
+    uint32_t i = 0;
+
+    for (i = 0; i < NET_UDP_PORTS; i++) {
+        if (udpPorts[i].port == 0 || udpPorts[i].port == port) {
+            udpPorts[i].port = port;
+            udpPorts[i].handler = handler;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Join a multicast group: datagrams sent to it are delivered to the
+ *    handler bound to their port
+ *
+ * Params:
+ *   [in] group - group address, 224.0.0.0 - 239.255.255.255
+ *
+ * Returns:
+ *    1 on success, 0 if the address is not a group or all NET_GROUPS
+ *    slots are taken
+ *
+ *****************************************************************************/
+uint8_t net_joinGroup(uint32_t group)
+{
+    uint8_t mac[6];
+    uint32_t i = 0;
+
+    if (!IP_IS_MCAST(group)) {
+        return 0;
+    }
+    if (isJoined(group)) {
+        return 1;
+    }
+
+    for (i = 0; i < NET_GROUPS; i++) {
+        if (groups[i] == 0) {
+            groups[i] = group;
+            mcastMac(group, mac);
+            netif_setMulticast(mac, 1);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Leave a multicast group
+ *
+ * Params:
+ *   [in] group - group address
+ *
+ *****************************************************************************/
+void net_leaveGroup(uint32_t group)
+{
+    uint8_t mac[6];
+    uint32_t i = 0;
+
+    for (i = 0; i < NET_GROUPS; i++) {
+        if (groups[i] == group) {
+            groups[i] = 0;
+            mcastMac(group, mac);
+            netif_setMulticast(mac, 0);
+        }
+    }
+
+    /* the hash bit may be shared with a group still joined */
+    for (i = 0; i < NET_GROUPS; i++) {
+        if (groups[i] != 0) {
+            mcastMac(groups[i], mac);
+            netif_setMulticast(mac, 1);
+        }
+    }
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Start a UDP datagram. The payload is written directly into the
+ *    returned TX buffer, then net_udpSend() sends it.
+ *
+ * Params:
+ *   [in] dstIp - destination address
+ *   [in] dstPort - destination port
+ *   [in] srcPort - source port
+ *
+ * Returns:
+ *    Pointer to NET_UDP_MAX bytes of payload space, NULL if the
+ *    destination is not resolved yet (an ARP request is sent) or no TX
+ *    buffer is free. The datagram is dropped in that case.
+ *
+ *****************************************************************************/
+uint8_t *net_udpBegin(uint32_t dstIp, uint16_t dstPort, uint16_t srcPort)
+{
+    const uint8_t *dstMac = macBroadcast;
+    uint8_t groupMac[6];
+    arp_entry_t *e = NULL;
+    uint32_t hop = dstIp;
+    uint8_t *f = NULL;
+    uint8_t *ip = NULL;
+    uint8_t *udp = NULL;
+
+    if (txOpen != NULL) {
+        return NULL;
+    }
+
+    if (IP_IS_MCAST(dstIp)) {
+        mcastMac(dstIp, groupMac);
+        dstMac = groupMac;
+    }
+    else if (!isLocalBroadcast(dstIp)) {
+        if (((dstIp ^ myIp) & netMask) != 0 && gateway != 0) {
+            hop = gateway;
+        }
+        e = arpFind(hop);
+        if (e == NULL || (getTicks() - e->stamp) > ARP_TIMEOUT_MS) {
+            arpRequest(hop);
+        }
+        if (e == NULL) {
+            stats.arpMiss++;
+            return NULL;
+        }
+        dstMac = e->mac;
+    }
+
+    f = netif_txFrame();
+    if (f == NULL) {
+        stats.txBusy++;
+        return NULL;
+    }
+
+    /* everything except the lengths and checksums */
+    fillEth(f, dstMac, ETHTYPE_IP);
+    ip = &f[ETH_HLEN];
+    put32(&ip[IP_DST], dstIp);
+    udp = &f[ETH_HLEN + IP_HLEN];
+    put16(&udp[UDP_SPORT], srcPort);
+    put16(&udp[UDP_DPORT], dstPort);
+
+    txOpen = f;
+    return &f[UDP_OFFSET];
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Send the datagram started with net_udpBegin()
+ *
+ * Params:
+ *   [in] len - payload length written to the buffer
+ *
+ *****************************************************************************/
+void net_udpSend(uint32_t len)
+{
+    uint8_t *ip = NULL;
+    uint8_t *udp = NULL;
+    uint16_t csum = 0;
+
+    if (txOpen == NULL) {
+        return;
+    }
+    if (len > NET_UDP_MAX) {
+        len = NET_UDP_MAX;
+    }
+
+    ip = &txOpen[ETH_HLEN];
+    udp = &txOpen[ETH_HLEN + IP_HLEN];
+    fillIp(ip, get32(&ip[IP_DST]), PROTO_UDP, UDP_HLEN + len);
+
+    put16(&udp[UDP_LEN], (uint16_t)(UDP_HLEN + len));
+    put16(&udp[UDP_CSUM], 0);
+    csum = csumFold(csumAdd(csumPseudo(myIp, get32(&ip[IP_DST]), PROTO_UDP,
+            UDP_HLEN + len), udp, UDP_HLEN + len));
+    /* a computed 0 is sent as all ones, 0 means no checksum */
+    put16(&udp[UDP_CSUM], (csum == 0) ? 0xFFFF : csum);
+
+    txOpen = NULL;
+    txSend(UDP_OFFSET + len);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the stack counters
+ *
+ *****************************************************************************/
+void net_getStats(net_stats_t *st)
+{
+    *st = stats;
+    st->rxFiltered = netif_getFiltered();
+}
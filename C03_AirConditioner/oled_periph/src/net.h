@@ -0,0 +1,58 @@
+/*****************************************************************************
+ *   net.h:  Header file for the minimal ARP/IPv4/UDP stack
+ *
+******************************************************************************/
+#ifndef __NET_H
+#define __NET_H
+
+#include <stdint.h>
+
+/* IPv4 address in host order, NET_IP(192, 168, 1, 10) */
+#define NET_IP(a, b, c, d) (((uint32_t)(a) << 24) | ((uint32_t)(b) << 16) \
+        | ((uint32_t)(c) << 8) | (uint32_t)(d))
+
+#define NET_ARP_ENTRIES   4     /* ARP cache size */
+#define NET_UDP_PORTS     4     /* number of UDP ports that can be bound */
+
+#define NET_GROUPS        4     /* multicast groups that can be joined */
+
+/* largest UDP payload that fits in one frame */
+#define NET_UDP_MAX       1472
+
+/* fleet wide multicast groups */
+#define NET_GROUP_CONFIG  NET_IP(239, 255, 42, 1)   /* config push */
+#define NET_GROUP_TIME    NET_IP(239, 255, 42, 2)   /* time sync */
+#define NET_PORT_CONFIG   5006
+#define NET_PORT_TIME     5007
+
+/* data points into the receive buffer and is only valid during the call */
+typedef void (*net_udp_handler_t)(uint32_t srcIp, uint16_t srcPort,
+        const uint8_t *data, uint32_t len);
+
+typedef struct
+{
+    uint32_t rxFrames;      /* frames taken from the interface */
+    uint32_t rxIgnored;     /* other protocols, other hosts, unbound ports */
+    uint32_t rxErrors;      /* malformed frames, bad checksums, fragments */
+    uint32_t rxFiltered;    /* rejected by the MAC receive filter */
+    uint32_t rxHashMiss;    /* passed the hash filter, not a joined group */
+    uint32_t txFrames;      /* frames handed to the interface */
+    uint32_t txBusy;        /* no free TX buffer */
+    uint32_t arpMiss;       /* UDP sends dropped while resolving */
+} net_stats_t;
+
+
+void net_init(const uint8_t *mac, uint32_t ip, uint32_t mask, uint32_t gw,
+        uint32_t (*getMsTicks)(void));
+void net_poll(void);
+uint8_t net_udpBind(uint16_t port, net_udp_handler_t handler);
+uint8_t net_joinGroup(uint32_t group);
+void net_leaveGroup(uint32_t group);
+uint8_t *net_udpBegin(uint32_t dstIp, uint16_t dstPort, uint16_t srcPort);
+void net_udpSend(uint32_t len);
+void net_getStats(net_stats_t *st);
+
+#endif /* end __NET_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
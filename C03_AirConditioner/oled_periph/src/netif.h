@@ -0,0 +1,32 @@
+/*****************************************************************************
+ *   netif.h:  Header file for the Ethernet frame interface used by net.c
+ *
+******************************************************************************/
+#ifndef __NETIF_H
+#define __NETIF_H
+
+#include <stdint.h>
+
+/* largest frame net.c builds, Ethernet header included, CRC excluded */
+#define NETIF_MTU_FRAME   1514
+
+/*
+ * Frames are handed over in place: netif_rxFrame() returns the receive
+ * buffer itself and netif_txFrame() the buffer the next frame is sent
+ * from. The firmware implementation is netif_emac.c, tools/netsim.c has
+ * one for the host.
+ */
+
+uint8_t netif_init(const uint8_t *mac);
+uint8_t *netif_rxFrame(uint32_t *len);
+void netif_rxRelease(void);
+uint8_t *netif_txFrame(void);
+void netif_txSend(uint32_t len);
+void netif_setMulticast(const uint8_t *mac, uint8_t enable);
+void netif_setFilterAudit(uint8_t enable);
+uint32_t netif_getFiltered(void);
+
+#endif /* end __NETIF_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
@@ -0,0 +1,243 @@
+/*****************************************************************************
+ *   netif_emac.c:  Ethernet frame interface on the LPC17xx EMAC
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: RMII pins ENET_TXD0/1, TX_EN, CRS, RXD0/1, RX_ER, REF_CLK (P1.0,
+ * 1, 4, 8, 9, 10, 14, 15) and MDC/MDIO (P1.16, 17). The EMAC runs without
+ * interrupts; net_poll() looks at the descriptor indices.
+ *
+ * The receive filter passes frames for our station address, broadcasts
+ * (ARP) and multicasts whose address hashes to a bit set by
+ * netif_setMulticast(). Everything else is dropped by the MAC before it
+ * reaches memory, which also means the MAC can't count it. For a
+ * measurement, netif_setFilterAudit() lets the rejected frames through
+ * flagged as such; they are counted and released without being parsed.
+ *
+ * The descriptors and buffers belong to lpc17xx_emac.c and live in the
+ * AHB SRAM. Received frames are parsed where the DMA put them and frames
+ * to send are built directly in the TX buffer; nothing is copied here.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include "lpc17xx_emac.h"
+#include "lpc17xx_pinsel.h"
+#include "netif.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define ETH_FCS_LEN 4
+
+/* receive errors that make a frame unusable */
+#define RX_BAD (EMAC_RINFO_CRC_ERR | EMAC_RINFO_SYM_ERR | EMAC_RINFO_ALIGN_ERR \
+        | EMAC_RINFO_OVERRUN | EMAC_RINFO_NO_DESCR)
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static const uint8_t enetPins[] = { 0, 1, 4, 8, 9, 10, 14, 15, 16, 17 };
+
+static uint8_t audit = 0;
+static uint32_t filtered = 0;
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize the EMAC and the PHY. The PHY is auto-negotiated, which
+ *    takes a few seconds with a cable plugged in.
+ *
+ * Params:
+ *   [in] mac - station address, 6 bytes
+ *
+ * Returns:
+ *    1 if the EMAC is up, 0 if no PHY answered
+ *
+ *****************************************************************************/
+uint8_t netif_init(const uint8_t *mac)
+{
+    EMAC_CFG_Type emacCfg;
+    PINSEL_CFG_Type pinCfg;
+    uint8_t addr[6];
+    uint32_t i = 0;
+
+    pinCfg.Funcnum = 1;
+    pinCfg.OpenDrain = 0;
+    pinCfg.Pinmode = 0;
+    pinCfg.Portnum = 1;
+    for (i = 0; i < sizeof(enetPins); i++) {
+        pinCfg.Pinnum = enetPins[i];
+        PINSEL_ConfigPin(&pinCfg);
+    }
+
+    for (i = 0; i < 6; i++) {
+        addr[i] = mac[i];
+    }
+    emacCfg.Mode = EMAC_MODE_AUTO;
+    emacCfg.pbEMAC_Addr = addr;
+
+    if (EMAC_Init(&emacCfg) != SUCCESS) {
+        return 0;
+    }
+
+    /* EMAC_Init() accepts all multicasts, only take the joined groups */
+    LPC_EMAC->HashFilterL = 0;
+    LPC_EMAC->HashFilterH = 0;
+    EMAC_SetFilterMode(EMAC_RFC_MCAST_EN, DISABLE);
+    EMAC_SetFilterMode(EMAC_RFC_MCAST_HASH_EN, ENABLE);
+    audit = 0;
+    filtered = 0;
+
+    return 1;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the next received frame. Broken frames and frames that failed
+ *    the receive filter are released here and never show up.
+ *
+ * Params:
+ *   [out] len - frame length without CRC
+ *
+ * Returns:
+ *    Pointer to the frame in the receive buffer or NULL if there is none.
+ *    Valid until netif_rxRelease().
+ *
+ *****************************************************************************/
+uint8_t *netif_rxFrame(uint32_t *len)
+{
+    uint32_t size = 0;
+
+    while (EMAC_CheckReceiveIndex()) {
+        size = EMAC_GetReceiveDataSize() + 1;
+
+        if (EMAC_CheckReceiveDataStatus(EMAC_RINFO_FAIL_FILT) == SET) {
+            /* audit mode, or the head of a rejected frame */
+            filtered++;
+        }
+        else if (EMAC_CheckReceiveDataStatus(RX_BAD) == RESET
+                && EMAC_CheckReceiveDataStatus(EMAC_RINFO_LAST_FLAG) == SET
+                && size > ETH_FCS_LEN) {
+            *len = size - ETH_FCS_LEN;
+            return EMAC_GetRxPacketBuffer();
+        }
+        EMAC_UpdateRxConsumeIndex();
+    }
+
+    return NULL;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Give the frame returned by netif_rxFrame() back to the EMAC
+ *
+ *****************************************************************************/
+void netif_rxRelease(void)
+{
+    EMAC_UpdateRxConsumeIndex();
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the TX buffer the next frame is built in
+ *
+ * Returns:
+ *    Pointer to the buffer or NULL if all TX descriptors are in use
+ *
+ *****************************************************************************/
+uint8_t *netif_txFrame(void)
+{
+    if (!EMAC_CheckTransmitIndex()) {
+        return NULL;
+    }
+    return EMAC_GetTxPacketBuffer();
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Send the frame built in the buffer from netif_txFrame(). Short frames
+ *    are padded by the MAC.
+ *
+ * Params:
+ *   [in] len - frame length without CRC
+ *
+ *****************************************************************************/
+void netif_txSend(uint32_t len)
+{
+    EMAC_SetTxPacketSize(len);
+    EMAC_UpdateTxProduceIndex();
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Accept or stop accepting a multicast address. The hash filter is
+ *    imperfect: addresses sharing a hash bit pass too, and disabling one
+ *    clears the bit for all of them.
+ *
+ * Params:
+ *   [in] mac - multicast address, 6 bytes
+ *   [in] enable - 1 to accept, 0 to drop
+ *
+ *****************************************************************************/
+void netif_setMulticast(const uint8_t *mac, uint8_t enable)
+{
+    uint8_t addr[6];
+    uint32_t i = 0;
+
+    for (i = 0; i < 6; i++) {
+        addr[i] = mac[i];
+    }
+    EMAC_SetHashFilter(addr, enable ? ENABLE : DISABLE);
+
+    /* EMAC_SetHashFilter() turns the pass-all mode off */
+    netif_setFilterAudit(audit);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Let frames that fail the receive filter through to be counted.
+ *    This costs CPU time like a promiscuous interface, use it only to
+ *    measure how much traffic the filter keeps away.
+ *
+ * Params:
+ *   [in] enable - 1 to count rejected frames, 0 for normal operation
+ *
+ *****************************************************************************/
+void netif_setFilterAudit(uint8_t enable)
+{
+    audit = enable;
+    if (enable) {
+        LPC_EMAC->Command |= EMAC_CR_PASS_RX_FILT;
+    }
+    else {
+        LPC_EMAC->Command &= ~EMAC_CR_PASS_RX_FILT;
+    }
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the number of frames that failed the receive filter. Outside
+ *    audit mode the MAC drops these silently and the count stays low.
+ *
+ *****************************************************************************/
+uint32_t netif_getFiltered(void)
+{
+    return filtered;
+}
@@ -0,0 +1,181 @@
+/*****************************************************************************
+ *   pid.c:  Fixed-point PID controller
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: The controller is reverse acting (cooling): a measurement above the
+ * setpoint drives the output up. pid_update() must be called at a fixed rate
+ * since the integral and derivative gains are expressed per update.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include "pid.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define CLAMP(v, lo, hi) ((v) < (lo) ? (lo) : ((v) > (hi) ? (hi) : (v)))
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize a controller. Gains, setpoint, deadband and slew rate are
+ *    cleared and must be configured before the first update.
+ *
+ * Params:
+ *   [in] pid - controller instance
+ *   [in] outMin - lowest output value
+ *   [in] outMax - highest output value
+ *
+ *****************************************************************************/
+void pid_init(pid_ctrl_t *pid, int32_t outMin, int32_t outMax)
+{
+    pid->kp = 0;
+    pid->ki = 0;
+    pid->kd = 0;
+    pid->setpoint = 0;
+    pid->deadband = 0;
+    pid->outMin = outMin;
+    pid->outMax = outMax;
+    pid->slewMax = 0;
+    pid->integ = (int32_t)outMin << PID_Q;
+    pid->prevMeas = 0;
+    pid->out = outMin;
+    pid->primed = 0;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Change the controller gains
+ *
+ * Params:
+ *   [in] pid - controller instance
+ *   [in] kp - proportional gain, Q8
+ *   [in] ki - integral gain per update, Q8
+ *   [in] kd - derivative gain per update, Q8
+ *
+ *****************************************************************************/
+void pid_setGains(pid_ctrl_t *pid, int32_t kp, int32_t ki, int32_t kd)
+{
+    pid->kp = kp;
+    pid->ki = ki;
+    pid->kd = kd;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Change the setpoint
+ *
+ * Params:
+ *   [in] pid - controller instance
+ *   [in] setpoint - new setpoint, same unit as the measurement
+ *
+ *****************************************************************************/
+void pid_setSetpoint(pid_ctrl_t *pid, int32_t setpoint)
+{
+    pid->setpoint = setpoint;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Change the deadband around the setpoint in which the error is
+ *    ignored. Keeps the output from hunting on sensor noise.
+ *
+ * Params:
+ *   [in] pid - controller instance
+ *   [in] deadband - half width of the band, same unit as the measurement
+ *
+ *****************************************************************************/
+void pid_setDeadband(pid_ctrl_t *pid, int32_t deadband)
+{
+    pid->deadband = deadband;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Limit how much the output may change in one update
+ *
+ * Params:
+ *   [in] pid - controller instance
+ *   [in] slewMax - max change per update, 0 disables the limit
+ *
+ *****************************************************************************/
+void pid_setSlewRate(pid_ctrl_t *pid, int32_t slewMax)
+{
+    pid->slewMax = slewMax;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Run one controller step
+ *
+ * Params:
+ *   [in] pid - controller instance
+ *   [in] measured - current process value
+ *
+ * Returns:
+ *    New output, within [outMin, outMax]
+ *
+ *****************************************************************************/
+int32_t pid_update(pid_ctrl_t *pid, int32_t measured)
+{
+    int32_t err = measured - pid->setpoint;
+    int32_t pTerm = 0;
+    int32_t dTerm = 0;
+    int32_t integ = 0;
+    int32_t out = 0;
+
+    if (!pid->primed) {
+        pid->prevMeas = measured;
+        pid->primed = 1;
+    }
+
+    if (err <= pid->deadband && err >= -pid->deadband) {
+        err = 0;
+    }
+
+    pTerm = pid->kp * err;
+
+    /* derivative on measurement avoids a kick on setpoint changes */
+    dTerm = pid->kd * (measured - pid->prevMeas);
+    pid->prevMeas = measured;
+
+    /*
+     * Anti-windup: only integrate when it doesn't push an already
+     * saturated output further, and keep the integrator in output range.
+     */
+    integ = pid->integ + pid->ki * err;
+    integ = CLAMP(integ, (pid->outMin << PID_Q), (pid->outMax << PID_Q));
+
+    out = (pTerm + integ + dTerm) >> PID_Q;
+
+    if ((out > pid->outMax && err > 0) || (out < pid->outMin && err < 0)) {
+        integ = pid->integ;
+        out = (pTerm + integ + dTerm) >> PID_Q;
+    }
+    pid->integ = integ;
+
+    out = CLAMP(out, pid->outMin, pid->outMax);
+
+    if (pid->slewMax > 0) {
+        out = CLAMP(out, pid->out - pid->slewMax, pid->out + pid->slewMax);
+    }
+
+    pid->out = out;
+
+    return out;
+}
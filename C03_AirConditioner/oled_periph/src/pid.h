@@ -0,0 +1,44 @@
+/*****************************************************************************
+ *   pid.h:  Header file for the fixed-point PID controller
+ *
+******************************************************************************/
+#ifndef __PID_H
+#define __PID_H
+
+#include <stdint.h>
+
+/*
+ * Gains are fixed-point with PID_Q fractional bits, i.e. a gain of
+ * PID_GAIN(1.5) multiplies the error by 1.5.
+ */
+#define PID_Q 8
+#define PID_GAIN(g) ((int32_t)((g) * (1 << PID_Q)))
+
+typedef struct
+{
+    int32_t kp;          /* proportional gain, Q8 */
+    int32_t ki;          /* integral gain per update, Q8 */
+    int32_t kd;          /* derivative gain per update, Q8 */
+    int32_t setpoint;    /* same unit as the measurement */
+    int32_t deadband;    /* |error| <= deadband is treated as zero */
+    int32_t outMin;
+    int32_t outMax;
+    int32_t slewMax;     /* max output change per update, 0 = unlimited */
+    int32_t integ;       /* integrator state, output unit in Q8 */
+    int32_t prevMeas;
+    int32_t out;
+    uint8_t primed;
+} pid_ctrl_t;
+
+
+void pid_init(pid_ctrl_t *pid, int32_t outMin, int32_t outMax);
+void pid_setGains(pid_ctrl_t *pid, int32_t kp, int32_t ki, int32_t kd);
+void pid_setSetpoint(pid_ctrl_t *pid, int32_t setpoint);
+void pid_setDeadband(pid_ctrl_t *pid, int32_t deadband);
+void pid_setSlewRate(pid_ctrl_t *pid, int32_t slewMax);
+int32_t pid_update(pid_ctrl_t *pid, int32_t measured);
+
+#endif /* end __PID_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
@@ -0,0 +1,427 @@
+/*****************************************************************************
+ *   pwm_out.c:  PWM1 channel manager with latched, ramped duty updates
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: Duties are staged with pwm_out_setDuty() and applied together by
+ * pwm_out_commit(). All match registers are written from the match 0
+ * interrupt, at the start of a period, with a single PWM_MultiMatchUpdate()
+ * (one LER write, PWM_MATCH_UPDATE_NEXT_RST), so channels that change
+ * together switch on the same period boundary. The match 0 interrupt is only
+ * enabled while there is something to write.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include "lpc17xx_pwm.h"
+#include "lpc17xx_pinsel.h"
+#include "lpc17xx_trace.h"
+#include "pwm_out.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define PWM_DEV LPC_PWM1
+
+/* 25 MHz PCLK / 25 = 1 MHz counter, i.e. 1 us per count */
+#define PWM_PRESCALE 25
+
+#define CH_VALID(ch) ((ch) >= 1 && (ch) <= PWM_OUT_NUM_CHANNELS)
+
+typedef struct
+{
+    uint8_t open;
+    uint8_t edge;
+    uint8_t offsetDirty;
+    uint32_t offset;        /* rising edge in double edge mode */
+    uint32_t staged;        /* set by pwm_out_setDuty(), not yet committed */
+    uint32_t target;        /* committed value the ramp is heading to */
+    uint32_t current;       /* value latched into the match register */
+    uint32_t step;          /* change per period while ramping */
+} channel_t;
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+/* PWM1.1..6 alternatives on port 1, function 2 */
+static const uint8_t p1Pins[PWM_OUT_NUM_CHANNELS] = {18, 20, 21, 23, 24, 26};
+
+static volatile channel_t channels[PWM_OUT_NUM_CHANNELS + 1];
+static uint8_t mrUsed = 0;          /* bit n set: MRn owned by a channel */
+static uint32_t rampPeriods = 0;
+static uint32_t maxDuty = 0;
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static void setMatch0Int(FunctionalState state)
+{
+    PWM_MATCHCFG_Type matchCfg;
+
+    matchCfg.MatchChannel = 0;
+    matchCfg.IntOnMatch = state;
+    matchCfg.StopOnMatch = DISABLE;
+    matchCfg.ResetOnMatch = ENABLE;
+    PWM_ConfigMatch(PWM_DEV, &matchCfg);
+}
+
+static uint8_t mrMask(uint8_t ch, pwm_out_edge_t edge)
+{
+    if (edge == PWM_OUT_DOUBLE_EDGE) {
+        return (uint8_t)((1 << ch) | (1 << (ch - 1)));
+    }
+    return (uint8_t)(1 << ch);
+}
+
+static void setMatch(PWM_Match_T *match, uint8_t ch, uint32_t duty,
+        uint32_t offset, uint8_t edge)
+{
+    if (edge == PWM_OUT_DOUBLE_EDGE) {
+        if (offset + duty > maxDuty) {
+            duty = maxDuty - offset;
+        }
+        match[ch - 1].Matchvalue = offset;
+        match[ch - 1].Status = SET;
+        match[ch].Matchvalue = offset + duty;
+    }
+    else {
+        match[ch].Matchvalue = duty;
+    }
+    match[ch].Status = SET;
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize PWM1 with all channels closed
+ *
+ * Params:
+ *   [in] period - PWM period in microseconds (match 0 value)
+ *
+ *****************************************************************************/
+void pwm_out_init(uint32_t period)
+{
+    PWM_TIMERCFG_Type timerCfg;
+    uint8_t ch = 0;
+
+    timerCfg.PrescaleOption = PWM_TIMER_PRESCALE_TICKVAL;
+    timerCfg.PrescaleValue = PWM_PRESCALE;
+    PWM_Init(PWM_DEV, PWM_MODE_TIMER, &timerCfg);
+
+    maxDuty = period;
+    mrUsed = 0;
+    for (ch = 1; ch <= PWM_OUT_NUM_CHANNELS; ch++) {
+        channels[ch].open = 0;
+    }
+
+    PWM_MatchUpdate(PWM_DEV, 0, period, PWM_MATCH_UPDATE_NOW);
+    setMatch0Int(DISABLE);
+
+    PWM_ResetCounter(PWM_DEV);
+    PWM_CounterCmd(PWM_DEV, ENABLE);
+    PWM_Cmd(PWM_DEV, ENABLE);
+
+    NVIC_EnableIRQ(PWM1_IRQn);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Allocate and enable a PWM channel. The output starts at 0% duty.
+ *
+ * Params:
+ *   [in] ch - channel 1..6
+ *   [in] edge - single or double edge mode. Double edge mode also uses
+ *               match register ch-1 and is not available on channel 1.
+ *   [in] pin - pin alternative for the channel output
+ *
+ * Returns:
+ *    0 on success, -1 if the channel is invalid or its match registers
+ *    are already in use
+ *
+ *****************************************************************************/
+int pwm_out_open(uint8_t ch, pwm_out_edge_t edge, pwm_out_pin_t pin)
+{
+    PINSEL_CFG_Type pinCfg;
+    PWM_MATCHCFG_Type matchCfg;
+    uint8_t mask = 0;
+
+    if (!CH_VALID(ch) || (edge == PWM_OUT_DOUBLE_EDGE && ch == 1)) {
+        return -1;
+    }
+
+    mask = mrMask(ch, edge);
+    if (mrUsed & mask) {
+        return -1;
+    }
+    mrUsed |= mask;
+
+    pinCfg.OpenDrain = 0;
+    pinCfg.Pinmode = 0;
+    if (pin == PWM_OUT_PIN_P1) {
+        pinCfg.Funcnum = 2;
+        pinCfg.Portnum = 1;
+        pinCfg.Pinnum = p1Pins[ch - 1];
+    }
+    else {
+        pinCfg.Funcnum = 1;
+        pinCfg.Portnum = 2;
+        pinCfg.Pinnum = ch - 1;
+    }
+    PINSEL_ConfigPin(&pinCfg);
+
+    if (ch >= 2) {
+        PWM_ChannelConfig(PWM_DEV, ch, (edge == PWM_OUT_DOUBLE_EDGE)
+                ? PWM_CHANNEL_DUAL_EDGE : PWM_CHANNEL_SINGLE_EDGE);
+    }
+
+    matchCfg.MatchChannel = ch;
+    matchCfg.IntOnMatch = DISABLE;
+    matchCfg.StopOnMatch = DISABLE;
+    matchCfg.ResetOnMatch = DISABLE;
+    PWM_ConfigMatch(PWM_DEV, &matchCfg);
+
+    channels[ch].edge = edge;
+    channels[ch].offset = 0;
+    channels[ch].offsetDirty = 0;
+    channels[ch].staged = 0;
+    channels[ch].target = 0;
+    channels[ch].current = 0;
+    channels[ch].step = 0;
+
+    if (edge == PWM_OUT_DOUBLE_EDGE) {
+        PWM_MatchUpdate(PWM_DEV, ch - 1, 0, PWM_MATCH_UPDATE_NEXT_RST);
+    }
+    PWM_MatchUpdate(PWM_DEV, ch, 0, PWM_MATCH_UPDATE_NEXT_RST);
+
+    channels[ch].open = 1;
+    PWM_ChannelCmd(PWM_DEV, ch, ENABLE);
+
+    return 0;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Disable a PWM channel and release its match registers
+ *
+ * Params:
+ *   [in] ch - channel 1..6
+ *
+ *****************************************************************************/
+void pwm_out_close(uint8_t ch)
+{
+    if (!CH_VALID(ch) || !channels[ch].open) {
+        return;
+    }
+
+    PWM_ChannelCmd(PWM_DEV, ch, DISABLE);
+    channels[ch].open = 0;
+    mrUsed &= ~mrMask(ch, (pwm_out_edge_t)channels[ch].edge);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Set over how many PWM periods a duty change is spread
+ *
+ * Params:
+ *   [in] periods - ramp length, 0 or 1 applies changes at the next period
+ *
+ *****************************************************************************/
+void pwm_out_setRamp(uint32_t periods)
+{
+    rampPeriods = periods;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Stage a new duty for a channel. Takes effect on pwm_out_commit().
+ *
+ * Params:
+ *   [in] ch - channel 1..6
+ *   [in] duty - new duty, 0..period
+ *
+ *****************************************************************************/
+void pwm_out_setDuty(uint8_t ch, uint32_t duty)
+{
+    if (!CH_VALID(ch)) {
+        return;
+    }
+
+    channels[ch].staged = (duty > maxDuty) ? maxDuty : duty;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Stage the rising edge position of a double edge channel. Takes effect
+ *    on pwm_out_commit(). Ignored for single edge channels.
+ *
+ * Params:
+ *   [in] ch - channel 2..6
+ *   [in] offset - rising edge, 0..period
+ *
+ *****************************************************************************/
+void pwm_out_setOffset(uint8_t ch, uint32_t offset)
+{
+    if (!CH_VALID(ch) || channels[ch].edge != PWM_OUT_DOUBLE_EDGE) {
+        return;
+    }
+
+    channels[ch].offset = (offset > maxDuty) ? maxDuty : offset;
+    channels[ch].offsetDirty = 1;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Apply all staged duties. Channels whose duty is unchanged are left
+ *    alone; the others ramp from the next period on, in lockstep.
+ *
+ *****************************************************************************/
+void pwm_out_commit(void)
+{
+    volatile channel_t *c = NULL;
+    uint32_t diff = 0;
+    uint32_t primask = 0;
+    uint8_t pending = 0;
+    uint8_t ch = 0;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    for (ch = 1; ch <= PWM_OUT_NUM_CHANNELS; ch++) {
+        c = &channels[ch];
+        if (!c->open) {
+            continue;
+        }
+
+        if (c->staged != c->target) {
+            c->target = c->staged;
+            diff = (c->target > c->current)
+                    ? c->target - c->current : c->current - c->target;
+
+            c->step = (rampPeriods > 1)
+                    ? (diff + rampPeriods - 1) / rampPeriods : diff;
+        }
+
+        if (c->target != c->current || c->offsetDirty) {
+            pending = 1;
+        }
+    }
+
+    if (pending) {
+        setMatch0Int(ENABLE);
+    }
+
+    __set_PRIMASK(primask);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the duty currently latched into a channel's match register
+ *
+ *****************************************************************************/
+uint32_t pwm_out_getDuty(uint8_t ch)
+{
+    return CH_VALID(ch) ? channels[ch].current : 0;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the committed duty a channel is ramping towards
+ *
+ *****************************************************************************/
+uint32_t pwm_out_getTarget(uint8_t ch)
+{
+    return CH_VALID(ch) ? channels[ch].target : 0;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the PWM period, i.e. the duty that means 100%
+ *
+ *****************************************************************************/
+uint32_t pwm_out_getPeriod(void)
+{
+    return maxDuty;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    PWM1 interrupt handler. Steps every ramping channel once per period
+ *    and latches all new values with one LER write for the next reset.
+ *
+ *****************************************************************************/
+void PWM1_IRQHandler(void)
+{
+    PWM_Match_T match[PWM_OUT_NUM_CHANNELS + 1];
+    volatile channel_t *c = NULL;
+    uint32_t next = 0;
+    uint8_t ramping = 0;
+    uint8_t update = 0;
+    uint8_t ch = 0;
+    TRACE_ISR_ENTER(TRACE_ISR_PWM1);
+
+    if (PWM_GetIntStatus(PWM_DEV, PWM_INTSTAT_MR0) != SET) {
+        TRACE_ISR_EXIT(TRACE_ISR_PWM1);
+        return;
+    }
+    PWM_ClearIntPending(PWM_DEV, PWM_INTSTAT_MR0);
+
+    for (ch = 0; ch <= PWM_OUT_NUM_CHANNELS; ch++) {
+        match[ch].Status = RESET;
+    }
+
+    for (ch = 1; ch <= PWM_OUT_NUM_CHANNELS; ch++) {
+        c = &channels[ch];
+        if (!c->open) {
+            continue;
+        }
+
+        if (c->current < c->target) {
+            next = (c->target - c->current > c->step)
+                    ? c->current + c->step : c->target;
+        }
+        else {
+            next = (c->current - c->target > c->step)
+                    ? c->current - c->step : c->target;
+        }
+
+        if (next != c->current || c->offsetDirty) {
+            setMatch(match, ch, next, c->offset, c->edge);
+            c->current = next;
+            c->offsetDirty = 0;
+            update = 1;
+        }
+
+        if (c->current != c->target) {
+            ramping = 1;
+        }
+    }
+
+    if (update) {
+        PWM_MultiMatchUpdate(PWM_DEV, match, PWM_MATCH_UPDATE_NEXT_RST);
+    }
+
+    if (!ramping) {
+        setMatch0Int(DISABLE);
+    }
+    TRACE_ISR_EXIT(TRACE_ISR_PWM1);
+}
@@ -0,0 +1,39 @@
+/*****************************************************************************
+ *   pwm_out.h:  Header file for the PWM1 output driver
+ *
+******************************************************************************/
+#ifndef __PWM_OUT_H
+#define __PWM_OUT_H
+
+#include <stdint.h>
+
+#define PWM_OUT_NUM_CHANNELS 6
+
+typedef enum
+{
+    PWM_OUT_SINGLE_EDGE,    /* rises at period start, falls at MRn */
+    PWM_OUT_DOUBLE_EDGE     /* rises at MR(n-1), falls at MRn, channel 2..6 */
+} pwm_out_edge_t;
+
+typedef enum
+{
+    PWM_OUT_PIN_P2,         /* PWM1.n on P2.(n-1) */
+    PWM_OUT_PIN_P1          /* PWM1.n on P1.18/20/21/23/24/26 */
+} pwm_out_pin_t;
+
+
+void pwm_out_init(uint32_t period);
+int pwm_out_open(uint8_t ch, pwm_out_edge_t edge, pwm_out_pin_t pin);
+void pwm_out_close(uint8_t ch);
+void pwm_out_setRamp(uint32_t periods);
+void pwm_out_setDuty(uint8_t ch, uint32_t duty);
+void pwm_out_setOffset(uint8_t ch, uint32_t offset);
+void pwm_out_commit(void);
+uint32_t pwm_out_getDuty(uint8_t ch);
+uint32_t pwm_out_getTarget(uint8_t ch);
+uint32_t pwm_out_getPeriod(void);
+
+#endif /* end __PWM_OUT_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
@@ -0,0 +1,304 @@
+/*****************************************************************************
+ *   rtclock.c:  64 bit timestamps from the RTC and a microsecond timer
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: Timestamps are microseconds since 1970-01-01 00:00 UTC as a
+ * uint64_t, so unlike msTicks they don't wrap. The RTC runs from the
+ * 32 kHz oscillator and the backup battery and keeps the seconds; its
+ * sub-second prescaler can't be read, so TIMER1 runs freely at 1 MHz and
+ * the RTC counter increment interrupt latches TIMER1 at each new second.
+ * A timestamp is the latched second plus the microseconds since the latch.
+ *
+ * The latch is taken in the interrupt, so the sub-second part is late by
+ * the interrupt latency (a few us). Between two rtclock_setTime() calls
+ * rtclock_now() never returns less than it returned before; setting the
+ * clock starts over from the new time, also when that is earlier.
+ *
+ * The RTC is left running over a reset; it is only initialized when its
+ * clock is off, e.g. after the backup battery was removed, or when it
+ * holds no valid date. It then starts at 1970-01-01, which counts as not
+ * set (rtclock_isSet()).
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include "lpc17xx_rtc.h"
+#include "lpc17xx_timer.h"
+#include "lpc17xx_clkpwr.h"
+#include "lpc17xx_trace.h"
+#include "rtclock.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define TIMER_DEV LPC_TIM1
+
+#define SECS_PER_DAY 86400UL
+
+/* consolidated time registers, read in one access each */
+#define CTIME0_SEC(v)   ((v) & 0x3F)
+#define CTIME0_MIN(v)   (((v) >> 8) & 0x3F)
+#define CTIME0_HOUR(v)  (((v) >> 16) & 0x1F)
+#define CTIME1_DOM(v)   ((v) & 0x1F)
+#define CTIME1_MONTH(v) (((v) >> 8) & 0x0F)
+#define CTIME1_YEAR(v)  (((v) >> 16) & 0xFFF)
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+/* written by the RTC interrupt, seq changes on every update */
+static volatile uint32_t latchSec = 0;
+static volatile uint32_t latchTicks = 0;
+static volatile uint32_t latchSeq = 0;
+
+static uint64_t lastStamp = 0;
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+/*
+ * Days since 1970-01-01 of a date in the proleptic Gregorian calendar
+ */
+static uint32_t daysFromCivil(uint32_t y, uint32_t m, uint32_t d)
+{
+    uint32_t era = 0;
+    uint32_t yoe = 0;
+    uint32_t doy = 0;
+
+    if (m <= 2) {
+        y--;
+    }
+    era = y / 400;
+    yoe = y - era * 400;
+    doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+
+    return era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+}
+
+static void civilFromDays(uint32_t days, uint32_t *y, uint32_t *m,
+        uint32_t *d)
+{
+    uint32_t z = days + 719468;
+    uint32_t era = z / 146097;
+    uint32_t doe = z - era * 146097;
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+
+    *d = doy - (153 * mp + 2) / 5 + 1;
+    *m = (mp < 10) ? mp + 3 : mp - 9;
+    *y = yoe + era * 400 + (*m <= 2);
+}
+
+/* check the date fields of CTIME1, they are random after a power loss */
+static uint8_t validDate(uint32_t t1)
+{
+    return (CTIME1_MONTH(t1) >= 1 && CTIME1_MONTH(t1) <= 12
+            && CTIME1_DOM(t1) >= 1 && CTIME1_YEAR(t1) >= 1970);
+}
+
+/*
+ * Seconds since 1970 from the RTC, 0 if it holds no valid date. Must not
+ * run across a second boundary, i.e. call it from the increment interrupt.
+ */
+static uint32_t readRtc(void)
+{
+    uint32_t t0 = LPC_RTC->CTIME0;
+    uint32_t t1 = LPC_RTC->CTIME1;
+
+    if (!validDate(t1)) {
+        return 0;
+    }
+
+    return daysFromCivil(CTIME1_YEAR(t1), CTIME1_MONTH(t1), CTIME1_DOM(t1))
+            * SECS_PER_DAY + CTIME0_HOUR(t0) * 3600 + CTIME0_MIN(t0) * 60
+            + CTIME0_SEC(t0);
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize the timestamp service. The RTC keeps its time if it was
+ *    running and holds a valid date, otherwise it starts at 1970-01-01.
+ *
+ *****************************************************************************/
+void rtclock_init(void)
+{
+    TIM_TIMERCFG_Type timCfg;
+
+    CLKPWR_ConfigPPWR(CLKPWR_PCONP_PCRTC, ENABLE);
+    if (!(LPC_RTC->CCR & RTC_CCR_CLKEN)) {
+        RTC_Init(LPC_RTC);
+        RTC_ResetClockTickCounter(LPC_RTC);
+        RTC_Cmd(LPC_RTC, ENABLE);
+    }
+
+    timCfg.PrescaleOption = TIM_PRESCALE_USVAL;
+    timCfg.PrescaleValue = 1;
+    TIM_Init(TIMER_DEV, TIM_TIMER_MODE, &timCfg);
+    TIM_Cmd(TIMER_DEV, ENABLE);
+
+    if (!validDate(LPC_RTC->CTIME1)) {
+        /* also takes the first latch */
+        rtclock_setTime(0);
+    }
+    else {
+        /* the first latch, until the next second starts */
+        NVIC_DisableIRQ(RTC_IRQn);
+        latchTicks = TIMER_DEV->TC;
+        latchSec = readRtc();
+        latchSeq++;
+        RTC_ClearIntPending(LPC_RTC, RTC_INT_COUNTER_INCREASE);
+    }
+
+    RTC_CntIncrIntConfig(LPC_RTC, RTC_TIMETYPE_SECOND, ENABLE);
+    NVIC_SetPriority(RTC_IRQn, 0);
+    NVIC_EnableIRQ(RTC_IRQn);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the current time. Safe to call from interrupt handlers.
+ *
+ * Returns:
+ *    Microseconds since 1970, never less than the previous result
+ *
+ *****************************************************************************/
+uint64_t rtclock_now(void)
+{
+    uint32_t seq = 0;
+    uint32_t sec = 0;
+    uint32_t us = 0;
+    uint32_t primask = 0;
+    uint64_t t = 0;
+
+    do {
+        seq = latchSeq;
+        sec = latchSec;
+        us = TIMER_DEV->TC - latchTicks;
+    } while (seq != latchSeq);
+
+    /* the interrupt for the next second is still pending */
+    if (us >= RTCLOCK_US_PER_SEC) {
+        us = RTCLOCK_US_PER_SEC - 1;
+    }
+    t = (uint64_t)sec * RTCLOCK_US_PER_SEC + us;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if (t < lastStamp) {
+        t = lastStamp;
+    }
+    lastStamp = t;
+    __set_PRIMASK(primask);
+
+    return t;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the current time in whole seconds
+ *
+ * Returns:
+ *    Seconds since 1970
+ *
+ *****************************************************************************/
+uint32_t rtclock_getSeconds(void)
+{
+    return (uint32_t)(rtclock_now() / RTCLOCK_US_PER_SEC);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Set the RTC. The new second starts now, and timestamps continue
+ *    from the new time even if it is earlier than the last one.
+ *
+ * Params:
+ *   [in] sec - seconds since 1970
+ *
+ *****************************************************************************/
+void rtclock_setTime(uint32_t sec)
+{
+    RTC_TIME_Type t;
+    uint32_t primask = 0;
+    uint32_t days = sec / SECS_PER_DAY;
+    uint32_t rem = sec % SECS_PER_DAY;
+    uint32_t y = 0, m = 0, d = 0;
+
+    civilFromDays(days, &y, &m, &d);
+    t.SEC = rem % 60;
+    t.MIN = (rem / 60) % 60;
+    t.HOUR = rem / 3600;
+    t.DOM = d;
+    t.MONTH = m;
+    t.YEAR = y;
+    t.DOW = (days + 4) % 7;     /* 1970-01-01 was a Thursday */
+    t.DOY = days - daysFromCivil(y, 1, 1) + 1;
+
+    NVIC_DisableIRQ(RTC_IRQn);
+    RTC_Cmd(LPC_RTC, DISABLE);
+    RTC_ResetClockTickCounter(LPC_RTC);
+    RTC_SetFullTime(LPC_RTC, &t);
+    RTC_Cmd(LPC_RTC, ENABLE);
+    latchTicks = TIMER_DEV->TC;
+    latchSec = sec;
+    latchSeq++;
+    RTC_ClearIntPending(LPC_RTC, RTC_INT_COUNTER_INCREASE);
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    lastStamp = (uint64_t)sec * RTCLOCK_US_PER_SEC;
+    __set_PRIMASK(primask);
+
+    NVIC_EnableIRQ(RTC_IRQn);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Check if the RTC holds a real date, i.e. it was set since the backup
+ *    battery was last removed
+ *
+ *****************************************************************************/
+uint8_t rtclock_isSet(void)
+{
+    return (latchSec >= daysFromCivil(RTCLOCK_MIN_YEAR, 1, 1) * SECS_PER_DAY);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    RTC interrupt handler. A new second has started; latch the
+ *    microsecond timer.
+ *
+ *****************************************************************************/
+void RTC_IRQHandler(void)
+{
+    uint32_t ticks = TIMER_DEV->TC;
+    TRACE_ISR_ENTER(TRACE_ISR_RTC);
+
+    if (RTC_GetIntPending(LPC_RTC, RTC_INT_COUNTER_INCREASE) == SET) {
+        latchTicks = ticks;
+        latchSec = readRtc();
+        latchSeq++;
+        RTC_ClearIntPending(LPC_RTC, RTC_INT_COUNTER_INCREASE);
+    }
+    if (RTC_GetIntPending(LPC_RTC, RTC_INT_ALARM) == SET) {
+        RTC_ClearIntPending(LPC_RTC, RTC_INT_ALARM);
+    }
+    TRACE_ISR_EXIT(TRACE_ISR_RTC);
+}
@@ -0,0 +1,25 @@
+/*****************************************************************************
+ *   rtclock.h:  Header file for the RTC based timestamp service
+ *
+******************************************************************************/
+#ifndef __RTCLOCK_H
+#define __RTCLOCK_H
+
+#include <stdint.h>
+
+/* the RTC is taken as set once it holds a year from here on */
+#define RTCLOCK_MIN_YEAR  2020
+
+#define RTCLOCK_US_PER_SEC 1000000
+
+
+void rtclock_init(void);
+uint64_t rtclock_now(void);
+uint32_t rtclock_getSeconds(void);
+void rtclock_setTime(uint32_t sec);
+uint8_t rtclock_isSet(void);
+
+#endif /* end __RTCLOCK_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
@@ -0,0 +1,265 @@
+/*****************************************************************************
+ *   sensrec.c:  Sensor trace recorder in dataflash
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: Records what the main loop read from the sensors, so a day of
+ * readings can be replayed on the host (host/src/replay.c, and fwsim -r)
+ * against another build of the controller. Records are 16 bytes, little
+ * endian:
+ *
+ *   uptime(32)          ms since boot
+ *   temp(16)            10 x T(C), SENSREC_NO_TEMP on a failed read
+ *   lux(16)
+ *   accX(8) accY(8) accZ(8)
+ *   flags(8)            SENSREC_ACC_VALID
+ *   duty(16)            controller output
+ *   setpoint(16)        10 x T(C)
+ *
+ * A recording starts at SENSREC_FIRST_PAGE and ends when it is stopped or
+ * the area is full; it does not wrap. The page being filled is kept in RAM
+ * and programmed once it is full, so a page is programmed every 16
+ * records. sensrec_stop() programs the last page padded with erased
+ * records, or an erased page after a full one, so a trace always ends with
+ * an erased record (uptime 0xFFFFFFFF). The trace is read out with the
+ * log dump: "dump" with the offset and length "rec" prints.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+#include "flash.h"
+#include "sensrec.h"
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static uint8_t page[SENSREC_PAGE_BYTES];
+static uint8_t recording = 0;
+static uint32_t count = 0;              /* records in the trace */
+static uint32_t every = 1;              /* record every n-th call */
+static uint32_t calls = 0;
+static uint32_t lost = 0;               /* records of failed page programs */
+static uint16_t flashPageSize = 0;
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static uint32_t pageOffset(uint32_t index)
+{
+    return (SENSREC_FIRST_PAGE + index / SENSREC_RECORDS_PER_PAGE)
+            * flashPageSize;
+}
+
+static void writePage(uint32_t index, uint32_t records)
+{
+    if (flash_write(page, pageOffset(index), SENSREC_PAGE_BYTES)
+            != SENSREC_PAGE_BYTES) {
+        lost += records;
+    }
+    memset(page, 0xFF, SENSREC_PAGE_BYTES);
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize the recorder, not recording. The dataflash (flash_init())
+ *    must be initialized.
+ *
+ *****************************************************************************/
+void sensrec_init(void)
+{
+    flashPageSize = flash_getPageSize();
+    recording = 0;
+    count = 0;
+    lost = 0;
+    memset(page, 0xFF, SENSREC_PAGE_BYTES);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Start a new recording, replacing the last one
+ *
+ * Params:
+ *   [in] n - record every n-th sensrec_add(), at least 1
+ *
+ * Returns:
+ *    1 if started, 0 if already recording
+ *
+ *****************************************************************************/
+uint8_t sensrec_start(uint32_t n)
+{
+    if (recording) {
+        return 0;
+    }
+
+    every = (n > 0) ? n : 1;
+    calls = 0;
+    count = 0;
+    lost = 0;
+    memset(page, 0xFF, SENSREC_PAGE_BYTES);
+    recording = 1;
+    return 1;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Stop recording and terminate the trace in the dataflash
+ *
+ *****************************************************************************/
+void sensrec_stop(void)
+{
+    if (!recording) {
+        return;
+    }
+
+    recording = 0;
+    if ((count % SENSREC_RECORDS_PER_PAGE) != 0
+            || count < SENSREC_CAPACITY) {
+        /* the partial page, or an erased one after the last full page */
+        writePage(count, count % SENSREC_RECORDS_PER_PAGE);
+    }
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Add a record to the trace. Only every n-th call, as given to
+ *    sensrec_start(), records. Programs a dataflash page every 16
+ *    records, so call from the main loop, not from interrupts.
+ *
+ * Params:
+ *   [in] rec - the record
+ *
+ *****************************************************************************/
+void sensrec_add(const sensrec_record_t *rec)
+{
+    if (!recording || (calls++ % every) != 0) {
+        return;
+    }
+
+    sensrec_pack(rec, &page[(count % SENSREC_RECORDS_PER_PAGE)
+            * SENSREC_RECORD_SIZE]);
+    count++;
+
+    if ((count % SENSREC_RECORDS_PER_PAGE) == 0) {
+        writePage(count - 1, SENSREC_RECORDS_PER_PAGE);
+        if (count >= SENSREC_CAPACITY) {
+            recording = 0;
+        }
+    }
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get whether a recording is running
+ *
+ *****************************************************************************/
+uint8_t sensrec_isRecording(void)
+{
+    return recording;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the number of records in the trace
+ *
+ *****************************************************************************/
+uint32_t sensrec_getCount(void)
+{
+    return count;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the dataflash offset of the trace, for the log dump
+ *
+ *****************************************************************************/
+uint32_t sensrec_getOffset(void)
+{
+    return SENSREC_FIRST_PAGE * flashPageSize;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the number of records lost to failed page programs
+ *
+ *****************************************************************************/
+uint32_t sensrec_getLost(void)
+{
+    return lost;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Encode a record
+ *
+ * Params:
+ *   [in] rec - the record
+ *   [out] r - SENSREC_RECORD_SIZE bytes
+ *
+ *****************************************************************************/
+void sensrec_pack(const sensrec_record_t *rec, uint8_t *r)
+{
+    r[0] = (uint8_t)rec->uptime;
+    r[1] = (uint8_t)(rec->uptime >> 8);
+    r[2] = (uint8_t)(rec->uptime >> 16);
+    r[3] = (uint8_t)(rec->uptime >> 24);
+    r[4] = (uint8_t)rec->temp;
+    r[5] = (uint8_t)((uint16_t)rec->temp >> 8);
+    r[6] = (uint8_t)rec->lux;
+    r[7] = (uint8_t)(rec->lux >> 8);
+    r[8] = (uint8_t)rec->accX;
+    r[9] = (uint8_t)rec->accY;
+    r[10] = (uint8_t)rec->accZ;
+    r[11] = rec->flags;
+    r[12] = (uint8_t)rec->duty;
+    r[13] = (uint8_t)(rec->duty >> 8);
+    r[14] = (uint8_t)rec->setpoint;
+    r[15] = (uint8_t)((uint16_t)rec->setpoint >> 8);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Decode a record
+ *
+ * Params:
+ *   [in] r - SENSREC_RECORD_SIZE bytes
+ *   [out] rec - the record
+ *
+ * Returns:
+ *    1 on success, 0 for an erased record, the end of the trace
+ *
+ *****************************************************************************/
+uint8_t sensrec_unpack(const uint8_t *r, sensrec_record_t *rec)
+{
+    rec->uptime = r[0] | (r[1] << 8) | (r[2] << 16) | ((uint32_t)r[3] << 24);
+    rec->temp = (int16_t)(r[4] | (r[5] << 8));
+    rec->lux = (uint16_t)(r[6] | (r[7] << 8));
+    rec->accX = (int8_t)r[8];
+    rec->accY = (int8_t)r[9];
+    rec->accZ = (int8_t)r[10];
+    rec->flags = r[11];
+    rec->duty = (uint16_t)(r[12] | (r[13] << 8));
+    rec->setpoint = (int16_t)(r[14] | (r[15] << 8));
+
+    return rec->uptime != 0xFFFFFFFF;
+}
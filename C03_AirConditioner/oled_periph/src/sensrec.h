@@ -0,0 +1,54 @@
+/*****************************************************************************
+ *   sensrec.h:  Header file for the sensor trace recorder
+ *
+******************************************************************************/
+#ifndef __SENSREC_H
+#define __SENSREC_H
+
+#include <stdint.h>
+
+/* dataflash area of the trace, the pages below the journal */
+#define SENSREC_FIRST_PAGE      2048
+#define SENSREC_PAGES           1984
+
+#define SENSREC_RECORD_SIZE     16
+#define SENSREC_PAGE_BYTES      256
+#define SENSREC_RECORDS_PER_PAGE (SENSREC_PAGE_BYTES / SENSREC_RECORD_SIZE)
+#define SENSREC_CAPACITY        (SENSREC_PAGES * SENSREC_RECORDS_PER_PAGE)
+
+/* temp of a record when the temperature read failed */
+#define SENSREC_NO_TEMP         INT16_MIN
+
+/* flags */
+#define SENSREC_ACC_VALID       0x01
+
+typedef struct
+{
+    uint32_t uptime;    /* ms since boot */
+    int16_t temp;       /* 10 x T(C), SENSREC_NO_TEMP on a failed read */
+    uint16_t lux;
+    int8_t accX;
+    int8_t accY;
+    int8_t accZ;
+    uint8_t flags;      /* SENSREC_ACC_VALID */
+    uint16_t duty;      /* controller output when the record was taken */
+    int16_t setpoint;   /* 10 x T(C) */
+} sensrec_record_t;
+
+
+void sensrec_init(void);
+uint8_t sensrec_start(uint32_t every);
+void sensrec_stop(void);
+void sensrec_add(const sensrec_record_t *rec);
+uint8_t sensrec_isRecording(void);
+uint32_t sensrec_getCount(void);
+uint32_t sensrec_getOffset(void);
+uint32_t sensrec_getLost(void);
+
+void sensrec_pack(const sensrec_record_t *rec, uint8_t *r);
+uint8_t sensrec_unpack(const uint8_t *r, sensrec_record_t *rec);
+
+#endif /* end __SENSREC_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
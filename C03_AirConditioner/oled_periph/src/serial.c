@@ -0,0 +1,386 @@
+/*****************************************************************************
+ *   serial.c:  Buffered, interrupt driven UART0/UART3 driver
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: Each port has a TX and an RX ring buffer with exactly one producer
+ * and one consumer: for TX the application writes and the THRE interrupt
+ * reads, for RX the RDA/CTI interrupt writes and the application reads.
+ * Each side only ever advances its own index, so no locking is needed.
+ * Indices run freely and are masked on access, which is why the buffer
+ * sizes must be powers of two.
+ *
+ * serial_write() never waits for the wire. Data that doesn't fit in the TX
+ * buffer is dropped and counted.
+ *
+ * The FIFOs run in DMA mode so a bulk transfer (logdump.c) can feed THR
+ * directly. While the transmitter is held, serial_write() drops new data
+ * and the ring drains as usual; once serial_txDrained() reports an empty
+ * FIFO the DMA owns THR until serial_txRelease().
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include "lpc17xx_uart.h"
+#include "lpc17xx_pinsel.h"
+#include "lpc17xx_trace.h"
+#include "serial.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define TX_MASK (SERIAL_TX_BUF_SIZE - 1)
+#define RX_MASK (SERIAL_RX_BUF_SIZE - 1)
+
+typedef struct
+{
+    LPC_UART_TypeDef *uart;
+    IRQn_Type irq;
+
+    volatile uint8_t txBuf[SERIAL_TX_BUF_SIZE];
+    volatile uint32_t txHead;       /* written by the application */
+    volatile uint32_t txTail;       /* written by the ISR */
+    volatile uint8_t txIdle;        /* set by the ISR when TX ran dry */
+    volatile uint8_t txHold;        /* THR is lent to a DMA transfer */
+
+    volatile uint8_t rxBuf[SERIAL_RX_BUF_SIZE];
+    volatile uint32_t rxHead;       /* written by the ISR */
+    volatile uint32_t rxTail;       /* written by the application */
+
+    volatile uint32_t txDropped;
+    volatile uint32_t rxDropped;
+} serial_t;
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static serial_t ports[SERIAL_NUM_PORTS];
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+/*
+ * Move bytes from the TX ring into the hardware FIFO. THRE means the whole
+ * 16 byte FIFO is empty, so up to UART_TX_FIFO_SIZE bytes can be written.
+ */
+static void fillTxFifo(serial_t *p)
+{
+    uint32_t tail = p->txTail;
+    uint32_t n = 0;
+
+    while (tail != p->txHead && n < UART_TX_FIFO_SIZE) {
+        p->uart->THR = p->txBuf[tail & TX_MASK];
+        tail++;
+        n++;
+    }
+    p->txTail = tail;
+    p->txIdle = (n == 0);
+}
+
+static void serialIrq(serial_t *p)
+{
+    uint32_t intId = 0;
+    uint32_t head = 0;
+    uint8_t c = 0;
+
+    while (!((intId = UART_GetIntId(p->uart)) & UART_IIR_INTSTAT_PEND)) {
+        switch (intId & UART_IIR_INTID_MASK) {
+        case UART_IIR_INTID_RLS:
+            /* reading LSR clears the error condition */
+            (void)UART_GetLineStatus(p->uart);
+            break;
+
+        case UART_IIR_INTID_RDA:
+        case UART_IIR_INTID_CTI:
+            head = p->rxHead;
+            while (UART_GetLineStatus(p->uart) & UART_LSR_RDR) {
+                c = (uint8_t)p->uart->RBR;
+                if (head - p->rxTail < SERIAL_RX_BUF_SIZE) {
+                    p->rxBuf[head & RX_MASK] = c;
+                    head++;
+                }
+                else {
+                    p->rxDropped++;
+                }
+            }
+            p->rxHead = head;
+            break;
+
+        case UART_IIR_INTID_THRE:
+            fillTxFifo(p);
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize a UART with 8N1 framing, FIFOs and interrupts enabled
+ *
+ * Params:
+ *   [in] port - the port to initialize
+ *   [in] baudRate - the baud rate to use
+ *
+ *****************************************************************************/
+void serial_init(serial_port_t port, uint32_t baudRate)
+{
+    serial_t *p = &ports[port];
+    UART_CFG_Type uartCfg;
+    UART_FIFO_CFG_Type fifoCfg;
+    PINSEL_CFG_Type pinCfg;
+
+    pinCfg.OpenDrain = 0;
+    pinCfg.Pinmode = 0;
+    pinCfg.Portnum = 0;
+    if (port == SERIAL_UART0) {
+        p->uart = (LPC_UART_TypeDef *)LPC_UART0;
+        p->irq = UART0_IRQn;
+        pinCfg.Funcnum = 1;
+        pinCfg.Pinnum = 2;
+        PINSEL_ConfigPin(&pinCfg);
+        pinCfg.Pinnum = 3;
+        PINSEL_ConfigPin(&pinCfg);
+    }
+    else {
+        p->uart = LPC_UART3;
+        p->irq = UART3_IRQn;
+        pinCfg.Funcnum = 2;
+        pinCfg.Pinnum = 0;
+        PINSEL_ConfigPin(&pinCfg);
+        pinCfg.Pinnum = 1;
+        PINSEL_ConfigPin(&pinCfg);
+    }
+
+    p->txHead = 0;
+    p->txTail = 0;
+    p->txIdle = 1;
+    p->txHold = 0;
+    p->rxHead = 0;
+    p->rxTail = 0;
+    p->txDropped = 0;
+    p->rxDropped = 0;
+
+    UART_ConfigStructInit(&uartCfg);
+    uartCfg.Baud_rate = baudRate;
+    UART_Init(p->uart, &uartCfg);
+
+    /*
+     * RX interrupt at 8 bytes, the character timeout picks up the rest.
+     * DMA mode only adds the DMA requests, the interrupts work as before.
+     */
+    UART_FIFOConfigStructInit(&fifoCfg);
+    fifoCfg.FIFO_Level = UART_FIFO_TRGLEV2;
+    fifoCfg.FIFO_DMAMode = ENABLE;
+    UART_FIFOConfig(p->uart, &fifoCfg);
+
+    UART_TxCmd(p->uart, ENABLE);
+
+    UART_IntConfig(p->uart, UART_INTCFG_RBR, ENABLE);
+    UART_IntConfig(p->uart, UART_INTCFG_RLS, ENABLE);
+    UART_IntConfig(p->uart, UART_INTCFG_THRE, ENABLE);
+    NVIC_EnableIRQ(p->irq);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Queue data for transmission. Never blocks.
+ *
+ * Params:
+ *   [in] port - the port to use
+ *   [in] data - data to send
+ *   [in] len - number of bytes
+ *
+ * Returns:
+ *    Number of bytes queued. Bytes that didn't fit are dropped.
+ *
+ *****************************************************************************/
+uint32_t serial_write(serial_port_t port, const uint8_t *data, uint32_t len)
+{
+    serial_t *p = &ports[port];
+    uint32_t head = p->txHead;
+    uint32_t space = SERIAL_TX_BUF_SIZE - (head - p->txTail);
+    uint32_t i = 0;
+
+    if (p->txHold) {
+        p->txDropped += len;
+        return 0;
+    }
+
+    if (len > space) {
+        p->txDropped += len - space;
+        len = space;
+    }
+
+    for (i = 0; i < len; i++) {
+        p->txBuf[(head + i) & TX_MASK] = data[i];
+    }
+    p->txHead = head + len;
+
+    /*
+     * If the transmitter ran dry there won't be another THRE interrupt,
+     * so prime the FIFO here. The interrupt is masked for the few cycles
+     * this takes so the ISR and this code don't both fill the FIFO.
+     */
+    if (p->txIdle && len > 0) {
+        NVIC_DisableIRQ(p->irq);
+        if (p->txIdle) {
+            fillTxFifo(p);
+        }
+        NVIC_EnableIRQ(p->irq);
+    }
+
+    return len;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Hold the transmitter so THR can be handed to a DMA transfer. Data
+ *    already queued is still sent, new data is dropped until
+ *    serial_txRelease() is called.
+ *
+ * Params:
+ *   [in] port - the port to hold
+ *
+ *****************************************************************************/
+void serial_txHold(serial_port_t port)
+{
+    ports[port].txHold = 1;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Check if the TX ring is empty and the transmitter has shifted out
+ *    its last byte
+ *
+ *****************************************************************************/
+uint8_t serial_txDrained(serial_port_t port)
+{
+    serial_t *p = &ports[port];
+
+    return (p->txHead == p->txTail
+            && (UART_GetLineStatus(p->uart) & UART_LSR_TEMT));
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Give THR back to the interrupt driven path
+ *
+ * Params:
+ *   [in] port - the port to release
+ *
+ *****************************************************************************/
+void serial_txRelease(serial_port_t port)
+{
+    ports[port].txHold = 0;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Read received data. Never blocks.
+ *
+ * Params:
+ *   [in] port - the port to use
+ *   [in] buf - data will be written to this buffer
+ *   [in] len - length of buffer in bytes
+ *
+ * Returns:
+ *    Number of bytes read
+ *
+ *****************************************************************************/
+uint32_t serial_read(serial_port_t port, uint8_t *buf, uint32_t len)
+{
+    serial_t *p = &ports[port];
+    uint32_t tail = p->rxTail;
+    uint32_t avail = p->rxHead - tail;
+    uint32_t i = 0;
+
+    if (len > avail) {
+        len = avail;
+    }
+
+    for (i = 0; i < len; i++) {
+        buf[i] = p->rxBuf[(tail + i) & RX_MASK];
+    }
+    p->rxTail = tail + len;
+
+    return len;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the free space in the TX buffer
+ *
+ *****************************************************************************/
+uint32_t serial_txFree(serial_port_t port)
+{
+    return SERIAL_TX_BUF_SIZE - (ports[port].txHead - ports[port].txTail);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the number of received bytes waiting to be read
+ *
+ *****************************************************************************/
+uint32_t serial_rxAvailable(serial_port_t port)
+{
+    return ports[port].rxHead - ports[port].rxTail;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the number of bytes dropped because the TX buffer was full
+ *
+ *****************************************************************************/
+uint32_t serial_getTxDropped(serial_port_t port)
+{
+    return ports[port].txDropped;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the number of bytes dropped because the RX buffer was full
+ *
+ *****************************************************************************/
+uint32_t serial_getRxDropped(serial_port_t port)
+{
+    return ports[port].rxDropped;
+}
+
+void UART0_IRQHandler(void)
+{
+    TRACE_ISR_ENTER(TRACE_ISR_UART0);
+
+    serialIrq(&ports[SERIAL_UART0]);
+    TRACE_ISR_EXIT(TRACE_ISR_UART0);
+}
+
+void UART3_IRQHandler(void)
+{
+    TRACE_ISR_ENTER(TRACE_ISR_UART3);
+
+    serialIrq(&ports[SERIAL_UART3]);
+    TRACE_ISR_EXIT(TRACE_ISR_UART3);
+}
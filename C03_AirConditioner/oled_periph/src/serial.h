@@ -0,0 +1,36 @@
+/*****************************************************************************
+ *   serial.h:  Header file for the buffered, interrupt driven UART driver
+ *
+******************************************************************************/
+#ifndef __SERIAL_H
+#define __SERIAL_H
+
+#include <stdint.h>
+
+/* ring buffer sizes, must be powers of two */
+#define SERIAL_TX_BUF_SIZE 512
+#define SERIAL_RX_BUF_SIZE 128
+
+typedef enum
+{
+    SERIAL_UART0,   /* TXD0 P0.2, RXD0 P0.3 (P0.2 is also the temp sensor) */
+    SERIAL_UART3,   /* TXD3 P0.0, RXD3 P0.1 */
+    SERIAL_NUM_PORTS
+} serial_port_t;
+
+
+void serial_init(serial_port_t port, uint32_t baudRate);
+uint32_t serial_write(serial_port_t port, const uint8_t *data, uint32_t len);
+void serial_txHold(serial_port_t port);
+uint8_t serial_txDrained(serial_port_t port);
+void serial_txRelease(serial_port_t port);
+uint32_t serial_read(serial_port_t port, uint8_t *buf, uint32_t len);
+uint32_t serial_txFree(serial_port_t port);
+uint32_t serial_rxAvailable(serial_port_t port);
+uint32_t serial_getTxDropped(serial_port_t port);
+uint32_t serial_getRxDropped(serial_port_t port);
+
+#endif /* end __SERIAL_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
@@ -0,0 +1,308 @@
+/*****************************************************************************
+ *   shell.c:  Line editing command shell on top of the serial driver
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: shell_poll() is called from the idle task. It takes whatever the
+ * UART interrupt has put in the RX ring, echoes it and edits the line in
+ * place; a complete line is split into words and dispatched from there as
+ * well. Nothing here runs in interrupt context and nothing ever waits for
+ * the UART.
+ *
+ * The command table is owned by the application, the shell only adds
+ * "help".
+ *
+ * The port may be shared with a binary stream (the telemetry frames); its
+ * writer asks shell_takeOutput() whether shell text went out in between.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include "shell.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define OUT_BUF_SIZE 96
+
+#define KEY_BS    0x08
+#define KEY_DEL   0x7F
+#define KEY_CTRLC 0x03
+
+/* largest value that can take another digit without overflowing */
+#define PARSE_MAX ((INT32_MAX - 9) / 10)
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static serial_port_t shellPort = SERIAL_UART3;
+static const shell_cmd_t *cmdTable = 0;
+static uint32_t cmdCount = 0;
+
+static char line[SHELL_LINE_MAX];
+static uint32_t lineLen = 0;
+static uint8_t wrote = 0;               /* output since shell_takeOutput() */
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static void putStr(const char *s)
+{
+    serial_write(shellPort, (const uint8_t *)s, strlen(s));
+    wrote = 1;
+}
+
+static void prompt(void)
+{
+    putStr("> ");
+}
+
+static void showHelp(void)
+{
+    uint32_t i = 0;
+
+    shell_printf("%-10s %s\r\n", "help", "list commands");
+    for (i = 0; i < cmdCount; i++) {
+        shell_printf("%-10s %s\r\n", cmdTable[i].name, cmdTable[i].help);
+    }
+}
+
+static void execute(char *cmdLine)
+{
+    char *argv[SHELL_ARGS_MAX];
+    int argc = 0;
+    char *p = cmdLine;
+    uint32_t i = 0;
+
+    /* split on blanks, in place; words past SHELL_ARGS_MAX are ignored */
+    while (*p != '\0' && argc < SHELL_ARGS_MAX) {
+        while (*p == ' ') {
+            *p++ = '\0';
+        }
+        if (*p == '\0') {
+            break;
+        }
+        argv[argc++] = p;
+        while (*p != ' ' && *p != '\0') {
+            p++;
+        }
+        if (*p == ' ') {
+            *p++ = '\0';
+        }
+    }
+
+    if (argc == 0) {
+        return;
+    }
+
+    if (strcmp(argv[0], "help") == 0) {
+        showHelp();
+        return;
+    }
+
+    for (i = 0; i < cmdCount; i++) {
+        if (strcmp(argv[0], cmdTable[i].name) == 0) {
+            cmdTable[i].handler(argc, argv);
+            return;
+        }
+    }
+
+    shell_printf("unknown command '%s'\r\n", argv[0]);
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize the shell. The serial port must already be initialized.
+ *
+ * Params:
+ *   [in] port - serial port the shell runs on
+ *   [in] cmds - command table, must stay valid
+ *   [in] numCmds - number of entries in cmds
+ *
+ *****************************************************************************/
+void shell_init(serial_port_t port, const shell_cmd_t *cmds, uint32_t numCmds)
+{
+    shellPort = port;
+    cmdTable = cmds;
+    cmdCount = numCmds;
+    lineLen = 0;
+
+    prompt();
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Process received characters. Called from the idle task, never from
+ *    an interrupt. Returns as soon as the RX ring is empty.
+ *
+ *****************************************************************************/
+void shell_poll(void)
+{
+    uint8_t c = 0;
+    char echo[2] = { 0, 0 };
+
+    while (serial_read(shellPort, &c, 1) == 1) {
+        switch (c) {
+        case '\r':
+        case '\n':
+            /* a CR LF pair only ends one line */
+            if (c == '\n' && lineLen == 0) {
+                break;
+            }
+            putStr("\r\n");
+            line[lineLen] = '\0';
+            execute(line);
+            lineLen = 0;
+            prompt();
+            break;
+
+        case KEY_BS:
+        case KEY_DEL:
+            if (lineLen > 0) {
+                lineLen--;
+                putStr("\b \b");
+            }
+            break;
+
+        case KEY_CTRLC:
+            lineLen = 0;
+            putStr("^C\r\n");
+            prompt();
+            break;
+
+        default:
+            /* ignore control characters and anything past the line end */
+            if (c >= ' ' && c < KEY_DEL && lineLen < SHELL_LINE_MAX - 1) {
+                line[lineLen++] = (char)c;
+                echo[0] = (char)c;
+                putStr(echo);
+            }
+            break;
+        }
+    }
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Formatted output to the shell port. Output longer than the internal
+ *    buffer is truncated.
+ *
+ *****************************************************************************/
+void shell_printf(const char *fmt, ...)
+{
+    char buf[OUT_BUF_SIZE];
+    va_list args;
+    int len = 0;
+
+    va_start(args, fmt);
+    len = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+
+    if (len < 0) {
+        return;
+    }
+    if (len >= (int)sizeof(buf)) {
+        len = sizeof(buf) - 1;
+    }
+    serial_write(shellPort, (const uint8_t *)buf, len);
+    wrote = 1;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Check if the shell wrote to its port since the last call
+ *
+ * Returns:
+ *   1 if there was shell output, otherwise 0
+ *
+ *****************************************************************************/
+uint8_t shell_takeOutput(void)
+{
+    uint8_t w = wrote;
+
+    wrote = 0;
+    return w;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Parse a decimal number with an optional fraction, e.g. "24.5" with
+ *    decimals = 1 gives 245. Extra fraction digits are ignored.
+ *
+ * Params:
+ *   [in] s - the string to parse
+ *   [in] decimals - number of fraction digits to keep
+ *   [out] value - the number scaled by 10^decimals
+ *
+ * Returns:
+ *   1 if s is a valid number that fits in 32 bits, otherwise 0
+ *
+ *****************************************************************************/
+uint8_t shell_parseFixed(const char *s, uint8_t decimals, int32_t *value)
+{
+    int32_t v = 0;
+    uint8_t neg = 0;
+    uint8_t digits = 0;
+    uint8_t frac = 0;
+
+    if (*s == '-') {
+        neg = 1;
+        s++;
+    }
+
+    while (*s >= '0' && *s <= '9') {
+        if (v > PARSE_MAX) {
+            return 0;
+        }
+        v = v * 10 + (*s++ - '0');
+        digits++;
+    }
+
+    if (*s == '.') {
+        s++;
+        while (*s >= '0' && *s <= '9') {
+            if (frac < decimals) {
+                if (v > PARSE_MAX) {
+                    return 0;
+                }
+                v = v * 10 + (*s - '0');
+                frac++;
+            }
+            s++;
+            digits++;
+        }
+    }
+
+    if (*s != '\0' || digits == 0) {
+        return 0;
+    }
+
+    while (frac < decimals) {
+        if (v > PARSE_MAX) {
+            return 0;
+        }
+        v *= 10;
+        frac++;
+    }
+
+    *value = neg ? -v : v;
+    return 1;
+}
@@ -0,0 +1,31 @@
+/*****************************************************************************
+ *   shell.h:  Header file for the UART command shell
+ *
+******************************************************************************/
+#ifndef __SHELL_H
+#define __SHELL_H
+
+#include <stdint.h>
+#include "serial.h"
+
+#define SHELL_LINE_MAX 64   /* longest command line */
+#define SHELL_ARGS_MAX 6    /* command name included */
+
+typedef struct
+{
+    const char *name;
+    const char *help;
+    void (*handler)(int argc, char **argv);
+} shell_cmd_t;
+
+
+void shell_init(serial_port_t port, const shell_cmd_t *cmds, uint32_t numCmds);
+void shell_poll(void);
+void shell_printf(const char *fmt, ...);
+uint8_t shell_takeOutput(void);
+uint8_t shell_parseFixed(const char *s, uint8_t decimals, int32_t *value);
+
+#endif /* end __SHELL_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
@@ -0,0 +1,69 @@
+/*****************************************************************************
+ *   stackmon.c:  Stack and heap usage monitor
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: The heap starts at _pvHeapStart, after the bss, and grows up with
+ * sbrk; the stack starts at _vStackTop, the top of the local SRAM, and
+ * grows down. ResetISR() paints the RAM between the two with
+ * STACKMON_CANARY before main() runs. Whatever the stack has overwritten
+ * since is its high-water mark: the canary words are counted up from the
+ * end of the heap until the first one that has changed.
+ *
+ * The heap figures are newlib's (mallinfo()); the firmware itself does not
+ * allocate, but the printf family does for some conversions.
+ *
+ * A function that puts an array on the stack without writing all of it
+ * can leave canary words in place below the mark, so keep some margin
+ * when sizing RAM from the figures.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <malloc.h>
+#include "stackmon.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+/* from the linker script */
+extern uint32_t _pvHeapStart;
+extern uint32_t _vStackTop;
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the stack high-water mark and the heap usage. Scans the unused
+ *    stack, so call it from the shell, not from the control path.
+ *
+ * Params:
+ *   [out] info - the usage
+ *
+ *****************************************************************************/
+void stackmon_get(stackmon_info_t *info)
+{
+    struct mallinfo mi = mallinfo();
+    uint32_t *p = (uint32_t *)((uint8_t *)&_pvHeapStart + mi.arena);
+    uint32_t *top = &_vStackTop;
+
+    /* sbrk keeps the heap end word aligned */
+    p = (uint32_t *)(((uintptr_t)p + 3) & ~(uintptr_t)3);
+    info->stackSize = (uint8_t *)top - (uint8_t *)p;
+
+    while (p < top && *p == STACKMON_CANARY) {
+        p++;
+    }
+
+    info->stackUsed = (uint8_t *)top - (uint8_t *)p;
+    info->heapArena = mi.arena;
+    info->heapUsed = mi.uordblks;
+}
@@ -0,0 +1,27 @@
+/*****************************************************************************
+ *   stackmon.h:  Header file for the stack and heap usage monitor
+ *
+******************************************************************************/
+#ifndef __STACKMON_H
+#define __STACKMON_H
+
+#include <stdint.h>
+
+/* ResetISR() in cr_startup_lpc17.c paints the free RAM with this */
+#define STACKMON_CANARY     0xA5A5A5A5
+
+typedef struct
+{
+    uint32_t stackSize;     /* bytes from the heap end to the stack top */
+    uint32_t stackUsed;     /* deepest the stack has been since reset */
+    uint32_t heapArena;     /* bytes taken from the RAM with sbrk */
+    uint32_t heapUsed;      /* bytes of it in allocated blocks */
+} stackmon_info_t;
+
+
+void stackmon_get(stackmon_info_t *info);
+
+#endif /* end __STACKMON_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
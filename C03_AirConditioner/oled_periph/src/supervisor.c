@@ -0,0 +1,279 @@
+/*****************************************************************************
+ *   supervisor.c:  Watchdog supervisor with per-task heartbeats
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: Each supervised task registers with a deadline and calls
+ * supervisor_checkIn() at least that often. The TIMER0 interrupt runs every
+ * SUPERVISOR_POLL_MS, checks the deadlines and feeds the watchdog only while
+ * every task is within its deadline.
+ *
+ * When a task misses its deadline its id is kept in the RTC general purpose
+ * registers (journal_setLastFault()) and the fault callback runs, from the
+ * TIMER0 interrupt, to put the outputs in a safe state. The watchdog is not
+ * fed again and resets the chip within its timeout.
+ *
+ * The supervisor keeps its own time in the TIMER0 interrupt, so a task hung
+ * in the SysTick handler is caught as well. The TIMER0 interrupt has the
+ * highest priority; a hang at that priority still resets the chip but
+ * leaves no fault code.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include "lpc17xx_wdt.h"
+#include "lpc17xx_timer.h"
+#include "lpc17xx_trace.h"
+#include "journal.h"
+#include "supervisor.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define TIMER_DEV LPC_TIM0
+
+#define SUPERVISOR_POLL_MS 100
+
+typedef struct
+{
+    const char *name;
+    volatile uint32_t deadline;
+    volatile uint32_t last;         /* time of the last check-in */
+    volatile uint32_t worst;
+    volatile uint32_t checkIns;
+} task_t;
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static task_t tasks[SUPERVISOR_MAX_TASKS];
+static uint8_t numTasks = 0;
+
+static volatile uint32_t now = 0;   /* ms, advanced by the TIMER0 interrupt */
+static uint8_t started = 0;
+static uint8_t expired = 0;
+
+static void (*faultCb)(uint8_t task) = NULL;
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize the supervisor. The watchdog is not started yet.
+ *
+ * Params:
+ *   [in] onFault - called from the TIMER0 interrupt with the id of the
+ *                  task that missed its deadline, may be NULL
+ *
+ *****************************************************************************/
+void supervisor_init(void (*onFault)(uint8_t task))
+{
+    TIM_TIMERCFG_Type timCfg;
+    TIM_MATCHCFG_Type matchCfg;
+
+    faultCb = onFault;
+    numTasks = 0;
+    started = 0;
+    expired = 0;
+
+    timCfg.PrescaleOption = TIM_PRESCALE_USVAL;
+    timCfg.PrescaleValue = 1;
+    TIM_Init(TIMER_DEV, TIM_TIMER_MODE, &timCfg);
+
+    matchCfg.MatchChannel = 0;
+    matchCfg.IntOnMatch = TRUE;
+    matchCfg.StopOnMatch = FALSE;
+    matchCfg.ResetOnMatch = TRUE;
+    matchCfg.ExtMatchOutputType = TIM_EXTMATCH_NOTHING;
+    matchCfg.MatchValue = SUPERVISOR_POLL_MS * 1000 - 1;
+    TIM_ConfigMatch(TIMER_DEV, &matchCfg);
+
+    NVIC_SetPriority(TIMER0_IRQn, 0);
+    NVIC_EnableIRQ(TIMER0_IRQn);
+    TIM_Cmd(TIMER_DEV, ENABLE);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Register a task. Its deadline starts counting at supervisor_start(),
+ *    or right away once the supervisor has been started.
+ *
+ * Params:
+ *   [in] name - task name, must stay valid
+ *   [in] deadlineMs - longest time allowed between check-ins
+ *
+ * Returns:
+ *    The task id, -1 if SUPERVISOR_MAX_TASKS tasks are registered
+ *
+ *****************************************************************************/
+int32_t supervisor_register(const char *name, uint32_t deadlineMs)
+{
+    task_t *t = NULL;
+
+    if (numTasks >= SUPERVISOR_MAX_TASKS) {
+        return -1;
+    }
+
+    t = &tasks[numTasks];
+    t->name = name;
+    t->deadline = deadlineMs;
+    t->last = now;
+    t->worst = 0;
+    t->checkIns = 0;
+
+    return numTasks++;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Change the deadline of a task, e.g. when its period changes
+ *
+ * Params:
+ *   [in] task - task id
+ *   [in] deadlineMs - longest time allowed between check-ins
+ *
+ *****************************************************************************/
+void supervisor_setDeadline(uint8_t task, uint32_t deadlineMs)
+{
+    if (task < numTasks) {
+        tasks[task].deadline = deadlineMs;
+    }
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Report that a task is alive. May be called from interrupt handlers.
+ *
+ * Params:
+ *   [in] task - task id
+ *
+ *****************************************************************************/
+void supervisor_checkIn(uint8_t task)
+{
+    task_t *t = NULL;
+    uint32_t interval = 0;
+
+    if (task >= numTasks) {
+        return;
+    }
+
+    t = &tasks[task];
+    interval = now - t->last;
+    if (interval > t->worst && t->checkIns > 0) {
+        t->worst = interval;
+    }
+    t->last = now;
+    t->checkIns++;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Start the watchdog in reset mode. It can't be stopped again.
+ *
+ * Params:
+ *   [in] timeoutMs - watchdog timeout, longer than SUPERVISOR_POLL_MS
+ *
+ *****************************************************************************/
+void supervisor_start(uint32_t timeoutMs)
+{
+    uint8_t i = 0;
+
+    for (i = 0; i < numTasks; i++) {
+        tasks[i].last = now;
+    }
+
+    WDT_ClrTimeOutFlag();
+    WDT_Init(WDT_CLKSRC_IRC, WDT_MODE_RESET);
+    WDT_Start(timeoutMs * 1000);
+    started = 1;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the state of a task
+ *
+ * Params:
+ *   [in] task - task id
+ *   [out] info - task state
+ *
+ * Returns:
+ *    1 on success, 0 if there is no such task
+ *
+ *****************************************************************************/
+uint8_t supervisor_getTask(uint8_t task, supervisor_task_t *info)
+{
+    if (task >= numTasks) {
+        return 0;
+    }
+
+    info->name = tasks[task].name;
+    info->deadline = tasks[task].deadline;
+    info->worst = tasks[task].worst;
+    info->checkIns = tasks[task].checkIns;
+
+    return 1;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the number of registered tasks
+ *
+ *****************************************************************************/
+uint8_t supervisor_getTaskCount(void)
+{
+    return numTasks;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    TIMER0 interrupt handler. Checks the deadlines and feeds the watchdog.
+ *
+ *****************************************************************************/
+void TIMER0_IRQHandler(void)
+{
+    uint8_t i = 0;
+    TRACE_ISR_ENTER(TRACE_ISR_TIMER0);
+
+    TIM_ClearIntPending(TIMER_DEV, TIM_MR0_INT);
+    now += SUPERVISOR_POLL_MS;
+
+    if (!started || expired) {
+        TRACE_ISR_EXIT(TRACE_ISR_TIMER0);
+        return;
+    }
+
+    for (i = 0; i < numTasks; i++) {
+        if ((now - tasks[i].last) > tasks[i].deadline) {
+            expired = 1;
+            journal_setLastFault(SUPERVISOR_FAULT_TASK | i);
+            if (faultCb != NULL) {
+                faultCb(i);
+            }
+            /* no more feeding, the watchdog resets the chip */
+            TRACE_ISR_EXIT(TRACE_ISR_TIMER0);
+            return;
+        }
+    }
+
+    WDT_Feed();
+    TRACE_ISR_EXIT(TRACE_ISR_TIMER0);
+}
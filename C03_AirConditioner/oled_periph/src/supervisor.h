@@ -0,0 +1,38 @@
+/*****************************************************************************
+ *   supervisor.h:  Header file for the watchdog supervisor
+ *
+******************************************************************************/
+#ifndef __SUPERVISOR_H
+#define __SUPERVISOR_H
+
+#include <stdint.h>
+
+#define SUPERVISOR_MAX_TASKS  6
+
+/* fault code kept over the reset (journal_setLastFault) when a task misses
+   its deadline, the low byte is the task id */
+#define SUPERVISOR_FAULT_TASK 0x5D00
+#define SUPERVISOR_FAULT_ID(f) \
+    ((((f) & 0xFF00) == SUPERVISOR_FAULT_TASK) ? (int32_t)((f) & 0xFF) : -1)
+
+typedef struct
+{
+    const char *name;
+    uint32_t deadline;      /* ms between check-ins */
+    uint32_t worst;         /* longest ms seen between check-ins */
+    uint32_t checkIns;
+} supervisor_task_t;
+
+
+void supervisor_init(void (*onFault)(uint8_t task));
+int32_t supervisor_register(const char *name, uint32_t deadlineMs);
+void supervisor_setDeadline(uint8_t task, uint32_t deadlineMs);
+void supervisor_checkIn(uint8_t task);
+void supervisor_start(uint32_t timeoutMs);
+uint8_t supervisor_getTask(uint8_t task, supervisor_task_t *info);
+uint8_t supervisor_getTaskCount(void);
+
+#endif /* end __SUPERVISOR_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
@@ -0,0 +1,235 @@
+/*****************************************************************************
+ *   tach.c:  Fan tachometer using the quadrature encoder interface
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: The fan tach output is connected to PhA (MCI0, P1.20). The QEI runs in
+ * clock/direction mode and its velocity counter counts tach edges in
+ * hardware. Every TACH_WINDOW_MS the velocity timer overflows, the count is
+ * captured and the QEI interrupt converts it to RPM; nothing is polled.
+ *
+ * The fan drive (fan.c) must be initialized before tach_init().
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include "lpc17xx_qei.h"
+#include "lpc17xx_pinsel.h"
+#include "lpc17xx_clkpwr.h"
+#include "lpc17xx_trace.h"
+#include "fan.h"
+#include "tach.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define QEI_DEV LPC_QEI
+
+#define TACH_WINDOW_MS 250
+
+/*
+ * Speed filter: first order IIR, filtered += (raw - filtered) / 2^FILTER_SHIFT.
+ * The filtered value is kept with FILTER_SHIFT fractional bits.
+ */
+#define FILTER_SHIFT 2
+
+/* below this duty the fan is not expected to turn */
+#define STALL_MIN_DUTY 150
+
+/* a fault must persist this many windows before it is reported */
+#define FAULT_WINDOWS 8
+
+/* speed below this percentage of the expected speed is underspeed */
+#define UNDERSPEED_PCT 50
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static uint32_t ppr = 2;
+static uint32_t rpmFull = 0;
+
+static volatile uint32_t rawRpm = 0;
+static volatile uint32_t filtRpm = 0;       /* FILTER_SHIFT fractional bits */
+static volatile uint32_t events = 0;
+static volatile uint8_t faulted = 0;
+static uint8_t faultCount = 0;
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static void checkSpeed(uint32_t rpm)
+{
+    uint32_t duty = fan_getDuty();
+    uint32_t expected = 0;
+    uint32_t fault = 0;
+
+    if (duty >= STALL_MIN_DUTY) {
+        expected = (rpmFull * duty) / FAN_DUTY_MAX;
+
+        if (rpm == 0) {
+            fault = TACH_EVENT_STALL;
+        }
+        else if (rpm * 100 < expected * UNDERSPEED_PCT) {
+            fault = TACH_EVENT_UNDERSPEED;
+        }
+    }
+
+    if (fault != 0) {
+        if (faultCount < FAULT_WINDOWS) {
+            faultCount++;
+        }
+        if (faultCount == FAULT_WINDOWS && !faulted) {
+            faulted = 1;
+            events |= fault;
+        }
+    }
+    else {
+        faultCount = 0;
+        if (faulted) {
+            faulted = 0;
+            events |= TACH_EVENT_RECOVERED;
+        }
+    }
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize the tachometer
+ *
+ * Params:
+ *   [in] pulsesPerRev - tach pulses per fan revolution
+ *   [in] rpmAtFullDuty - nominal fan speed at 100% duty, used to detect a
+ *                        fan that doesn't follow the duty
+ *
+ *****************************************************************************/
+void tach_init(uint32_t pulsesPerRev, uint32_t rpmAtFullDuty)
+{
+    QEI_CFG_Type qeiCfg;
+    QEI_RELOADCFG_Type reloadCfg;
+    PINSEL_CFG_Type pinCfg;
+
+    ppr = pulsesPerRev;
+    rpmFull = rpmAtFullDuty;
+
+    pinCfg.Funcnum = 1;
+    pinCfg.OpenDrain = 0;
+    pinCfg.Pinmode = 0;
+    pinCfg.Portnum = 1;
+    pinCfg.Pinnum = 20;
+    PINSEL_ConfigPin(&pinCfg);
+
+    qeiCfg.DirectionInvert = QEI_DIRINV_NONE;
+    qeiCfg.SignalMode = QEI_SIGNALMODE_CLKDIR;
+    qeiCfg.CaptureMode = QEI_CAPMODE_2X;
+    qeiCfg.InvertIndex = QEI_INVINX_NONE;
+    QEI_Init(QEI_DEV, &qeiCfg);
+
+    /* reject contact bounce / EMI shorter than 10 us on the tach line */
+    QEI_SetDigiFilter(QEI_DEV, CLKPWR_GetPCLK(CLKPWR_PCLKSEL_QEI) / 100000);
+
+    reloadCfg.ReloadOption = QEI_TIMERRELOAD_TICKVAL;
+    reloadCfg.ReloadValue = (CLKPWR_GetPCLK(CLKPWR_PCLKSEL_QEI) / 1000)
+            * TACH_WINDOW_MS;
+    QEI_SetTimerReload(QEI_DEV, &reloadCfg);
+
+    QEI_IntCmd(QEI_DEV, QEI_INTFLAG_TIM_Int, ENABLE);
+    NVIC_EnableIRQ(QEI_IRQn);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the filtered fan speed
+ *
+ * Returns:
+ *    Speed in RPM
+ *
+ *****************************************************************************/
+uint32_t tach_getRpm(void)
+{
+    return filtRpm >> FILTER_SHIFT;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the fan speed measured in the last window
+ *
+ * Returns:
+ *    Speed in RPM
+ *
+ *****************************************************************************/
+uint32_t tach_getRawRpm(void)
+{
+    return rawRpm;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get and clear the pending tachometer events
+ *
+ * Returns:
+ *    Mask of TACH_EVENT_* flags raised since the last call
+ *
+ *****************************************************************************/
+uint32_t tach_getEvents(void)
+{
+    uint32_t ev = 0;
+
+    NVIC_DisableIRQ(QEI_IRQn);
+    ev = events;
+    events = 0;
+    NVIC_EnableIRQ(QEI_IRQn);
+
+    return ev;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Check if a stall or underspeed fault is active
+ *
+ *****************************************************************************/
+uint8_t tach_isFaulted(void)
+{
+    return faulted;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    QEI interrupt handler. The velocity timer expired; convert the
+ *    captured edge count to RPM and check it against the fan duty.
+ *
+ *****************************************************************************/
+void QEI_IRQHandler(void)
+{
+    uint32_t rpm = 0;
+    TRACE_ISR_ENTER(TRACE_ISR_QEI);
+
+    if (QEI_GetIntStatus(QEI_DEV, QEI_INTFLAG_TIM_Int) != SET) {
+        TRACE_ISR_EXIT(TRACE_ISR_QEI);
+        return;
+    }
+    QEI_IntClear(QEI_DEV, QEI_INTFLAG_TIM_Int);
+
+    rpm = QEI_CalculateRPM(QEI_DEV, QEI_GetVelocityCap(QEI_DEV), ppr);
+
+    rawRpm = rpm;
+    filtRpm += rpm - (filtRpm >> FILTER_SHIFT);
+
+    checkSpeed(rpm);
+    TRACE_ISR_EXIT(TRACE_ISR_QEI);
+}
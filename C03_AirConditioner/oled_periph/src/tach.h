@@ -0,0 +1,24 @@
+/*****************************************************************************
+ *   tach.h:  Header file for the fan tachometer
+ *
+******************************************************************************/
+#ifndef __TACH_H
+#define __TACH_H
+
+#include <stdint.h>
+
+#define TACH_EVENT_STALL     (1 << 0)   /* fan driven but not turning */
+#define TACH_EVENT_UNDERSPEED (1 << 1)  /* fan turning well below the duty */
+#define TACH_EVENT_RECOVERED (1 << 2)   /* speed follows the duty again */
+
+
+void tach_init(uint32_t pulsesPerRev, uint32_t rpmAtFullDuty);
+uint32_t tach_getRpm(void);
+uint32_t tach_getRawRpm(void);
+uint32_t tach_getEvents(void);
+uint8_t tach_isFaulted(void);
+
+#endif /* end __TACH_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
@@ -0,0 +1,63 @@
+/*****************************************************************************
+ *   telem.h:  Header file for the binary telemetry frame codec
+ *
+******************************************************************************/
+#ifndef __TELEM_H
+#define __TELEM_H
+
+#include <stdint.h>
+
+#define TELEM_VERSION       1
+
+#define TELEM_TYPE_KEY      0   /* all fields, absolute */
+#define TELEM_TYPE_DELTA    1   /* changed fields, relative to the last frame */
+
+/* a key frame is sent at least every TELEM_KEY_INTERVAL frames */
+#define TELEM_KEY_INTERVAL  16
+
+/* largest encoded frame, COBS overhead and delimiter included */
+#define TELEM_FRAME_MAX     32
+
+/* UDP port of the telemetry collector, one frame per datagram */
+#define TELEM_UDP_PORT      5005
+
+/* telem_decode() results */
+#define TELEM_OK            0
+#define TELEM_ERR_LEN       (-1)   /* frame too short or too long */
+#define TELEM_ERR_COBS      (-2)   /* bad COBS encoding */
+#define TELEM_ERR_CRC       (-3)   /* CRC mismatch */
+#define TELEM_ERR_VERSION   (-4)   /* unknown version or frame type */
+#define TELEM_ERR_SYNC      (-5)   /* delta frame without a valid base */
+
+typedef struct
+{
+    uint32_t uptime;    /* ms since reset */
+    int16_t temp;       /* 10 x T(C) */
+    uint16_t lux;
+    uint16_t duty;      /* compressor/fan PWM duty, 0..1000 */
+    uint16_t rpm;       /* filtered fan speed */
+    int8_t accX;
+    int8_t accY;
+    int8_t accZ;
+} telem_sample_t;
+
+typedef struct
+{
+    telem_sample_t prev;    /* last sample sent / received */
+    uint8_t seq;            /* sequence number of the last frame */
+    uint8_t sinceKey;       /* encoder: frames left until the next key frame */
+    uint8_t synced;         /* decoder: prev is valid */
+} telem_state_t;
+
+
+void telem_initState(telem_state_t *st);
+void telem_forceKey(telem_state_t *st);
+uint32_t telem_encode(telem_state_t *st, const telem_sample_t *s,
+        uint8_t *frame);
+int telem_decode(telem_state_t *st, const uint8_t *frame, uint32_t len,
+        telem_sample_t *s);
+
+#endif /* end __TELEM_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
@@ -0,0 +1,621 @@
+/*****************************************************************************
+ *   zone.c:  CAN protocol between the air-conditioner units of one zone
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: Every unit in a building zone is a node on CAN2 (RD2 P0.4, TD2
+ * P0.5). Identifiers are 11 bit: zone(6) | type(2) | node(3), so lower
+ * message types win arbitration.
+ *
+ *   SETPOINT  version, setpoint      sent on a local change
+ *   LOAD      zone mean demand       sent by the leader
+ *   STATUS    flags, setpoint version/value, demand, temperature
+ *                                    sent by every node every ZONE_STATUS_MS
+ *   SELFTEST  no data                sent by zone_selfTest() only
+ *
+ * Each node loads a FullCAN entry for every identifier of its own zone and
+ * nothing else, so the acceptance filter drops all other traffic in
+ * hardware. SELFTEST is the exception: a node only accepts its own, so a
+ * self test frame that reaches the bus is dropped by every other node.
+ * Received objects are copied into a ring by the CAN interrupt; all
+ * protocol handling is done in zone_poll() from the idle task.
+ *
+ * Leader election: the lowest node id whose STATUS was seen within
+ * ZONE_TIMEOUT_MS (or this node) is the leader. No extra messages are
+ * needed and every node reaches the same result.
+ *
+ * Setpoint sync: a setpoint carries an 8 bit version. Any node may change
+ * it; the newer version wins, a tie is won by the lower node id. STATUS
+ * repeats the current version so a node that missed a change catches up.
+ * A node that has just booted takes over any changed setpoint it hears.
+ * Setpoints outside the range given to zone_init() are ignored, so one
+ * bad node cannot make the zone agree on a setpoint nobody can use.
+ *
+ * Load sharing: the leader sends the mean demand of all live nodes and
+ * each node pulls its duty ZONE_SHARE_PCT of the way towards it, so the
+ * units serving one zone run at similar load.
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include "lpc17xx_can.h"
+#include "lpc17xx_pinsel.h"
+#include "lpc17xx_trace.h"
+#include "zone.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define CAN_DEV LPC_CAN2
+#define CAN_CTRL CAN2_CTRL
+
+#define TYPE_SETPOINT   0
+#define TYPE_LOAD       1
+#define TYPE_STATUS     2
+#define NUM_TYPES       3
+#define TYPE_SELFTEST   3       /* not one of the protocol types */
+
+#define MSG_ID(zone, type, node) (((zone) << 5) | ((type) << 3) | (node))
+#define ID_TYPE(id)     (((id) >> 3) & 0x03)
+#define ID_NODE(id)     ((id) & 0x07)
+
+#define ZONE_STATUS_MS  250
+#define ZONE_TIMEOUT_MS (4 * ZONE_STATUS_MS)
+
+#define FLAG_LEADER     0x01
+
+#define SELFTEST_WAIT_MS 20
+
+/* must be a power of two */
+#define RX_RING_SIZE    16
+#define RX_MASK         (RX_RING_SIZE - 1)
+
+typedef struct
+{
+    uint32_t lastSeen;
+    uint8_t alive;
+    int16_t temp;
+    uint16_t demand;
+} node_t;
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static uint32_t (*getTicks)(void) = NULL;
+
+static uint8_t zoneId = 0;
+static uint8_t nodeId = 0;
+static uint8_t leader = 0;
+static node_t nodes[ZONE_MAX_NODES];
+
+static int32_t setpoint = 0;
+static int32_t spMin = 0;
+static int32_t spMax = 0;
+static uint8_t spVersion = 0;
+static uint8_t spOwner = 0;
+static uint8_t spChanged = 0;
+static uint8_t spFresh = 1;                /* not changed since boot */
+
+static volatile int32_t zoneMean = -1;     /* -1: no load sharing */
+static uint32_t lastLoad = 0;
+static uint32_t lastStatus = 0;
+
+static CAN_MSG_Type rxRing[RX_RING_SIZE];
+static volatile uint32_t rxHead = 0;       /* written by the ISR */
+static volatile uint32_t rxTail = 0;       /* written by zone_poll() */
+
+static volatile uint8_t selfTestPending = 0;
+static volatile uint8_t selfTestOk = 0;
+
+static volatile uint32_t rxCount = 0;
+static volatile uint32_t rxDropped = 0;
+static uint32_t txFailed = 0;
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static void put16(uint8_t *buf, uint16_t v)
+{
+    buf[0] = (uint8_t)v;
+    buf[1] = (uint8_t)(v >> 8);
+}
+
+static uint16_t get16(const uint8_t *buf)
+{
+    return (uint16_t)(buf[0] | (buf[1] << 8));
+}
+
+static Status send(uint8_t type, const uint8_t *data, uint8_t len)
+{
+    CAN_MSG_Type msg;
+    uint8_t i = 0;
+
+    msg.id = MSG_ID(zoneId, type, nodeId);
+    msg.len = len;
+    msg.format = STD_ID_FORMAT;
+    msg.type = DATA_FRAME;
+    for (i = 0; i < 4; i++) {
+        msg.dataA[i] = (i < len) ? data[i] : 0;
+        msg.dataB[i] = (i + 4 < len) ? data[i + 4] : 0;
+    }
+
+    if (CAN_SendMsg(CAN_DEV, &msg) != SUCCESS) {
+        txFailed++;
+        return ERROR;
+    }
+    return SUCCESS;
+}
+
+static void sendSetpoint(void)
+{
+    uint8_t data[3];
+
+    data[0] = spVersion;
+    put16(&data[1], (uint16_t)setpoint);
+    send(TYPE_SETPOINT, data, 3);
+}
+
+static void sendStatus(void)
+{
+    uint8_t data[8];
+
+    data[0] = (leader == nodeId) ? FLAG_LEADER : 0;
+    data[1] = spVersion;
+    put16(&data[2], (uint16_t)setpoint);
+    put16(&data[4], nodes[nodeId].demand);
+    put16(&data[6], (uint16_t)nodes[nodeId].temp);
+    send(TYPE_STATUS, data, 8);
+}
+
+/* adopt a setpoint from another node if it is newer than ours */
+static void offerSetpoint(uint8_t from, uint8_t version, int32_t sp)
+{
+    int8_t age = (int8_t)(version - spVersion);
+
+    if (sp < spMin || sp > spMax) {
+        return;
+    }
+
+    if ((spFresh && version != 0) || age > 0
+            || (age == 0 && sp != setpoint && from < spOwner)) {
+        setpoint = sp;
+        spVersion = version;
+        spOwner = from;
+        spChanged = 1;
+        spFresh = 0;
+    }
+}
+
+static void handleMsg(const CAN_MSG_Type *msg, uint32_t now)
+{
+    uint8_t data[8];
+    uint8_t from = ID_NODE(msg->id);
+    uint8_t i = 0;
+
+    for (i = 0; i < 4; i++) {
+        data[i] = msg->dataA[i];
+        data[i + 4] = msg->dataB[i];
+    }
+
+    switch (ID_TYPE(msg->id)) {
+    case TYPE_SETPOINT:
+        if (msg->len >= 3) {
+            offerSetpoint(from, data[0], (int16_t)get16(&data[1]));
+        }
+        break;
+
+    case TYPE_LOAD:
+        if (msg->len >= 2 && from == leader) {
+            zoneMean = get16(&data[0]);
+            lastLoad = now;
+        }
+        break;
+
+    case TYPE_STATUS:
+        if (msg->len >= 8) {
+            nodes[from].lastSeen = now;
+            nodes[from].alive = 1;
+            nodes[from].demand = get16(&data[4]);
+            nodes[from].temp = (int16_t)get16(&data[6]);
+            offerSetpoint(from, data[1], (int16_t)get16(&data[2]));
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void electLeader(uint32_t now)
+{
+    uint8_t i = 0;
+
+    leader = nodeId;
+    for (i = 0; i < ZONE_MAX_NODES; i++) {
+        if (i == nodeId) {
+            continue;
+        }
+        if (nodes[i].alive && (now - nodes[i].lastSeen) > ZONE_TIMEOUT_MS) {
+            nodes[i].alive = 0;
+        }
+        if (nodes[i].alive && i < leader) {
+            leader = i;
+        }
+    }
+}
+
+static void shareLoad(uint32_t now)
+{
+    uint8_t data[3];
+    uint32_t sum = 0;
+    uint8_t count = 0;
+    uint8_t i = 0;
+
+    if (leader != nodeId) {
+        /* follow the leader, run standalone if it went quiet */
+        if ((now - lastLoad) > ZONE_TIMEOUT_MS) {
+            zoneMean = -1;
+        }
+        return;
+    }
+
+    for (i = 0; i < ZONE_MAX_NODES; i++) {
+        if (nodes[i].alive) {
+            sum += nodes[i].demand;
+            count++;
+        }
+    }
+
+    if (count < 2) {
+        zoneMean = -1;
+        return;
+    }
+
+    zoneMean = sum / count;
+    put16(&data[0], (uint16_t)zoneMean);
+    data[2] = count;
+    send(TYPE_LOAD, data, 3);
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ *
+ * Description:
+ *    Initialize CAN2 and join a zone
+ *
+ * Params:
+ *   [in] zone - zone id, 0..ZONE_MAX_ZONES-1
+ *   [in] node - node id within the zone, 0..ZONE_MAX_NODES-1. Must be
+ *               unique in the zone.
+ *   [in] sp - setpoint to use until the zone agrees on one, 10 x T(C)
+ *   [in] min - lowest setpoint taken from another node, 10 x T(C)
+ *   [in] max - highest setpoint taken from another node, 10 x T(C)
+ *   [in] getMsTicks - callback function for retrieving number of elapsed
+ *                     ticks in milliseconds
+ *
+ *****************************************************************************/
+void zone_init(uint8_t zone, uint8_t node, int32_t sp, int32_t min,
+        int32_t max, uint32_t (*getMsTicks)(void))
+{
+    FullCAN_Entry entries[NUM_TYPES * ZONE_MAX_NODES + 1];
+    AF_SectionDef afTable;
+    PINSEL_CFG_Type pinCfg;
+    uint8_t type = 0;
+    uint8_t n = 0;
+    uint8_t i = 0;
+
+    zoneId = zone & (ZONE_MAX_ZONES - 1);
+    nodeId = node & (ZONE_MAX_NODES - 1);
+    getTicks = getMsTicks;
+    leader = nodeId;
+    setpoint = sp;
+    spMin = min;
+    spMax = max;
+    spOwner = nodeId;
+    nodes[nodeId].alive = 1;
+
+    pinCfg.Funcnum = 2;
+    pinCfg.OpenDrain = 0;
+    pinCfg.Pinmode = 0;
+    pinCfg.Portnum = 0;
+    pinCfg.Pinnum = 4;
+    PINSEL_ConfigPin(&pinCfg);
+    pinCfg.Pinnum = 5;
+    PINSEL_ConfigPin(&pinCfg);
+
+    CAN_Init(CAN_DEV, ZONE_BAUD);
+
+    /*
+     * One FullCAN object per identifier of this zone, our own included so
+     * the self test can receive its own frames, and our SELFTEST
+     * identifier. The table must be sorted.
+     */
+    for (type = 0; type < NUM_TYPES; type++) {
+        for (n = 0; n < ZONE_MAX_NODES; n++) {
+            entries[i].controller = CAN_CTRL;
+            entries[i].disable = MSG_ENABLE;
+            entries[i].id_11 = MSG_ID(zoneId, type, n);
+            i++;
+        }
+    }
+    entries[i].controller = CAN_CTRL;
+    entries[i].disable = MSG_ENABLE;
+    entries[i].id_11 = MSG_ID(zoneId, TYPE_SELFTEST, nodeId);
+    i++;
+
+    afTable.FullCAN_Sec = entries;
+    afTable.FC_NumEntry = i;
+    afTable.SFF_Sec = NULL;
+    afTable.SFF_NumEntry = 0;
+    afTable.SFF_GPR_Sec = NULL;
+    afTable.SFF_GPR_NumEntry = 0;
+    afTable.EFF_Sec = NULL;
+    afTable.EFF_NumEntry = 0;
+    afTable.EFF_GPR_Sec = NULL;
+    afTable.EFF_GPR_NumEntry = 0;
+    CAN_SetupAFLUT(LPC_CANAF, &afTable);
+
+    /* also switches the acceptance filter to FullCAN mode */
+    CAN_IRQCmd(CAN_DEV, CANINT_FCE, ENABLE);
+    NVIC_EnableIRQ(CAN_IRQn);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Run the protocol: handle received messages, elect the leader and
+ *    send this node's status. Called from the idle task.
+ *
+ * Params:
+ *   [in] demand - this node's controller output before load sharing
+ *   [in] temp - this node's temperature, 10 x T(C)
+ *
+ *****************************************************************************/
+void zone_poll(int32_t demand, int32_t temp)
+{
+    uint32_t now = getTicks();
+    uint32_t tail = rxTail;
+
+    nodes[nodeId].demand = (uint16_t)demand;
+    nodes[nodeId].temp = (int16_t)temp;
+    nodes[nodeId].lastSeen = now;
+
+    while (tail != rxHead) {
+        handleMsg(&rxRing[tail & RX_MASK], now);
+        tail++;
+    }
+    rxTail = tail;
+
+    if ((now - lastStatus) >= ZONE_STATUS_MS) {
+        lastStatus = now;
+        electLeader(now);
+        sendStatus();
+        shareLoad(now);
+    }
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Change the zone setpoint from this node
+ *
+ * Params:
+ *   [in] sp - new setpoint, 10 x T(C)
+ *
+ *****************************************************************************/
+void zone_setSetpoint(int32_t sp)
+{
+    setpoint = sp;
+    spVersion++;
+    spOwner = nodeId;
+    spFresh = 0;
+    sendSetpoint();
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Check if another node changed the setpoint
+ *
+ * Params:
+ *   [out] sp - the new setpoint
+ *
+ * Returns:
+ *   1 if the setpoint changed since the last call, otherwise 0
+ *
+ *****************************************************************************/
+uint8_t zone_takeSetpoint(int32_t *sp)
+{
+    if (!spChanged) {
+        return 0;
+    }
+    spChanged = 0;
+    *sp = setpoint;
+    return 1;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Apply load sharing to this node's controller output. Safe to call
+ *    from the control interrupt.
+ *
+ * Params:
+ *   [in] demand - this node's controller output
+ *
+ * Returns:
+ *   The duty to drive
+ *
+ *****************************************************************************/
+int32_t zone_shareDuty(int32_t demand)
+{
+    int32_t mean = zoneMean;
+
+    if (mean < 0) {
+        return demand;
+    }
+    return demand + ((mean - demand) * ZONE_SHARE_PCT) / 100;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Self test on a single board. The controller is put in self test
+ *    mode, sends a SELFTEST frame with self reception and must receive it
+ *    back through the acceptance filter. The frame still goes out on the
+ *    bus, the other nodes drop it in their acceptance filter.
+ *
+ * Returns:
+ *   1 if the frame was received, otherwise 0
+ *
+ *****************************************************************************/
+uint8_t zone_selfTest(void)
+{
+    uint32_t start = 0;
+
+    selfTestOk = 0;
+    selfTestPending = 1;
+
+    CAN_ModeConfig(CAN_DEV, CAN_SELFTEST_MODE, ENABLE);
+    if (CAN_DEV->SR & CAN_SR_TBS1) {
+        /*
+         * Load TX buffer 1 directly, CAN_SendMsg() would also request a
+         * normal transmission. Self reception only: no acknowledge needed.
+         */
+        CAN_DEV->TFI1 = CAN_TFI_DLC(0);
+        CAN_DEV->TID1 = CAN_TID_ID11(MSG_ID(zoneId, TYPE_SELFTEST, nodeId));
+        CAN_DEV->TDA1 = 0;
+        CAN_DEV->TDB1 = 0;
+        CAN_SetCommand(CAN_DEV, CAN_CMR_SRR | CAN_CMR_STB1);
+
+        start = getTicks();
+        while (!selfTestOk && (getTicks() - start) < SELFTEST_WAIT_MS);
+    }
+    else {
+        txFailed++;
+    }
+    CAN_ModeConfig(CAN_DEV, CAN_SELFTEST_MODE, DISABLE);
+
+    selfTestPending = 0;
+    return selfTestOk;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the id of the current leader
+ *
+ *****************************************************************************/
+uint8_t zone_getLeader(void)
+{
+    return leader;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the id of this node
+ *
+ *****************************************************************************/
+uint8_t zone_getNodeId(void)
+{
+    return nodeId;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get what is known about a node
+ *
+ * Params:
+ *   [in] node - node id
+ *   [out] info - node state
+ *
+ *****************************************************************************/
+void zone_getNode(uint8_t node, zone_node_t *info)
+{
+    node &= (ZONE_MAX_NODES - 1);
+    info->alive = nodes[node].alive;
+    info->temp = nodes[node].temp;
+    info->demand = nodes[node].demand;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the number of messages received
+ *
+ *****************************************************************************/
+uint32_t zone_getRxCount(void)
+{
+    return rxCount;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the number of messages dropped because the RX ring was full
+ *
+ *****************************************************************************/
+uint32_t zone_getRxDropped(void)
+{
+    return rxDropped;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Get the number of messages that could not be queued for transmission
+ *
+ *****************************************************************************/
+uint32_t zone_getTxFailed(void)
+{
+    return txFailed;
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    CAN interrupt handler. Copies the received FullCAN objects into the
+ *    RX ring; our own frames only show up in self test.
+ *
+ *****************************************************************************/
+void CAN_IRQHandler(void)
+{
+    CAN_MSG_Type msg;
+    uint32_t head = rxHead;
+    TRACE_ISR_ENTER(TRACE_ISR_CAN);
+
+    /* reading ICR acknowledges the controller interrupts */
+    (void)CAN_IntGetStatus(CAN_DEV);
+
+    while (FCAN_ReadObj(LPC_CANAF, &msg) == CAN_OK) {
+        rxCount++;
+
+        if (ID_NODE(msg.id) == nodeId) {
+            if (selfTestPending && ID_TYPE(msg.id) == TYPE_SELFTEST) {
+                selfTestOk = 1;
+            }
+            continue;
+        }
+
+        if (head - rxTail < RX_RING_SIZE) {
+            rxRing[head & RX_MASK] = msg;
+            head++;
+        }
+        else {
+            rxDropped++;
+        }
+    }
+    rxHead = head;
+    TRACE_ISR_EXIT(TRACE_ISR_CAN);
+}
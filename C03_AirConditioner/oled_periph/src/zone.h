@@ -0,0 +1,44 @@
+/*****************************************************************************
+ *   zone.h:  Header file for the CAN zone protocol
+ *
+******************************************************************************/
+#ifndef __ZONE_H
+#define __ZONE_H
+
+#include <stdint.h>
+
+#define ZONE_MAX_NODES    8     /* node ids 0..7 */
+#define ZONE_MAX_ZONES    64    /* zone ids 0..63 */
+
+#define ZONE_BAUD         125000
+
+/* how strongly a node's duty is pulled towards the zone mean, percent */
+#define ZONE_SHARE_PCT    50
+
+typedef struct
+{
+    uint8_t alive;
+    int16_t temp;       /* 10 x T(C) */
+    uint16_t demand;    /* PID output before load sharing */
+} zone_node_t;
+
+
+void zone_init(uint8_t zone, uint8_t node, int32_t sp, int32_t min,
+        int32_t max, uint32_t (*getMsTicks)(void));
+void zone_poll(int32_t demand, int32_t temp);
+void zone_setSetpoint(int32_t setpoint);
+uint8_t zone_takeSetpoint(int32_t *setpoint);
+int32_t zone_shareDuty(int32_t demand);
+uint8_t zone_selfTest(void);
+
+uint8_t zone_getLeader(void);
+uint8_t zone_getNodeId(void);
+void zone_getNode(uint8_t node, zone_node_t *info);
+uint32_t zone_getRxCount(void);
+uint32_t zone_getRxDropped(void);
+uint32_t zone_getTxFailed(void);
+
+#endif /* end __ZONE_H */
+/****************************************************************************
+**                            End Of File
+*****************************************************************************/
@@ -0,0 +1,457 @@
+/*****************************************************************************
+ *   itmdecode.c:  Host side decoder for the ITM/SWO event trace
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: Reads the raw SWO byte stream (ITM packets, TPIU formatter
+ * bypassed) from a file or stdin, and prints a timeline of the trace
+ * events followed by a summary with the count, total and longest duration
+ * of every task, interrupt handler and driver transaction.
+ *
+ * The firmware sends no time with the events. The ITM adds local
+ * timestamp packets, in CPU cycles since the previous timestamp, after the
+ * events they belong to; the events seen since the last timestamp all get
+ * its time. Events written in the same cycle window can therefore share a
+ * time.
+ *
+ * With -j the events are also written as a Chrome trace (chrome://tracing,
+ * ui.perfetto.dev): spans as complete events, values as counters.
+ *
+ * Build:
+ *   gcc -Wall -I../Lib_MCU/inc -o itmdecode itmdecode.c
+ *
+ * Use:
+ *   stty -F /dev/ttyUSB1 2000000 raw && ./itmdecode /dev/ttyUSB1
+ *   ./itmdecode -f 100000000 -q -j trace.json swo.bin
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lpc17xx_trace_ids.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define CPU_HZ_DEFAULT  100000000UL
+
+#define MAX_PENDING     256     /* events waiting for a timestamp */
+#define MAX_IDS         128     /* ids per port, 7 bits */
+#define TEXT_MAX        128
+
+#define NUM_SPAN_PORTS  (TRACE_PORT_DRV + 1)
+
+typedef struct
+{
+    unsigned port;
+    unsigned long value;
+} event_t;
+
+typedef struct
+{
+    unsigned long long start;
+    unsigned long long total;
+    unsigned long long max;
+    unsigned long count;
+    unsigned long unmatched;    /* an end without a begin, or the reverse */
+    int open;
+} span_t;
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static const char *taskNames[] = { TRACE_TASK_NAMES };
+static const char *isrNames[] = { TRACE_ISR_NAMES };
+static const char *drvNames[] = { TRACE_DRV_NAMES };
+static const char *valNames[] = { TRACE_VAL_NAMES };
+
+static const char *portNames[NUM_SPAN_PORTS] = {
+    "text", "task", "isr", "drv"
+};
+
+static span_t spans[NUM_SPAN_PORTS][MAX_IDS];
+
+static event_t pending[MAX_PENDING];
+static unsigned numPending = 0;
+
+static unsigned long long now = 0;     /* cycles */
+static double cpuHz = CPU_HZ_DEFAULT;
+static int quiet = 0;
+
+static char text[TEXT_MAX];
+static unsigned textLen = 0;
+
+static FILE *json = NULL;
+static int jsonFirst = 1;
+
+static unsigned long events = 0;
+static unsigned long overflows = 0;
+static unsigned long dropped = 0;     /* pending buffer full */
+static unsigned long skipped = 0;     /* packets not from the trace */
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static double toUs(unsigned long long cycles)
+{
+    return cycles * 1000000.0 / cpuHz;
+}
+
+static const char *idName(unsigned port, unsigned id)
+{
+    static char buf[16];
+
+    switch (port) {
+    case TRACE_PORT_TASK:
+        if (id < TRACE_NUM_TASKS) {
+            return taskNames[id];
+        }
+        break;
+    case TRACE_PORT_ISR:
+        if (id < TRACE_NUM_ISRS) {
+            return isrNames[id];
+        }
+        break;
+    case TRACE_PORT_DRV:
+        if (id < TRACE_NUM_DRVS) {
+            return drvNames[id];
+        }
+        break;
+    case TRACE_PORT_VALUE:
+        if (id < TRACE_NUM_VALS) {
+            return valNames[id];
+        }
+        break;
+    }
+
+    snprintf(buf, sizeof(buf), "#%u", id);
+    return buf;
+}
+
+static void jsonEvent(const char *fmt, const char *name, unsigned port,
+        double ts, double arg)
+{
+    if (json == NULL) {
+        return;
+    }
+
+    fprintf(json, "%s\n", jsonFirst ? "" : ",");
+    jsonFirst = 0;
+    fprintf(json, fmt, name, port, ts, arg);
+}
+
+static void spanEvent(unsigned port, unsigned long v, unsigned long long t)
+{
+    unsigned id = v & ~TRACE_END & 0xFF;
+    span_t *s = &spans[port][id];
+    unsigned long long d = 0;
+
+    if (!quiet) {
+        printf("%14llu %14.3f  %-4s %-12s %s\n", t, toUs(t), portNames[port],
+                idName(port, id), (v & TRACE_END) ? "end" : "begin");
+    }
+
+    if (!(v & TRACE_END)) {
+        if (s->open) {
+            s->unmatched++;
+        }
+        s->start = t;
+        s->open = 1;
+        return;
+    }
+
+    if (!s->open) {
+        s->unmatched++;
+        return;
+    }
+    s->open = 0;
+
+    d = t - s->start;
+    s->count++;
+    s->total += d;
+    if (d > s->max) {
+        s->max = d;
+    }
+
+    jsonEvent("{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+            "\"ts\":%.3f,\"dur\":%.3f}", idName(port, id), port,
+            toUs(s->start), toUs(d));
+}
+
+static void valueEvent(unsigned long v, unsigned long long t)
+{
+    unsigned id = (v >> 24) & 0xFF;
+    long val = (long)(v & 0xFFFFFF);
+
+    if (val & 0x800000) {
+        val -= 0x1000000;
+    }
+
+    if (!quiet) {
+        printf("%14llu %14.3f  val  %-12s %ld\n", t, toUs(t),
+                idName(TRACE_PORT_VALUE, id), val);
+    }
+    jsonEvent("{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"tid\":%u,"
+            "\"ts\":%.3f,\"args\":{\"value\":%.0f}}",
+            idName(TRACE_PORT_VALUE, id), TRACE_PORT_VALUE, toUs(t),
+            (double)val);
+}
+
+static void textEvent(unsigned long v, unsigned long long t)
+{
+    char c = (char)(v & 0xFF);
+
+    if (c != '\n' && c != '\r' && textLen < TEXT_MAX - 1) {
+        text[textLen++] = c;
+    }
+    if (c == '\n' || textLen == TEXT_MAX - 1) {
+        text[textLen] = '\0';
+        if (!quiet) {
+            printf("%14llu %14.3f  text %s\n", t, toUs(t), text);
+        }
+        textLen = 0;
+    }
+}
+
+/* all pending events happened no later than the current time */
+static void flushPending(void)
+{
+    unsigned i = 0;
+
+    for (i = 0; i < numPending; i++) {
+        events++;
+        if (pending[i].port == TRACE_PORT_TEXT) {
+            textEvent(pending[i].value, now);
+        }
+        else if (pending[i].port < NUM_SPAN_PORTS) {
+            spanEvent(pending[i].port, pending[i].value, now);
+        }
+        else if (pending[i].port == TRACE_PORT_VALUE) {
+            valueEvent(pending[i].value, now);
+        }
+        else {
+            skipped++;
+        }
+    }
+    numPending = 0;
+}
+
+static void addEvent(unsigned port, unsigned long value)
+{
+    if (numPending == MAX_PENDING) {
+        dropped++;
+        return;
+    }
+    pending[numPending].port = port;
+    pending[numPending].value = value;
+    numPending++;
+}
+
+/* reads up to max continuation bytes (bit 7 set: another byte follows) */
+static int readCont(FILE *in, unsigned long *value, int max)
+{
+    int c = 0;
+    int n = 0;
+
+    *value = 0;
+    do {
+        c = fgetc(in);
+        if (c == EOF) {
+            return 0;
+        }
+        if (n < max) {
+            *value |= (unsigned long)(c & 0x7F) << (7 * n);
+        }
+        n++;
+    } while (c & 0x80);
+
+    return 1;
+}
+
+static int readPayload(FILE *in, unsigned long *value, int size)
+{
+    int c = 0;
+    int i = 0;
+
+    *value = 0;
+    for (i = 0; i < size; i++) {
+        c = fgetc(in);
+        if (c == EOF) {
+            return 0;
+        }
+        *value |= (unsigned long)c << (8 * i);
+    }
+
+    return 1;
+}
+
+static void decode(FILE *in)
+{
+    static const int sizes[4] = { 0, 1, 2, 4 };
+    unsigned long v = 0;
+    int h = 0;
+
+    while ((h = fgetc(in)) != EOF) {
+        if (h == 0x00 || h == 0x80) {
+            /* synchronization: at least 47 zero bits, then a one */
+            continue;
+        }
+        if (h == 0x70) {
+            overflows++;
+            flushPending();
+            if (!quiet) {
+                printf("%14llu %14.3f  ---- overflow, packets lost\n",
+                        now, toUs(now));
+            }
+            continue;
+        }
+        if ((h & 0x8F) == 0x00) {
+            /* local timestamp, format 2: 1..6 cycles, data in sync */
+            now += (h >> 4) & 0x07;
+            flushPending();
+            continue;
+        }
+        if ((h & 0xCF) == 0xC0) {
+            /* local timestamp, format 1: up to 4 bytes of cycles */
+            if (!readCont(in, &v, 4)) {
+                break;
+            }
+            now += v;
+            flushPending();
+            continue;
+        }
+        if (h == 0x94 || h == 0xB4) {
+            /* global timestamp, not enabled by TRACE_Init() */
+            if (!readCont(in, &v, 4)) {
+                break;
+            }
+            skipped++;
+            continue;
+        }
+        if ((h & 0x0B) == 0x08) {
+            /* extension, e.g. stimulus port page */
+            if ((h & 0x80) && !readCont(in, &v, 4)) {
+                break;
+            }
+            skipped++;
+            continue;
+        }
+        if ((h & 0x03) == 0) {
+            skipped++;
+            continue;
+        }
+
+        if (!readPayload(in, &v, sizes[h & 0x03])) {
+            break;
+        }
+        if (h & 0x04) {
+            /* hardware source (DWT) packet */
+            skipped++;
+            continue;
+        }
+        addEvent((unsigned)(h >> 3), v);
+    }
+
+    flushPending();
+}
+
+static void printSummary(void)
+{
+    const span_t *s = NULL;
+    unsigned port = 0;
+    unsigned id = 0;
+
+    printf("\n%-4s %-12s %10s %16s %12s %12s %8s\n", "", "name", "count",
+            "total_us", "mean_us", "max_us", "unmatch");
+    for (port = TRACE_PORT_TASK; port < NUM_SPAN_PORTS; port++) {
+        for (id = 0; id < MAX_IDS; id++) {
+            s = &spans[port][id];
+            if (s->count == 0 && s->unmatched == 0) {
+                continue;
+            }
+            printf("%-4s %-12s %10lu %16.3f %12.3f %12.3f %8lu\n",
+                    portNames[port], idName(port, id), s->count,
+                    toUs(s->total),
+                    s->count ? toUs(s->total) / s->count : 0.0,
+                    toUs(s->max), s->unmatched);
+        }
+    }
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+int main(int argc, char **argv)
+{
+    const char *jsonPath = NULL;
+    const char *inPath = NULL;
+    FILE *in = stdin;
+    int i = 0;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            cpuHz = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            jsonPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "-q") == 0) {
+            quiet = 1;
+        }
+        else if (argv[i][0] != '-' && inPath == NULL) {
+            inPath = argv[i];
+        }
+        else {
+            break;
+        }
+    }
+    if (i != argc || cpuHz <= 0) {
+        fprintf(stderr, "usage: %s [-f cpu_hz] [-q] [-j trace.json]"
+                " [swo.bin]\n", argv[0]);
+        return 2;
+    }
+
+    if (inPath != NULL) {
+        in = fopen(inPath, "rb");
+        if (in == NULL) {
+            perror(inPath);
+            return 1;
+        }
+    }
+
+    if (jsonPath != NULL) {
+        json = fopen(jsonPath, "w");
+        if (json == NULL) {
+            perror(jsonPath);
+            return 1;
+        }
+        fprintf(json, "{\"traceEvents\":[");
+    }
+
+    if (!quiet) {
+        printf("%14s %14s  event\n", "cycles", "us");
+    }
+    decode(in);
+    printSummary();
+
+    fprintf(stderr, "events: %lu, overflows: %lu, dropped: %lu,"
+            " skipped: %lu\n", events, overflows, dropped, skipped);
+
+    if (json != NULL) {
+        fprintf(json, "\n]}\n");
+        fclose(json);
+    }
+    if (in != stdin) {
+        fclose(in);
+    }
+    return 0;
+}
@@ -0,0 +1,509 @@
+/*****************************************************************************
+ *   netsim.c:  Host harness for the ARP/IPv4/UDP stack
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: Runs the firmware stack (net.c) on the host with a netif
+ * implementation backed by a pcap file or a Linux TAP interface. Like the
+ * firmware it sends a telemetry frame (telem.c) every TELEM_PERIOD_MS to
+ * the collector; it also answers ARP and ping, echoes datagrams sent
+ * to UDP port 7 and joins the config and time multicast groups.
+ *
+ * The receive filter of the EMAC is emulated: frames for other stations
+ * and multicasts that miss the hash table are counted as filtered and
+ * never reach net.c.
+ *
+ * Replay mode feeds the frames of a capture to net_poll() with the clock
+ * taken from the capture timestamps, and writes every transmitted frame
+ * to the output capture. TAP mode runs in real time; the frames sent are
+ * also written to the output capture if one is given.
+ *
+ * Build:
+ *   gcc -Wall -I../oled_periph/src -o netsim netsim.c \
+ *       ../oled_periph/src/net.c ../oled_periph/src/telem.c
+ *
+ * Use:
+ *   ./netsim -r in.pcap -w out.pcap
+ *
+ *   ip tuntap add dev tap0 mode tap user $USER
+ *   ip addr add 192.168.50.1/24 dev tap0 && ip link set tap0 up
+ *   ./netsim -t tap0 &
+ *   ping 192.168.50.10
+ *   socat -u UDP-RECV:5005 - | ./telemdump
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <net/if.h>
+#include <linux/if_tun.h>
+#endif
+#include "netif.h"
+#include "net.h"
+#include "telem.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define FRAME_BUF_SIZE  1536
+#define ETH_MIN_FRAME   60      /* without CRC, the MAC pads to this */
+
+#define PCAP_MAGIC      0xA1B2C3D4
+#define PCAP_MAGIC_NS   0xA1B23C4D
+#define PCAP_LINK_ETH   1
+
+#define TELEM_PERIOD_MS 50
+#define ECHO_PORT       7
+
+/* EMAC hash filter: bits [28:23] of the Ethernet CRC of the address */
+#define HASH_INDEX(crc) (((crc) >> 23) & 0x3F)
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static const uint8_t simMac[6] = { 0x02, 0x00, 0x00, 0x00, 0x01, 0x00 };
+
+static uint8_t rxBuf[FRAME_BUF_SIZE];
+static uint32_t rxLen = 0;
+static uint8_t rxFull = 0;
+static uint8_t txBuf[FRAME_BUF_SIZE];
+
+static uint64_t hashTable = 0;
+static uint32_t filtered = 0;
+
+static FILE *pcapOut = NULL;
+static int tapFd = -1;
+
+static uint32_t simTicks = 0;
+static telem_state_t telemState;
+static uint32_t collector = NET_IP(192, 168, 50, 1);
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static uint32_t getTicks(void)
+{
+    return simTicks;
+}
+
+static int parseIp(const char *s, uint32_t *ip)
+{
+    unsigned a = 0, b = 0, c = 0, d = 0;
+
+    if (sscanf(s, "%u.%u.%u.%u", &a, &b, &c, &d) != 4
+            || a > 255 || b > 255 || c > 255 || d > 255) {
+        return 0;
+    }
+    *ip = NET_IP(a, b, c, d);
+    return 1;
+}
+
+static void pcapWriteHeader(FILE *f)
+{
+    uint32_t hdr[6] = { PCAP_MAGIC, 0x00040002, 0, 0, FRAME_BUF_SIZE,
+            PCAP_LINK_ETH };
+
+    fwrite(hdr, sizeof(hdr), 1, f);
+}
+
+static void pcapWriteFrame(FILE *f, const uint8_t *frame, uint32_t len)
+{
+    uint32_t rec[4];
+
+    rec[0] = simTicks / 1000;
+    rec[1] = (simTicks % 1000) * 1000;
+    rec[2] = len;
+    rec[3] = len;
+    fwrite(rec, sizeof(rec), 1, f);
+    fwrite(frame, len, 1, f);
+}
+
+static uint32_t swap32(uint32_t v)
+{
+    return (v >> 24) | ((v >> 8) & 0xFF00) | ((v << 8) & 0xFF0000) | (v << 24);
+}
+
+/*
+ * Same CRC as emac_CRCCalc() in lpc17xx_emac.c, nibble at a time
+ */
+static uint32_t hashCrc(const uint8_t *p, uint32_t len)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    uint32_t b = 0;
+    uint32_t i = 0;
+    uint32_t j = 0;
+
+    for (i = 0; i < len; i++) {
+        b = p[i];
+        for (j = 0; j < 2; j++) {
+            crc = (crc << 4)
+                    ^ ((((crc >> 28) ^ (b >> 3)) & 1) ? 0x04C11DB7 : 0)
+                    ^ ((((crc >> 29) ^ (b >> 2)) & 1) ? 0x09823B6E : 0)
+                    ^ ((((crc >> 30) ^ (b >> 1)) & 1) ? 0x130476DC : 0)
+                    ^ ((((crc >> 31) ^ b) & 1) ? 0x2608EDB8 : 0);
+            b >>= 4;
+        }
+    }
+    return crc;
+}
+
+/*
+ * Receive filter as set up by netif_emac.c: perfect match, broadcast and
+ * multicast hash
+ */
+static uint8_t filterPass(const uint8_t *f)
+{
+    static const uint8_t bcast[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+    if (memcmp(f, simMac, 6) == 0 || memcmp(f, bcast, 6) == 0) {
+        return 1;
+    }
+    if (f[0] & 0x01) {
+        return (hashTable >> HASH_INDEX(hashCrc(f, 6))) & 1;
+    }
+    return 0;
+}
+
+static void sendTelemetry(void)
+{
+    telem_sample_t s;
+    uint8_t *payload = NULL;
+
+    /* a slow temperature swing, enough to exercise the delta frames */
+    s.uptime = simTicks;
+    s.temp = (int16_t)(245 + (int32_t)((simTicks / 1000) % 20) - 10);
+    s.lux = (uint16_t)(100 + (simTicks / 100) % 50);
+    s.duty = 650;
+    s.rpm = 1950;
+    s.accX = 0;
+    s.accY = 0;
+    s.accZ = 64;
+
+    payload = net_udpBegin(collector, TELEM_UDP_PORT, TELEM_UDP_PORT);
+    if (payload == NULL) {
+        /* the collector decodes deltas, restart from a key frame */
+        telem_forceKey(&telemState);
+        return;
+    }
+    net_udpSend(telem_encode(&telemState, &s, payload));
+}
+
+static void groupHandler(uint32_t srcIp, uint16_t srcPort,
+        const uint8_t *data, uint32_t len)
+{
+    fprintf(stderr, "%u.%03u group datagram from %u.%u.%u.%u len %u\n",
+            simTicks / 1000, simTicks % 1000,
+            srcIp >> 24, (srcIp >> 16) & 0xFF, (srcIp >> 8) & 0xFF,
+            srcIp & 0xFF, len);
+}
+
+static void echoHandler(uint32_t srcIp, uint16_t srcPort,
+        const uint8_t *data, uint32_t len)
+{
+    uint8_t *payload = NULL;
+
+    fprintf(stderr, "%u.%03u udp %u.%u.%u.%u:%u len %u\n",
+            simTicks / 1000, simTicks % 1000,
+            srcIp >> 24, (srcIp >> 16) & 0xFF, (srcIp >> 8) & 0xFF,
+            srcIp & 0xFF, srcPort, len);
+
+    payload = net_udpBegin(srcIp, srcPort, ECHO_PORT);
+    if (payload != NULL) {
+        memcpy(payload, data, len);
+        net_udpSend(len);
+    }
+}
+
+/*
+ * Advance the clock to 'now', sending the telemetry frames due on the way
+ */
+static void runUntil(uint32_t now)
+{
+    static uint32_t lastTelemetry = 0;
+
+    while ((int32_t)(now - simTicks) > 0) {
+        simTicks++;
+        if (simTicks - lastTelemetry >= TELEM_PERIOD_MS) {
+            lastTelemetry = simTicks;
+            sendTelemetry();
+        }
+    }
+}
+
+static int replay(const char *path)
+{
+    FILE *in = fopen(path, "rb");
+    uint32_t hdr[6];
+    uint32_t rec[4];
+    uint8_t swapped = 0;
+    uint32_t usPerTick = 1000;
+    uint32_t first = 0;
+    uint8_t haveFirst = 0;
+    uint64_t t = 0;
+    uint32_t i = 0;
+
+    if (in == NULL) {
+        perror(path);
+        return 1;
+    }
+    if (fread(hdr, sizeof(hdr), 1, in) != 1) {
+        fprintf(stderr, "%s: not a pcap file\n", path);
+        fclose(in);
+        return 1;
+    }
+    if (hdr[0] == swap32(PCAP_MAGIC) || hdr[0] == swap32(PCAP_MAGIC_NS)) {
+        swapped = 1;
+        for (i = 0; i < 6; i++) {
+            hdr[i] = swap32(hdr[i]);
+        }
+    }
+    if ((hdr[0] != PCAP_MAGIC && hdr[0] != PCAP_MAGIC_NS)
+            || hdr[5] != PCAP_LINK_ETH) {
+        fprintf(stderr, "%s: not an Ethernet pcap file\n", path);
+        fclose(in);
+        return 1;
+    }
+    if (hdr[0] == PCAP_MAGIC_NS) {
+        usPerTick = 1000000;
+    }
+
+    while (fread(rec, sizeof(rec), 1, in) == 1) {
+        if (swapped) {
+            for (i = 0; i < 4; i++) {
+                rec[i] = swap32(rec[i]);
+            }
+        }
+        if (rec[2] > sizeof(rxBuf)) {
+            fprintf(stderr, "%s: frame too long, skipped\n", path);
+            fseek(in, rec[2], SEEK_CUR);
+            continue;
+        }
+        if (fread(rxBuf, rec[2], 1, in) != 1) {
+            break;
+        }
+
+        t = (uint64_t)rec[0] * 1000 + rec[1] / usPerTick;
+        if (!haveFirst) {
+            first = (uint32_t)t;
+            haveFirst = 1;
+        }
+        runUntil((uint32_t)t - first);
+
+        rxLen = rec[2];
+        rxFull = 1;
+        net_poll();
+    }
+
+    fclose(in);
+    return 0;
+}
+
+#ifdef __linux__
+static uint32_t monoMs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static int tap(const char *name)
+{
+    struct ifreq ifr;
+    struct pollfd pfd;
+    uint32_t start = 0;
+    ssize_t n = 0;
+
+    tapFd = open("/dev/net/tun", O_RDWR);
+    if (tapFd < 0) {
+        perror("/dev/net/tun");
+        return 1;
+    }
+    memset(&ifr, 0, sizeof(ifr));
+    ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+    strncpy(ifr.ifr_name, name, IFNAMSIZ - 1);
+    if (ioctl(tapFd, TUNSETIFF, &ifr) < 0) {
+        perror(name);
+        close(tapFd);
+        return 1;
+    }
+
+    start = monoMs();
+    pfd.fd = tapFd;
+    pfd.events = POLLIN;
+    while (1) {
+        if (poll(&pfd, 1, 1) > 0) {
+            n = read(tapFd, rxBuf, sizeof(rxBuf));
+            if (n > 0) {
+                rxLen = (uint32_t)n;
+                rxFull = 1;
+            }
+        }
+        runUntil(monoMs() - start);
+        net_poll();
+    }
+    return 0;
+}
+#endif
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+uint8_t netif_init(const uint8_t *mac)
+{
+    return 1;
+}
+
+uint8_t *netif_rxFrame(uint32_t *len)
+{
+    if (!rxFull) {
+        return NULL;
+    }
+    if (rxLen < 6 || !filterPass(rxBuf)) {
+        filtered++;
+        rxFull = 0;
+        return NULL;
+    }
+    *len = rxLen;
+    return rxBuf;
+}
+
+void netif_rxRelease(void)
+{
+    rxFull = 0;
+}
+
+uint8_t *netif_txFrame(void)
+{
+    return txBuf;
+}
+
+void netif_setMulticast(const uint8_t *mac, uint8_t enable)
+{
+    uint64_t bit = (uint64_t)1 << HASH_INDEX(hashCrc(mac, 6));
+
+    if (enable) {
+        hashTable |= bit;
+    }
+    else {
+        hashTable &= ~bit;
+    }
+}
+
+void netif_setFilterAudit(uint8_t enable)
+{
+    /* the emulated filter always counts */
+}
+
+uint32_t netif_getFiltered(void)
+{
+    return filtered;
+}
+
+void netif_txSend(uint32_t len)
+{
+    if (len < ETH_MIN_FRAME) {
+        memset(&txBuf[len], 0, ETH_MIN_FRAME - len);
+        len = ETH_MIN_FRAME;
+    }
+    if (pcapOut != NULL) {
+        pcapWriteFrame(pcapOut, txBuf, len);
+    }
+#ifdef __linux__
+    if (tapFd >= 0 && write(tapFd, txBuf, len) < 0) {
+        perror("tap write");
+    }
+#endif
+}
+
+int main(int argc, char **argv)
+{
+    const char *replayPath = NULL;
+    const char *tapName = NULL;
+    const char *outPath = NULL;
+    uint32_t ip = NET_IP(192, 168, 50, 10);
+    net_stats_t st;
+    int ret = 0;
+    int i = 0;
+
+    for (i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-r") == 0) {
+            replayPath = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "-t") == 0) {
+            tapName = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "-w") == 0) {
+            outPath = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "-a") == 0 && parseIp(argv[i + 1], &ip)) {
+        }
+        else if (strcmp(argv[i], "-c") == 0
+                && parseIp(argv[i + 1], &collector)) {
+        }
+        else {
+            break;
+        }
+    }
+    if (i != argc || (replayPath == NULL) == (tapName == NULL)) {
+        fprintf(stderr, "usage: %s -r in.pcap | -t tapN [-w out.pcap]"
+                " [-a ip] [-c collector]\n", argv[0]);
+        return 2;
+    }
+
+    if (outPath != NULL) {
+        pcapOut = fopen(outPath, "wb");
+        if (pcapOut == NULL) {
+            perror(outPath);
+            return 1;
+        }
+        pcapWriteHeader(pcapOut);
+    }
+
+    netif_init(simMac);
+    net_init(simMac, ip, NET_IP(255, 255, 255, 0), 0, &getTicks);
+    net_udpBind(ECHO_PORT, &echoHandler);
+    net_udpBind(NET_PORT_CONFIG, &groupHandler);
+    net_udpBind(NET_PORT_TIME, &groupHandler);
+    net_joinGroup(NET_GROUP_CONFIG);
+    net_joinGroup(NET_GROUP_TIME);
+    telem_initState(&telemState);
+
+    if (replayPath != NULL) {
+        ret = replay(replayPath);
+    }
+    else {
+#ifdef __linux__
+        ret = tap(tapName);
+#else
+        fprintf(stderr, "TAP mode needs Linux\n");
+        ret = 1;
+#endif
+    }
+
+    net_getStats(&st);
+    fprintf(stderr, "rx %u ignored %u errors %u, filtered %u hash_miss %u,"
+            " tx %u busy %u arp_miss %u\n",
+            st.rxFrames, st.rxIgnored, st.rxErrors, st.rxFiltered,
+            st.rxHashMiss, st.txFrames, st.txBusy, st.arpMiss);
+
+    if (pcapOut != NULL) {
+        fclose(pcapOut);
+    }
+    return ret;
+}
@@ -0,0 +1,126 @@
+/*****************************************************************************
+ *   telemdump.c:  Host side decoder for the binary telemetry stream
+ *
+ ******************************************************************************/
+
+/*
+ * NOTE: Reads the raw byte stream from a file or a serial device (stdin
+ * when no file is given), splits it on 0 delimiters and prints one CSV line
+ * per decoded frame. Frame errors are counted and reported on stderr.
+ *
+ * Build:
+ *   gcc -Wall -I../oled_periph/src -o telemdump telemdump.c \
+ *       ../oled_periph/src/telem.c
+ *
+ * Use:
+ *   stty -F /dev/ttyUSB0 115200 raw && ./telemdump /dev/ttyUSB0
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <stdio.h>
+#include "telem.h"
+
+/******************************************************************************
+ * Defines and typedefs
+ *****************************************************************************/
+
+#define NUM_ERRORS 5
+
+/******************************************************************************
+ * Local variables
+ *****************************************************************************/
+
+static const char *errorNames[NUM_ERRORS] = {
+    "length", "cobs", "crc", "version", "sync"
+};
+
+static unsigned long errors[NUM_ERRORS];
+static unsigned long frames = 0;
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+static void handleFrame(telem_state_t *st, const uint8_t *buf, uint32_t len)
+{
+    telem_sample_t s;
+    int ret = 0;
+    int t = 0;
+
+    if (len == 0) {
+        return;
+    }
+
+    ret = telem_decode(st, buf, len, &s);
+    if (ret != TELEM_OK) {
+        errors[-ret - 1]++;
+        return;
+    }
+
+    frames++;
+    t = (s.temp < 0) ? -s.temp : s.temp;
+    printf("%lu,%u,%s%d.%d,%u,%u,%u,%d,%d,%d\n",
+            (unsigned long)s.uptime, st->seq,
+            (s.temp < 0) ? "-" : "", t / 10, t % 10,
+            s.lux, s.duty, s.rpm, s.accX, s.accY, s.accZ);
+    fflush(stdout);
+}
+
+/******************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+int main(int argc, char **argv)
+{
+    telem_state_t st;
+    uint8_t buf[TELEM_FRAME_MAX];
+    uint32_t len = 0;
+    uint8_t overflow = 0;
+    FILE *in = stdin;
+    int c = 0;
+    int i = 0;
+
+    if (argc > 1) {
+        in = fopen(argv[1], "rb");
+        if (in == NULL) {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    telem_initState(&st);
+    printf("uptime_ms,seq,temp_c,lux,duty,rpm,acc_x,acc_y,acc_z\n");
+
+    while ((c = fgetc(in)) != EOF) {
+        if (c == 0) {
+            if (overflow) {
+                errors[-TELEM_ERR_LEN - 1]++;
+            }
+            else {
+                handleFrame(&st, buf, len);
+            }
+            len = 0;
+            overflow = 0;
+        }
+        else if (len < sizeof(buf)) {
+            buf[len++] = (uint8_t)c;
+        }
+        else {
+            overflow = 1;
+        }
+    }
+
+    fprintf(stderr, "frames: %lu", frames);
+    for (i = 0; i < NUM_ERRORS; i++) {
+        fprintf(stderr, ", %s errors: %lu", errorNames[i], errors[i]);
+    }
+    fprintf(stderr, "\n");
+
+    if (in != stdin) {
+        fclose(in);
+    }
+    return 0;
+}